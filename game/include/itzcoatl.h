@@ -84,6 +84,7 @@ public:
   static constexpr int longestPossibleCombo       {7};
 
   static constexpr float gameOverPeriod_s        {3.f};
+  static constexpr float sceneFadeDuration_s     {0.25f};
 
   ////////////////////////////////////////////////////////////////////////////////////////////////
   // CONTROLS       
@@ -388,6 +389,16 @@ public:
     "click"
   };
 
+  //
+  // Score beeps come in rapid bursts when chaining combos so are limited to a few overlapping
+  // instances, the oldest of which is restarted, and a short cooldown.
+  //
+  static constexpr std::array<sfx::SoundPolicy, SFX_COUNT> soundEffectPolicies {{
+    //  priority  maxInstances  stealOldest  cooldown_ms
+    {   1,        4,            true,        30 },
+    {   2,        2,            true,        0  }
+  }};
+
   ////////////////////////////////////////////////////////////////////////////////////////////////
   // MUSIC         
   ////////////////////////////////////////////////////////////////////////////////////////////////
@@ -18,7 +18,7 @@ public:
   bool onInit();
   void onEnter();
   void onUpdate(double now, float dt);
-  void onDraw(double now, float dt, const std::vector<gfx::ScreenID_t>& screens);
+  void onDraw(double now, float dt, float alpha, const std::vector<gfx::ScreenID_t>& screens);
   void onExit();
 
   std::string getName() const {return name;}
@@ -78,7 +78,7 @@ private:
   void drawForeground();
   void drawTongue(){}
   void drawSnake(gfx::ScreenID_t screenid);
-  void drawSmoothSnake(gfx::ScreenID_t screenid);
+  void drawSmoothSnake(gfx::ScreenID_t screenid, float alpha);
   void drawNuggets(gfx::ScreenID_t screenid);
 
   bool havePossibleSameCombo();
@@ -141,6 +141,7 @@ private:
   int _numNuggetsInWorld;
 
   float _stepClock_s;
+  float _updatePeriod_s;
   float _gameOverClock_s;
 
   std::array<Snake::NuggetClassID, Snake::longestPossibleCombo> _eatHistory;
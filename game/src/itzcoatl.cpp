@@ -1,5 +1,6 @@
 #include <cassert>
 #include "pxr_gfx.h"
+#include "pxr_jobs.h"
 
 #include "../include/itzcoatl.h"
 #include "../include/play_scene.h"
@@ -72,10 +73,11 @@ sfx::MusicSequence_t Snake::getMusicSequence(MusicSequenceID sequenceID)
   const MusicIDSequence_t& idSequence = musicIDSequences[sequenceID];
   sfx::MusicSequence_t sequence {};
   for(const auto& node : idSequence){
+    float playDuration_ms = node._playDuration_s * 1000.f;
     sequence.push_back({
       getMusicLoopKey(node._musicID),
       static_cast<int>(node._fadeInDuration_s * 1000),
-      static_cast<int>(node._playDuration_s * 1000),
+      (playDuration_ms < sfx::PLAY_MUSIC_FOREVER) ? static_cast<int>(playDuration_ms) : sfx::PLAY_MUSIC_FOREVER,
       static_cast<int>(node._fadeOutDuration_s * 1000)
     });
   }
@@ -95,6 +97,10 @@ void Snake::addNuggetEaten(NuggetClassID classID, int count)
 
 void Snake::loadSpritesheets()
 {
+  jobs::parallelFor(0, SSID_COUNT, 1, [](int first, int last){
+    for(int ssid {first}; ssid < last; ++ssid)
+      gfx::prefetchSpritesheet(spritesheetNames[ssid]);
+  });
   for(int ssid {0}; ssid < SSID_COUNT; ++ssid)
     _spritesheetKeys[ssid] = gfx::loadSpritesheet(spritesheetNames[ssid]);
 }
@@ -107,8 +113,10 @@ void Snake::loadFonts()
 
 void Snake::loadSoundEffects()
 {
-  for(int sfxid {0}; sfxid < SFX_COUNT; ++sfxid)
+  for(int sfxid {0}; sfxid < SFX_COUNT; ++sfxid){
     _soundEffectKeys[sfxid] = sfx::loadSoundWAV(soundEffectNames[sfxid]);
+    sfx::setSoundPolicy(_soundEffectKeys[sfxid], soundEffectPolicies[sfxid]);
+  }
 }
 
 void Snake::loadMusicLoops()
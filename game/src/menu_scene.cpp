@@ -1,6 +1,7 @@
 #include <cassert>
 #include "pxr_mathutil.h"
 #include "pxr_hud.h"
+#include "pxr_profile.h"
 #include "../include/menu_scene.h"
 #include "../include/play_scene.h"
 
@@ -183,6 +184,7 @@ void MenuScene::onEnter()
 
 void MenuScene::onUpdate(double now, float dt)
 {
+  PXR_PROFILE_ZONE("MenuScene::onUpdate");
   handleInput();
   updateDisplay(dt);
   _southwardSnake.update(dt);
@@ -190,8 +192,9 @@ void MenuScene::onUpdate(double now, float dt)
   _hud->onUpdate(dt);
 }
 
-void MenuScene::onDraw(double now, float dt, const std::vector<gfx::ScreenID_t>& screens)
+void MenuScene::onDraw(double now, float dt, float alpha, const std::vector<gfx::ScreenID_t>& screens)
 {
+  PXR_PROFILE_ZONE("MenuScene::onDraw");
   gfx::clearScreenTransparent(screens[Snake::SCREEN_STAGE]);
   _southwardSnake.draw(screens[Snake::SCREEN_STAGE]);
   _northwardSnake.draw(screens[Snake::SCREEN_STAGE]);
@@ -245,7 +248,7 @@ void MenuScene::handleInput()
 
 void MenuScene::onPlayButtonPressed()
 {
-  _sk->switchScene(PlayScene::name);
+  _sk->requestScene(PlayScene::name, Snake::sceneFadeDuration_s);
 }
 
 void MenuScene::onSnakeButtonPressed()
@@ -4,6 +4,7 @@
 #include "pxr_mathutil.h"
 #include "pxr_rand.h"
 #include "pxr_gfx.h"
+#include "pxr_profile.h"
 
 #include <iostream>
 #include <menu_scene.h>
@@ -16,8 +17,12 @@ PlayScene::PlayScene(pxr::Game* owner) :
   _snakeLength{0},
   _nextMoveDirection{Snake::WEST},
   _currentMoveDirection{Snake::WEST},
+  _isSnakeSmoothMover{false},
   _stepClock_s{0.f},
-  _isSnakeSmoothMover{false}
+  _updatePeriod_s{0.f},
+  _speedClock_s{0.f},
+  _currentSpeedBonusAsInt{0},
+  _speedBonusTableIndex{0}
 {}
 
 bool PlayScene::onInit()
@@ -41,6 +46,8 @@ void PlayScene::onEnter()
 
 void PlayScene::onUpdate(double now, float dt)
 {
+  PXR_PROFILE_ZONE("PlayScene::onUpdate");
+  _updatePeriod_s = dt;
   switch(_currentState){
     case State::PLAYING:
       onUpdatePlaying(now, dt);
@@ -59,14 +66,15 @@ void PlayScene::onUpdate(double now, float dt)
     switchState();
 }
 
-void PlayScene::onDraw(double now, float dt, const std::vector<gfx::ScreenID_t>& screens)
+void PlayScene::onDraw(double now, float dt, float alpha, const std::vector<gfx::ScreenID_t>& screens)
 {
+  PXR_PROFILE_ZONE("PlayScene::onDraw");
   gfx::clearScreenTransparent(screens[Snake::SCREEN_STAGE]);
 
   drawNuggets(screens[Snake::SCREEN_STAGE]);
 
   if(_isSnakeSmoothMover)
-    drawSmoothSnake(screens[Snake::SCREEN_STAGE]);
+    drawSmoothSnake(screens[Snake::SCREEN_STAGE], alpha);
   else
     drawSnake(screens[Snake::SCREEN_STAGE]);
 
@@ -151,7 +159,7 @@ void PlayScene::onUpdateGameOver(double now, float dt)
 {
   _gameOverClock_s += dt;
   if(_gameOverClock_s > Snake::gameOverPeriod_s){
-    _sk->switchScene(MenuScene::name);
+    _sk->requestScene(MenuScene::name, Snake::sceneFadeDuration_s);
   }
 }
 
@@ -357,6 +365,7 @@ void PlayScene::growSnake()
 
 void PlayScene::spawnNugget()
 {
+  PXR_PROFILE_ZONE("PlayScene::spawnNugget");
   assert(_numNuggetsInWorld < Snake::maxNuggetsInWorld);
 
   int choice = rand::uniformSignedInt(
@@ -506,6 +515,7 @@ void PlayScene::updateSmoothSnakeBlockSpriteIDs()
 
 bool PlayScene::collideSnakeNuggets()
 {
+  PXR_PROFILE_ZONE("PlayScene::collideSnakeNuggets");
   for(auto& nugget : _nuggets){
     if(!nugget._isAlive) continue;
     bool collision = _snake[SNAKE_HEAD_BLOCK]._row == nugget._row &&
@@ -521,6 +531,7 @@ bool PlayScene::collideSnakeNuggets()
 
 bool PlayScene::collideSnakeSnake()
 {
+  PXR_PROFILE_ZONE("PlayScene::collideSnakeSnake");
   int headRow {_snake[SNAKE_HEAD_BLOCK]._row};
   int headCol {_snake[SNAKE_HEAD_BLOCK]._col};
   for(int block{SNAKE_HEAD_BLOCK + 1}; block < _snakeLength; ++block){
@@ -768,15 +779,24 @@ void PlayScene::drawSnake(gfx::ScreenID_t screenid)
   }
 }
 
-void PlayScene::drawSmoothSnake(gfx::ScreenID_t screenid)
+void PlayScene::drawSmoothSnake(gfx::ScreenID_t screenid, float alpha)
 {
+  //
+  // The step clock only advances on update ticks; the alpha extrapolates it on to the time of
+  // the draw (clamped to the end of the step) so the snake glides rather than moving in update
+  // sized jumps.
+  //
+  float stepClock_s = _stepClock_s;
+  if(_currentState == State::PLAYING)
+    stepClock_s += alpha * _updatePeriod_s;
+  float t = std::min(stepClock_s / Snake::stepPeriod_s, 1.f);
+
   for(int block {_snakeLength - 1}; block >= SNAKE_HEAD_BLOCK; --block){
     Vector2i position {
       Snake::boardPosition._x + (_snake[block]._col * Snake::blockSize_rx),
       Snake::boardPosition._y + (_snake[block]._row * Snake::blockSize_rx)
     };
 
-    float t = _stepClock_s / Snake::stepPeriod_s;
     float limit = static_cast<float>(Snake::blockSize_rx) - 1.f;
     switch(_snake[block]._currentMoveDirection){
       case Snake::NORTH:
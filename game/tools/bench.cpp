@@ -0,0 +1,400 @@
+//
+// Benchmarks the game's scenes headless: boots the engine without a window or audio device
+// (see Engine::initializeHeadless) and drives it for a scripted number of ticks as fast as it
+// can go, timing each phase of every tick and counting the heap allocations each makes. The
+// results are written as json so runs can be compared by script.
+//
+// usage: pxr_bench <script> [--warmup <runs>] [--repetitions <runs>] [--seed <seed>]
+//                           [--output <results.json>]
+//
+// Run from the game directory so assets and rc files load from their usual paths. Results go
+// to stdout unless an output file is given. Defaults are 1 warmup run, 5 repetitions and seed
+// 1; the seed pins the rand generator, which is reseeded at the start of every run, so every
+// run of a script plays out the same.
+//
+// The script holds one command per line; blank lines and lines starting with '#' are ignored:
+//
+//    ticks <count>                 the number of ticks in a run (default 600).
+//    <tick> scene <name>           switches to a scene, menu_scene or play_scene.
+//    <tick> down <key>             presses a key, named as its input::KeyCode, e.g. KEY_UP.
+//    <tick> up <key>               releases a key.
+//    <tick> tap <key>              presses a key and releases it on the next tick.
+//
+// Commands run before the update of their tick; ticks count from 0 in every run. Runs follow
+// on from one another in one game, so a script should start with a scene command at tick 0 to
+// start every run from the same state.
+//
+// Every tick is an update, an audio mix of a tick's worth of frames and a draw; each is a
+// phase, timed and reported separately along with the tick as a whole:
+//
+//    PHASE      TIMES
+//    -----      -----
+//
+//    update     Engine::stepUpdate; the scene and hud updates, input and sfx.
+//    audio      sfx::advanceOffline; mixing the sounds and music the update played.
+//    draw       Engine::stepDraw; rasterizing the screens (nothing is presented).
+//    tick       All of the above.
+//
+// Allocations are those through operator new (so std containers, but not SDL's mallocs).
+//
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <numeric>
+#include <chrono>
+#include <atomic>
+#include <cstdlib>
+#include <cmath>
+#include <new>
+#include "pxr_engine.h"
+#include "pxr_input.h"
+#include "pxr_sfx.h"
+#include "pxr_rand.h"
+#include "../include/itzcoatl.h"
+#include "../include/menu_scene.h"
+#include "../include/play_scene.h"
+
+using namespace pxr;
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+// ALLOCATION COUNTING
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+static std::atomic<int64_t> allocations {0};
+static std::atomic<int64_t> allocatedBytes {0};
+
+void* operator new(std::size_t bytes)
+{
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  allocatedBytes.fetch_add(static_cast<int64_t>(bytes), std::memory_order_relaxed);
+  void* p = std::malloc(bytes == 0 ? 1 : bytes);
+  if(p == nullptr)
+    throw std::bad_alloc{};
+  return p;
+}
+
+void operator delete(void* p) noexcept
+{
+  std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+  std::free(p);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+// SCRIPT
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+struct Command
+{
+  int _tick;
+  std::string _verb;
+  std::string _arg;
+};
+
+static std::vector<Command> commands;
+static int ticksPerRun {600};
+
+static bool loadScript(const std::string& scriptpath)
+{
+  std::ifstream script {scriptpath};
+  if(!script){
+    std::cerr << "failed to open script " << scriptpath << std::endl;
+    return false;
+  }
+  std::string line {};
+  int lineNo {0};
+  while(std::getline(script, line)){
+    ++lineNo;
+    std::istringstream words {line};
+    std::string first {};
+    if(!(words >> first) || first[0] == '#')
+      continue;
+    if(first == "ticks"){
+      words >> ticksPerRun;
+      continue;
+    }
+    Command command {};
+    command._tick = std::atoi(first.c_str());
+    words >> command._verb >> command._arg;
+    bool isKeyVerb = (command._verb == "down" || command._verb == "up" || command._verb == "tap");
+    bool isValid = (command._verb == "scene")
+      ? (command._arg == MenuScene::name || command._arg == PlayScene::name)
+      : (isKeyVerb && input::keyStringToKeyCode(command._arg) != input::KEY_COUNT);
+    if(!isValid){
+      std::cerr << "invalid command on line " << lineNo << " of " << scriptpath << std::endl;
+      return false;
+    }
+    commands.push_back(std::move(command));
+  }
+  std::stable_sort(commands.begin(), commands.end(), [](const Command& a, const Command& b){
+    return a._tick < b._tick;
+  });
+  return true;
+}
+
+//
+// Runs the commands of a tick; taps release their keys the tick after.
+//
+static void runCommands(int tick, size_t& nextCommand, Game& game, std::vector<input::KeyCode>& tapped)
+{
+  for(input::KeyCode key : tapped)
+    input::onKey(key, false);
+  tapped.clear();
+
+  while(nextCommand < commands.size() && commands[nextCommand]._tick <= tick){
+    const Command& command = commands[nextCommand++];
+    if(command._verb == "scene"){
+      game.switchScene(command._arg);
+      continue;
+    }
+    input::KeyCode key = input::keyStringToKeyCode(command._arg);
+    input::onKey(key, command._verb != "up");
+    if(command._verb == "tap")
+      tapped.push_back(key);
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+// MEASUREMENT
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+enum Phase
+{
+  PHASE_UPDATE,
+  PHASE_AUDIO,
+  PHASE_DRAW,
+  PHASE_TICK,
+  PHASE_COUNT
+};
+
+static constexpr std::array<const char*, PHASE_COUNT> phaseNames {"update", "audio", "draw", "tick"};
+
+struct PhaseSamples
+{
+  std::vector<double> _durations_ms;
+  int64_t _allocations;
+  int64_t _allocatedBytes;
+};
+
+struct PhaseResult
+{
+  double _mean_ms;
+  double _p50_ms;
+  double _p99_ms;
+  double _max_ms;
+  double _perSecond;
+  int64_t _allocations;
+  int64_t _allocatedBytes;
+};
+
+struct RunResult
+{
+  double _wall_ms;
+  std::array<PhaseResult, PHASE_COUNT> _phases;
+};
+
+using Clock_t = std::chrono::steady_clock;
+
+//
+// Times a phase and counts its allocations into its samples.
+//
+template<typename F>
+static void measure(PhaseSamples& samples, F&& phase)
+{
+  int64_t allocationsBefore = allocations.load(std::memory_order_relaxed);
+  int64_t bytesBefore = allocatedBytes.load(std::memory_order_relaxed);
+  auto start = Clock_t::now();
+  phase();
+  auto end = Clock_t::now();
+  samples._durations_ms.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+  samples._allocations += allocations.load(std::memory_order_relaxed) - allocationsBefore;
+  samples._allocatedBytes += allocatedBytes.load(std::memory_order_relaxed) - bytesBefore;
+}
+
+//
+// Nearest rank.
+//
+static double calculatePercentile(const std::vector<double>& sorted, double p)
+{
+  int rank = static_cast<int>(std::ceil(p * sorted.size())) - 1;
+  return sorted[std::clamp(rank, 0, static_cast<int>(sorted.size()) - 1)];
+}
+
+static PhaseResult summarize(PhaseSamples& samples)
+{
+  std::vector<double>& sorted = samples._durations_ms;
+  std::sort(sorted.begin(), sorted.end());
+  PhaseResult result {};
+  result._mean_ms = std::accumulate(sorted.begin(), sorted.end(), 0.0) / sorted.size();
+  result._p50_ms = calculatePercentile(sorted, 0.50);
+  result._p99_ms = calculatePercentile(sorted, 0.99);
+  result._max_ms = sorted.back();
+  result._perSecond = (result._mean_ms > 0.0) ? 1000.0 / result._mean_ms : 0.0;
+  result._allocations = samples._allocations;
+  result._allocatedBytes = samples._allocatedBytes;
+  return result;
+}
+
+static RunResult run(Engine& engine, Game& game, uint32_t seed)
+{
+  rand::generator.seed(static_cast<rand::xorwow::result_type>(seed));
+
+  std::array<PhaseSamples, PHASE_COUNT> samples {};
+  for(auto& phase : samples)
+    phase._durations_ms.reserve(ticksPerRun);
+
+  float tickPeriod_s = engine.getTickPeriodSeconds();
+  size_t nextCommand {0};
+  std::vector<input::KeyCode> tapped {};
+  tapped.reserve(input::KEY_COUNT);
+
+  auto runStart = Clock_t::now();
+  for(int tick = 0; tick < ticksPerRun; ++tick){
+    runCommands(tick, nextCommand, game, tapped);
+    measure(samples[PHASE_TICK], [&](){
+      measure(samples[PHASE_UPDATE], [&](){engine.stepUpdate();});
+      measure(samples[PHASE_AUDIO], [&](){sfx::advanceOffline(tickPeriod_s);});
+      measure(samples[PHASE_DRAW], [&](){engine.stepDraw();});
+    });
+  }
+  auto runEnd = Clock_t::now();
+
+  RunResult result {};
+  result._wall_ms = std::chrono::duration<double, std::milli>(runEnd - runStart).count();
+  for(int phase = 0; phase < PHASE_COUNT; ++phase)
+    result._phases[phase] = summarize(samples[phase]);
+  return result;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+// OUTPUT
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void writePhase(std::ostream& os, const PhaseResult& phase)
+{
+  os << "{\"mean_ms\": " << phase._mean_ms
+     << ", \"p50_ms\": " << phase._p50_ms
+     << ", \"p99_ms\": " << phase._p99_ms
+     << ", \"max_ms\": " << phase._max_ms
+     << ", \"per_second\": " << phase._perSecond
+     << ", \"allocations\": " << phase._allocations
+     << ", \"allocated_bytes\": " << phase._allocatedBytes
+     << ", \"allocations_per_tick\": " << static_cast<double>(phase._allocations) / ticksPerRun
+     << "}";
+}
+
+//
+// The summary takes the best (least) and median means of each phase over the repetitions; the
+// best is the least disturbed by the rest of the machine, the median the most typical. Its
+// allocations per tick are averaged over the repetitions.
+//
+static void writeResults(std::ostream& os, const std::string& scriptpath, uint32_t seed,
+                         int warmupRuns, const std::vector<RunResult>& runs, float tickPeriod_s)
+{
+  os << "{\n"
+     << "  \"script\": \"" << scriptpath << "\",\n"
+     << "  \"seed\": " << seed << ",\n"
+     << "  \"ticks\": " << ticksPerRun << ",\n"
+     << "  \"tick_period_s\": " << tickPeriod_s << ",\n"
+     << "  \"warmup\": " << warmupRuns << ",\n"
+     << "  \"repetitions\": " << runs.size() << ",\n"
+     << "  \"runs\": [\n";
+  for(size_t r = 0; r < runs.size(); ++r){
+    os << "    {\"wall_ms\": " << runs[r]._wall_ms
+       << ", \"ticks_per_second\": " << (ticksPerRun * 1000.0 / runs[r]._wall_ms)
+       << ", \"phases\": {\n";
+    for(int phase = 0; phase < PHASE_COUNT; ++phase){
+      os << "      \"" << phaseNames[phase] << "\": ";
+      writePhase(os, runs[r]._phases[phase]);
+      os << ((phase < PHASE_COUNT - 1) ? ",\n" : "\n");
+    }
+    os << "    }}" << ((r < runs.size() - 1) ? ",\n" : "\n");
+  }
+  os << "  ],\n"
+     << "  \"summary\": {\n";
+  for(int phase = 0; phase < PHASE_COUNT; ++phase){
+    std::vector<double> means {};
+    int64_t allocationsTotal {0};
+    for(const RunResult& run : runs){
+      means.push_back(run._phases[phase]._mean_ms);
+      allocationsTotal += run._phases[phase]._allocations;
+    }
+    std::sort(means.begin(), means.end());
+    os << "    \"" << phaseNames[phase] << "\": {\"best_mean_ms\": " << means.front()
+       << ", \"median_mean_ms\": " << calculatePercentile(means, 0.5)
+       << ", \"allocations_per_tick\": "
+       << static_cast<double>(allocationsTotal) / (static_cast<double>(ticksPerRun) * runs.size())
+       << "}" << ((phase < PHASE_COUNT - 1) ? ",\n" : "\n");
+  }
+  os << "  }\n}\n";
+}
+
+int main(int argc, char* argv[])
+{
+  if(argc < 2 || argc % 2 != 0){
+    std::cerr << "usage: " << argv[0] << " <script> [--warmup <runs>] [--repetitions <runs>] "
+              << "[--seed <seed>] [--output <results.json>]" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::string scriptpath {argv[1]};
+  int warmupRuns {1};
+  int repetitions {5};
+  uint32_t seed {1};
+  std::string outpath {};
+  for(int a = 2; a + 1 < argc; a += 2){
+    std::string option {argv[a]};
+    if(option == "--warmup")
+      warmupRuns = std::max(0, std::atoi(argv[a + 1]));
+    else if(option == "--repetitions")
+      repetitions = std::max(1, std::atoi(argv[a + 1]));
+    else if(option == "--seed")
+      seed = static_cast<uint32_t>(std::strtoul(argv[a + 1], nullptr, 10));
+    else if(option == "--output")
+      outpath = argv[a + 1];
+    else{
+      std::cerr << "unknown option " << option << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  if(!loadScript(scriptpath))
+    return EXIT_FAILURE;
+  if(ticksPerRun <= 0){
+    std::cerr << "a run must have at least one tick" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  Snake* snake = new Snake{};
+  Engine engine {};
+  engine.initializeHeadless(std::unique_ptr<Snake>(snake), seed);
+
+  for(int r = 0; r < warmupRuns; ++r)
+    run(engine, *snake, seed);
+
+  std::vector<RunResult> runs {};
+  for(int r = 0; r < repetitions; ++r)
+    runs.push_back(run(engine, *snake, seed));
+
+  if(outpath.empty())
+    writeResults(std::cout, scriptpath, seed, warmupRuns, runs, engine.getTickPeriodSeconds());
+  else{
+    std::ofstream os {outpath, std::ios_base::trunc};
+    if(!os){
+      std::cerr << "failed to open " << outpath << std::endl;
+      return EXIT_FAILURE;
+    }
+    writeResults(os, scriptpath, seed, warmupRuns, runs, engine.getTickPeriodSeconds());
+  }
+
+  engine.shutdown();
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,82 @@
+#ifndef _PIXIRETRO_ADPCM_H_
+#define _PIXIRETRO_ADPCM_H_
+
+#include <cinttypes>
+
+namespace pxr
+{
+namespace io
+{
+namespace adpcm
+{
+
+//
+// IMA ADPCM codec as used in wave files (format tag 0x0011).
+//
+// Each 16-bit sample is coded as a 4-bit difference from a predicted sample, giving a 4:1
+// compression ratio. The data is coded in blocks which can be decoded independently of one
+// another, which allows random access (seeking) to any block of a stream.
+//
+// Block layout for n channels:
+//
+//    [header ch0][header ch1]...[header chn-1]   4 bytes each: int16 sample, uint8 step index,
+//                                                 uint8 reserved. The header sample is the
+//                                                 first sample of the block.
+//
+//    [4 bytes ch0][4 bytes ch1]...                 groups of 8 samples (2 per byte, low nibble
+//    [4 bytes ch0][4 bytes ch1]...                 first) for each channel in turn.
+//    ...
+//
+// Thus a block of blockAlign bytes holds 1 + ((blockAlign - 4n) * 2 / n) samples per channel.
+//
+
+static constexpr int16_t FORMAT_TAG {0x0011};
+static constexpr int BITS_PER_SAMPLE {4};
+static constexpr int BLOCK_HEADER_BYTES_PER_CHANNEL {4};
+static constexpr int MAX_CHANNELS {8};
+
+//
+// The default block size used by the encoder; larger blocks have a slightly lower overhead,
+// smaller blocks finer seeking granularity.
+//
+static constexpr int DEFAULT_BLOCK_ALIGN_PER_CHANNEL {512};
+
+//
+// The running state of the codec for a single channel.
+//
+struct ChannelState
+{
+  int _predictor = 0;
+  int _stepIndex = 0;
+};
+
+//
+// Returns the number of samples per channel held in a full block, or 0 if the block size is
+// invalid for the channel count.
+//
+int calculateSamplesPerBlock(int blockAlign, int numChannels);
+
+//
+// Returns the number of samples per channel held in a block which may be truncated (the last
+// block of a stream) to blockBytes bytes.
+//
+int calculateSamplesInBlock(int blockBytes, int numChannels);
+
+//
+// Decodes a block of blockBytes bytes to samplesInBlock interleaved 16-bit frames in dst.
+// blockBytes may be less than a full block for the last block of a stream.
+//
+void decodeBlock(const uint8_t* block, int blockBytes, int numChannels, int16_t* dst);
+
+//
+// Encodes samplesPerBlock interleaved 16-bit frames from src into a block of blockAlign bytes.
+// The states carry the step index from block to block and must be zero initialized for the
+// first block of a stream.
+//
+void encodeBlock(const int16_t* src, int blockAlign, int numChannels, ChannelState* states, uint8_t* block);
+
+} // namespace adpcm
+} // namespace io
+} // namespace pxr
+
+#endif
@@ -0,0 +1,124 @@
+#ifndef _PIXIRETRO_ARENA_H_
+#define _PIXIRETRO_ARENA_H_
+
+#include <memory_resource>
+#include <string>
+#include <vector>
+#include <cstddef>
+
+namespace pxr
+{
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// PIXIRETRO FRAME ARENA
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// A linear (bump) allocator for transient allocations, the strings and scratch containers which
+// live no longer than the frame which makes them. An allocation is a pointer bump in a block
+// the arena owns and a deallocation does nothing; everything is freed at once when the arena is
+// reset, which the engine does at the end of every frame.
+//
+// The arena is a std::pmr::memory_resource, so any allocator-aware container can use it through
+// the pmr aliases:
+//
+//    std::pmr::string line {&arena::getFrameArena()};
+//    std::pmr::vector<Vector2i> cells {&arena::getFrameArena()};
+//
+// If a frame needs more than the arena's block the excess is allocated from the upstream
+// resource (the heap) and freed by the reset, which then grows the block to cover the frame's
+// high water mark, so after the first frames of a steady state the arena never touches the heap.
+//
+// Every thread which runs a frame loop has a frame arena of its own (see getFrameArena), so
+// arenas are never shared between threads and need no locking. Nothing allocated on a frame
+// arena may outlive the frame: do not store arena memory in members, or hand it to another
+// thread.
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+class LinearArena final : public std::pmr::memory_resource
+{
+public:
+  explicit LinearArena(size_t capacity, std::pmr::memory_resource* upstream = std::pmr::new_delete_resource());
+  ~LinearArena();
+
+  LinearArena(const LinearArena&) = delete;
+  LinearArena& operator=(const LinearArena&) = delete;
+
+  //
+  // Frees everything allocated since the last reset. Grows the block if allocations overflowed
+  // it since the last reset.
+  //
+  void reset();
+
+  size_t getCapacity() const {return _capacity;}
+
+  //
+  // The bytes allocated since the last reset, including any overflow.
+  //
+  size_t getUsed() const {return _used + _overflowBytes;}
+
+  //
+  // The most bytes allocated between any two resets.
+  //
+  size_t getHighWater() const {return _highWater;}
+
+private:
+  //
+  // An allocation made upstream as it did not fit the block; the header sits at the start of
+  // the upstream allocation.
+  //
+  struct Overflow
+  {
+    Overflow* _next;
+    size_t _bytes;
+    size_t _alignment;
+  };
+
+private:
+  void* do_allocate(size_t bytes, size_t alignment) override;
+  void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+  bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+  void* allocateOverflow(size_t bytes, size_t alignment);
+  void freeOverflows();
+
+private:
+  std::pmr::memory_resource* _upstream;
+  std::byte* _block;
+  size_t _capacity;
+  size_t _used;
+  size_t _highWater;
+  Overflow* _overflows;
+  size_t _overflowBytes;
+};
+
+namespace arena
+{
+
+//
+// The initial size of every frame arena's block.
+//
+static constexpr size_t FRAME_ARENA_CAPACITY {64 * 1024};
+
+//
+// The calling thread's frame arena, made on the thread's first call.
+//
+LinearArena& getFrameArena();
+
+//
+// Resets the calling thread's frame arena; call at the end of each pass of the thread's frame
+// loop.
+//
+void resetFrame();
+
+//
+// Formats a string (printf style) on the calling thread's frame arena.
+//
+std::pmr::string formatFrameString(const char* format, ...);
+
+} // namespace arena
+} // namespace pxr
+
+#endif
@@ -35,6 +35,7 @@ public:
   const gfx::Color4u getPixel(int row, int col);
   const gfx::Color4u* getRow(int row);
   const gfx::Color4u* const* getPixels() const {return _pixels;}
+  gfx::Color4u* const* getPixels() {return _pixels;}
 
   int getWidth() const {return _size._x;}
   int getHeight() const {return _size._y;}
@@ -0,0 +1,166 @@
+#ifndef _PIXIRETRO_CACHE_H_
+#define _PIXIRETRO_CACHE_H_
+
+#include <cinttypes>
+#include <array>
+
+namespace pxr
+{
+namespace cache
+{
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// PIXIRETRO RESOURCE CACHE
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// A shared bookkeeping layer used by the resource owning modules (gfx and sfx) to keep resources
+// resident after their reference counts drop to zero. Such unreferenced resources are termed
+// 'warm'; they remain in memory so a subsequent load by name is satisfied without touching the
+// disk, e.g. when switching back and forth between scenes which load and unload their assets.
+//
+// The cache never owns the resources themselves, the modules do. The cache only tracks the
+// resident size of every resource, which resources are warm, and the order in which they became
+// warm. When the total resident size exceeds the memory budget the cache evicts warm resources
+// in least recently used (LRU) order by invoking the evictor function registered by the module
+// which owns the resource type. Referenced resources are never evicted, thus if the referenced
+// resources alone exceed the budget the budget will be exceeded.
+//
+// The lifecycle of a resource w.r.t the cache is thus:
+//
+//    onLoad -> [onHit]* -> onRelease -> (warm) -> onHit -> ... -> onRelease -> (evicted)
+//
+// Resources are identified by the pair [type, key] since each module assigns keys from its own
+// key space.
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+enum ResourceType
+{
+  RESOURCE_SPRITESHEET,
+  RESOURCE_FONT,
+  RESOURCE_SOUND,
+  RESOURCE_MUSIC,
+  RESOURCE_TYPE_COUNT
+};
+
+//
+// The names of the resource types; useful for printing stats.
+//
+static constexpr std::array<const char*, RESOURCE_TYPE_COUNT> resourceTypeNames {
+  "spritesheet",
+  "font",
+  "sound",
+  "music"
+};
+
+//
+// The type of the keys the owning modules use to identify their resources.
+//
+using Key_t = int32_t;
+
+//
+// The signiture of the functions the owning modules register to free their resources upon
+// eviction. The evictor must free the resource without calling back into this module. If the
+// resource cannot be freed right now (e.g. a sound which is still playing on a channel) the
+// evictor should return false and the cache will try the next least recently used resource.
+//
+using Evictor_t = bool (*)(Key_t key);
+
+//
+// Cache statistics, maintained for each resource type.
+//
+// PROPERTY           ROLE
+// --------           ----
+//
+// _residentBytes     Total size of all resources in memory; referenced and warm.
+//
+// _warmBytes         Size of the subset of resident resources which are warm.
+//
+// _residentCount     Number of resources in memory.
+//
+// _warmCount         Number of resources in memory which are warm.
+//
+// _hits              Number of loads satisfied by a resource already in memory.
+//
+// _misses            Number of loads which had to read and decode a resource from disk.
+//
+// _evictions         Number of warm resources freed to stay within the budget.
+//
+struct Stats
+{
+  int64_t _residentBytes = 0;
+  int64_t _warmBytes     = 0;
+  int     _residentCount = 0;
+  int     _warmCount     = 0;
+  int64_t _hits          = 0;
+  int64_t _misses        = 0;
+  int64_t _evictions     = 0;
+};
+
+static constexpr int64_t ONE_MEBIBYTE {1024 * 1024};
+static constexpr int64_t DEFAULT_BUDGET_BYTES {64 * ONE_MEBIBYTE};
+
+//
+// Must be called before the gfx and sfx modules are initialized.
+//
+void initialize(int64_t budgetBytes = DEFAULT_BUDGET_BYTES);
+
+//
+// Call after the gfx and sfx modules have shutdown. Clears all bookkeeping without invoking any
+// evictors.
+//
+void shutdown();
+
+//
+// Registers the function used to free resources of a type. Must be called by the owning module
+// before it reports its first load.
+//
+void setEvictor(ResourceType type, Evictor_t evictor);
+
+//
+// Changes the memory budget; evicts warm resources immediately if the new budget is smaller
+// than the current resident size.
+//
+void setBudget(int64_t budgetBytes);
+int64_t getBudget();
+
+//
+// Reports a resource which has just been read from disk (a miss) and the number of bytes it
+// keeps resident.
+//
+void onLoad(ResourceType type, Key_t key, int64_t bytes);
+
+//
+// Reports a load which was satisfied by a resident resource (a hit). If the resource was warm
+// it is revived and removed from the eviction order.
+//
+void onHit(ResourceType type, Key_t key);
+
+//
+// Reports that the reference count of a resource has dropped to zero. The resource becomes warm
+// and is kept resident until evicted.
+//
+void onRelease(ResourceType type, Key_t key);
+
+//
+// Returns true if the resource is resident but unreferenced.
+//
+bool isWarm(ResourceType type, Key_t key);
+
+//
+// Evicts all warm resources regardless of the budget.
+//
+void evictAll();
+
+//
+// Accessors for the cache statistics.
+//
+const Stats& getStats(ResourceType type);
+Stats getTotalStats();
+
+} // namespace cache
+} // namespace pxr
+
+#endif
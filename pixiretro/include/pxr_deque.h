@@ -0,0 +1,121 @@
+#ifndef _PIXIRETRO_DEQUE_H_
+#define _PIXIRETRO_DEQUE_H_
+
+#include <atomic>
+#include <array>
+#include <cstdint>
+#include <cstddef>
+
+namespace pxr
+{
+
+//
+// A lock-free work-stealing deque (Chase and Lev, with the memory orderings of Le et al's
+// "Correct and Efficient Work-Stealing for Weak Memory Models") for handing out work between
+// threads, e.g. the jobs of the job system (see pxr_jobs.h).
+//
+// Exactly one thread, the owner, may push and pop; they work the bottom of the deque, last in
+// first out, so the owner runs the work it made most recently whilst its data is still in its
+// caches. Any other thread may steal; steals take from the top, first in first out, so thieves
+// take the oldest (typically the largest) work. Neither ever blocks or allocates; push fails if
+// the deque is full, pop and steal fail if it is empty, and steal may also fail if it loses a
+// race for the last item to another thief or the owner.
+//
+// Items are pointers. The capacity is fixed, a power of 2.
+//
+template<typename T, int Capacity>
+class WorkStealingDeque
+{
+  static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "capacity must be a power of 2");
+
+public:
+  WorkStealingDeque() : _top{0}, _bottom{0}
+  {
+    for(auto& item : _items)
+      item.store(nullptr, std::memory_order_relaxed);
+  }
+
+  WorkStealingDeque(const WorkStealingDeque&) = delete;
+  WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+  //
+  // Owner only.
+  //
+  bool push(T* item)
+  {
+    int64_t bottom = _bottom.load(std::memory_order_relaxed);
+    int64_t top = _top.load(std::memory_order_acquire);
+    if(bottom - top >= Capacity)
+      return false;
+    _items[bottom & mask].store(item, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    _bottom.store(bottom + 1, std::memory_order_relaxed);
+    return true;
+  }
+
+  //
+  // Owner only. Returns nullptr if empty.
+  //
+  T* pop()
+  {
+    int64_t bottom = _bottom.load(std::memory_order_relaxed) - 1;
+    _bottom.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t top = _top.load(std::memory_order_relaxed);
+
+    if(top > bottom){
+      _bottom.store(bottom + 1, std::memory_order_relaxed);
+      return nullptr;
+    }
+
+    T* item = _items[bottom & mask].load(std::memory_order_relaxed);
+    if(top == bottom){
+
+      // the last item; race the thieves for it.
+      if(!_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        item = nullptr;
+      _bottom.store(bottom + 1, std::memory_order_relaxed);
+    }
+    return item;
+  }
+
+  //
+  // Any thread. Returns nullptr if empty or if the steal lost a race.
+  //
+  T* steal()
+  {
+    int64_t top = _top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t bottom = _bottom.load(std::memory_order_acquire);
+    if(top >= bottom)
+      return nullptr;
+
+    T* item = _items[top & mask].load(std::memory_order_relaxed);
+    if(!_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+      return nullptr;
+    return item;
+  }
+
+  //
+  // Any thread; a snapshot which may be stale by the time it returns.
+  //
+  bool isEmpty() const
+  {
+    return _top.load(std::memory_order_relaxed) >= _bottom.load(std::memory_order_relaxed);
+  }
+
+private:
+  static constexpr int64_t mask {Capacity - 1};
+  static constexpr size_t CACHE_LINE_SIZE {64};
+
+  //
+  // Thieves contend for the top, the owner works the bottom; each on its own cache line.
+  //
+  alignas(CACHE_LINE_SIZE) std::atomic<int64_t> _top;
+  alignas(CACHE_LINE_SIZE) std::atomic<int64_t> _bottom;
+  alignas(CACHE_LINE_SIZE) std::array<std::atomic<T*>, Capacity> _items;
+};
+
+} // namespace pxr
+
+#endif
@@ -0,0 +1,344 @@
+#ifndef _PIXIRETRO_DSP_H_
+#define _PIXIRETRO_DSP_H_
+
+#include <cinttypes>
+#include <vector>
+
+namespace pxr
+{
+namespace dsp
+{
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// PIXIRETRO DSP KERNELS
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Bulk sample processing kernels shared by the audio code. All kernels operate on whole
+// buffers of samples rather than single samples so they can be vectorized; on x86 they use
+// SSE2 intrinsics and elsewhere they fall back to plain loops the compiler can vectorize.
+//
+// Float samples are normalized to the range [-1, 1]. Planar buffers hold the samples of a
+// single channel; interleaved buffers hold frames of samples, one sample per channel per frame,
+// with the left channel first.
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+//
+// Converts count signed 16-bit samples to float samples.
+//
+void convertS16ToFloat(const int16_t* src, float* dst, int count);
+
+//
+// Converts count float samples to signed 16-bit samples with saturation.
+//
+void convertFloatToS16(const float* src, int16_t* dst, int count);
+
+//
+// Splits frameCount interleaved stereo signed 16-bit frames into two planar float buffers.
+//
+void deinterleaveS16Stereo(const int16_t* src, float* left, float* right, int frameCount);
+
+//
+// Merges two planar float buffers into frameCount interleaved stereo signed 16-bit frames
+// with saturation.
+//
+void interleaveFloatToS16Stereo(const float* left, const float* right, int16_t* dst, int frameCount);
+
+//
+// Averages two planar buffers into a single planar buffer; dst may alias either source.
+//
+void downmixStereoToMono(const float* left, const float* right, float* dst, int count);
+
+//
+// Returns the sum of the products of count pairs of samples.
+//
+float dotProduct(const float* a, const float* b, int count);
+
+//
+// Scales count signed 16-bit samples by a gain which ramps linearly from gain (applied to the
+// first sample) by gainStep per sample, and adds the results to the float samples in dst.
+// Ramping the gain over a buffer rather than stepping it avoids audible clicks (zipper noise)
+// when a gain changes.
+//
+void mixS16Mono(const int16_t* src, float* dst, int count, float gain, float gainStep);
+
+//
+// As mixS16Mono but for frameCount interleaved stereo frames with independent left and right
+// gain ramps, i.e. the gain ramps of a panned stereo voice.
+//
+void mixS16Stereo(const int16_t* src, float* dst, int frameCount, float gainLeft, float gainRight,
+                  float stepLeft, float stepRight);
+
+//
+// Adds count float samples from src to the float samples in dst.
+//
+void addSamples(const float* src, float* dst, int count);
+
+//
+// Scales frameCount interleaved float frames by a gain which ramps linearly from gain (applied
+// to the first frame) by gainStep per frame; all channels of a frame share the gain.
+//
+void scaleFrames(float* samples, int frameCount, int numChannels, float gain, float gainStep);
+
+//
+// Blends interleaved float frames of a dry and wet signal into wet as dry + (wet - dry) * mix,
+// where mix ramps linearly from mix (applied to the first frame) by mixStep per frame.
+//
+void blendFrames(const float* dry, float* wet, int frameCount, int numChannels, float mix, float mixStep);
+
+//
+// Splits frameCount interleaved stereo float frames into two planar buffers, and merges them
+// back.
+//
+void deinterleaveStereo(const float* src, float* left, float* right, int frameCount);
+void interleaveStereo(const float* left, const float* right, float* dst, int frameCount);
+
+//
+// Returns the largest absolute value of count float samples.
+//
+float findPeak(const float* samples, int count);
+
+//
+// A peak limiter which keeps interleaved float samples within [-threshold, threshold].
+//
+// The limiter has an instant attack, so no sample ever exceeds the threshold, and an
+// exponential release back to unity gain. Since all channels of a frame share the gain the
+// stereo image is preserved.
+//
+class Limiter
+{
+public:
+  Limiter(float threshold, float release_ms, int sampleRate_hz);
+
+  void process(float* samples, int frameCount, int numChannels);
+
+  float getGain() const {return _gain;}
+
+private:
+  float _threshold;
+  float _releaseCoefficient;
+  float _gain;
+};
+
+//
+// Filters are recursive, i.e. each output depends on the outputs before it, so cannot be
+// vectorized across samples directly. Instead blocks of BLOCK outputs are computed at once: the
+// outputs of a block are a linear function of the inputs of the block and the filter's state
+// before it, so are the product of a matrix (precomputed when the filter is configured) with
+// those inputs. The recursion then only runs from block to block.
+//
+
+//
+// A second order (biquad) IIR filter of planar float samples with the responses of the audio
+// eq cookbook (R. Bristow-Johnson); processed in transposed direct form II.
+//
+class Biquad
+{
+public:
+  enum Type
+  {
+    LOWPASS,
+    HIGHPASS,
+    BANDPASS      // constant 0dB peak gain.
+  };
+
+  static constexpr float DEFAULT_Q {0.7071f};   // butterworth; no resonant peak.
+
+public:
+  Biquad();
+
+  //
+  // Recalculates the coefficients; the state is kept so the filter can be swept whilst running.
+  // The cutoff is clamped below the nyquist frequency.
+  //
+  void configure(Type type, float cutoff_hz, float q, int sampleRate_hz);
+
+  void process(float* samples, int count);
+  void reset();
+
+private:
+  static constexpr int BLOCK {4};
+  static constexpr int BLOCK_INPUTS {BLOCK + 2};   // the block's inputs and the 2 states.
+
+  void processSample(float& sample);
+  void calculateBlockMatrix();
+
+private:
+  float _b0, _b1, _b2, _a1, _a2;
+  float _s1, _s2;
+
+  //
+  // Column k holds the contribution of block input k to the outputs and to the new states.
+  //
+  alignas(16) float _outputMatrix[BLOCK_INPUTS][BLOCK];
+  alignas(16) float _stateMatrix[BLOCK_INPUTS][BLOCK];
+};
+
+//
+// A one-pole low-pass filter; a gentle (6dB/octave) filter of planar float samples and, via
+// advance, a smoother of control values such as gains so they glide rather than jump.
+//
+class OnePole
+{
+public:
+  OnePole();
+
+  //
+  // The time constant is the time taken to cover ~63% of a change; 0 makes changes instant.
+  //
+  void configure(float timeConstant_ms, int sampleRate_hz);
+
+  void process(float* samples, int count);
+
+  //
+  // Moves the value towards target as frameCount frames of a constant target input would, and
+  // returns the new value.
+  //
+  float advance(float target, int frameCount);
+
+  void reset(float value) {_value = value;}
+  float getValue() const {return _value;}
+
+private:
+  static constexpr int BLOCK {4};
+
+  float _coefficient;
+  float _value;
+  alignas(16) float _outputMatrix[BLOCK + 1][BLOCK];
+};
+
+//
+// M. R. Schroeder's reverberator; four parallel feedback comb filters (the echo density) into
+// two series allpass filters (the diffusion). Mono in, the wet signal out.
+//
+// The combs and allpasses are processed in runs no longer than their delays, within which no
+// output depends on another, so the runs are vectorized.
+//
+class SchroederReverb
+{
+public:
+  static constexpr int NUM_COMBS {4};
+  static constexpr int NUM_ALLPASSES {2};
+
+public:
+  explicit SchroederReverb(int sampleRate_hz);
+
+  //
+  // The time taken for the reverb tail to decay by 60dB.
+  //
+  void setDecay(float decay_s);
+
+  void process(const float* src, float* dst, int count);
+  void reset();
+
+private:
+  struct DelayLine
+  {
+    std::vector<float> _buffer;
+    int _position;
+    float _gain;
+  };
+
+  static constexpr float COMB_DELAYS_MS[NUM_COMBS] {29.7f, 37.1f, 41.1f, 43.7f};
+  static constexpr float ALLPASS_DELAYS_MS[NUM_ALLPASSES] {5.0f, 1.7f};
+  static constexpr float ALLPASS_GAIN {0.7f};
+  static constexpr float INPUT_GAIN {1.f / NUM_COMBS};
+
+private:
+  int _sampleRate_hz;
+  DelayLine _combs[NUM_COMBS];
+  DelayLine _allpasses[NUM_ALLPASSES];
+};
+
+//
+// A feed-forward peak compressor of interleaved float frames.
+//
+// The level is detected, and the gain computed, once per CONTROL_FRAMES frames; the gain is
+// ramped across each run of frames so applying it is a vectorized scale.
+//
+class Compressor
+{
+public:
+  static constexpr int CONTROL_FRAMES {16};
+
+public:
+  explicit Compressor(int sampleRate_hz);
+
+  void configure(float threshold_db, float ratio, float attack_ms, float release_ms, float makeup_db);
+  void process(float* samples, int frameCount, int numChannels);
+
+  float getGainReduction_db() const;
+
+private:
+  int _sampleRate_hz;
+  float _threshold;
+  float _exponent;            // 1/ratio - 1; the slope of the gain above the threshold.
+  float _attackCoefficient;   // per control step.
+  float _releaseCoefficient;
+  float _makeup;
+  float _envelope;
+  float _gain;                // excluding makeup.
+};
+
+//
+// Converts planar float samples from one sampling rate to another with a polyphase windowed
+// sinc filter.
+//
+// The conversion ratio is reduced to the rational L/M (L = up factor, M = down factor) and the
+// filter is stored as a bank of L phases. Each output sample is then a single dot product of
+// the input samples around the output position with the phase of the filter selected by the
+// fractional part of that position. Ratios with more than MAX_PHASES phases use the nearest
+// of MAX_PHASES phases; the output position is always tracked exactly so the pitch is never
+// altered.
+//
+// When downsampling the filter cutoff is lowered to the output nyquist frequency and the
+// filter lengthened accordingly to avoid aliasing.
+//
+// Resampling is done on whole buffers (e.g. at load time) with the signal assumed silent
+// outside of the buffer.
+//
+class Resampler
+{
+public:
+  static constexpr int MAX_PHASES {512};
+  static constexpr int MAX_DOWN_FACTOR {8};
+
+public:
+  Resampler(int inRate_hz, int outRate_hz);
+
+  int calculateOutputCount(int inputCount) const;
+
+  //
+  // Resamples inputCount samples from src into dst which must have space for
+  // calculateOutputCount(inputCount) samples.
+  //
+  void resample(const float* src, int inputCount, float* dst) const;
+
+  int getTapCount() const {return _tapCount;}
+  int getPhaseCount() const {return _phaseCount;}
+
+private:
+  void generateFilterBank();
+
+private:
+  static constexpr int HALF_TAPS_PER_UNITY {16};
+  static constexpr float CUTOFF_ROLLOFF {0.95f};
+
+  int64_t _upFactor;
+  int64_t _downFactor;
+  int _phaseCount;
+  int _halfTapCount;
+  int _tapCount;
+
+  //
+  // The filter bank; _phaseCount phases of _tapCount coefficients each stored back to back.
+  //
+  std::vector<float> _bank;
+};
+
+} // namespace dsp
+} // namespace pxr
+
+#endif
@@ -2,15 +2,24 @@
 #define _PIXIRETRO_ENGINE_H_
 
 #include <SDL2/SDL_keycode.h>
+#include <SDL2/SDL_events.h>
 
 #include <memory>
 #include <chrono>
+#include <thread>
+#include <atomic>
 
 #include "pxr_rc.h"
 #include "pxr_game.h"
 #include "pxr_color.h"
 #include "pxr_gfx.h"
 #include "pxr_sfx.h"
+#include "pxr_cache.h"
+#include "pxr_spsc.h"
+#include "pxr_triple.h"
+#include "pxr_telemetry.h"
+#include "pxr_replay.h"
+#include "pxr_jobs.h"
 
 namespace pxr
 {
@@ -18,6 +27,14 @@ namespace pxr
 //
 // The core engine class which manages the main loop, initialisation and shutdown.
 //
+// With threadedUpdate set in the engine rc (and a game which supports it, see Scene) the
+// update tick runs on a simulation thread of its own, leaving the main thread to poll events,
+// draw and present; so a slow draw no longer delays updates and on multicore machines the
+// update and frame rates stop competing for one core. The main thread forwards key events to
+// the simulation thread through a queue and the simulation thread publishes the state the main
+// thread needs (the game clock, pause state and stats) through a triple buffer; neither ever
+// waits on the other.
+//
 class Engine final
 {
 public:
@@ -42,6 +59,22 @@ public:
   //
   void run();
 
+  //
+  // Headless stepping, for tools which drive a game deterministically without a display, audio
+  // device or real time (e.g. pxr_bench). Call initializeHeadless in place of initialize: the
+  // gfx module draws screens but presents nothing (see gfx::initialize), the sfx module runs
+  // offline, the splash is skipped, updates are never threaded and the rand generator is
+  // seeded with seed rather than at random. Then step the game in place of run; stepUpdate
+  // runs one update tick, advancing the game clock by the locked tick period, and stepDraw one
+  // draw tick, ending the frame (it resets the frame arena, see pxr_arena.h). Neither sleeps or
+  // polls events; script input with input::onKey and advance the audio with
+  // sfx::advanceOffline. Call shutdown as usual.
+  //
+  void initializeHeadless(std::unique_ptr<Game> game, uint32_t seed);
+  void stepUpdate();
+  void stepDraw();
+  float getTickPeriodSeconds() const;
+
 private:
   //
   // The system clock and resolution used to record time.
@@ -56,6 +89,25 @@ private:
   static constexpr Duration_t oneMinute      {60'000'000'000};
   static constexpr Duration_t minFramePeriod {1'000'000     };
 
+  //
+  // The most time the update ticker catches up on with CATCHUP_CLAMP (see Ticker).
+  //
+  static constexpr Duration_t maxCatchUpDuration {250'000'000};
+
+  //
+  // Whilst idle (the game clock paused, the window minimized or hidden, or the scene idle; see
+  // Scene::isIdle) the engine draws at the idleFps set in the engine rc (not at all whilst the
+  // window is hidden) and, rather than spinning, blocks waiting for events until the next tick
+  // falls due; but never for longer than maxIdleWait, as the music must be kept queued.
+  //
+  static constexpr Duration_t maxIdleWait {100'000'000};
+
+  //
+  // Whilst idle with threaded updates, the most time the simulation thread sleeps between
+  // applying the forwarded key events; bounds the lag of e.g. the unpause key.
+  //
+  static constexpr Duration_t idleSimulationPollPeriod {10'000'000};
+
   static constexpr float splashDurationSeconds     {1.0f};
   static constexpr float splashWaitDurationSeconds {1.0f};
 
@@ -77,6 +129,26 @@ private:
   static constexpr int pauseGameClockKey          {SDLK_p           };
   static constexpr int toggleDrawEngineStatsKey   {SDLK_BACKQUOTE   };
   static constexpr int skipSplashKey              {SDLK_ESCAPE      };
+  static constexpr int exportTelemetryKey         {SDLK_F9          };
+
+  //
+  // The name of the file frame telemetry is exported to (see telemetry::exportStats); the
+  // extension is that of the format. Exported on exportTelemetryKey and, if telemetryExport is
+  // set in the engine rc, at shutdown.
+  //
+  static constexpr const char* telemetryName {"telemetry"};
+
+  //
+  // The file the profiler's trace is written to at shutdown in builds with the profiler (see
+  // pxr_profile.h).
+  //
+  static constexpr const char* profileTraceFilename {"profile.json"};
+
+  //
+  // The file sessions are recorded to, or played back from, when replayMode is set in the engine
+  // rc (see pxr_replay.h). Recording overwrites the last session recorded.
+  //
+  static constexpr const char* replayFilename {"session.replay"};
 
   //
   // The name of the splash screen assets used by the engine. The engine will attempt 
@@ -124,6 +196,7 @@ private:
     void unpause(){_isPaused = false;}
     void togglePause(){_isPaused = !_isPaused;}
     bool isPaused() const {return _isPaused;}
+    void rewind(Duration_t dt){_now -= dt;}
   private:
     Duration_t _now;
     float _scale;
@@ -145,6 +218,10 @@ private:
   // frequency of callback invocation. Further the measured frequency is actually an average 
   // value over the last half second of game time.
   //
+  // After each call to doTicks the alpha is how far the master clock has run past the last tick
+  // done, as a fraction of the tick period; a draw can interpolate between the last two update
+  // ticks by it so motion stays smooth when drawing at a higher rate than updating.
+  //
   class Ticker
   {
   public:
@@ -153,6 +230,31 @@ private:
     //
     using Callback_t = void (Engine::*)(float);
 
+    //
+    // What to do with ticks which fall due faster than maxTicksPerFrame can do them, e.g. after
+    // a stall such as a window drag or a debugger break.
+    //
+    // POLICY            BEHAVIOUR
+    // ------            ---------
+    //
+    // CATCHUP_DROP      The ticks are dropped; the ticker skips the stalled time.
+    //
+    // CATCHUP_CLAMP     The ticks are carried and done in later frames (at up to
+    //                   maxTicksPerFrame a frame) so the ticker catches up after short stalls,
+    //                   but no more than maxCatchUpDuration of them are carried.
+    //
+    // CATCHUP_SLOWMO    The ticks are dropped and the ticker's timeline is wound back by them,
+    //                   so time slows rather than skips. The ticker's owner must wind back the
+    //                   clock it chases by getSlowedTime between scheduleTicks and doTicks,
+    //                   so the ticks never see it run backwards; so game clock only.
+    //
+    enum CatchUpPolicy
+    {
+      CATCHUP_DROP,
+      CATCHUP_CLAMP,
+      CATCHUP_SLOWMO
+    };
+
     //
     // The history is used to plot the performance graph for the ticker thus the size of
     // the history determines the time span the graph covers where each sample is the 
@@ -162,12 +264,28 @@ private:
 
   public:
     Ticker() = default;
-    Ticker(Callback_t onTick, Engine* tickCtx, Duration_t tickPeriod, int maxTicksPerFrame, bool isChasingGameNow);
+    Ticker(Callback_t onTick, Engine* tickCtx, Duration_t tickPeriod, int maxTicksPerFrame, 
+           bool isChasingGameNow, CatchUpPolicy policy);
+    //
+    // Each frame scheduleTicks takes the ticks due onto the backlog and applies the catch up
+    // policy, then doTicks does the frame's share of the backlog.
+    //
+    void scheduleTicks(Duration_t gameNow, Duration_t realNow);
     void doTicks(Duration_t gameNow, Duration_t realNow);
     void reset();
+
+    //
+    // The time until the next tick falls due on the ticker's timeline; zero if one is due.
+    //
+    Duration_t getTimeToNextTick(Duration_t gameNow, Duration_t realNow) const;
+
     int getTicksDoneTotal() const {return _ticksDoneTotal;}
     int getTicksDoneThisFrame() const {return _ticksDoneThisFrame;}
     int getTicksAccumulated() const {return _ticksAccumulated;}
+    int64_t getTicksDroppedTotal() const {return _ticksDroppedTotal;}
+    float getAlpha() const {return _alpha;}
+    Duration_t getSlowedTime() const {return _slowedTime;}
+    CatchUpPolicy getCatchUpPolicy() const {return _policy;}
     const std::array<double, FPS_HISTORY_SIZE>& getTickFrequencyHistory() {return _measuredTickFrequencyHistory;}
     bool isNewTickFrequencySample() const {return _isNewTickFrequencySample;}
     void setCallback(Callback_t onTick){_onTick = onTick;}
@@ -184,6 +302,11 @@ private:
     int _ticksDoneThisFrame;           // useful performance stat.
     int _maxTicksPerFrame;             // limit to number of ticks in each call to doTicks.
     int _ticksAccumulated;             // backlog of ticks that need to be done.
+    int _maxTicksAccumulated;          // backlog carried between frames by CATCHUP_CLAMP.
+    int64_t _ticksDroppedTotal;        // ticks dropped by the catch up policy.
+    float _alpha;                      // fraction of a period the clock is past the last tick done.
+    Duration_t _slowedTime;            // time wound back this frame by CATCHUP_SLOWMO.
+    CatchUpPolicy _policy;
     bool _isChasingGameNow;            // ticker either 'chases' the real clock or the game clock.
 
     //
@@ -212,7 +335,15 @@ private:
       KEY_CLEAR_RED,
       KEY_CLEAR_GREEN,
       KEY_CLEAR_BLUE,
-      KEY_FPS_LOCK
+      KEY_FPS_LOCK,
+      KEY_CACHE_BUDGET_MIB,
+      KEY_THREADED_UPDATE,
+      KEY_CATCH_UP_POLICY,
+      KEY_TELEMETRY_EXPORT,
+      KEY_REPLAY_MODE,
+      KEY_JOB_WORKERS,
+      KEY_ASYNC_LOG,
+      KEY_IDLE_FPS
     };
 
     EngineRC() : RC({
@@ -223,13 +354,99 @@ private:
       {KEY_CLEAR_RED,     "clearRed",     {10},    {0},     {255}},
       {KEY_CLEAR_GREEN,   "clearGreen",   {10},    {0},     {255}},
       {KEY_CLEAR_BLUE,    "clearBlue",    {10},    {0},     {255}},
-      {KEY_FPS_LOCK,      "fpsLock",      {60},    {24},    {1000}}
+      {KEY_FPS_LOCK,      "fpsLock",      {60},    {24},    {1000}},
+      {KEY_CACHE_BUDGET_MIB, "cacheBudgetMiB", {64}, {0},     {4096}},
+      {KEY_THREADED_UPDATE, "threadedUpdate", {false}, {false}, {true}},
+      {KEY_CATCH_UP_POLICY, "catchUpPolicy", {Ticker::CATCHUP_CLAMP}, {Ticker::CATCHUP_DROP}, {Ticker::CATCHUP_SLOWMO}},
+      {KEY_TELEMETRY_EXPORT, "telemetryExport", {telemetry::EXPORT_NONE}, {telemetry::EXPORT_NONE}, {telemetry::EXPORT_JSON}},
+      {KEY_REPLAY_MODE,   "replayMode",   {replay::MODE_OFF}, {replay::MODE_OFF}, {replay::MODE_PLAYBACK}},
+      {KEY_JOB_WORKERS,   "jobWorkers",   {-1},    {-1},    {jobs::MAX_THREADS - 1}},
+      {KEY_ASYNC_LOG,     "asyncLog",     {true},  {false}, {true}},
+      {KEY_IDLE_FPS,      "idleFps",      {10},    {1},     {60}}
+    }){}
+  };
+
+  //
+  // The configuration of the sfx module (see sfx::SFXConfiguration). With lowLatency the low
+  // latency preset replaces chunkSize and adaptiveChunkSize. adaptedChunkSize is written by
+  // the engine when adaptive sizing settles on a larger chunk size, so later runs start with
+  // it rather than underrunning again; 0 if the chunk size has never adapted.
+  //
+  class SFXRC final : public io::RC
+  {
+  public:
+    static constexpr const char* filename = "sfx";
+
+    enum Key
+    {
+      KEY_LOW_LATENCY,
+      KEY_SAMPLING_FREQ_HZ,
+      KEY_SAMPLE_BITS,
+      KEY_STEREO,
+      KEY_CHUNK_SIZE,
+      KEY_ADAPTIVE_CHUNK_SIZE,
+      KEY_MAX_CHUNK_SIZE,
+      KEY_ADAPTED_CHUNK_SIZE,
+      KEY_NUM_MIX_CHANNELS
+    };
+
+    SFXRC() : RC({
+      //    key                         name                 default   min      max
+      {KEY_LOW_LATENCY,            "lowLatency",          {false}, {false}, {true}},
+      {KEY_SAMPLING_FREQ_HZ,       "samplingFreqHz",      {sfx::DEFAULT_SAMPLING_FREQ_HZ}, {8000}, {48000}},
+      {KEY_SAMPLE_BITS,            "sampleBits",          {16},    {8},     {32}},
+      {KEY_STEREO,                 "stereo",              {false}, {false}, {true}},
+      {KEY_CHUNK_SIZE,             "chunkSize",           {sfx::DEFAULT_CHUNK_SIZE}, {64}, {16384}},
+      {KEY_ADAPTIVE_CHUNK_SIZE,    "adaptiveChunkSize",   {false}, {false}, {true}},
+      {KEY_MAX_CHUNK_SIZE,         "maxChunkSize",        {sfx::DEFAULT_MAX_CHUNK_SIZE}, {64}, {16384}},
+      {KEY_ADAPTED_CHUNK_SIZE,     "adaptedChunkSize",    {0},     {0},     {16384}},
+      {KEY_NUM_MIX_CHANNELS,       "numMixChannels",      {sfx::DEFAULT_NUM_MIX_CHANNELS}, {1}, {4096}}
     }){}
   };
 
+  //
+  // The state of the simulation the main thread reads to draw. With threaded updates it is
+  // published by the simulation thread every loop, else it is made on demand.
+  //
+  struct SimulationState
+  {
+    Duration_t _gameNow;
+    Duration_t _realNow;
+    double _updateFrequency;
+    int _updateFrequencySamples;   // counts new update frequency samples.
+    float _updateAlpha;            // see Ticker.
+    bool _isPaused;
+    bool _isSceneIdle;             // see Scene::isIdle.
+    cache::Stats _cacheStats;
+    int64_t _cacheBudget;
+    sfx::AudioStats _audioStats;
+    int _chunkSize;
+  };
+
+  //
+  // Capacity of the queue of key events forwarded to the simulation thread.
+  //
+  static constexpr int forwardedEventCapacity {256};
+
 private:
   void mainloop();
+  bool onEngineKey(SDL_Keycode key);
+  void syncPauseScreen(bool isPaused);
+  void onWindowEvent(const SDL_WindowEvent& event);
+  bool isDrawDue(bool isIdle, Duration_t realNow);
+  Duration_t calculateTimeToNextUpdate();
+  Duration_t calculateIdleWait(bool isUpdating, Duration_t realNow);
+  void measureFrameFrequency(Duration_t realNow);
+  void endFrame(TimePoint_t frameStart, Duration_t idleWait);
+  void exportTelemetry();
+  void threadedRun();
+  void threadedMainloop();
+  void simulationLoop();
+  SimulationState makeSimulationState();
+  SimulationState readSimulationState();
   void drawEngineStats();
+  sfx::SFXConfiguration makeSFXConfiguration();
+  void saveAdaptedChunkSize();
   void drawPauseDialog();
   void onUpdateTick(float tickPeriodSeconds);
   void onDrawTick(float tickPeriodSeconds);
@@ -246,6 +463,7 @@ private:
 
 private:
   EngineRC _rc;
+  SFXRC _sfxrc;
 
   Ticker _updateTicker;
   Ticker _drawTicker;
@@ -253,9 +471,27 @@ private:
   RealClock _realClock;
   GameClock _gameClock;
 
+  //
+  // With threaded updates the simulation thread owns the clocks above and the update ticker;
+  // the main thread keeps time with its own clock.
+  //
+  RealClock _renderClock;
+  bool _isThreaded;
+  std::thread _simulationThread;
+  std::atomic<bool> _isSimulating {false};
+  SPSCQueue<SDL_Event> _forwardedEvents;
+  TripleBuffer<SimulationState> _simulationState;
+  int _updateFrequencySamples;
+  int _drawnUpdateFrequencySamples;
+
   gfx::Color4f _clearColor;
 
   int _fpsLockHz;
+  Duration_t _tickPeriod;
+
+  Duration_t _idleDrawPeriod;
+  Duration_t _lastIdleDrawNow;      // on the main thread's real clock.
+  bool _isWindowHidden;
 
   long _framesDone;
   int _framesDoneThisSecond;
@@ -272,13 +508,17 @@ private:
   Vector2i _splashPosition;
   Vector2i _splashSize;
   int _splashProgress;
-  bool _isSplashDone;
+  std::atomic<bool> _isSplashDone;     // written by the main thread; read by onEngineKey.
 
   std::unique_ptr<Game> _game;
 
   bool _isDrawingEngineStats;
   bool _needRedrawEngineStats;
+  bool _isPauseScreenEnabled;
   bool _isDone;
+
+  bool _isHeadless {false};
+  uint32_t _headlessSeed;
 };
 
 } // namespace pxr
@@ -3,10 +3,14 @@
 
 #include <vector>
 #include <memory>
+#include <atomic>
 #include <string>
 #include <unordered_map>
+#include <algorithm>
+#include <cassert>
 
 //#include "pxr_gfx.h"
+#include "pxr_jobs.h"
 
 namespace pxr
 {
@@ -22,6 +26,45 @@ class Game;
 // Virtual base class for app states. Derive from this class to create app 'modes'
 // that can be switched between, e.g. a splash screen, a menu, a gameplay state etc.
 //
+// THREADED UPDATES
+//
+// By default every method is called from the main thread. If the engine is configured for
+// threaded updates (see EngineRC) and the game supports them (see Game), onUpdate, onEnter
+// and onExit are instead called from a simulation thread whilst onDraw continues to be called
+// from the main thread, concurrently. The contract for such scenes is then:
+//
+//    onDraw may read only its arguments, data which does not change after onInit (e.g.
+//    resource keys and screen ids), and draw state the scene publishes at the end of onUpdate
+//    through a TripleBuffer (see pxr_triple.h). It must not write anything onUpdate reads.
+//
+//    gfx functions may only be called from onInit and onDraw; onUpdate, onEnter and onExit
+//    must leave screens alone, e.g. enabling screens becomes part of the draw state.
+//
+//    sfx and input functions may only be called from onInit, onUpdate, onEnter and onExit.
+//
+// onDraw may be called before the scene first publishes, in which case it reads the value
+// initialized read buffer.
+//
+// PRELOADING
+//
+// A scene loads its resources in onPreload, which runs once on a job worker (see pxr_jobs.h)
+// ahead of the scene's first onEnter, so loading never stalls the frame of a scene switch. As
+// it runs concurrently with everything else, onPreload may only call functions documented as
+// callable from any thread, e.g. gfx::prefetchSpritesheet, and must not touch data any other
+// scene method uses other than through its own synchronization. A scene whose resources keep
+// arriving after onPreload returns (e.g. from jobs of its own) reports when they are resident
+// through isReady. See Game::preloadScene and Game::requestScene. The initial scene, which the
+// game enters directly in its onInit, is never preloaded; load its resources in onInit.
+//
+// INTERPOLATION
+//
+// Updates run at a fixed period whilst draws run whenever the draw tick falls due, so a draw
+// usually falls after the last update but before the next. The alpha passed to onDraw is how
+// far past the last update the draw is, as a fraction of the update period in [0, 1]. To keep
+// motion smooth when drawing at a higher rate than updating a scene either interpolates between
+// its last two updates by alpha, drawing a period behind, or extrapolates from its last update
+// by alpha * dt, clamped so it never runs past a change the next update could make.
+//
 class Scene
 {
 public:
@@ -30,14 +73,42 @@ public:
   virtual ~Scene() = default;
   virtual bool onInit() = 0;
   virtual void onUpdate(double now, float dt) = 0;
-  virtual void onDraw(double now, float dt, const std::vector<gfx::ScreenID_t>& screens) = 0;
+  virtual void onDraw(double now, float dt, float alpha, const std::vector<gfx::ScreenID_t>& screens) = 0;
   virtual void onEnter() = 0;
   virtual void onExit() = 0;
 
   virtual std::string getName() const = 0;
 
+  //
+  // Return true whilst the scene is idle: its draws would not change from one to the next, e.g.
+  // a static menu waiting on input. The engine then draws at a low rate and sleeps between
+  // ticks rather than spinning (see Engine::maxIdleWait); updates still run. Called after
+  // updates, from the thread which runs them.
+  //
+  virtual bool isIdle() const {return false;}
+
+  //
+  // Loads the scene's resources; runs once, on a job worker, before the scene is first entered.
+  //
+  virtual void onPreload() {}
+
+  //
+  // Return false whilst resources the scene needs to enter are still loading after onPreload has
+  // returned. Called from the thread which runs updates. The answer must follow from the
+  // simulation alone (e.g. the updates since the request), never wall clock time or job
+  // scheduling, else replays diverge.
+  //
+  virtual bool isReady() const {return true;}
+
 protected:
   Game* _owner;
+
+private:
+  friend class Game;
+
+  jobs::Job _preloadJob {};
+  jobs::Counter _preloadCounter {};
+  bool _isPreloadStarted {false};
 };
 
 //
@@ -63,32 +134,133 @@ public:
   //
   virtual void onShutdown() = 0;
 
+  //
+  // Return true only if every scene keeps the contract for threaded updates (see Scene), in
+  // which case the engine may run the update tick on a thread of its own.
+  //
+  virtual bool isThreadedUpdateSupported() const {return false;}
+
   //
   // Invoked by the engine during the update tick.
   //
   void onUpdate(double now, float dt)
   {
+    updateTransition(dt);
     _activeScene->onUpdate(now, dt);
+    _drawScene.store(_activeScene.get(), std::memory_order_release);
+  }
+
+  //
+  // Invoked by the engine during the draw tick. Draws the scene which last updated, which
+  // (with threaded updates) may lag a scene switch by a draw tick.
+  //
+  void onDraw(double now, float dt, float alpha)
+  {
+    Scene* scene = _drawScene.load(std::memory_order_acquire);
+    if(scene != nullptr)
+      scene->onDraw(now, dt, alpha, _screens);
+  }
+
+  //
+  // Invoked by the engine after the update tick; see Scene::isIdle.
+  //
+  bool isIdle() const
+  {
+    return _transition == TRANSITION_NONE && _activeScene != nullptr && _activeScene->isIdle();
+  }
+
+  //
+  // Invoked by the engine on shutdown, before onShutdown; waits out any preloads still running.
+  //
+  void waitPreloads()
+  {
+    for(auto& [name, scene] : _scenes)
+      jobs::wait(scene->_preloadCounter);
   }
 
   //
-  // Invoked by the engine during the draw tick.
+  // Starts loading a scene's resources in the background (see Scene::onPreload), e.g. whilst
+  // the player is still in the menu, so a later request to switch to it need not wait. Does
+  // nothing if the scene has already been preloaded.
   //
-  void onDraw(double now, float dt)
+  void preloadScene(const std::string& name)
   {
-    _activeScene->onDraw(now, dt, _screens);
+    Scene* scene = findScene(name);
+    if(scene->_isPreloadStarted)
+      return;
+    scene->_isPreloadStarted = true;
+    scene->_preloadJob = jobs::Job{[](void* data){static_cast<Scene*>(data)->onPreload();}, scene, nullptr};
+    jobs::run(&scene->_preloadJob, 1, scene->_preloadCounter);
+
+    //
+    // Without workers nothing would run the job until waited on.
+    //
+    if(jobs::getWorkerCount() == 0)
+      jobs::wait(scene->_preloadCounter);
+  }
+
+  //
+  // True once a scene's preload is done and the scene reports itself ready. When the preload
+  // finishes depends on the workers' scheduling, so use this only for presentation (e.g. a
+  // loading indicator), never to drive the simulation.
+  //
+  bool isSceneReady(const std::string& name) const
+  {
+    auto search = _scenes.find(name);
+    assert(search != _scenes.end());
+    return isSceneReady(*search->second);
   }
 
   //
   // For use by app states to switch between other states (game state, menu states etc).
   //
+  // Switches to the scene only once it is ready, preloading it if not already preloaded. Given a
+  // fade duration the screens first fade out, stay black for as long as the scene takes to get
+  // ready, then fade back in on the new scene; without one the switch is due on the next update.
+  // When the switch falls due the update waits for the preload to finish (it has had the fade to
+  // run in the background), then polls isReady once per update, so the update the switch happens
+  // on never depends on the workers' scheduling and replays stay deterministic. The active scene
+  // keeps updating until the switch. Requests for the scene
+  // already requested are ignored, so a request may be repeated every update; a request for
+  // another scene replaces it.
+  //
+  void requestScene(const std::string& name, float fadeDuration_s = 0.f)
+  {
+    Scene* scene = findScene(name);
+    if(scene == _requestedScene.get())
+      return;
+    preloadScene(name);
+    _requestedScene = _scenes[name];
+    _fadeDuration_s = fadeDuration_s;
+    if(_transition == TRANSITION_NONE || _transition == TRANSITION_FADE_IN)
+      _transition = fadeDuration_s > 0.f ? TRANSITION_FADE_OUT : TRANSITION_LOADING;
+  }
+
+  //
+  // Switches scene immediately, on this update, cancelling any requested switch. If the scene has
+  // not been preloaded it is preloaded now, stalling until done; isReady is not consulted. Use
+  // for scenes with nothing (more) to load, or where stalling does not matter, e.g. in tools.
+  //
   void switchScene(const std::string& name)
   {
-    _activeScene->onExit();
-    _activeScene = _scenes[name];
-    _activeScene->onEnter();
+    Scene* scene = findScene(name);
+    preloadScene(name);
+    jobs::wait(scene->_preloadCounter);
+    _requestedScene.reset();
+    _transition = TRANSITION_NONE;
+    _fadeLevel = 0.f;
+    _publishedFadeLevel.store(0.f, std::memory_order_relaxed);
+    enterScene(_scenes[name]);
   }
 
+  //
+  // How far the screens are faded to black by a scene transition, in [0, 1]; applied by the
+  // engine after the draw tick. May be read from any thread.
+  //
+  float getFadeLevel() const {return _publishedFadeLevel.load(std::memory_order_relaxed);}
+
+  const std::vector<gfx::ScreenID_t>& getScreens() const {return _screens;}
+
   //
   // Accessors to provide information to the engine about your application. Used, for example,
   // to set the window title.
@@ -104,6 +276,79 @@ protected:
   std::unordered_map<std::string, std::shared_ptr<Scene>> _scenes;
   std::shared_ptr<Scene> _activeScene;
   std::vector<gfx::ScreenID_t> _screens;
+
+private:
+  //
+  // The phases of a requested scene switch:
+  //
+  //    PHASE                   ACTIVE SCENE   FADE LEVEL
+  //    TRANSITION_NONE         current        0
+  //    TRANSITION_FADE_OUT     current        rising to 1
+  //    TRANSITION_LOADING      current        1 (0 without a fade); waits on the preload, polls isReady
+  //    TRANSITION_FADE_IN      requested      falling to 0
+  //
+  enum Transition
+  {
+    TRANSITION_NONE,
+    TRANSITION_FADE_OUT,
+    TRANSITION_LOADING,
+    TRANSITION_FADE_IN
+  };
+
+  Scene* findScene(const std::string& name) const
+  {
+    auto search = _scenes.find(name);
+    assert(search != _scenes.end());
+    return search->second.get();
+  }
+
+  static bool isSceneReady(const Scene& scene)
+  {
+    return scene._isPreloadStarted && scene._preloadCounter.isDone() && scene.isReady();
+  }
+
+  void enterScene(std::shared_ptr<Scene> scene)
+  {
+    _activeScene->onExit();
+    _activeScene = std::move(scene);
+    _activeScene->onEnter();
+  }
+
+  void updateTransition(float dt)
+  {
+    switch(_transition){
+    case TRANSITION_NONE:
+      return;
+    case TRANSITION_FADE_OUT:
+      _fadeLevel = std::min(1.f, _fadeLevel + (dt / _fadeDuration_s));
+      if(_fadeLevel < 1.f)
+        break;
+      _transition = TRANSITION_LOADING;
+      [[fallthrough]];
+    case TRANSITION_LOADING:
+      jobs::wait(_requestedScene->_preloadCounter);
+      if(!_requestedScene->isReady())
+        break;
+      enterScene(std::move(_requestedScene));
+      _transition = _fadeLevel > 0.f ? TRANSITION_FADE_IN : TRANSITION_NONE;
+      break;
+    case TRANSITION_FADE_IN:
+      _fadeLevel = std::max(0.f, _fadeLevel - (dt / _fadeDuration_s));
+      if(_fadeLevel <= 0.f)
+        _transition = TRANSITION_NONE;
+      break;
+    }
+    _publishedFadeLevel.store(_fadeLevel, std::memory_order_relaxed);
+  }
+
+private:
+  std::atomic<Scene*> _drawScene {nullptr};
+
+  std::shared_ptr<Scene> _requestedScene;
+  Transition _transition {TRANSITION_NONE};
+  float _fadeDuration_s {0.f};
+  float _fadeLevel {0.f};
+  std::atomic<float> _publishedFadeLevel {0.f};
 };
 
 } // namespace pxr
@@ -2,6 +2,7 @@
 #define _PIXIRETRO_GFX_H_
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <array>
 #include <cmath>
@@ -257,6 +258,7 @@ struct Screen
   Color4u*     _pxColors;        // accessed [col + (row * width)]
   Vector2i*    _pxPositions;     // accessed [col + (row * width)]
   bool         _isEnabled;       // enable/disable drawing this screen to the window.
+  float        _fadeLevel;       // darkening applied as the screen is presented; see setScreenFade.
 };
 
 //
@@ -267,7 +269,11 @@ using ScreenID_t = int;
 //
 // Initializes the gfx subsystem. Returns true if success and false if fatal error.
 //
-bool initialize(std::string windowTitle, Vector2i windowSize, bool fullscreen);
+// A headless module creates no window or opengl context, for tools which run a game without a
+// display (e.g. pxr_bench); screens are created and drawn to exactly as usual but present and
+// clearWindowColor do nothing. windowSize is still used to size the screens.
+//
+bool initialize(std::string windowTitle, Vector2i windowSize, bool fullscreen, bool headless = false);
 
 //
 // Call to shutdown the module upon app termination.
@@ -297,12 +303,14 @@ void onWindowResize(Vector2i windowSize);
 // Loads a spritesheet from RESOURCE_PATH_SPRITESHEET directory in the file system.
 //
 // The 'name' arg must be the name of the asset files for the spritesheet. All spritesheets have 
-// 2 asset files: an xml meta file and a bmp image file. 
+// 2 asset files: an xml meta file and an image file, either qoi or bmp. If both image files
+// exist the qoi image is loaded.
 //
 // The naming format for the asset files is:
 //    <name>.<extension>
 //
-// see XML_RESOURCE_EXTENSION_SPRITESHEET and Bmp::FILE_EXTENSION for the extensions.
+// see XML_RESOURCE_EXTENSION_SPRITESHEET, QOI_FILE_EXTENSION and Bmp::FILE_EXTENSION for the
+// extensions.
 //
 //
 // Returns the resource key the loaded spritesheet was mapped to which is needed for the drawing
@@ -313,8 +321,17 @@ void onWindowResize(Vector2i windowSize);
 ResourceKey_t loadSpritesheet(ResourceName_t name);
 
 //
-// Unloads a spritesheet. The spritesheet will only be removed from memory if the reference 
-// count drops to zero.
+// Reads a spritesheet's asset files into memory ahead of its load, so the following call to
+// loadSpritesheet only registers it rather than touching the disk. Unlike the other gfx
+// functions this may be called from any thread, e.g. from a job in Scene::onPreload. A
+// spritesheet which fails to read is left for loadSpritesheet to report.
+//
+void prefetchSpritesheet(ResourceName_t name);
+
+//
+// Unloads a spritesheet. If the reference count drops to zero the spritesheet is released to
+// the resource cache (see pxr_cache.h) which keeps it resident until evicted to stay within the
+// cache memory budget; reloading it before eviction will not touch the disk.
 //
 void unloadSpritesheet(ResourceKey_t sheetKey);
 
@@ -322,12 +339,14 @@ void unloadSpritesheet(ResourceKey_t sheetKey);
 // Loads a font from RESOURCE_PATH_FONTS directory in the file system.
 //
 // The 'name' arg must be the name of the asset files for the font. All fonts have 2
-// asset files: an xml meta file and a bmp image file. 
+// asset files: an xml meta file and an image file, either qoi or bmp, picked in the same
+// manner as for spritesheets.
 //
 // The naming format for the asset files is:
 //    <name>.<extension>
 //
-// see XML_RESOURCE_EXTENSION_FONTS and Bmp::FILE_EXTENSION for the extensions.
+// see XML_RESOURCE_EXTENSION_FONTS, QOI_FILE_EXTENSION and Bmp::FILE_EXTENSION for the
+// extensions.
 //
 // Returns the resource key the loaded font was mapped to which is needed for the drawing
 // routines. Internally fonts are reference counted and thus can be loaded multiple times
@@ -337,8 +356,8 @@ void unloadSpritesheet(ResourceKey_t sheetKey);
 ResourceKey_t loadFont(ResourceName_t name);
 
 //
-// Unloads a font. The font will only be removed from memory if the reference count drops 
-// to zero.
+// Unloads a font. If the reference count drops to zero the font is released to the resource
+// cache in the same manner as spritesheets.
 //
 void unloadFont(ResourceKey_t fontKey);
 
@@ -394,7 +413,7 @@ void drawSpriteColumn(Vector2i position, ResourceKey_t sheetKey, SpriteID_t spri
 // 
 // Draw a text string.
 //
-void drawText(Vector2i position, const std::string& text, ResourceKey_t fontKey, Color4u color, ScreenID_t screenid);
+void drawText(Vector2i position, std::string_view text, ResourceKey_t fontKey, Color4u color, ScreenID_t screenid);
 
 //
 // Draw a border rectangle, i.e draw only the outline. This function clamps the rectangle to 
@@ -453,6 +472,13 @@ void setScreenManualPixelSize(int pxSize, ScreenID_t screenid);
 //
 void setPixelShader(PXShader_t shader, ScreenID_t screenid);
 
+//
+// Darkens a screen towards black by level, in [0, 1] where 1 is black, as it is presented. The
+// screen's pixels are not changed, so the fade holds until set back to 0 however often (or
+// rarely) the screen is redrawn. Transparent pixels stay transparent.
+//
+void setScreenFade(float level, ScreenID_t screenid);
+
 //
 // Enables a screen so it will be rendered to the window.
 //
@@ -467,7 +493,7 @@ void disableScreen(ScreenID_t screenid);
 // Utility function for calculating the dimensions of the smallest possible bounding box of 
 // a text string for a given font. Dimensions are in units of virtual pixels.
 //
-Vector2i calculateTextSize(const std::string& text, ResourceKey_t fontKey);
+Vector2i calculateTextSize(std::string_view text, ResourceKey_t fontKey);
 
 //
 // Utility to test if a spritesheet resource key is associated with the error spritesheet. Allows 
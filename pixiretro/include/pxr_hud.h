@@ -24,12 +24,20 @@ public:
 
   static constexpr float IMMORTAL_LIFETIME {0.f};
 
+  //
+  // Labels are allocated from a pool shared by all HUDs rather than the heap, as games make and
+  // kill short lived labels (score popups and the like) as they play; the pool recycles the
+  // memory of dead labels, so once it has warmed up making labels never touches the heap.
+  //
   class Label
   {
     friend HUD;
   public:
     virtual ~Label() = default;
 
+    static void* operator new(std::size_t bytes);
+    static void operator delete(void* p, std::size_t bytes);
+
     virtual void onReset();
     virtual void onUpdate(float dt);
     virtual void onDraw(gfx::ScreenID_t screenid) = 0;
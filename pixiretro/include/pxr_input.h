@@ -23,6 +23,12 @@ struct KeyLog
   bool _isReleased;     // was key released between last update tick and the current?
 };
 
+struct KeyEvent
+{
+  KeyCode _key;
+  bool _isDown;
+};
+
 //
 // Must be called prior to any other function in this module. Results of calls prior to
 // initialization are undefined.
@@ -34,6 +40,11 @@ void initialize();
 //
 void onKeyEvent(const SDL_Event& event);
 
+//
+// Records a key event by key code; for tools which script input rather than take it from SDL.
+//
+void onKey(KeyCode key, bool isDown);
+
 //
 // Updates the key logs and clears the key history. Called by the engine during the update tick.
 //
@@ -54,6 +65,12 @@ bool isKeyReleased(KeyCode key);
 //
 const std::vector<KeyCode>& getHistory();
 
+//
+// Accessor to get the key events (presses and releases) recorded since the last update tick,
+// in the order they were recorded. Wiped at the end of every update tick as is the history.
+//
+const std::vector<KeyEvent>& getEvents();
+
 //
 // Simple helper to convert a key code to the ascii value of the character associated with
 // the key. Only valid for key codes which have an associated ascii value, i.e. for alpha
@@ -0,0 +1,190 @@
+#ifndef _PIXIRETRO_JOBS_H_
+#define _PIXIRETRO_JOBS_H_
+
+#include <atomic>
+#include <array>
+#include <algorithm>
+#include <type_traits>
+
+namespace pxr
+{
+namespace jobs
+{
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// PIXIRETRO JOB SYSTEM
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// A pool of worker threads shared by the whole engine, to which any thread can hand work as
+// jobs, so work which can run in parallel (asset decoding, banded rasterization, particle
+// updates, collision batches) shares one pool rather than each spawning threads of its own.
+//
+// Jobs are handed out by work stealing: every thread which runs jobs has a deque of its own
+// (see pxr_deque.h) to which it pushes the jobs it makes and from which it pops them back, and
+// a thread whose deque is empty steals from the others. Workers with nothing to steal sleep.
+//
+// Jobs are run in fork/join fashion. A job counts down a counter as it completes; a thread
+// waits on the counter until all the jobs it counts are done, running jobs itself (its own or
+// stolen) whilst it waits rather than blocking, so waiting never idles a core and jobs may
+// safely make and wait on jobs of their own. Counters double as dependencies: make a job which
+// depends on others after waiting on their counter.
+//
+// The jobs themselves (the Job structs) are owned by their maker and must outlive the wait on
+// their counter; typically both live on the maker's stack. The job system never allocates
+// after initialization.
+//
+// The helpers forkJoin and parallelFor cover the common cases without handling jobs directly:
+//
+//    jobs::parallelFor(0, numRows, 16, [&](int first, int last){
+//      for(int row = first; row < last; ++row)
+//        rasterizeRow(row);
+//    });
+//
+// With no workers (or before initialization) everything still works; the waiting thread just
+// runs every job itself.
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+//
+// The most threads which may ever run jobs (workers and the threads which make jobs). A thread
+// is given a deque on its first job; its deque outlives it.
+//
+static constexpr int MAX_THREADS {32};
+
+//
+// The most jobs a thread can have waiting in its deque; jobs made when it is full are run
+// immediately by their maker.
+//
+static constexpr int DEQUE_CAPACITY {1024};
+
+//
+// The most jobs parallelFor splits a range into.
+//
+static constexpr int MAX_PARALLEL_FOR_JOBS {64};
+
+//
+// Counts the jobs outstanding in a batch; see run and wait. The count is managed by the job
+// system, never touch it.
+//
+class Counter
+{
+public:
+  Counter() : _count{0} {}
+
+  Counter(const Counter&) = delete;
+  Counter& operator=(const Counter&) = delete;
+
+  bool isDone() const {return _count.load(std::memory_order_acquire) == 0;}
+
+  std::atomic<int> _count;
+};
+
+using JobFunction_t = void (*)(void* data);
+
+struct Job
+{
+  JobFunction_t _function;
+  void* _data;
+  Counter* _counter;     // set by run.
+};
+
+//
+// Starts the worker threads; numWorkers less than 0 starts one per core but one (the core
+// left for the main thread). Call from the main thread before any jobs are made.
+//
+void initialize(int numWorkers);
+
+//
+// Stops and joins the worker threads; every counter must have been waited on.
+//
+void shutdown();
+
+//
+// The number of worker threads, which does not count the threads which wait on jobs.
+//
+int getWorkerCount();
+
+//
+// Makes jobs runnable; they may run on any thread, in any order, from now until counter is
+// waited on. Adds the jobs to counter, so one counter can count several batches.
+//
+void run(Job* jobs, int numJobs, Counter& counter);
+
+//
+// Returns once all the jobs counted by counter are done, running jobs until then.
+//
+void wait(Counter& counter);
+
+//
+// Runs a and b in parallel and returns when both are done; a may run on another thread, b
+// runs on the calling thread.
+//
+template<typename A, typename B>
+void forkJoin(A&& a, B&& b)
+{
+  using AFunction_t = std::remove_reference_t<A>;
+  Job job {
+    [](void* data){(*static_cast<AFunction_t*>(data))();},
+    const_cast<void*>(static_cast<const void*>(&a)),
+    nullptr
+  };
+  Counter counter {};
+  run(&job, 1, counter);
+  b();
+  wait(counter);
+}
+
+//
+// Calls body(first, last) over subranges [first, last) which together cover [begin, end), in
+// parallel, and returns when all are done. The range is split into as few subranges as keep
+// every thread busy, but never into subranges smaller than grain (bar the last) nor into more
+// than MAX_PARALLEL_FOR_JOBS. The calling thread takes the first subrange.
+//
+template<typename F>
+void parallelFor(int begin, int end, int grain, F&& body)
+{
+  int count = end - begin;
+  if(count <= 0)
+    return;
+
+  grain = std::max(1, grain);
+  int maxJobs = std::min(MAX_PARALLEL_FOR_JOBS, (getWorkerCount() + 1) * 4);
+  int numJobs = std::min((count + grain - 1) / grain, maxJobs);
+  if(numJobs <= 1){
+    body(begin, end);
+    return;
+  }
+
+  using Body_t = std::remove_reference_t<F>;
+  struct Range
+  {
+    Body_t* _body;
+    int _first;
+    int _last;
+  };
+
+  std::array<Range, MAX_PARALLEL_FOR_JOBS> ranges;
+  std::array<Job, MAX_PARALLEL_FOR_JOBS> jobs;
+  int rangeSize = (count + numJobs - 1) / numJobs;
+  numJobs = (count + rangeSize - 1) / rangeSize;
+  for(int j = 0; j < numJobs; ++j){
+    int first = begin + j * rangeSize;
+    ranges[j] = Range{&body, first, std::min(first + rangeSize, end)};
+    jobs[j] = Job{[](void* data){
+      Range* range = static_cast<Range*>(data);
+      (*range->_body)(range->_first, range->_last);
+    }, &ranges[j], nullptr};
+  }
+
+  Counter counter {};
+  run(jobs.data() + 1, numJobs - 1, counter);
+  body(ranges[0]._first, ranges[0]._last);
+  wait(counter);
+}
+
+} // namespace jobs
+} // namespace pxr
+
+#endif
@@ -2,6 +2,8 @@
 #define _PIXIRETRO_LOG_H_  
 
 #include <array>
+#include <string_view>
+#include <cinttypes>
 
 namespace pxr
 {
@@ -16,6 +18,9 @@ namespace log
 
 LOGSTR msg_log_fail_open = "failed to open log file";
 LOGSTR msg_log_to_stderr = "logging to standard error";
+LOGSTR msg_log_async = "logging asynchronously";
+LOGSTR msg_log_dropped = "log queue full : dropped messages";
+LOGSTR msg_log_suppressed = "suppressed repeats of message";
 
 //
 // engine log strings.
@@ -25,6 +30,9 @@ LOGSTR msg_eng_fail_sdl_init = "failed to initialize SDL";
 LOGSTR msg_eng_locking_fps = "locking fps to";
 LOGSTR msg_eng_fail_load_splash = "failed to splash sprite : skipping splash screen";
 LOGSTR msg_eng_fail_init_game = "failed to initialize the game";
+LOGSTR msg_eng_threaded_update = "running update ticks on a simulation thread";
+LOGSTR msg_eng_threaded_update_unsupported = "game does not support threaded updates : running single threaded";
+LOGSTR msg_eng_event_queue_full = "simulation event queue full : dropped event";
 
 //
 // gfx log strings.
@@ -33,6 +41,7 @@ LOGSTR msg_eng_fail_init_game = "failed to initialize the game";
 LOGSTR msg_gfx_initializing = "initializing gfx module";
 LOGSTR msg_gfx_fail_init = "failed to initialize gfx module : terminating program";
 LOGSTR msg_gfx_fullscreen = "activating fullscreen window mode";
+LOGSTR msg_gfx_headless = "running headless : screens are drawn but not presented";
 LOGSTR msg_gfx_creating_window = "creating window";
 LOGSTR msg_gfx_fail_create_window = "failed to create window";
 LOGSTR msg_gfx_created_window = "successfully created window";
@@ -45,6 +54,7 @@ LOGSTR msg_gfx_loading_spritesheets = "starting spritesheet loading";
 LOGSTR msg_gfx_loading_spritesheet = "loading spritesheet";
 LOGSTR msg_gfx_spritesheet_already_loaded = "spritesheet already loaded";
 LOGSTR msg_gfx_loading_spritesheet_success = "successfully loaded spritesheet";
+LOGSTR msg_gfx_prefetched_spritesheet = "prefetched spritesheet";
 LOGSTR msg_gfx_loading_font = "loading font";
 LOGSTR msg_gfx_loading_font_success = "successfully loaded font";
 LOGSTR msg_gfx_fail_load_asset_bmp = "failed to load the bitmap image of asset";
@@ -60,6 +70,8 @@ LOGSTR msg_gfx_font_invalid_xml_bmp_mismatch = "invalid font : char xml meta ext
 LOGSTR msg_gfx_unloading_nonexistent_resource = "trying to unload nonexistent resource";
 LOGSTR msg_gfx_unload_spritesheet_success = "successfully unloaded spritesheet";
 LOGSTR msg_gfx_unload_font_success = "successfully unloaded font";
+LOGSTR msg_gfx_release_spritesheet = "spritesheet unreferenced : keeping warm in resource cache";
+LOGSTR msg_gfx_release_font = "font unreferenced : keeping warm in resource cache";
 
 //
 // sfx log strings.
@@ -71,12 +83,14 @@ LOGSTR msg_sfx_fail_open_audio = "failed to open SDL_Mixer audio device";
 LOGSTR msg_sfx_fail_query_spec = "failed to query sfx module initialisation spec";
 LOGSTR msg_sfx_loading_sound = "loading sound";
 LOGSTR msg_sfx_loading_music = "loading music";
+LOGSTR msg_sfx_synthesizing_sound = "synthesizing sound";
 LOGSTR msg_sfx_sound_unloaded = "successfully unloaded sound";
 LOGSTR msg_sfx_music_unloaded = "successfully unloaded music";
 LOGSTR msg_sfx_sound_already_loaded = "sound already loaded";
 LOGSTR msg_sfx_music_already_loaded = "music already loaded";
 LOGSTR msg_sfx_fail_load_sound = "failed to load sound";
 LOGSTR msg_sfx_fail_load_music = "failed to load music";
+LOGSTR msg_sfx_fail_synthesize_sound = "failed to synthesize sound (zero duration patch)";
 LOGSTR msg_sfx_using_error_sound = "using error sound to substitute sound";
 LOGSTR msg_sfx_no_error_music = "unloaded music is substituted with silence";
 LOGSTR msg_sfx_error_sound_usage = "error sound usage count";
@@ -89,6 +103,65 @@ LOGSTR msg_sfx_playing_nonexistent_sound = "trying to play nonexistent sound wit
 LOGSTR msg_sfx_playing_nonexistent_music = "trying to play nonexistent music with key";
 LOGSTR msg_sfx_fail_play_sound = "failed to play sound with key";
 LOGSTR msg_sfx_fail_play_music = "failed to play music with key";
+LOGSTR msg_sfx_release_sound = "sound unreferenced : keeping warm in resource cache";
+LOGSTR msg_sfx_release_music = "music unreferenced : keeping warm in resource cache";
+LOGSTR msg_sfx_chunk_size_grown = "audio device underrunning : reopened with larger chunk size";
+LOGSTR msg_sfx_render_not_offline = "offline rendering requires the sfx module initialized offline";
+LOGSTR msg_sfx_render_offline = "rendered sound offline : [seconds:file]";
+
+LOGSTR msg_mixer_voices = "software mixer voice count";
+LOGSTR msg_mixer_command_queue_full = "software mixer command queue full : dropped command";
+LOGSTR msg_mixer_unsupported_channels = "software mixer only supports mono and stereo output : channels";
+LOGSTR msg_mixer_effect_chain_full = "software mixer effect chain full : bus";
+
+//
+// cache log strings.
+//
+
+LOGSTR msg_cache_budget = "resource cache memory budget";
+LOGSTR msg_cache_evicted = "evicted warm resource from resource cache";
+LOGSTR msg_cache_over_budget = "resource cache over budget with no evictable resources";
+
+//
+// telemetry log strings.
+//
+
+LOGSTR msg_telemetry_exported = "exported frame telemetry";
+LOGSTR msg_telemetry_fail_export = "failed to export frame telemetry";
+
+//
+// profile log strings.
+//
+
+LOGSTR msg_profile_trace_written = "wrote profile trace";
+LOGSTR msg_profile_fail_write = "failed to write profile trace";
+LOGSTR msg_profile_too_many_reservations = "too many profiler thread reservations : thread will allocate its buffer";
+
+//
+// arena log strings.
+//
+
+LOGSTR msg_arena_grown = "frame arena overflowed : growing block to bytes";
+
+//
+// jobs log strings.
+//
+
+LOGSTR msg_jobs_workers = "job system worker threads";
+LOGSTR msg_jobs_too_many_threads = "too many threads making jobs : thread will run its jobs itself";
+
+//
+// replay log strings.
+//
+
+LOGSTR msg_replay_recording = "recording input replay";
+LOGSTR msg_replay_recorded = "recorded input replay";
+LOGSTR msg_replay_playing = "playing back input replay";
+LOGSTR msg_replay_played = "input replay ended : live input resumed";
+LOGSTR msg_replay_fail_open = "failed to open input replay";
+LOGSTR msg_replay_not_a_replay = "file is not an input replay";
+LOGSTR msg_replay_unsupported_version = "unsupported input replay version";
+LOGSTR msg_replay_truncated = "input replay truncated : stopped playback at tick";
 
 //
 // xml log strings.
@@ -117,6 +190,17 @@ LOGSTR msg_bmp_unsupported_colorspace = "loaded bitmap image using unsupported n
 LOGSTR msg_bmp_unsupported_compression = "loaded bitmap image using unsupported compression mode";
 LOGSTR msg_bmp_unsupported_size = "loaded bitmap image has unsupported size";
 
+//
+// qoi log strings.
+//
+
+LOGSTR msg_qoi_fail_open = "failed to open qoi image file";
+LOGSTR msg_qoi_corrupted = "expected a qoi image file; file corrupted or wrong type";
+LOGSTR msg_qoi_unsupported_size = "loaded qoi image has unsupported size";
+LOGSTR msg_qoi_truncated = "qoi image data ended before all pixels were decoded";
+LOGSTR msg_qoi_fail_create = "failed to create qoi image file";
+LOGSTR msg_qoi_write_fail = "failed to write data to a qoi image file";
+
 //
 // wav file log strings.
 //
@@ -133,7 +217,18 @@ LOGSTR msg_wav_odd_channels = "detected unsupported number of sound channels";
 LOGSTR msg_wav_odd_sample_bits = "detected unsupported number of bits per sample";
 LOGSTR msg_wav_data_chunk_missing = "missing data chunk";
 LOGSTR msg_wav_odd_data_size = "detected unsupported wave file size";
+LOGSTR msg_wav_bad_fmt_chunk = "malformed format chunk";
+LOGSTR msg_wav_odd_sample_rate = "detected unsupported sampling rate";
+LOGSTR msg_wav_odd_target = "unsupported conversion target";
+LOGSTR msg_wav_truncated_data = "data chunk truncated by end of file";
+LOGSTR msg_wav_resampling = "resampling wave sound data";
+LOGSTR msg_wav_odd_block_align = "detected unsupported adpcm block size";
+LOGSTR msg_wav_odd_frame_align = "detected block align not matching the frame size of uncompressed data";
 LOGSTR msg_wav_load_success = "successfully loaded wave file";
+LOGSTR msg_wav_saving = "saving wave sound file";
+LOGSTR msg_wav_fail_create = "failed to create wave sound file";
+LOGSTR msg_wav_write_fail = "failed to write data to a wave sound file";
+LOGSTR msg_wav_save_success = "successfully saved wave file";
 
 //
 // rc log strings.
@@ -192,26 +287,101 @@ enum Level
 //
 static constexpr std::array<const char*, 4> prefix {"Fatal", "Error", "Warning", "Info"};
 
+//
+// Messages less severe than PXR_LOG_LEVEL (a Level; set by the PXR_LOG_LEVEL cmake option,
+// INFO if unset) are stripped at compile time: logging them compiles to nothing. Note the
+// arguments of a stripped call are still evaluated, so guard the building of an expensive
+// addendum with isCompiledIn.
+//
+#if !defined(PXR_LOG_LEVEL)
+#define PXR_LOG_LEVEL 3
+#endif
+
+static constexpr Level COMPILED_LEVEL {static_cast<Level>(PXR_LOG_LEVEL)};
+
+constexpr bool isCompiledIn(Level level) {return level <= COMPILED_LEVEL;}
+
+//
+// Repeats of a message (the same error and addendum) are rate limited: no more than
+// RATE_LIMIT_BURST of them are written each RATE_LIMIT_PERIOD_MS; the rest are counted and the
+// count written once the period is out.
+//
+// In asynchronous mode repeats are limited by the logging thread before they are queued, so a
+// message repeated in a hot loop cannot fill the queue and crowd others out. The limiting
+// there tracks at most RATE_LIMIT_SLOTS messages at once, in periods aligned to multiples of
+// RATE_LIMIT_PERIOD_MS; messages which collide in its table take turns being tracked.
+//
+static constexpr int RATE_LIMIT_BURST {8};
+static constexpr int64_t RATE_LIMIT_PERIOD_MS {1000};
+static constexpr int RATE_LIMIT_SLOTS {256};
+
+//
+// In asynchronous mode (see startAsync) messages are records of this size; longer addenda are
+// truncated.
+//
+static constexpr int MAX_ADDENDUM_LENGTH {112};
+
+//
+// The most records waiting to be written in asynchronous mode; messages logged when the queue
+// is full are dropped (and counted).
+//
+static constexpr int ASYNC_QUEUE_CAPACITY {1024};
+
+//
+// How often the writer thread wakes to write out waiting records; it writes FATAL and ERROR
+// messages without waiting.
+//
+static constexpr int64_t WRITER_PERIOD_MS {50};
+
 //
 // Initialises the log by opening the log stream. The first stream preference is a log 
 // file with the name defined by LOG_FILENAME. The second preference is stderr which will
 // be used if the log file cannot be opened or created.
 //
+// The log starts synchronous: a message is written and flushed by the thread which logs it
+// before log returns, which keeps every message should the program crash, at the cost of a
+// flush on the logging thread.
+//
 void initialize();
 
 //
-// Closes the log stream.
+// Switches to asynchronous mode: log copies the message into a fixed size record and pushes it
+// to a lock-free queue, and a background writer thread formats and writes the records in
+// batches, flushing once a batch. Logging never blocks nor allocates, so is safe anywhere, even
+// in a frame's hot path or the audio callback. The price is that a crash loses the messages
+// still queued.
+//
+void startAsync();
+
+//
+// Blocks until every message logged so far has been written. FATAL messages flush themselves,
+// as the program is expected to exit after one.
+//
+void flush();
+
+//
+// Stops the writer thread, writing out waiting messages, and closes the log stream.
 //
 void shutdown();
 
+//
+// Not to be called directly; see log.
+//
+void write(Level level, const char* error, std::string_view addendum);
+
 //
 // Logs a string to the log with the format:
 //
 //    <prefix><delim><error><delim><addendum>
 //
-// where the <prefix> is determined by the log level.
+// where the <prefix> is determined by the log level. The error must be a string with static
+// storage (e.g. one of the LOGSTR above) as only its pointer is queued.
 //
-void log(Level level, const char* error, const std::string& addendum = std::string{});
+inline void log(Level level, const char* error, std::string_view addendum = std::string_view{})
+{
+  if(isCompiledIn(level))
+    write(level, error, addendum);
+}
 
 } // namespace log
 } // namespace pxr
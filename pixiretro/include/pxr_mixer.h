@@ -0,0 +1,366 @@
+#ifndef _PIXIRETRO_MIXER_H_
+#define _PIXIRETRO_MIXER_H_
+
+#include <cinttypes>
+
+namespace pxr
+{
+namespace mixer
+{
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// PIXIRETRO SOFTWARE MIXER
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// The engine's own sound effect mixer. Sound effects are played on voices which are mixed in the
+// SDL audio callback (the mixer is installed as SDL_mixer's post mix hook). The number of voices
+// is set at initialization and is not limited by SDL_mixer's channels.
+//
+// Voices play signed 16-bit interleaved samples which must already be in the sampling rate and
+// channel count of the output (the sfx module converts sounds at load time). Voices are mixed in
+// float with vectorized kernels a block at a time; gain and pan changes, and fades, are applied
+// as linear ramps over each block so they never click. The final mix (music and voices) passes
+// through a peak limiter before being converted back to the output sample format, so hundreds
+// of overlapping voices saturate gracefully rather than wrapping or hard clipping.
+//
+// The game thread and the audio thread never share voice state. The functions which control
+// voices push commands into a wait-free single-producer single-consumer queue (see pxr_spsc.h)
+// which the audio thread drains at the start of every mix, and the audio thread reports voices
+// which have finished through a second such queue which the game thread drains with pollEvent.
+// The audio callback thus never takes a lock.
+//
+// As a consequence the state of voices seen by the game thread (isPlaying, isPaused) is the
+// state requested by the game thread up until the last drained event; a voice remains playing
+// from the moment it is played until its finished event is polled, and cannot be reused before
+// then. All functions except mix and onPostMix must be called from the game thread.
+//
+// Music is played on the music track, a timeline of nodes which the audio thread starts and
+// stops itself so that every transition lands on an exact frame (see queueTrackNode).
+//
+// Sound voices are mixed onto the master bus and the music track onto the music bus, which is
+// then mixed onto the master bus. Each bus has a chain of effects (filters, reverb, gain and
+// compression; see EFFECTS below) through which it passes before the next stage of the mix.
+//
+// The mixer can be driven without an audio device by calling mix directly, and runs unchanged
+// under SDL's dummy audio driver (set the environment variable SDL_AUDIODRIVER=dummy), which is
+// useful for headless testing.
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+//
+// Returned from play when no voice is free.
+//
+static constexpr int NULL_VOICE {-2};
+
+//
+// Pass to functions which modify voices to modify all voices.
+//
+static constexpr int ALL_VOICES {-1};
+
+//
+// Pass as the loop count to play to loop forever.
+//
+static constexpr int INFINITE_LOOPS {-1};
+
+//
+// Pan positions; values in between pan proportionally.
+//
+static constexpr float PAN_LEFT {-1.f};
+static constexpr float PAN_CENTER {0.f};
+static constexpr float PAN_RIGHT {1.f};
+
+//
+// The peak level the limiter holds the output to; normalized so 1 is full scale.
+//
+static constexpr float LIMITER_THRESHOLD {0.95f};
+static constexpr float LIMITER_RELEASE_MS {80.f};
+
+//
+// The duration over which the sound a stolen voice was playing is faded out.
+//
+static constexpr int STEAL_FADE_MS {3};
+
+//
+// Voices are mixed in blocks of at most this many frames; gain ramps span a block.
+//
+static constexpr int MIX_BLOCK_FRAMES {256};
+
+//
+// The number of commands which can be waiting for the audio thread; commands pushed when the
+// queue is full are dropped (and logged).
+//
+static constexpr int COMMAND_QUEUE_CAPACITY {4096};
+
+//
+// The audio device is deemed to have underrun when the callback falls this far (as a fraction
+// of the callback period) behind the rate at which the device consumes frames; the device
+// holds a buffer in reserve so callbacks can be late by up to a period without a gap.
+//
+static constexpr float UNDERRUN_TOLERANCE {1.f};
+
+//
+// The music track plays on voices of its own (in addition to the sound voices) and so can
+// overlap TRACK_VOICES nodes at once; a node starting whilst both track voices are busy cuts
+// the oldest short (with the same quick fade as a steal).
+//
+static constexpr int TRACK_VOICES {2};
+
+//
+// The number of nodes which can wait to start on the music track; nodes queued when full are
+// dropped (and reported finished).
+//
+static constexpr int MAX_QUEUED_TRACK_NODES {4};
+
+//
+// Pass as the play duration of a track node to play it until the track is stopped.
+//
+static constexpr int PLAY_FOREVER {-1};
+
+//
+// Returned by getTrackFading.
+//
+static constexpr int TRACK_NOT_FADING {0};
+static constexpr int TRACK_FADING_IN {1};
+static constexpr int TRACK_FADING_OUT {2};
+
+//
+// Messages from the audio thread to the game thread.
+//
+struct Event
+{
+  enum Type
+  {
+    VOICE_FINISHED,
+    TRACK_NODE_STARTED,     // _generation is the node id; _voice is NULL_VOICE.
+    TRACK_NODE_FINISHED,    // the node's samples are no longer read.
+    EFFECT_REMOVED          // handled within pollEvent; never returned.
+  };
+
+  Type _type;
+  int _voice;
+  uint32_t _generation;   // identifies the play of the voice the event concerns.
+};
+
+//
+// Must be called before any other function in this module. sampleFormat is an SDL integer
+// audio format and numChannels must be 1 (mono) or 2 (stereo).
+//
+bool initialize(int sampleRate_hz, uint16_t sampleFormat, int numChannels, int numVoices);
+
+//
+// Stops all voices.
+//
+void shutdown();
+
+//
+// Starts a voice playing frameCount frames of samples; the samples must remain valid until the
+// voice stops. loops is the number of additional times to play the samples. A fade in duration
+// of 0 starts at full gain and a play duration of -1 plays until the samples (and loops) end.
+//
+// Returns the voice or NULL_VOICE if all voices are in use. The gain and pan of a voice are
+// properties of the voice and so persist between plays.
+//
+int play(const int16_t* samples, int frameCount, int loops, int fadeIn_ms = 0, int playDuration_ms = -1);
+
+//
+// As play but plays on a specific voice, stealing it from whatever it is playing; the stolen
+// sound is quickly faded out (over STEAL_FADE_MS) rather than cut. The stolen play still
+// reports a finished event, with its own generation.
+//
+// A voice can only be stolen once until the finished event of the stolen play is drained;
+// returns NULL_VOICE if the voice cannot be stolen yet (see canSteal).
+//
+int steal(int voice, const int16_t* samples, int frameCount, int loops, int fadeIn_ms = 0, int playDuration_ms = -1);
+bool canSteal(int voice);
+
+//
+// Every play of a voice is given a new generation; events whose generation is not the current
+// generation of their voice concern stolen plays.
+//
+uint32_t getGeneration(int voice);
+
+void stop(int voice);
+void stopTimed(int voice, int durationUntilStop_ms);
+void stopFadeOut(int voice, int fadeDuration_ms);
+void pause(int voice);
+void resume(int voice);
+
+//
+// A paused voice is still playing.
+//
+bool isPlaying(int voice);
+bool isPaused(int voice);
+
+//
+// Gain is linear in [0, 1]; pan in [PAN_LEFT, PAN_RIGHT].
+//
+void setGain(int voice, float gain);
+void setPan(int voice, float pan);
+
+//
+// Queues a node on the music track. Nodes play one after another in the order queued, each
+// looping its samples for play_ms; the next node starts at exactly the frame the current node
+// begins its fade out, so the fade out of one node and the fade in of the next overlap (a
+// crossfade), and nodes without fades join without a gap. The first node queued on an idle
+// track starts as soon as the audio thread receives it.
+//
+// The track's timeline is measured in frames mixed whilst the track is not paused, so it does
+// not depend on the game's frame rate or clocks. Nodes must be queued before the node before
+// them reaches its transition; queue the next node when the previous one starts (see the
+// TRACK_NODE_STARTED event). The samples must remain valid until the node's finished event.
+//
+void queueTrackNode(uint32_t id, const int16_t* samples, int frameCount, int fadeIn_ms, int play_ms, int fadeOut_ms);
+
+//
+// Stops the track, fading out over fadeOut_ms, and discards all queued nodes.
+//
+void stopTrack(int fadeOut_ms = 0);
+void pauseTrack();
+void resumeTrack();
+void setTrackGain(float gain);
+
+//
+// Whether the current node of the track is fading; may be called from any thread.
+//
+int getTrackFading();
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+// EFFECTS
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+enum Bus
+{
+  BUS_MASTER,
+  BUS_MUSIC,
+  BUS_COUNT
+};
+
+//
+// EFFECT              ROLE
+// ------              ----
+//
+// EFFECT_GAIN         Scales the bus by PARAM_GAIN; e.g. to duck the music.
+//
+// EFFECT_LOWPASS      Biquad filters (see dsp::Biquad) at PARAM_CUTOFF_HZ with PARAM_Q; e.g. a
+// EFFECT_HIGHPASS     low-pass muffles the music whilst paused.
+// EFFECT_BANDPASS
+//
+// EFFECT_SMOOTH       A one-pole low-pass (see dsp::OnePole) at PARAM_CUTOFF_HZ; a gentle
+//                     darkening of the bus.
+//
+// EFFECT_REVERB       A Schroeder reverb (see dsp::SchroederReverb) with a tail of PARAM_DECAY_S.
+//
+// EFFECT_COMPRESSOR   A peak compressor (see dsp::Compressor) with PARAM_THRESHOLD_DB,
+//                     PARAM_RATIO, PARAM_ATTACK_MS, PARAM_RELEASE_MS and PARAM_MAKEUP_DB.
+//
+// Filters and the reverb blend their output with their input by PARAM_MIX (0 is dry, 1 is
+// wet). PARAM_GAIN, PARAM_MIX and PARAM_CUTOFF_HZ glide to new values over PARAM_GLIDE_MS so
+// effects can be swept without clicks; those set before an effect first processes audio apply
+// at once. An effect whose mix (or gain) has settled at a value which leaves the bus unaltered
+// is skipped, so effects can be left inserted at no cost.
+//
+enum EffectType
+{
+  EFFECT_GAIN,
+  EFFECT_LOWPASS,
+  EFFECT_HIGHPASS,
+  EFFECT_BANDPASS,
+  EFFECT_SMOOTH,
+  EFFECT_REVERB,
+  EFFECT_COMPRESSOR
+};
+
+enum EffectParameter
+{
+  PARAM_MIX,              // default 1.
+  PARAM_GAIN,             // linear; default 1.
+  PARAM_CUTOFF_HZ,        // default 1000.
+  PARAM_Q,                // default dsp::Biquad::DEFAULT_Q.
+  PARAM_DECAY_S,          // default 1.5.
+  PARAM_THRESHOLD_DB,     // default -12.
+  PARAM_RATIO,            // default 4.
+  PARAM_ATTACK_MS,        // default 5.
+  PARAM_RELEASE_MS,       // default 100.
+  PARAM_MAKEUP_DB,        // default 0.
+  PARAM_GLIDE_MS,         // default 20.
+  PARAM_COUNT
+};
+
+using EffectID_t = int;
+
+static constexpr EffectID_t NULL_EFFECT {-1};
+static constexpr int MAX_EFFECTS_PER_BUS {8};
+
+//
+// Appends an effect to the end of a bus's chain; returns NULL_EFFECT if the chain is full.
+// Effects are created (and their buffers allocated) on the game thread and handed to the audio
+// thread, so inserting never allocates in the audio callback.
+//
+EffectID_t insertEffect(Bus bus, EffectType type);
+
+//
+// Removes an effect from its chain. The effect is freed once the audio thread has let go of
+// it (by pollEvent), until which it still counts towards the bus's MAX_EFFECTS_PER_BUS.
+//
+void removeEffect(EffectID_t effect);
+
+void setEffectParameter(EffectID_t effect, EffectParameter parameter, float value);
+
+//
+// Pops the next event from the audio thread; returns false when there are no more events.
+// Should be called every tick until it returns false so finished voices become free.
+//
+bool pollEvent(Event& event);
+
+int getVoiceCount();
+int getActiveVoiceCount();
+
+//
+// Timing of the audio callback, measured by onPostMix. Durations cover the mixing of voices
+// and the music track; the effects duration is the share of that spent in the effect chains.
+//
+// Underruns are estimated by comparing the frames the callback has produced against the real
+// time elapsed: when the device consumes frames faster than the callback produces them the
+// device must have run dry. The estimate tolerates backends which call back in bursts.
+//
+struct CallbackStats
+{
+  int64_t _callbacks;
+  int64_t _underruns;
+  int _framesPerCallback;
+  float _averageDuration_ms;
+  float _maxDuration_ms;
+  float _averageEffectsDuration_ms;
+};
+
+//
+// May be called from any thread.
+//
+CallbackStats getCallbackStats();
+
+//
+// Restarts the callback timing and the max duration (the counts are kept); must only be called
+// whilst the audio device is closed (i.e. whilst onPostMix cannot be running), e.g. when the
+// device is reopened with a new buffer size.
+//
+void restartCallbackClock();
+
+//
+// Mixes the next frameCount frames of all playing voices into dst, adding to the interleaved
+// float frames already in dst, and then limits dst. Called on the audio thread, or on any
+// single thread when there is no audio device.
+//
+void mix(float* dst, int frameCount);
+
+//
+// The SDL_mixer post mix hook; mixes all voices and the music track into the stream (which
+// SDL_mixer leaves silent as it plays nothing itself).
+//
+void onPostMix(void* userdata, uint8_t* stream, int bytes);
+
+} // namespace mixer
+} // namespace pxr
+
+#endif
@@ -0,0 +1,117 @@
+#ifndef _PIXIRETRO_MPSC_H_
+#define _PIXIRETRO_MPSC_H_
+
+#include <atomic>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+#include <cassert>
+
+namespace pxr
+{
+
+//
+// A lock-free multi-producer single-consumer ring buffer (Vyukov's bounded queue) for passing
+// messages from any number of threads to one, e.g. log records to the log's writer thread.
+//
+// Any thread may push; exactly one thread may pop. Neither push nor pop ever blocks or
+// allocates; push fails if the queue is full and pop fails if it is empty. Each slot carries a
+// sequence number which tells producers the slot is free and the consumer the slot is written,
+// so a producer which has claimed a slot but not yet written it holds up the consumer (only)
+// until it has. Items are copied in and out so should be trivially copyable.
+//
+// The capacity is rounded up to a power of 2 and fixed at construction (or reset, which is not
+// thread safe).
+//
+template<typename T>
+class MPSCQueue
+{
+public:
+  MPSCQueue() : MPSCQueue(1) {}
+  explicit MPSCQueue(int capacity) {reset(capacity);}
+
+  MPSCQueue(const MPSCQueue&) = delete;
+  MPSCQueue& operator=(const MPSCQueue&) = delete;
+
+  //
+  // Empties the queue and changes its capacity; must not be called whilst any thread may be
+  // using the queue.
+  //
+  void reset(int capacity)
+  {
+    assert(capacity > 0);
+    size_t size {1};
+    while(size < static_cast<size_t>(capacity))
+      size <<= 1;
+    _slots = std::make_unique<Slot[]>(size);
+    for(size_t i = 0; i < size; ++i)
+      _slots[i]._sequence.store(i, std::memory_order_relaxed);
+    _mask = size - 1;
+    _head.store(0, std::memory_order_relaxed);
+    _tail.store(0, std::memory_order_relaxed);
+  }
+
+  //
+  // Any thread.
+  //
+  bool push(const T& item)
+  {
+    size_t tail = _tail.load(std::memory_order_relaxed);
+    Slot* slot;
+    while(true){
+      slot = &_slots[tail & _mask];
+      size_t sequence = slot->_sequence.load(std::memory_order_acquire);
+      auto diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(tail);
+      if(diff == 0){
+        if(_tail.compare_exchange_weak(tail, tail + 1, std::memory_order_relaxed))
+          break;
+      }
+      else if(diff < 0)
+        return false;
+      else
+        tail = _tail.load(std::memory_order_relaxed);
+    }
+    slot->_item = item;
+    slot->_sequence.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  //
+  // Consumer only.
+  //
+  bool pop(T& item)
+  {
+    size_t head = _head.load(std::memory_order_relaxed);
+    Slot& slot = _slots[head & _mask];
+    if(slot._sequence.load(std::memory_order_acquire) != head + 1)
+      return false;
+    item = slot._item;
+    slot._sequence.store(head + _mask + 1, std::memory_order_release);
+    _head.store(head + 1, std::memory_order_relaxed);
+    return true;
+  }
+
+  int getCapacity() const {return static_cast<int>(_mask + 1);}
+
+private:
+  struct Slot
+  {
+    std::atomic<size_t> _sequence;
+    T _item;
+  };
+
+  //
+  // The head and tail indices only ever increase; they are masked to index the slots. Each
+  // sits on its own cache line so the consumer and the producers do not contend for one line.
+  //
+  static constexpr size_t CACHE_LINE_SIZE {64};
+
+  std::unique_ptr<Slot[]> _slots;
+  size_t _mask;
+  alignas(CACHE_LINE_SIZE) std::atomic<size_t> _head;
+  alignas(CACHE_LINE_SIZE) std::atomic<size_t> _tail;
+};
+
+} // namespace pxr
+
+#endif
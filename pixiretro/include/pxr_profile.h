@@ -0,0 +1,119 @@
+#ifndef _PIXIRETRO_PROFILE_H_
+#define _PIXIRETRO_PROFILE_H_
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// PIXIRETRO PROFILER
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Scoped profiling zones written out as a Chrome trace (load the file in chrome://tracing or
+// ui.perfetto.dev). Where the telemetry module (pxr_telemetry.h) keeps percentiles of a few
+// fixed frame phases, the profiler records every entry to every zone, with its thread, so a
+// single slow frame can be taken apart call by call.
+//
+// The profiler is compiled in only when PXR_PROFILE is defined (see the PXR_PROFILE option in
+// CMakeLists.txt); otherwise all the macros below expand to nothing and no profiler code or
+// data exists in the build. Use the macros, never the profile namespace directly, so code
+// stays instrumented in both builds.
+//
+// MACRO                              USE
+// -----                              ---
+//
+// PXR_PROFILE_ZONE(name)             Times the enclosing scope as a zone. The name must be a
+//                                    string literal (only the pointer is stored).
+//
+// PXR_PROFILE_THREAD_NAME(name)      Names the calling thread in the trace; a string literal.
+//
+// PXR_PROFILE_WRITE_TRACE(path)      Writes the recorded zones of all threads to a file.
+//
+// PXR_PROFILE_RESERVE_THREAD(name)   Makes the buffer of a thread yet to start, which takes it
+//                                    on naming itself name; a string literal.
+//
+// Each thread records into a buffer of its own, allocated on the thread's first zone, so
+// recording never locks (after that first zone) and never allocates. Threads which may never
+// allocate or lock at all, e.g. the audio thread, instead have their buffer reserved before
+// they start and name themselves before their first zone. The buffers are rings of
+// the last RING_SIZE zones per thread; the trace holds the last seconds of each thread rather
+// than the first. Traces may be written from any thread while others are recording, at the
+// cost of missing the zones which complete as it is written.
+//
+// Timestamps are from the steady clock, which on the platforms we target reads the cpu's time
+// stamp counter via the vdso; a few tens of nanoseconds per zone, so zones are fine around
+// anything from a sprite draw up but not around single pixels.
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+#if defined(PXR_PROFILE)
+
+#include <cinttypes>
+#include <chrono>
+#include <string>
+
+namespace pxr
+{
+namespace profile
+{
+
+using Clock_t = std::chrono::steady_clock;
+
+//
+// The number of zones kept per thread; 24 bytes each.
+//
+static constexpr int RING_SIZE {1 << 16};
+
+void recordZone(const char* name, Clock_t::time_point start, Clock_t::time_point end);
+
+//
+// The most threads which may have a buffer reserved but not yet claimed at once.
+//
+static constexpr int MAX_RESERVED_THREADS {4};
+
+void setThreadName(const char* name);
+
+void reserveThread(const char* name);
+
+//
+// Returns false if the file could not be written.
+//
+bool writeTrace(const std::string& filepath);
+
+class Zone
+{
+public:
+  explicit Zone(const char* name) : _name{name}, _start{Clock_t::now()} {}
+  ~Zone() {recordZone(_name, _start, Clock_t::now());}
+
+  Zone(const Zone&) = delete;
+  Zone& operator=(const Zone&) = delete;
+
+private:
+  const char* _name;
+  Clock_t::time_point _start;
+};
+
+} // namespace profile
+} // namespace pxr
+
+#define PXR_PROFILE_CONCAT_IMPL(a, b) a##b
+#define PXR_PROFILE_CONCAT(a, b) PXR_PROFILE_CONCAT_IMPL(a, b)
+
+#define PXR_PROFILE_ZONE(name) \
+  ::pxr::profile::Zone PXR_PROFILE_CONCAT(_profileZone, __LINE__) {name}
+
+#define PXR_PROFILE_THREAD_NAME(name) ::pxr::profile::setThreadName(name)
+
+#define PXR_PROFILE_WRITE_TRACE(path) ::pxr::profile::writeTrace(path)
+
+#define PXR_PROFILE_RESERVE_THREAD(name) ::pxr::profile::reserveThread(name)
+
+#else
+
+#define PXR_PROFILE_ZONE(name)
+#define PXR_PROFILE_THREAD_NAME(name)
+#define PXR_PROFILE_WRITE_TRACE(path)
+#define PXR_PROFILE_RESERVE_THREAD(name)
+
+#endif
+
+#endif
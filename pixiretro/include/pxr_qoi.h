@@ -0,0 +1,37 @@
+#ifndef _PIXIRETRO_IO_QOI_H_
+#define _PIXIRETRO_IO_QOI_H_
+
+#include <string>
+#include "pxr_bmp.h"
+
+namespace pxr
+{
+namespace io
+{
+
+//
+// Support for the 'Quite OK Image' (.qoi) format; a lossless format which typically compresses
+// pixel art several-fold and decodes at close to the speed of a copy. See qoiformat.org for
+// the specification.
+//
+// Images are loaded into and saved from the same in-memory image type as bitmaps so either
+// format can be used wherever images are needed. Both 3 channel (rgb) and 4 channel (rgba)
+// files are supported; rgb images load with an opaque alpha.
+//
+
+static constexpr const char* QOI_FILE_EXTENSION {".qoi"};
+
+//
+// Loads a qoi image file into image. Errors are logged to the engine log.
+//
+bool loadQoi(const std::string& filepath, Bmp& image);
+
+//
+// Saves an image to a 4 channel qoi image file. Errors are logged to the engine log.
+//
+bool saveQoi(const std::string& filepath, const Bmp& image);
+
+} // namespace io
+} // namespace pxr
+
+#endif
@@ -0,0 +1,121 @@
+#ifndef _PIXIRETRO_REPLAY_H_
+#define _PIXIRETRO_REPLAY_H_
+
+#include <cinttypes>
+#include <string>
+#include <vector>
+#include "pxr_input.h"
+#include "pxr_rand.h"
+
+namespace pxr
+{
+namespace replay
+{
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// PIXIRETRO INPUT REPLAY
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Records a session (the state of the rand generator it started with, then the key events and
+// game time of every update tick) to a compact binary file, and plays sessions back so they run
+// the same, update for update. A replay can turn a bug report, a perf trace or a benchmark into
+// something anyone can run again.
+//
+// A session is keyed by update tick, not by time: a played back tick applies the key events
+// recorded with it (through input::onKey, before the game's update) and hands the game the game
+// time it was recorded with, however long after the last tick it actually runs. So a session
+// plays back the same at any frame or tick rate, even uncapped, and however the machine stalls.
+// Playback also locks the tick period to that of the recording. Live key events must not reach
+// the input module whilst playing back (the engine drops them); when the recording runs out
+// playback stops and live input resumes.
+//
+// Recording and playing back happen on the thread which runs the update ticks.
+//
+// The file is little endian:
+//
+// FIELD               SIZE                ROLE
+// -----               ----                ----
+//
+// magic               4                   "PXRR".
+// version             4                   FILE_VERSION.
+// seed                4 * state_size      The state of the rand generator the session began with.
+// tick period         8                   Nanoseconds.
+// ticks               variable            Until the end of the file.
+//
+// and each tick:
+//
+// game time delta     varint              Nanoseconds since the last tick's game time, zigzag
+//                                         encoded.
+// event count         varint
+// events              1 per event         Key code << 1 | isDown.
+//
+// A tick with no input takes 5 bytes at 60hz; about 18KiB a minute.
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+static constexpr uint32_t FILE_VERSION {1};
+
+//
+// MODE               ROLE
+// ----               ----
+//
+// MODE_OFF           Neither recording nor playing back.
+// MODE_RECORD        Recording every update tick.
+// MODE_PLAYBACK      Playing back every update tick.
+//
+enum Mode
+{
+  MODE_OFF,
+  MODE_RECORD,
+  MODE_PLAYBACK
+};
+
+//
+// Starts recording a session to a file, which is written as the session runs. Call after
+// seeding the rand generator with the generator's state and before the first update tick.
+// Returns false if the file could not be opened.
+//
+bool startRecording(const std::string& filepath, const rand::xorwow::state_type& seed,
+                    int64_t tickPeriod_ns);
+
+//
+// Records an update tick; call before the tick's update with the key events of the tick (see
+// input::getEvents) and the game time passed to the update.
+//
+void recordTick(int64_t gameNow_ns, const std::vector<input::KeyEvent>& events);
+
+//
+// Loads a recorded session to play back. Seed the rand generator with getSeed and tick with
+// getTickPeriodNanoseconds before the first update tick. Returns false if the file could not be
+// read or is not a recording.
+//
+bool startPlayback(const std::string& filepath);
+
+const rand::xorwow::state_type& getSeed();
+int64_t getTickPeriodNanoseconds();
+
+//
+// Plays back an update tick; call before the tick's update. Feeds the tick's key events to the
+// input module and sets gameNow_ns to the game time to pass to the update. Returns false, and
+// stops playback, once the recording has run out.
+//
+bool playTick(int64_t& gameNow_ns);
+
+//
+// Stops recording, writing out the rest of the file, or stops playback.
+//
+void stop();
+
+Mode getMode();
+
+//
+// The ticks recorded or played back so far.
+//
+int64_t getTicksDone();
+
+} // namespace replay
+} // namespace pxr
+
+#endif
@@ -3,6 +3,9 @@
 
 #include <SDL2/SDL_audio.h>
 #include <limits>
+#include <string>
+#include <vector>
+#include "pxr_synth.h"
 
 namespace pxr
 {
@@ -78,8 +81,28 @@ enum SampleFormat : uint16_t
 static constexpr int DEFAULT_SAMPLING_FREQ_HZ {22050               };
 static constexpr int DEFAULT_SAMPLE_FORMAT    {SAMPLE_FORMAT_S16LSB};
 static constexpr int DEFAULT_CHUNK_SIZE       {4096                };
-static constexpr int DEFAULT_NUM_MIX_CHANNELS {16                  };
+static constexpr int DEFAULT_NUM_MIX_CHANNELS {256                 };
+static constexpr int DEFAULT_MAX_CHUNK_SIZE   {8192                };
+static constexpr int LOW_LATENCY_CHUNK_SIZE   {256                 };
 
+//
+// Sound effects are mixed by the engine's software mixer (see pxr_mixer.h); _numMixChannels is
+// the number of voices it can play at once, i.e. the number of sound channels. Music plays on
+// the mixer's music track, which has voices of its own.
+//
+// _chunkSize is the size in frames of the audio device's buffer. The latency between playing a
+// sound and hearing it is roughly two buffers (the buffer playing and the buffer being mixed),
+// so small chunks reduce latency at the cost of more frequent audio callbacks; if a callback
+// is late the device runs dry (underruns) and the output glitches.
+//
+// With _isAdaptiveChunkSize the module reopens the audio device with double the chunk size
+// (up to _maxChunkSize) whenever it underruns repeatedly, so a small chunk size can be tried
+// on any machine and grows to the smallest that machine can sustain. Sounds and music carry
+// on from where they were when the device is reopened.
+//
+// An offline module opens no audio device; time advances only as renderOffline renders (see
+// OFFLINE RENDERING below). All other functions behave as they do online.
+//
 struct SFXConfiguration
 {
   int      _samplingFreq_hz {DEFAULT_SAMPLING_FREQ_HZ};
@@ -87,8 +110,17 @@ struct SFXConfiguration
   int      _outputMode      {OutputMode::MONO        };
   int      _chunkSize       {DEFAULT_CHUNK_SIZE      };
   int      _numMixChannels  {DEFAULT_NUM_MIX_CHANNELS};
+  bool     _isOffline       {false                   };
+  bool     _isAdaptiveChunkSize {false                 };
+  int      _maxChunkSize    {DEFAULT_MAX_CHUNK_SIZE  };
 };
 
+//
+// The default configuration with the smallest chunk size and adaptive chunk sizing; latency is
+// ~25ms at the default sampling rate rather than ~370ms.
+//
+SFXConfiguration makeLowLatencyConfiguration();
+
 //
 // Must call before any other function in this module.
 //
@@ -105,6 +137,41 @@ void shutdown();
 //
 void onUpdate(float dt);
 
+//
+// The configuration in use; differs from that passed to initialize if the audio device was
+// opened with a different spec or the chunk size has since adapted.
+//
+const SFXConfiguration& getConfiguration();
+
+//
+// Measurements of the audio device (see also mixer::CallbackStats).
+//
+// PROPERTY              MEANING
+// --------              -------
+//
+// _callbacks            The number of audio callbacks.
+// _underruns            The estimated number of times the device ran dry.
+// _chunkResizes         The number of times the chunk size adapted.
+// _averageCallback_ms   The average time spent mixing sounds in each callback.
+// _maxCallback_ms       The max since the chunk size last changed.
+// _averageEffects_ms    The part of the average spent processing the buses' effect chains.
+// _callbackPeriod_ms    The time between callbacks; the time the callback has to mix.
+// _latency_ms           The estimated delay between playing a sound and hearing it.
+//
+struct AudioStats
+{
+  int64_t _callbacks;
+  int64_t _underruns;
+  int _chunkResizes;
+  float _averageCallback_ms;
+  float _maxCallback_ms;
+  float _averageEffects_ms;
+  float _callbackPeriod_ms;
+  float _latency_ms;
+};
+
+AudioStats getAudioStats();
+
 //////////////////////////////////////////////////////////////////////////////////////////////////
 // SOUND EFFECTS
 //////////////////////////////////////////////////////////////////////////////////////////////////
@@ -151,19 +218,86 @@ extern ResourceKey_t errorSoundKey;
 //
 // Returned resource keys are always positive.
 //
+// Sounds are converted to the sampling rate, channel count and sample format of the mixer at
+// load time. Both pcm and ima adpcm wave files are supported; see the pxr_wav2adpcm tool.
+//
 ResourceKey_t loadSoundWAV(ResourceName_t soundName);
 
+//
+// Load a sound synthesized from a patch (see pxr_synth.h) rather than a wave file. The patch is
+// rendered in the mixer's format when loaded, so plays exactly as a loaded wave sound would,
+// and is reference counted and cached by name in the same way; a patch loaded under a name
+// already loaded returns the existing sound whatever the patch.
+//
+// Sound names are shared with loadSoundWAV so should not clash with the names of wave files.
+//
+ResourceKey_t loadSoundSynth(ResourceName_t soundName, const synth::Patch& patch);
+
 //
 // Adds a sound to the queue of sounds waiting to be unloaded. Sounds in the queue are unloaded
 // once all channels have stopped using it. A call to this function will only actually queue a 
 // sound if its reference count drops to 0. Thus it is necessary to unload a sound an equal
 // number of times to which it was loaded.
 //
+// Sounds whose reference count drops to 0 are released to the resource cache (see pxr_cache.h)
+// and remain resident until evicted to stay within the cache memory budget.
+//
 void queueUnloadSound(ResourceKey_t soundKey);
 
+//
+// The playback policy of a sound; controls what happens when a sound is played in bursts or
+// when all channels are busy.
+//
+// PROPERTY              ROLE
+// --------              ----
+//
+// _priority             When all channels are busy a sound steals the channel of a sound of
+//                       equal or lower priority; lower priority sounds are stolen first, then
+//                       the quietest (by channel volume) and then the oldest. If every channel
+//                       plays a higher priority sound the new sound is dropped.
+//
+// _maxInstances         The maximum number of channels which can play the sound at once;
+//                       UNLIMITED_INSTANCES for no limit.
+//
+// _stealOldestInstance  When at max instances, restart the oldest instance rather than drop
+//                       the new one.
+//
+// _cooldown_ms          Plays of the sound within this duration of its last play are dropped;
+//                       timed on the clock advanced by onUpdate.
+//
+// Stolen sounds are faded out over a few milliseconds rather than cut.
+//
+static constexpr int DEFAULT_SOUND_PRIORITY {0};
+static constexpr int UNLIMITED_INSTANCES {0};
+
+struct SoundPolicy
+{
+  int _priority {DEFAULT_SOUND_PRIORITY};
+  int _maxInstances {UNLIMITED_INSTANCES};
+  bool _stealOldestInstance {true};
+  int _cooldown_ms {0};
+};
+
+void setSoundPolicy(ResourceKey_t soundKey, SoundPolicy policy);
+
+//
+// Counts of the outcomes of play calls since initialization. Dropped plays are only counted,
+// not logged, so bursts of plays cost next to nothing when they fail.
+//
+struct PlaybackStats
+{
+  int64_t _played;
+  int64_t _stolen;
+  int64_t _droppedCooldown;
+  int64_t _droppedInstances;
+  int64_t _droppedNoChannel;
+};
+
+const PlaybackStats& getPlaybackStats();
+
 //
 // Play a sound. These functions return the channel the sound is playing on which can be used to
-// manipulate the playback.
+// manipulate the playback, or NULL_CHANNEL if the play was dropped (see SoundPolicy).
 //
 SoundChannel_t playSound(ResourceKey_t soundKey, int loops = NO_LOOPS);
 SoundChannel_t playSoundTimed(ResourceKey_t soundKey, int loops, int playDuration_ms);
@@ -197,6 +331,13 @@ void setChannelVolume(SoundChannel_t channel, int volume);
 //
 int getChannelVolume(SoundChannel_t channel);
 
+//
+// Pans a channel between the left (-1) and right (1) speakers; 0 is center. Has no effect on
+// mono output. As with volume the pan is a property of the channel and so persists between
+// sounds played on it. Volume and pan changes are ramped so never click.
+//
+void setChannelPan(SoundChannel_t channel, float pan);
+
 int getMusicVolume();
 
 
@@ -204,8 +345,19 @@ int getMusicVolume();
 // MUSIC FUNCTIONS
 //////////////////////////////////////////////////////////////////////////////////////////////////
 
-static constexpr float PLAY_MUSIC_FOREVER {std::numeric_limits<float>::max()};
+//
+// Pass as the play duration of a node to play it until the music is stopped.
+//
+static constexpr int PLAY_MUSIC_FOREVER {std::numeric_limits<int>::max()};
 
+//
+// A node loops its music for _playDuration_ms, which includes its fade in and fade out. The
+// next node of the sequence starts as this node begins its fade out, so the fade out and the
+// next node's fade in overlap as a crossfade; without fades nodes join without a gap.
+//
+// Nodes are timed in the audio callback to the sample, so transitions do not drift with the
+// frame rate and land on the beat however long the game's frames take.
+//
 struct MusicSequenceNode
 {
   ResourceKey_t _musicKey;
@@ -216,6 +368,13 @@ struct MusicSequenceNode
 
 using MusicSequence_t = std::vector<MusicSequenceNode>;
 
+//
+// Music is decoded into memory (in the mixer's format) when loaded, so playing it never
+// touches the disk. Both pcm and ima adpcm wave files are supported.
+//
+// Music is not played on the sound channels and so is unaffected by the channel functions.
+// Loaded music is released to the resource cache like sounds once fully unloaded.
+//
 ResourceKey_t loadMusicWAV(ResourceName_t musicName);
 void queueUnloadMusic(ResourceKey_t musicKey);
 void playMusic(MusicSequence_t sequence, bool loop = true);
@@ -228,6 +387,50 @@ bool isMusicFadingIn();
 bool isMusicFadingOut();
 void setMusicVolume(int volume);
 
+//
+// Music plays through the mixer's music bus (see mixer::Bus) on which the module inserts a gain
+// and a low-pass filter; ducking glides the music down to PAUSE_DUCK_GAIN and muffles it to
+// PAUSE_DUCK_CUTOFF_HZ over about PAUSE_DUCK_GLIDE_MS, and undoing it glides back. The engine
+// ducks the music whilst the game is paused rather than stopping it. Games are free to insert
+// their own effects on either bus with mixer::insertEffect.
+//
+static constexpr float PAUSE_DUCK_GAIN {0.35f};
+static constexpr float PAUSE_DUCK_CUTOFF_HZ {900.f};
+static constexpr float PAUSE_DUCK_GLIDE_MS {250.f};
+
+void duckMusic(bool isDucked);
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+// OFFLINE RENDERING
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+//
+// Called by renderOffline at the start of every tick with the time rendered so far; use it to
+// play sounds and music at scripted times.
+//
+using RenderTick_t = void (*)(float clock_s);
+
+//
+// Renders duration_s seconds of the module's output to a 16-bit wave file as fast as the mixer
+// can go, rather than in real time. Only valid if the module was initialized offline.
+//
+// Time is virtual: every tick calls onTick, then onUpdate with tickPeriod_s, and then mixes
+// the frames up to the new time. Since nothing depends on the wall clock the same script
+// always renders the same samples, so renders can be compared against reference renders to
+// catch regressions, and timed to measure mixer throughput.
+//
+// Music plays on the mixer's music track exactly as it does online.
+//
+bool renderOffline(std::string wavpath, float duration_s, float tickPeriod_s, RenderTick_t onTick);
+
+//
+// Mixes the frames up to dt_s past the time last advanced to and discards them; a null audio
+// device for offline modules driven by a clock of their own (e.g. by pxr_bench), so sounds and
+// music play, finish and cost mixing time as they would online. Call after onUpdate each tick.
+// Only valid if the module was initialized offline.
+//
+void advanceOffline(float dt_s);
+
 } // namespace sfx
 } // namespace pxr
 
@@ -0,0 +1,93 @@
+#ifndef _PIXIRETRO_SPSC_H_
+#define _PIXIRETRO_SPSC_H_
+
+#include <atomic>
+#include <vector>
+#include <cstddef>
+#include <cassert>
+
+namespace pxr
+{
+
+//
+// A wait-free single-producer single-consumer ring buffer for passing messages between two
+// threads, e.g. the game thread and the audio thread, without locks.
+//
+// Exactly one thread may push and exactly one (other) thread may pop. Neither push nor pop ever
+// blocks or allocates; push fails if the queue is full and pop fails if it is empty. Items are
+// copied in and out so should be small trivially copyable types.
+//
+// The capacity is rounded up to a power of 2 and fixed at construction (or reset, which is not
+// thread safe).
+//
+template<typename T>
+class SPSCQueue
+{
+public:
+  SPSCQueue() : SPSCQueue(1) {}
+  explicit SPSCQueue(int capacity) {reset(capacity);}
+
+  SPSCQueue(const SPSCQueue&) = delete;
+  SPSCQueue& operator=(const SPSCQueue&) = delete;
+
+  //
+  // Empties the queue and changes its capacity; must not be called whilst either thread may
+  // be using the queue.
+  //
+  void reset(int capacity)
+  {
+    assert(capacity > 0);
+    size_t size {1};
+    while(size < static_cast<size_t>(capacity))
+      size <<= 1;
+    _buffer.assign(size, T{});
+    _mask = size - 1;
+    _head.store(0, std::memory_order_relaxed);
+    _tail.store(0, std::memory_order_relaxed);
+  }
+
+  //
+  // Producer only.
+  //
+  bool push(const T& item)
+  {
+    size_t tail = _tail.load(std::memory_order_relaxed);
+    if(tail - _head.load(std::memory_order_acquire) == _buffer.size())
+      return false;
+    _buffer[tail & _mask] = item;
+    _tail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  //
+  // Consumer only.
+  //
+  bool pop(T& item)
+  {
+    size_t head = _head.load(std::memory_order_relaxed);
+    if(head == _tail.load(std::memory_order_acquire))
+      return false;
+    item = _buffer[head & _mask];
+    _head.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  int getCapacity() const {return static_cast<int>(_buffer.size());}
+
+private:
+
+  //
+  // The head and tail indices only ever increase; they are masked to index the buffer. Each
+  // sits on its own cache line so the two threads do not contend for the same line.
+  //
+  static constexpr size_t CACHE_LINE_SIZE {64};
+
+  std::vector<T> _buffer;
+  size_t _mask;
+  alignas(CACHE_LINE_SIZE) std::atomic<size_t> _head;
+  alignas(CACHE_LINE_SIZE) std::atomic<size_t> _tail;
+};
+
+} // namespace pxr
+
+#endif
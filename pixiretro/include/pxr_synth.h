@@ -0,0 +1,127 @@
+#ifndef _PIXIRETRO_SYNTH_H_
+#define _PIXIRETRO_SYNTH_H_
+
+#include <cinttypes>
+#include <string>
+#include <vector>
+
+namespace pxr
+{
+namespace synth
+{
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// PIXIRETRO CHIPTUNE SYNTHESIZER
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Synthesizes retro sound effects from a handful of parameters (a patch) in the manner of the
+// sound chips of 8-bit consoles: a single oscillator shaped by an ADSR envelope, with pitch and
+// duty cycle sweeps. A patch is a few dozen bytes in place of a wave file, and rendering one
+// touches no disk.
+//
+// Oscillators are deliberately naive (no band limiting) as were the chips they imitate. Noise
+// is generated by a 15-bit linear feedback shift register, as on the NES, so a patch always
+// renders the same samples.
+//
+// Patches are rendered whole into signed 16-bit samples which can be handed to the mixer as
+// is; see sfx::loadSoundSynth which renders and caches patches as sounds.
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+enum Waveform
+{
+  WAVE_SQUARE,     // a pulse with a fixed 50% duty cycle.
+  WAVE_PULSE,      // a pulse with a variable (and sweepable) duty cycle.
+  WAVE_TRIANGLE,
+  WAVE_NOISE       // the frequency is the rate at which the shift register is clocked / 16.
+};
+
+//
+// The range of oscillator frequencies; sweeps are clamped to this range.
+//
+static constexpr float MIN_FREQUENCY_HZ {10.f};
+static constexpr float MAX_FREQUENCY_HZ {20000.f};
+
+//
+// The range of pulse duty cycles; sweeps are clamped to this range.
+//
+static constexpr float MIN_DUTY {0.05f};
+static constexpr float MAX_DUTY {0.95f};
+
+//
+// The longest sound a patch can describe; longer envelopes are cut short when rendered
+// and rejected when parsed.
+//
+static constexpr float MAX_DURATION_S {10.f};
+
+//
+// The parameters of a synthesized sound.
+//
+// PROPERTY              ROLE
+// --------              ----
+//
+// _waveform             The oscillator.
+//
+// _frequency_hz         The starting pitch.
+//
+// _sweep_oct_per_s      Pitch sweep in octaves per second; positive sweeps up (e.g. a jump or
+//                       coin), negative down (e.g. a fall or laser). Sweeps are exponential so
+//                       sound even across octaves.
+//
+// _duty                 The fraction of the period a pulse is high; pulse only.
+//
+// _dutySweep_per_s      The change in duty per second; pulse only.
+//
+// _attack_s             Envelope durations. The level rises linearly from silence to full over
+// _decay_s              the attack, falls to the sustain level over the decay, holds for the
+// _sustain_s            sustain and falls to silence over the release. The sound lasts the sum
+// _release_s            of the four.
+//
+// _sustainLevel         The level held during the sustain in [0, 1].
+//
+// _volume               The peak level in [0, 1].
+//
+struct Patch
+{
+  Waveform _waveform       {WAVE_SQUARE};
+  float _frequency_hz      {440.f};
+  float _sweep_oct_per_s   {0.f};
+  float _duty              {0.5f};
+  float _dutySweep_per_s   {0.f};
+  float _attack_s          {0.f};
+  float _decay_s           {0.05f};
+  float _sustain_s         {0.05f};
+  float _release_s         {0.1f};
+  float _sustainLevel      {0.5f};
+  float _volume            {0.5f};
+};
+
+//
+// Returns the duration of the sound a patch describes, clamped to MAX_DURATION_S.
+//
+float calculateDuration(const Patch& patch);
+
+//
+// Renders a patch to signed 16-bit samples with numChannels interleaved (identical) channels.
+//
+std::vector<int16_t> render(const Patch& patch, int sampleRate_hz, int numChannels);
+
+//
+// Parses a patch from its compact text form; a waveform name followed by any of the
+// properties as name=value pairs separated by whitespace, e.g.
+//
+//    "pulse freq=880 sweep=-3 duty=0.25 decay=0.05 sustain=0.1 release=0.2 level=0.4"
+//
+// names:  freq, sweep, duty, dutysweep, attack, decay, sustain, release, level, volume
+//
+// Properties not given keep their defaults. Returns false if the text is malformed or the
+// envelope is longer than MAX_DURATION_S, in which case patch is left unmodified.
+//
+bool parsePatch(const std::string& text, Patch& patch);
+
+} // namespace synth
+} // namespace pxr
+
+#endif
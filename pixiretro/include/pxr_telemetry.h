@@ -0,0 +1,145 @@
+#ifndef _PIXIRETRO_TELEMETRY_H_
+#define _PIXIRETRO_TELEMETRY_H_
+
+#include <cinttypes>
+#include <array>
+#include <chrono>
+#include <string>
+
+namespace pxr
+{
+namespace telemetry
+{
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// PIXIRETRO FRAME TELEMETRY
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Records how long each phase of the engine's frame takes so frame spikes can be traced to the
+// phase which caused them. The engine times its phases every frame; the durations are kept in
+// a fixed size ring per phase (the last RING_SIZE samples) from which percentiles are computed
+// on demand and exported as csv or json.
+//
+// Recording never allocates or locks; each phase is recorded by one thread only (with threaded
+// updates the update phases by the simulation thread, the rest by the main thread) and the
+// stats may be computed from any thread, in which case they may include a sample or two which
+// is being overwritten as they are computed.
+//
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+//
+// PHASE                 TIMES
+// -----                 -----
+//
+// PHASE_FRAME           A whole pass of the main loop, sleep included.
+// PHASE_EVENTS          Polling and handling the SDL event queue.
+// PHASE_UPDATE_TICK     A whole update tick; one sample per tick.
+// PHASE_SCENE_UPDATE    The game's (active scene's) part of an update tick.
+// PHASE_HUD_UPDATE      Updating a HUD (see pxr_hud.h).
+// PHASE_RASTER          Drawing the game and engine screens into their pixel buffers.
+// PHASE_HUD_DRAW        Drawing a HUD; part of the raster.
+// PHASE_PRESENT         Presenting the screens to the window, including the buffer swap.
+// PHASE_SLEEP           The sleep at the end of a frame.
+//
+enum Phase
+{
+  PHASE_FRAME,
+  PHASE_EVENTS,
+  PHASE_UPDATE_TICK,
+  PHASE_SCENE_UPDATE,
+  PHASE_HUD_UPDATE,
+  PHASE_RASTER,
+  PHASE_HUD_DRAW,
+  PHASE_PRESENT,
+  PHASE_SLEEP,
+  PHASE_COUNT
+};
+
+static constexpr std::array<const char*, PHASE_COUNT> phaseNames {
+  "frame",
+  "events",
+  "update_tick",
+  "scene_update",
+  "hud_update",
+  "raster",
+  "hud_draw",
+  "present",
+  "sleep"
+};
+
+//
+// The number of samples kept per phase; about 17 seconds of frames at 60hz.
+//
+static constexpr int RING_SIZE {1024};
+
+using Clock_t = std::chrono::steady_clock;
+
+//
+// Records a sample of the duration of a phase.
+//
+void record(Phase phase, float duration_ms);
+
+//
+// Times its scope as a sample of a phase.
+//
+class ScopedPhase
+{
+public:
+  explicit ScopedPhase(Phase phase) : _phase{phase}, _start{Clock_t::now()} {}
+  ~ScopedPhase()
+  {
+    record(_phase, std::chrono::duration<float, std::milli>(Clock_t::now() - _start).count());
+  }
+
+  ScopedPhase(const ScopedPhase&) = delete;
+  ScopedPhase& operator=(const ScopedPhase&) = delete;
+
+private:
+  Phase _phase;
+  Clock_t::time_point _start;
+};
+
+//
+// Statistics of the samples of a phase currently in its ring; all zero if it has none.
+//
+struct PhaseStats
+{
+  int _samples      = 0;
+  float _mean_ms    = 0.f;
+  float _p50_ms     = 0.f;
+  float _p95_ms     = 0.f;
+  float _p99_ms     = 0.f;
+  float _max_ms     = 0.f;
+};
+
+PhaseStats calculateStats(Phase phase);
+
+//
+// Discards all samples.
+//
+void clear();
+
+enum ExportFormat
+{
+  EXPORT_NONE,
+  EXPORT_CSV,
+  EXPORT_JSON
+};
+
+//
+// The file extensions of the export formats.
+//
+static constexpr std::array<const char*, EXPORT_JSON + 1> exportExtensions {"", ".csv", ".json"};
+
+//
+// Writes the stats of every phase to a file; a row per phase in csv, an object per phase in
+// json. Returns false if the file could not be written.
+//
+bool exportStats(const std::string& filepath, ExportFormat format);
+
+} // namespace telemetry
+} // namespace pxr
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef _PIXIRETRO_TRIPLE_H_
+#define _PIXIRETRO_TRIPLE_H_
+
+#include <atomic>
+#include <cstdint>
+
+namespace pxr
+{
+
+//
+// A wait-free triple buffer for handing snapshots of state from one thread to another, e.g.
+// draw state from the update thread to the render thread, without locks.
+//
+// Exactly one thread may write and exactly one (other) thread may read. The writer fills the
+// write buffer and publishes it; the reader acquires the latest published buffer and reads it
+// until its next acquire. Neither ever waits for the other: the writer always has a buffer to
+// fill, the reader always has one to read, and the third holds the latest published snapshot
+// between them. Snapshots the reader is too slow to acquire are dropped, never queued, so the
+// reader always sees the newest state and never a torn one.
+//
+// The write buffer is recycled and so holds an old snapshot; the writer must overwrite all of
+// it before publishing. The read buffer is value initialized until the first acquire.
+//
+template<typename T>
+class TripleBuffer
+{
+public:
+  TripleBuffer() : _buffers{}, _writeIndex{0}, _readIndex{1}, _middle{2} {}
+
+  TripleBuffer(const TripleBuffer&) = delete;
+  TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+  //
+  // Writer only.
+  //
+  T& getWriteBuffer() {return _buffers[_writeIndex];}
+
+  //
+  // Writer only. Swaps the write buffer with the middle so it becomes the latest snapshot.
+  //
+  void publish()
+  {
+    uint8_t old = _middle.exchange(_writeIndex | FRESH_BIT, std::memory_order_acq_rel);
+    _writeIndex = old & INDEX_MASK;
+  }
+
+  //
+  // Reader only. Swaps the read buffer with the middle if a snapshot has been published since
+  // the last acquire; returns whether it did.
+  //
+  bool acquire()
+  {
+    if(!(_middle.load(std::memory_order_relaxed) & FRESH_BIT))
+      return false;
+    uint8_t old = _middle.exchange(_readIndex, std::memory_order_acq_rel);
+    _readIndex = old & INDEX_MASK;
+    return true;
+  }
+
+  //
+  // Reader only.
+  //
+  const T& getReadBuffer() const {return _buffers[_readIndex];}
+
+private:
+
+  //
+  // The middle packs the index of the middle buffer with a flag set by publish and cleared by
+  // acquire, so both are swapped in one atomic exchange.
+  //
+  static constexpr uint8_t INDEX_MASK {0x3};
+  static constexpr uint8_t FRESH_BIT {0x4};
+
+  T _buffers[3];
+  uint8_t _writeIndex;
+  uint8_t _readIndex;
+  std::atomic<uint8_t> _middle;
+};
+
+} // namespace pxr
+
+#endif
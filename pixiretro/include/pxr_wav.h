@@ -2,6 +2,8 @@
 #define _PIXIRETRO_WAVSOUND_H_
 
 #include <string>
+#include <vector>
+#include <fstream>
 #include <cinttypes>
 
 namespace pxr
@@ -12,29 +14,68 @@ namespace io
 //
 // Represent a wave (.wav) sound file.
 //
-// This class only supports wave sounds with:
-//      
-//      sample depths == 8 or 16
-//      num channels  == 1 or 2
+// This class supports wave sounds with:
 //
-// i.e. mono8, mono16, stereo8 or stereo16.
+//      encoding      == integer pcm, ieee float (plain or extensible format) or ima adpcm
+//      sample depths == 8, 16, 24 or 32 (float must be 32, ima adpcm is 4)
+//      num channels  == 1 to 8
+//
+// Chunks other than the format, fact and data chunks (e.g. LIST, bext, JUNK) are skipped.
+//
+// Whatever the source encoding, the loaded sound is held as signed 16-bit samples interleaved
+// with the left channel first (lower index). The sound can optionally be converted at load time
+// to a target sampling rate and channel count (mono or stereo), such that the data can be handed
+// to the mixer as is.
 //
 class Wav
 {
 public:
   static constexpr const char* FILE_EXTENSION {".wav"};
 
+  //
+  // Pass as a target to keep the sampling rate or channel count of the file.
+  //
+  static constexpr int KEEP_SOURCE {0};
+
+  //
+  // The encodings which can be written by save.
+  //
+  enum Encoding
+  {
+    ENCODING_PCM16,
+    ENCODING_IMA_ADPCM
+  };
+
 public:
   Wav();
-  ~Wav();
+  ~Wav() = default;
 
-  bool load(std::string filepath);
+  bool load(std::string filepath, int targetSampleRate_hz = KEEP_SOURCE, int targetNumChannels = KEEP_SOURCE);
 
-  const void* getSampleData() const {return reinterpret_cast<void*>(_waveData);}
-  int getSampleDataSize() const {return _waveSizeBytes;}
+  //
+  // Replaces the sound with signed 16-bit samples interleaved with the left channel first,
+  // e.g. to save generated or rendered sound.
+  //
+  void create(std::vector<int16_t> samples, int sampleRate_hz, int numChannels);
+
+  //
+  // Writes the sound to a wave file. blockAlign is the adpcm block size in bytes; 0 selects the
+  // codec default.
+  //
+  bool save(std::string filepath, Encoding encoding = ENCODING_PCM16, int blockAlign = 0) const;
+
+  //
+  // Encodes the sound as the bytes of a wave file, as would be written by save.
+  //
+  bool encode(std::vector<uint8_t>& bytes, Encoding encoding = ENCODING_PCM16, int blockAlign = 0) const;
+
+  const int16_t* getSampleData() const {return _samples.data();}
+  int getSampleDataSize() const {return static_cast<int>(_samples.size() * sizeof(int16_t));}
+  int getSampleCount() const {return static_cast<int>(_samples.size());}
+  int getFrameCount() const {return _numChannels ? getSampleCount() / _numChannels : 0;}
   int getSampleRate() const {return _sampleRate;}
   int getNumChannels() const {return _numChannels;}
-  int getBitsPerSample() const {return _bitsPerSample;}
+  int getBitsPerSample() const {return _bitsPerSample;}   // always 16 once loaded.
 
 private:
 
@@ -44,8 +85,19 @@ private:
   static constexpr int32_t RIFFMAGIC   {0x46464952};
   static constexpr int32_t WAVEMAGIC   {0x45564157};
   static constexpr int32_t FORMATMAGIC {0x20746d66};
+  static constexpr int32_t FACTMAGIC   {0x74636166};
   static constexpr int32_t DATAMAGIC   {0x61746164};
 
+  //
+  // Values of the audio format field of the format chunk.
+  //
+  static constexpr int16_t FORMAT_PCM        {0x0001};
+  static constexpr int16_t FORMAT_IEEE_FLOAT {0x0003};
+  static constexpr int16_t FORMAT_IMA_ADPCM  {0x0011};
+  static constexpr int16_t FORMAT_EXTENSIBLE {static_cast<int16_t>(0xfffe)};
+
+  static constexpr int MAX_CHANNELS {8};
+
   //
   // Used to guard against excessive file sizes.
   //
@@ -59,10 +111,19 @@ private:
     int32_t _waveMagic;
   };
 
-  struct FormatSubChunk
+  struct ChunkHeader
+  {
+    int32_t _magic;
+    int32_t _size;
+  };
+
+  //
+  // The leading fields common to all format chunks; extensible formats follow this with an
+  // extension whose first two bytes of the sub format guid hold the actual audio format, and
+  // ima adpcm with an extension holding the samples per block.
+  //
+  struct FormatChunk
   {
-    int32_t _formatMagic;
-    int32_t _subChunkSize;
     int16_t _audioFormat;
     int16_t _numChannels;
     int32_t _sampleRate;
@@ -71,25 +132,38 @@ private:
     int16_t _bitsPerSample;
   };
 
-  struct DataSubChunk
+  static constexpr int FORMAT_EXTENSIBLE_SIZE {40};
+  static constexpr int FORMAT_EXTENSIBLE_SUBFORMAT_OFFSET {24};
+  static constexpr int FORMAT_IMA_ADPCM_SIZE {20};
+  static constexpr int FORMAT_IMA_ADPCM_SAMPLES_PER_BLOCK_OFFSET {18};
+
+  //
+  // The validated layout of a wave file; where its sample data is and how it is encoded.
+  //
+  struct Layout
   {
-    int32_t _dataMagic;
-    int32_t _subChunkSize;
+    FormatChunk _fmt;
+    int _samplesPerBlock;       // adpcm only.
+    int64_t _frameCount;
+    std::streamoff _dataOffset;
+    int64_t _dataSize;
   };
 
 private:
   void unload();
 
+  //
+  // Walks the chunks of an open wave file to find its layout. Logs and returns false if the
+  // file is not a wave file or uses an unsupported encoding.
+  //
+  static bool readLayout(std::ifstream& file, const std::string& filepath, Layout& layout);
+
 private:
 
   //
-  // Raw wave sound data. For stereo data the samples are interleaved with the left channel
-  // coming first (lower index) than the right. This formatting is such as to be compatible
-  // with openal.
+  // Signed 16-bit samples interleaved with the left channel first.
   //
-  char* _waveData;
-
-  int _waveSizeBytes;
+  std::vector<int16_t> _samples;
   int _sampleRate;
   int _bitsPerSample;
   int _numChannels;
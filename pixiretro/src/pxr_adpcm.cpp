@@ -0,0 +1,161 @@
+#include <algorithm>
+#include <cstring>
+#include <cassert>
+#include "../include/pxr_adpcm.h"
+
+namespace pxr
+{
+namespace io
+{
+namespace adpcm
+{
+
+static constexpr int indexTable[16] {
+  -1, -1, -1, -1, 2, 4, 6, 8,
+  -1, -1, -1, -1, 2, 4, 6, 8
+};
+
+static constexpr int STEP_INDEX_MAX {88};
+
+static constexpr int stepTable[STEP_INDEX_MAX + 1] {
+  7, 8, 9, 10, 11, 12, 13, 14, 16, 17,
+  19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+  50, 55, 60, 66, 73, 80, 88, 97, 107, 118,
+  130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
+  337, 371, 408, 449, 494, 544, 598, 658, 724, 796,
+  876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+  2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358,
+  5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+  15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+
+static constexpr int BYTES_PER_GROUP {4};
+static constexpr int SAMPLES_PER_GROUP {8};
+
+static inline int16_t decodeNibble(ChannelState& state, int nibble)
+{
+  int step = stepTable[state._stepIndex];
+  int delta = step >> 3;
+  if(nibble & 4) delta += step;
+  if(nibble & 2) delta += step >> 1;
+  if(nibble & 1) delta += step >> 2;
+  state._predictor += (nibble & 8) ? -delta : delta;
+  state._predictor = std::clamp(state._predictor, -32768, 32767);
+  state._stepIndex = std::clamp(state._stepIndex + indexTable[nibble], 0, STEP_INDEX_MAX);
+  return static_cast<int16_t>(state._predictor);
+}
+
+//
+// Quantizes the difference between the sample and the prediction to a nibble; updates the
+// state exactly as the decoder will so the two never drift apart.
+//
+static inline int encodeNibble(ChannelState& state, int sample)
+{
+  int step = stepTable[state._stepIndex];
+  int difference = sample - state._predictor;
+  int nibble {0};
+  if(difference < 0){
+    nibble = 8;
+    difference = -difference;
+  }
+  if(difference >= step){
+    nibble |= 4;
+    difference -= step;
+  }
+  step >>= 1;
+  if(difference >= step){
+    nibble |= 2;
+    difference -= step;
+  }
+  step >>= 1;
+  if(difference >= step)
+    nibble |= 1;
+
+  decodeNibble(state, nibble);
+  return nibble;
+}
+
+int calculateSamplesPerBlock(int blockAlign, int numChannels)
+{
+  if(numChannels <= 0)
+    return 0;
+  int dataBytes = blockAlign - (BLOCK_HEADER_BYTES_PER_CHANNEL * numChannels);
+  if(dataBytes < 0 || dataBytes % (BYTES_PER_GROUP * numChannels) != 0)
+    return 0;
+  return 1 + ((dataBytes / numChannels) * 2);
+}
+
+int calculateSamplesInBlock(int blockBytes, int numChannels)
+{
+  int dataBytes = blockBytes - (BLOCK_HEADER_BYTES_PER_CHANNEL * numChannels);
+  if(dataBytes < 0)
+    return 0;
+  int groupCount = dataBytes / (BYTES_PER_GROUP * numChannels);
+  return 1 + (groupCount * SAMPLES_PER_GROUP);
+}
+
+void decodeBlock(const uint8_t* block, int blockBytes, int numChannels, int16_t* dst)
+{
+  int samplesInBlock = calculateSamplesInBlock(blockBytes, numChannels);
+  if(samplesInBlock == 0)
+    return;
+
+  ChannelState states[MAX_CHANNELS];
+  assert(numChannels <= MAX_CHANNELS);
+
+  for(int c = 0; c < numChannels; ++c){
+    const uint8_t* header = block + (c * BLOCK_HEADER_BYTES_PER_CHANNEL);
+    int16_t first;
+    std::memcpy(&first, header, sizeof(first));
+    states[c]._predictor = first;
+    states[c]._stepIndex = std::min(static_cast<int>(header[2]), STEP_INDEX_MAX);
+    dst[c] = first;
+  }
+
+  const uint8_t* data = block + (BLOCK_HEADER_BYTES_PER_CHANNEL * numChannels);
+  int groupCount = (samplesInBlock - 1) / SAMPLES_PER_GROUP;
+  for(int g = 0; g < groupCount; ++g){
+    int16_t* frames = dst + ((1 + (g * SAMPLES_PER_GROUP)) * numChannels);
+    for(int c = 0; c < numChannels; ++c){
+      ChannelState& state = states[c];
+      for(int b = 0; b < BYTES_PER_GROUP; ++b){
+        uint8_t byte = *data++;
+        frames[((b * 2) + 0) * numChannels + c] = decodeNibble(state, byte & 0x0f);
+        frames[((b * 2) + 1) * numChannels + c] = decodeNibble(state, byte >> 4);
+      }
+    }
+  }
+}
+
+void encodeBlock(const int16_t* src, int blockAlign, int numChannels, ChannelState* states, uint8_t* block)
+{
+  int samplesPerBlock = calculateSamplesPerBlock(blockAlign, numChannels);
+  assert(samplesPerBlock > 0);
+
+  for(int c = 0; c < numChannels; ++c){
+    uint8_t* header = block + (c * BLOCK_HEADER_BYTES_PER_CHANNEL);
+    int16_t first = src[c];
+    std::memcpy(header, &first, sizeof(first));
+    header[2] = static_cast<uint8_t>(states[c]._stepIndex);
+    header[3] = 0;
+    states[c]._predictor = first;
+  }
+
+  uint8_t* data = block + (BLOCK_HEADER_BYTES_PER_CHANNEL * numChannels);
+  int groupCount = (samplesPerBlock - 1) / SAMPLES_PER_GROUP;
+  for(int g = 0; g < groupCount; ++g){
+    const int16_t* frames = src + ((1 + (g * SAMPLES_PER_GROUP)) * numChannels);
+    for(int c = 0; c < numChannels; ++c){
+      ChannelState& state = states[c];
+      for(int b = 0; b < BYTES_PER_GROUP; ++b){
+        int lo = encodeNibble(state, frames[((b * 2) + 0) * numChannels + c]);
+        int hi = encodeNibble(state, frames[((b * 2) + 1) * numChannels + c]);
+        *data++ = static_cast<uint8_t>(lo | (hi << 4));
+      }
+    }
+  }
+}
+
+} // namespace adpcm
+} // namespace io
+} // namespace pxr
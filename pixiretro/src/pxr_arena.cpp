@@ -0,0 +1,142 @@
+#include <new>
+#include <cstdio>
+#include <cstdarg>
+#include <cstdint>
+#include <algorithm>
+#include <cassert>
+#include "../include/pxr_arena.h"
+#include "../include/pxr_log.h"
+
+namespace pxr
+{
+
+static constexpr size_t BLOCK_ALIGNMENT {alignof(std::max_align_t)};
+
+static size_t alignUp(size_t value, size_t alignment)
+{
+  return (value + alignment - 1) & ~(alignment - 1);
+}
+
+LinearArena::LinearArena(size_t capacity, std::pmr::memory_resource* upstream) :
+  _upstream{upstream},
+  _block{nullptr},
+  _capacity{alignUp(capacity, BLOCK_ALIGNMENT)},
+  _used{0},
+  _highWater{0},
+  _overflows{nullptr},
+  _overflowBytes{0}
+{
+  assert(_upstream != nullptr);
+  if(_capacity > 0)
+    _block = static_cast<std::byte*>(_upstream->allocate(_capacity, BLOCK_ALIGNMENT));
+}
+
+LinearArena::~LinearArena()
+{
+  freeOverflows();
+  if(_block != nullptr)
+    _upstream->deallocate(_block, _capacity, BLOCK_ALIGNMENT);
+}
+
+void LinearArena::reset()
+{
+  size_t used = getUsed();
+  _highWater = std::max(_highWater, used);
+
+  if(_overflows != nullptr){
+    freeOverflows();
+
+    //
+    // Grow to half again the frame which overflowed, so frames which vary a little do not
+    // overflow again.
+    //
+    size_t capacity = alignUp(used + used / 2, BLOCK_ALIGNMENT);
+    if(_block != nullptr)
+      _upstream->deallocate(_block, _capacity, BLOCK_ALIGNMENT);
+    _block = static_cast<std::byte*>(_upstream->allocate(capacity, BLOCK_ALIGNMENT));
+    _capacity = capacity;
+    log::log(log::INFO, log::msg_arena_grown, std::to_string(_capacity));
+  }
+
+  _used = 0;
+}
+
+void* LinearArena::do_allocate(size_t bytes, size_t alignment)
+{
+  if(_block == nullptr)
+    return allocateOverflow(bytes, alignment);
+  auto address = reinterpret_cast<uintptr_t>(_block);
+  size_t offset = alignUp(address + _used, alignment) - address;
+  if(offset + bytes > _capacity)
+    return allocateOverflow(bytes, alignment);
+  _used = offset + bytes;
+  return _block + offset;
+}
+
+void LinearArena::do_deallocate(void*, size_t, size_t)
+{
+  // freed by reset.
+}
+
+bool LinearArena::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+{
+  return this == &other;
+}
+
+void* LinearArena::allocateOverflow(size_t bytes, size_t alignment)
+{
+  alignment = std::max(alignment, alignof(Overflow));
+  size_t headerSize = alignUp(sizeof(Overflow), alignment);
+  size_t total = headerSize + bytes;
+  auto* base = static_cast<std::byte*>(_upstream->allocate(total, alignment));
+  auto* overflow = new (base) Overflow{_overflows, total, alignment};
+  _overflows = overflow;
+  _overflowBytes += bytes;
+  return base + headerSize;
+}
+
+void LinearArena::freeOverflows()
+{
+  while(_overflows != nullptr){
+    Overflow* next = _overflows->_next;
+    _upstream->deallocate(_overflows, _overflows->_bytes, _overflows->_alignment);
+    _overflows = next;
+  }
+  _overflowBytes = 0;
+}
+
+namespace arena
+{
+
+LinearArena& getFrameArena()
+{
+  static thread_local LinearArena frameArena {FRAME_ARENA_CAPACITY};
+  return frameArena;
+}
+
+void resetFrame()
+{
+  getFrameArena().reset();
+}
+
+std::pmr::string formatFrameString(const char* format, ...)
+{
+  std::pmr::string str {&getFrameArena()};
+
+  va_list args;
+  va_start(args, format);
+  va_list argsCopy;
+  va_copy(argsCopy, args);
+  int length = std::vsnprintf(nullptr, 0, format, args);
+  va_end(args);
+
+  if(length > 0){
+    str.resize(static_cast<size_t>(length));
+    std::vsnprintf(str.data(), str.size() + 1, format, argsCopy);
+  }
+  va_end(argsCopy);
+  return str;
+}
+
+} // namespace arena
+} // namespace pxr
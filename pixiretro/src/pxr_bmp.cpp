@@ -13,6 +13,7 @@
 #include "../include/pxr_color.h"
 #include "../include/pxr_bmp.h"
 #include "../include/pxr_log.h"
+#include "../include/pxr_profile.h"
 
 namespace pxr
 {
@@ -93,6 +94,7 @@ const gfx::Color4u* Bmp::getRow(int row)
 
 bool Bmp::load(std::string filepath)
 {
+  PXR_PROFILE_ZONE("Bmp::load");
   std::ifstream file {filepath, std::ios_base::binary};
   if(!file){
     log::log(log::ERROR, log::msg_bmp_fail_open, filepath);
@@ -249,7 +251,7 @@ void Bmp::extractIndexedPixels(std::ifstream& file, FileHeader& fileHead, InfoHe
   // extract the color palette.
   std::vector<gfx::Color4u> palette {};
   file.seekg(FILEHEADER_SIZE_BYTES + infoHead._headerSize_bytes, std::ios::beg);
-  for(uint8_t i = 0; i < infoHead._numPaletteColors; ++i){
+  for(uint32_t i = 0; i < infoHead._numPaletteColors; ++i){
     char bytes[4];
     file.read(bytes, 4);
 
@@ -0,0 +1,252 @@
+#include <unordered_map>
+#include <list>
+#include <string>
+#include <cassert>
+#include <algorithm>
+#include "../include/pxr_cache.h"
+#include "../include/pxr_log.h"
+
+namespace pxr
+{
+namespace cache
+{
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+// MODULE DATA
+/////////////////////////////////////////////////////////////////////////////////////////////////
+
+struct LRUNode
+{
+  ResourceType _type;
+  Key_t _key;
+};
+
+using LRUList_t = std::list<LRUNode>;
+
+struct Entry
+{
+  int64_t _bytes;
+  bool _isWarm;
+  LRUList_t::iterator _lruPosition;   // valid only if warm.
+};
+
+static int64_t budgetBytes {DEFAULT_BUDGET_BYTES};
+
+//
+// Bookkeeping for all resident resources; one map for each resource type since the owning
+// modules assign keys from independent key spaces.
+//
+static std::array<std::unordered_map<Key_t, Entry>, RESOURCE_TYPE_COUNT> entries;
+
+//
+// Warm resources ordered by the time they became warm; front is least recently used.
+//
+static LRUList_t lru;
+
+static std::array<Evictor_t, RESOURCE_TYPE_COUNT> evictors;
+static std::array<Stats, RESOURCE_TYPE_COUNT> stats;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+// MODULE FUNCTIONS
+/////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int64_t calculateResidentBytes()
+{
+  int64_t total {0};
+  for(const auto& s : stats)
+    total += s._residentBytes;
+  return total;
+}
+
+static void evict(LRUList_t::iterator node)
+{
+  ResourceType type = node->_type;
+  Key_t key = node->_key;
+  auto search = entries[type].find(key);
+  assert(search != entries[type].end());
+
+  Stats& s = stats[type];
+  s._residentBytes -= search->second._bytes;
+  s._warmBytes -= search->second._bytes;
+  --s._residentCount;
+  --s._warmCount;
+  ++s._evictions;
+
+  entries[type].erase(search);
+  lru.erase(node);
+
+  std::string addendum {};
+  addendum += "[type:key]=[";
+  addendum += resourceTypeNames[type];
+  addendum += ":";
+  addendum += std::to_string(key);
+  addendum += "]";
+  log::log(log::INFO, log::msg_cache_evicted, addendum);
+}
+
+//
+// Evicts warm resources in LRU order until the resident size is within the budget or there are
+// no more evictable resources.
+//
+static void trim()
+{
+  int64_t residentBytes = calculateResidentBytes();
+  auto node = lru.begin();
+  while(residentBytes > budgetBytes && node != lru.end()){
+    Evictor_t evictor = evictors[node->_type];
+    assert(evictor != nullptr);
+    if(!evictor(node->_key)){
+      ++node;
+      continue;
+    }
+    auto victim = node++;
+    residentBytes -= entries[victim->_type].at(victim->_key)._bytes;
+    evict(victim);
+  }
+
+  if(residentBytes > budgetBytes){
+    std::string addendum {std::to_string(residentBytes / ONE_MEBIBYTE)};
+    addendum += "MiB > ";
+    addendum += std::to_string(budgetBytes / ONE_MEBIBYTE);
+    addendum += "MiB";
+    log::log(log::WARN, log::msg_cache_over_budget, addendum);
+  }
+}
+
+void initialize(int64_t budgetBytes_)
+{
+  budgetBytes = std::max(int64_t{0}, budgetBytes_);
+  log::log(log::INFO, log::msg_cache_budget, std::to_string(budgetBytes / ONE_MEBIBYTE) + "MiB");
+  evictors.fill(nullptr);
+  for(auto& map : entries)
+    map.clear();
+  for(auto& s : stats)
+    s = Stats{};
+  lru.clear();
+}
+
+void shutdown()
+{
+  for(auto& map : entries)
+    map.clear();
+  lru.clear();
+}
+
+void setEvictor(ResourceType type, Evictor_t evictor)
+{
+  assert(0 <= type && type < RESOURCE_TYPE_COUNT);
+  evictors[type] = evictor;
+}
+
+void setBudget(int64_t budgetBytes_)
+{
+  budgetBytes = std::max(int64_t{0}, budgetBytes_);
+  log::log(log::INFO, log::msg_cache_budget, std::to_string(budgetBytes / ONE_MEBIBYTE) + "MiB");
+  trim();
+}
+
+int64_t getBudget()
+{
+  return budgetBytes;
+}
+
+void onLoad(ResourceType type, Key_t key, int64_t bytes)
+{
+  assert(0 <= type && type < RESOURCE_TYPE_COUNT);
+  assert(entries[type].find(key) == entries[type].end());
+
+  entries[type].emplace(key, Entry{bytes, false, lru.end()});
+
+  Stats& s = stats[type];
+  s._residentBytes += bytes;
+  ++s._residentCount;
+  ++s._misses;
+
+  trim();
+}
+
+void onHit(ResourceType type, Key_t key)
+{
+  assert(0 <= type && type < RESOURCE_TYPE_COUNT);
+  auto search = entries[type].find(key);
+  if(search == entries[type].end())
+    return;
+
+  Entry& entry = search->second;
+  Stats& s = stats[type];
+  ++s._hits;
+
+  if(entry._isWarm){
+    lru.erase(entry._lruPosition);
+    entry._lruPosition = lru.end();
+    entry._isWarm = false;
+    s._warmBytes -= entry._bytes;
+    --s._warmCount;
+  }
+}
+
+void onRelease(ResourceType type, Key_t key)
+{
+  assert(0 <= type && type < RESOURCE_TYPE_COUNT);
+  auto search = entries[type].find(key);
+  if(search == entries[type].end())
+    return;
+
+  Entry& entry = search->second;
+  if(entry._isWarm)
+    return;
+
+  entry._isWarm = true;
+  entry._lruPosition = lru.insert(lru.end(), LRUNode{type, key});
+
+  Stats& s = stats[type];
+  s._warmBytes += entry._bytes;
+  ++s._warmCount;
+
+  trim();
+}
+
+bool isWarm(ResourceType type, Key_t key)
+{
+  assert(0 <= type && type < RESOURCE_TYPE_COUNT);
+  auto search = entries[type].find(key);
+  return search != entries[type].end() && search->second._isWarm;
+}
+
+void evictAll()
+{
+  auto node = lru.begin();
+  while(node != lru.end()){
+    Evictor_t evictor = evictors[node->_type];
+    assert(evictor != nullptr);
+    if(!evictor(node->_key)){
+      ++node;
+      continue;
+    }
+    evict(node++);
+  }
+}
+
+const Stats& getStats(ResourceType type)
+{
+  assert(0 <= type && type < RESOURCE_TYPE_COUNT);
+  return stats[type];
+}
+
+Stats getTotalStats()
+{
+  Stats total {};
+  for(const auto& s : stats){
+    total._residentBytes += s._residentBytes;
+    total._warmBytes += s._warmBytes;
+    total._residentCount += s._residentCount;
+    total._warmCount += s._warmCount;
+    total._hits += s._hits;
+    total._misses += s._misses;
+    total._evictions += s._evictions;
+  }
+  return total;
+}
+
+} // namespace cache
+} // namespace pxr
@@ -0,0 +1,784 @@
+#include <cmath>
+#include <numeric>
+#include <algorithm>
+#include <cassert>
+#include "../include/pxr_dsp.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace pxr
+{
+namespace dsp
+{
+
+static constexpr float S16_TO_FLOAT {1.f / 32768.f};
+static constexpr float FLOAT_TO_S16 {32767.f};
+
+static inline int16_t saturateS16(float sample)
+{
+  float scaled = sample * FLOAT_TO_S16;
+  scaled = std::min(std::max(scaled, -32768.f), 32767.f);
+  return static_cast<int16_t>(std::lrint(scaled));
+}
+
+void convertS16ToFloat(const int16_t* src, float* dst, int count)
+{
+  int i {0};
+#if defined(__SSE2__)
+  const __m128 scale = _mm_set1_ps(S16_TO_FLOAT);
+  for(; i + 8 <= count; i += 8){
+    __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16);   // sign extend.
+    __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16);
+    _mm_storeu_ps(dst + i + 0, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+    _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+  }
+#endif
+  for(; i < count; ++i)
+    dst[i] = src[i] * S16_TO_FLOAT;
+}
+
+void convertFloatToS16(const float* src, int16_t* dst, int count)
+{
+  int i {0};
+#if defined(__SSE2__)
+  const __m128 scale = _mm_set1_ps(FLOAT_TO_S16);
+  for(; i + 8 <= count; i += 8){
+    __m128i lo = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(src + i + 0), scale));
+    __m128i hi = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(src + i + 4), scale));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packs_epi32(lo, hi));
+  }
+#endif
+  for(; i < count; ++i)
+    dst[i] = saturateS16(src[i]);
+}
+
+void deinterleaveS16Stereo(const int16_t* src, float* left, float* right, int frameCount)
+{
+  int i {0};
+#if defined(__SSE2__)
+  const __m128 scale = _mm_set1_ps(S16_TO_FLOAT);
+  for(; i + 4 <= frameCount; i += 4){
+    __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + (i * 2)));
+    __m128 lo = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16)); // l0 r0 l1 r1
+    __m128 hi = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16)); // l2 r2 l3 r3
+    _mm_storeu_ps(left + i, _mm_mul_ps(_mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0)), scale));
+    _mm_storeu_ps(right + i, _mm_mul_ps(_mm_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1)), scale));
+  }
+#endif
+  for(; i < frameCount; ++i){
+    left[i] = src[(i * 2) + 0] * S16_TO_FLOAT;
+    right[i] = src[(i * 2) + 1] * S16_TO_FLOAT;
+  }
+}
+
+void interleaveFloatToS16Stereo(const float* left, const float* right, int16_t* dst, int frameCount)
+{
+  int i {0};
+#if defined(__SSE2__)
+  const __m128 scale = _mm_set1_ps(FLOAT_TO_S16);
+  for(; i + 8 <= frameCount; i += 8){
+    __m128i l = _mm_packs_epi32(
+      _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(left + i + 0), scale)),
+      _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(left + i + 4), scale))
+    );
+    __m128i r = _mm_packs_epi32(
+      _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(right + i + 0), scale)),
+      _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(right + i + 4), scale))
+    );
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + (i * 2) + 0), _mm_unpacklo_epi16(l, r));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + (i * 2) + 8), _mm_unpackhi_epi16(l, r));
+  }
+#endif
+  for(; i < frameCount; ++i){
+    dst[(i * 2) + 0] = saturateS16(left[i]);
+    dst[(i * 2) + 1] = saturateS16(right[i]);
+  }
+}
+
+void downmixStereoToMono(const float* left, const float* right, float* dst, int count)
+{
+  for(int i = 0; i < count; ++i)
+    dst[i] = (left[i] + right[i]) * 0.5f;
+}
+
+float dotProduct(const float* a, const float* b, int count)
+{
+  int i {0};
+  float sum {0.f};
+#if defined(__SSE2__)
+  __m128 acc0 = _mm_setzero_ps();
+  __m128 acc1 = _mm_setzero_ps();
+  for(; i + 8 <= count; i += 8){
+    acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i + 0), _mm_loadu_ps(b + i + 0)));
+    acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+  }
+  alignas(16) float lanes[4];
+  _mm_store_ps(lanes, _mm_add_ps(acc0, acc1));
+  sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#endif
+  for(; i < count; ++i)
+    sum += a[i] * b[i];
+  return sum;
+}
+
+void mixS16Mono(const int16_t* src, float* dst, int count, float gain, float gainStep)
+{
+  gain *= S16_TO_FLOAT;
+  gainStep *= S16_TO_FLOAT;
+  int i {0};
+#if defined(__SSE2__)
+  __m128 g0 = _mm_add_ps(_mm_set1_ps(gain), _mm_mul_ps(_mm_set1_ps(gainStep), _mm_setr_ps(0.f, 1.f, 2.f, 3.f)));
+  __m128 g1 = _mm_add_ps(g0, _mm_set1_ps(gainStep * 4.f));
+  const __m128 step = _mm_set1_ps(gainStep * 8.f);
+  for(; i + 8 <= count; i += 8){
+    __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    __m128 lo = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16));
+    __m128 hi = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16));
+    _mm_storeu_ps(dst + i + 0, _mm_add_ps(_mm_loadu_ps(dst + i + 0), _mm_mul_ps(lo, g0)));
+    _mm_storeu_ps(dst + i + 4, _mm_add_ps(_mm_loadu_ps(dst + i + 4), _mm_mul_ps(hi, g1)));
+    g0 = _mm_add_ps(g0, step);
+    g1 = _mm_add_ps(g1, step);
+  }
+#endif
+  for(; i < count; ++i)
+    dst[i] += src[i] * (gain + (gainStep * i));
+}
+
+void mixS16Stereo(const int16_t* src, float* dst, int frameCount, float gainLeft, float gainRight,
+                  float stepLeft, float stepRight)
+{
+  gainLeft *= S16_TO_FLOAT;
+  gainRight *= S16_TO_FLOAT;
+  stepLeft *= S16_TO_FLOAT;
+  stepRight *= S16_TO_FLOAT;
+  int i {0};
+#if defined(__SSE2__)
+  //
+  // Each vector holds two frames, l0 r0 l1 r1, so the lanes alternate between the left and
+  // right ramps.
+  //
+  __m128 g0 = _mm_setr_ps(gainLeft, gainRight, gainLeft + stepLeft, gainRight + stepRight);
+  __m128 g1 = _mm_add_ps(g0, _mm_setr_ps(stepLeft * 2.f, stepRight * 2.f, stepLeft * 2.f, stepRight * 2.f));
+  const __m128 step = _mm_setr_ps(stepLeft * 4.f, stepRight * 4.f, stepLeft * 4.f, stepRight * 4.f);
+  for(; i + 4 <= frameCount; i += 4){
+    float* d = dst + (i * 2);
+    __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + (i * 2)));
+    __m128 lo = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16));
+    __m128 hi = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16));
+    _mm_storeu_ps(d + 0, _mm_add_ps(_mm_loadu_ps(d + 0), _mm_mul_ps(lo, g0)));
+    _mm_storeu_ps(d + 4, _mm_add_ps(_mm_loadu_ps(d + 4), _mm_mul_ps(hi, g1)));
+    g0 = _mm_add_ps(g0, step);
+    g1 = _mm_add_ps(g1, step);
+  }
+#endif
+  for(; i < frameCount; ++i){
+    dst[(i * 2) + 0] += src[(i * 2) + 0] * (gainLeft + (stepLeft * i));
+    dst[(i * 2) + 1] += src[(i * 2) + 1] * (gainRight + (stepRight * i));
+  }
+}
+
+void addSamples(const float* src, float* dst, int count)
+{
+  int i {0};
+#if defined(__SSE2__)
+  for(; i + 4 <= count; i += 4)
+    _mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), _mm_loadu_ps(src + i)));
+#endif
+  for(; i < count; ++i)
+    dst[i] += src[i];
+}
+
+void scaleFrames(float* samples, int frameCount, int numChannels, float gain, float gainStep)
+{
+  int count = frameCount * numChannels;
+  int i {0};
+#if defined(__SSE2__)
+  if(numChannels == 1 || numChannels == 2){
+    //
+    // A vector holds 4 mono frames or 2 stereo frames.
+    //
+    int framesPerVector = 4 / numChannels;
+    __m128 lane = (numChannels == 1) ? _mm_setr_ps(0.f, 1.f, 2.f, 3.f) : _mm_setr_ps(0.f, 0.f, 1.f, 1.f);
+    __m128 g = _mm_add_ps(_mm_set1_ps(gain), _mm_mul_ps(_mm_set1_ps(gainStep), lane));
+    const __m128 step = _mm_set1_ps(gainStep * framesPerVector);
+    for(; i + 4 <= count; i += 4){
+      _mm_storeu_ps(samples + i, _mm_mul_ps(_mm_loadu_ps(samples + i), g));
+      g = _mm_add_ps(g, step);
+    }
+  }
+#endif
+  for(; i < count; ++i)
+    samples[i] *= gain + (gainStep * (i / numChannels));
+}
+
+void blendFrames(const float* dry, float* wet, int frameCount, int numChannels, float mix, float mixStep)
+{
+  int count = frameCount * numChannels;
+  int i {0};
+#if defined(__SSE2__)
+  if(numChannels == 1 || numChannels == 2){
+    int framesPerVector = 4 / numChannels;
+    __m128 lane = (numChannels == 1) ? _mm_setr_ps(0.f, 1.f, 2.f, 3.f) : _mm_setr_ps(0.f, 0.f, 1.f, 1.f);
+    __m128 m = _mm_add_ps(_mm_set1_ps(mix), _mm_mul_ps(_mm_set1_ps(mixStep), lane));
+    const __m128 step = _mm_set1_ps(mixStep * framesPerVector);
+    for(; i + 4 <= count; i += 4){
+      __m128 d = _mm_loadu_ps(dry + i);
+      __m128 w = _mm_loadu_ps(wet + i);
+      _mm_storeu_ps(wet + i, _mm_add_ps(d, _mm_mul_ps(_mm_sub_ps(w, d), m)));
+      m = _mm_add_ps(m, step);
+    }
+  }
+#endif
+  for(; i < count; ++i)
+    wet[i] = dry[i] + ((wet[i] - dry[i]) * (mix + (mixStep * (i / numChannels))));
+}
+
+void deinterleaveStereo(const float* src, float* left, float* right, int frameCount)
+{
+  int i {0};
+#if defined(__SSE2__)
+  for(; i + 4 <= frameCount; i += 4){
+    __m128 lo = _mm_loadu_ps(src + (i * 2) + 0);   // l0 r0 l1 r1
+    __m128 hi = _mm_loadu_ps(src + (i * 2) + 4);   // l2 r2 l3 r3
+    _mm_storeu_ps(left + i, _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0)));
+    _mm_storeu_ps(right + i, _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1)));
+  }
+#endif
+  for(; i < frameCount; ++i){
+    left[i] = src[(i * 2) + 0];
+    right[i] = src[(i * 2) + 1];
+  }
+}
+
+void interleaveStereo(const float* left, const float* right, float* dst, int frameCount)
+{
+  int i {0};
+#if defined(__SSE2__)
+  for(; i + 4 <= frameCount; i += 4){
+    __m128 l = _mm_loadu_ps(left + i);
+    __m128 r = _mm_loadu_ps(right + i);
+    _mm_storeu_ps(dst + (i * 2) + 0, _mm_unpacklo_ps(l, r));
+    _mm_storeu_ps(dst + (i * 2) + 4, _mm_unpackhi_ps(l, r));
+  }
+#endif
+  for(; i < frameCount; ++i){
+    dst[(i * 2) + 0] = left[i];
+    dst[(i * 2) + 1] = right[i];
+  }
+}
+
+float findPeak(const float* samples, int count)
+{
+  int i {0};
+  float peak {0.f};
+#if defined(__SSE2__)
+  const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+  __m128 acc = _mm_setzero_ps();
+  for(; i + 4 <= count; i += 4)
+    acc = _mm_max_ps(acc, _mm_and_ps(_mm_loadu_ps(samples + i), absMask));
+  alignas(16) float lanes[4];
+  _mm_store_ps(lanes, acc);
+  peak = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+#endif
+  for(; i < count; ++i)
+    peak = std::max(peak, std::fabs(samples[i]));
+  return peak;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+// LIMITER
+/////////////////////////////////////////////////////////////////////////////////////////////////
+
+Limiter::Limiter(float threshold, float release_ms, int sampleRate_hz) :
+  _threshold{threshold},
+  _releaseCoefficient{std::exp(-1.f / ((release_ms / 1000.f) * sampleRate_hz))},
+  _gain{1.f}
+{
+  assert(threshold > 0.f && release_ms > 0.f && sampleRate_hz > 0);
+}
+
+void Limiter::process(float* samples, int frameCount, int numChannels)
+{
+  //
+  // The common case; nothing to release and nothing to limit.
+  //
+  if(_gain == 1.f){
+    int count = frameCount * numChannels;
+    float peak {0.f};
+    for(int i = 0; i < count; ++i)
+      peak = std::max(peak, std::fabs(samples[i]));
+    if(peak <= _threshold)
+      return;
+  }
+
+  float gain = _gain;
+  for(int f = 0; f < frameCount; ++f){
+    float* frame = samples + (f * numChannels);
+    float peak {0.f};
+    for(int c = 0; c < numChannels; ++c)
+      peak = std::max(peak, std::fabs(frame[c]));
+
+    //
+    // Release towards unity gain but never above the gain which holds this frame at the
+    // threshold.
+    //
+    gain = 1.f - ((1.f - gain) * _releaseCoefficient);
+    if(peak * gain > _threshold)
+      gain = _threshold / peak;
+
+    for(int c = 0; c < numChannels; ++c)
+      frame[c] *= gain;
+  }
+  _gain = gain;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+// FILTERS
+/////////////////////////////////////////////////////////////////////////////////////////////////
+
+Biquad::Biquad() :
+  _b0{1.f}, _b1{0.f}, _b2{0.f}, _a1{0.f}, _a2{0.f},
+  _s1{0.f}, _s2{0.f}
+{
+  calculateBlockMatrix();
+}
+
+void Biquad::configure(Type type, float cutoff_hz, float q, int sampleRate_hz)
+{
+  assert(sampleRate_hz > 0);
+  double nyquist_hz = sampleRate_hz * 0.5;
+  double f0 = std::clamp<double>(cutoff_hz, 1.0, nyquist_hz * 0.98);
+  double w0 = 2.0 * M_PI * f0 / sampleRate_hz;
+  double cosw0 = std::cos(w0);
+  double alpha = std::sin(w0) / (2.0 * std::max(q, 0.01f));
+
+  double b0 {0.0}, b1 {0.0}, b2 {0.0};
+  switch(type){
+    case LOWPASS: {
+      b0 = (1.0 - cosw0) * 0.5;
+      b1 = 1.0 - cosw0;
+      b2 = b0;
+      break;
+    }
+    case HIGHPASS: {
+      b0 = (1.0 + cosw0) * 0.5;
+      b1 = -(1.0 + cosw0);
+      b2 = b0;
+      break;
+    }
+    case BANDPASS: {
+      b0 = alpha;
+      b1 = 0.0;
+      b2 = -alpha;
+      break;
+    }
+  }
+  double a0 = 1.0 + alpha;
+  _b0 = static_cast<float>(b0 / a0);
+  _b1 = static_cast<float>(b1 / a0);
+  _b2 = static_cast<float>(b2 / a0);
+  _a1 = static_cast<float>((-2.0 * cosw0) / a0);
+  _a2 = static_cast<float>((1.0 - alpha) / a0);
+  calculateBlockMatrix();
+}
+
+void Biquad::reset()
+{
+  _s1 = 0.f;
+  _s2 = 0.f;
+}
+
+void Biquad::processSample(float& sample)
+{
+  float x = sample;
+  float y = (_b0 * x) + _s1;
+  _s1 = (_b1 * x) - (_a1 * y) + _s2;
+  _s2 = (_b2 * x) - (_a2 * y);
+  sample = y;
+}
+
+//
+// Runs the filter over a block once for each block input set to 1 (and all others 0) to find
+// each input's contribution to the block's outputs and final states.
+//
+void Biquad::calculateBlockMatrix()
+{
+  float s1 = _s1;
+  float s2 = _s2;
+  for(int k = 0; k < BLOCK_INPUTS; ++k){
+    float block[BLOCK] {0.f, 0.f, 0.f, 0.f};
+    if(k < BLOCK)
+      block[k] = 1.f;
+    _s1 = (k == BLOCK + 0) ? 1.f : 0.f;
+    _s2 = (k == BLOCK + 1) ? 1.f : 0.f;
+    for(int n = 0; n < BLOCK; ++n){
+      processSample(block[n]);
+      _outputMatrix[k][n] = block[n];
+    }
+    _stateMatrix[k][0] = _s1;
+    _stateMatrix[k][1] = _s2;
+    _stateMatrix[k][2] = 0.f;
+    _stateMatrix[k][3] = 0.f;
+  }
+  _s1 = s1;
+  _s2 = s2;
+}
+
+void Biquad::process(float* samples, int count)
+{
+  int i {0};
+#if defined(__SSE2__)
+  __m128 outputColumns[BLOCK_INPUTS];
+  __m128 stateColumns[BLOCK_INPUTS];
+  for(int k = 0; k < BLOCK_INPUTS; ++k){
+    outputColumns[k] = _mm_load_ps(_outputMatrix[k]);
+    stateColumns[k] = _mm_load_ps(_stateMatrix[k]);
+  }
+  __m128 s1 = _mm_set1_ps(_s1);
+  __m128 s2 = _mm_set1_ps(_s2);
+  for(; i + BLOCK <= count; i += BLOCK){
+    __m128 x = _mm_loadu_ps(samples + i);
+    __m128 x0 = _mm_shuffle_ps(x, x, _MM_SHUFFLE(0, 0, 0, 0));
+    __m128 x1 = _mm_shuffle_ps(x, x, _MM_SHUFFLE(1, 1, 1, 1));
+    __m128 x2 = _mm_shuffle_ps(x, x, _MM_SHUFFLE(2, 2, 2, 2));
+    __m128 x3 = _mm_shuffle_ps(x, x, _MM_SHUFFLE(3, 3, 3, 3));
+    __m128 y = _mm_add_ps(
+      _mm_add_ps(_mm_mul_ps(outputColumns[0], x0), _mm_mul_ps(outputColumns[1], x1)),
+      _mm_add_ps(_mm_mul_ps(outputColumns[2], x2), _mm_mul_ps(outputColumns[3], x3))
+    );
+    y = _mm_add_ps(y, _mm_add_ps(_mm_mul_ps(outputColumns[4], s1), _mm_mul_ps(outputColumns[5], s2)));
+    __m128 s = _mm_add_ps(
+      _mm_add_ps(_mm_mul_ps(stateColumns[0], x0), _mm_mul_ps(stateColumns[1], x1)),
+      _mm_add_ps(_mm_mul_ps(stateColumns[2], x2), _mm_mul_ps(stateColumns[3], x3))
+    );
+    s = _mm_add_ps(s, _mm_add_ps(_mm_mul_ps(stateColumns[4], s1), _mm_mul_ps(stateColumns[5], s2)));
+    _mm_storeu_ps(samples + i, y);
+    s1 = _mm_shuffle_ps(s, s, _MM_SHUFFLE(0, 0, 0, 0));
+    s2 = _mm_shuffle_ps(s, s, _MM_SHUFFLE(1, 1, 1, 1));
+  }
+  _s1 = _mm_cvtss_f32(s1);
+  _s2 = _mm_cvtss_f32(s2);
+#endif
+  for(; i < count; ++i)
+    processSample(samples[i]);
+}
+
+OnePole::OnePole() :
+  _coefficient{1.f},
+  _value{0.f}
+{
+  configure(0.f, 1);
+}
+
+void OnePole::configure(float timeConstant_ms, int sampleRate_hz)
+{
+  assert(sampleRate_hz > 0);
+  float timeConstant_frames = (timeConstant_ms / 1000.f) * sampleRate_hz;
+  _coefficient = (timeConstant_frames > 0.f) ? 1.f - std::exp(-1.f / timeConstant_frames) : 1.f;
+
+  //
+  // y[n] = p.y[n-1] + a.x[n] where p = 1 - a, so output n of a block is a sum of the block's
+  // inputs weighted by a.p^(n - input) and the previous output weighted by p^(n + 1).
+  //
+  float pole = 1.f - _coefficient;
+  for(int k = 0; k < BLOCK; ++k)
+    for(int n = 0; n < BLOCK; ++n)
+      _outputMatrix[k][n] = (n >= k) ? _coefficient * std::pow(pole, static_cast<float>(n - k)) : 0.f;
+  for(int n = 0; n < BLOCK; ++n)
+    _outputMatrix[BLOCK][n] = std::pow(pole, static_cast<float>(n + 1));
+}
+
+void OnePole::process(float* samples, int count)
+{
+  int i {0};
+#if defined(__SSE2__)
+  __m128 columns[BLOCK + 1];
+  for(int k = 0; k <= BLOCK; ++k)
+    columns[k] = _mm_load_ps(_outputMatrix[k]);
+  __m128 state = _mm_set1_ps(_value);
+  for(; i + BLOCK <= count; i += BLOCK){
+    __m128 x = _mm_loadu_ps(samples + i);
+    __m128 y = _mm_add_ps(
+      _mm_add_ps(_mm_mul_ps(columns[0], _mm_shuffle_ps(x, x, _MM_SHUFFLE(0, 0, 0, 0))),
+                 _mm_mul_ps(columns[1], _mm_shuffle_ps(x, x, _MM_SHUFFLE(1, 1, 1, 1)))),
+      _mm_add_ps(_mm_mul_ps(columns[2], _mm_shuffle_ps(x, x, _MM_SHUFFLE(2, 2, 2, 2))),
+                 _mm_mul_ps(columns[3], _mm_shuffle_ps(x, x, _MM_SHUFFLE(3, 3, 3, 3))))
+    );
+    y = _mm_add_ps(y, _mm_mul_ps(columns[BLOCK], state));
+    _mm_storeu_ps(samples + i, y);
+    state = _mm_shuffle_ps(y, y, _MM_SHUFFLE(3, 3, 3, 3));
+  }
+  _value = _mm_cvtss_f32(state);
+#endif
+  for(; i < count; ++i){
+    _value += (samples[i] - _value) * _coefficient;
+    samples[i] = _value;
+  }
+}
+
+float OnePole::advance(float target, int frameCount)
+{
+  float remaining = std::pow(1.f - _coefficient, static_cast<float>(frameCount));
+  _value = target + ((_value - target) * remaining);
+
+  //
+  // Snap once imperceptibly close so callers can tell when a glide has settled.
+  //
+  if(std::fabs(_value - target) < 1e-5f)
+    _value = target;
+  return _value;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+// REVERB
+/////////////////////////////////////////////////////////////////////////////////////////////////
+
+SchroederReverb::SchroederReverb(int sampleRate_hz) :
+  _sampleRate_hz{sampleRate_hz}
+{
+  assert(sampleRate_hz > 0);
+  auto makeDelayLine = [sampleRate_hz](float delay_ms, float gain){
+    int frames = std::max(1, static_cast<int>(std::lround((delay_ms / 1000.f) * sampleRate_hz)));
+    return DelayLine{std::vector<float>(frames, 0.f), 0, gain};
+  };
+  for(int c = 0; c < NUM_COMBS; ++c)
+    _combs[c] = makeDelayLine(COMB_DELAYS_MS[c], 0.f);
+  for(int a = 0; a < NUM_ALLPASSES; ++a)
+    _allpasses[a] = makeDelayLine(ALLPASS_DELAYS_MS[a], ALLPASS_GAIN);
+  setDecay(1.f);
+}
+
+void SchroederReverb::setDecay(float decay_s)
+{
+  //
+  // A comb of delay d loses g per pass, so 60dB after (decay / d) passes.
+  //
+  decay_s = std::max(decay_s, 0.01f);
+  for(int c = 0; c < NUM_COMBS; ++c){
+    float delay_s = static_cast<float>(_combs[c]._buffer.size()) / _sampleRate_hz;
+    _combs[c]._gain = std::pow(10.f, (-3.f * delay_s) / decay_s);
+  }
+}
+
+void SchroederReverb::reset()
+{
+  for(auto& comb : _combs)
+    std::fill(comb._buffer.begin(), comb._buffer.end(), 0.f);
+  for(auto& allpass : _allpasses)
+    std::fill(allpass._buffer.begin(), allpass._buffer.end(), 0.f);
+}
+
+//
+// Runs of at most the delay length; within a run every delayed sample read was written
+// before the run began.
+//
+template<typename Kernel>
+static void processDelayRuns(std::vector<float>& buffer, int& position, int count, Kernel kernel)
+{
+  int size = static_cast<int>(buffer.size());
+  int i {0};
+  while(i < count){
+    int n = std::min(count - i, size - position);
+    kernel(buffer.data() + position, i, n);
+    position += n;
+    if(position == size)
+      position = 0;
+    i += n;
+  }
+}
+
+//
+// comb:     out += d[n];  d[n + D] = x[n] + g.d[n]
+//
+static void combRun(const float* src, float* dst, float* delayed, int count, float gain)
+{
+  int i {0};
+#if defined(__SSE2__)
+  const __m128 g = _mm_set1_ps(gain);
+  for(; i + 4 <= count; i += 4){
+    __m128 d = _mm_loadu_ps(delayed + i);
+    _mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), d));
+    _mm_storeu_ps(delayed + i, _mm_add_ps(_mm_loadu_ps(src + i), _mm_mul_ps(d, g)));
+  }
+#endif
+  for(; i < count; ++i){
+    float d = delayed[i];
+    dst[i] += d;
+    delayed[i] = src[i] + (d * gain);
+  }
+}
+
+//
+// allpass:  w[n] = x[n] + g.w[n - D];  y[n] = w[n - D] - g.w[n]
+//
+static void allpassRun(float* samples, float* delayed, int count, float gain)
+{
+  int i {0};
+#if defined(__SSE2__)
+  const __m128 g = _mm_set1_ps(gain);
+  for(; i + 4 <= count; i += 4){
+    __m128 d = _mm_loadu_ps(delayed + i);
+    __m128 w = _mm_add_ps(_mm_loadu_ps(samples + i), _mm_mul_ps(d, g));
+    _mm_storeu_ps(samples + i, _mm_sub_ps(d, _mm_mul_ps(w, g)));
+    _mm_storeu_ps(delayed + i, w);
+  }
+#endif
+  for(; i < count; ++i){
+    float d = delayed[i];
+    float w = samples[i] + (d * gain);
+    samples[i] = d - (w * gain);
+    delayed[i] = w;
+  }
+}
+
+void SchroederReverb::process(const float* src, float* dst, int count)
+{
+  std::fill(dst, dst + count, 0.f);
+  for(auto& comb : _combs){
+    float gain = comb._gain;
+    processDelayRuns(comb._buffer, comb._position, count, [src, dst, gain](float* delayed, int i, int n){
+      combRun(src + i, dst + i, delayed, n, gain);
+    });
+  }
+  scaleFrames(dst, count, 1, INPUT_GAIN, 0.f);
+  for(auto& allpass : _allpasses){
+    float gain = allpass._gain;
+    processDelayRuns(allpass._buffer, allpass._position, count, [dst, gain](float* delayed, int i, int n){
+      allpassRun(dst + i, delayed, n, gain);
+    });
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+// COMPRESSOR
+/////////////////////////////////////////////////////////////////////////////////////////////////
+
+static float decibelsToGain(float decibels)
+{
+  return std::pow(10.f, decibels / 20.f);
+}
+
+Compressor::Compressor(int sampleRate_hz) :
+  _sampleRate_hz{sampleRate_hz},
+  _envelope{0.f},
+  _gain{1.f}
+{
+  assert(sampleRate_hz > 0);
+  configure(-12.f, 4.f, 5.f, 100.f, 0.f);
+}
+
+void Compressor::configure(float threshold_db, float ratio, float attack_ms, float release_ms, float makeup_db)
+{
+  auto stepCoefficient = [this](float time_ms){
+    float steps = ((time_ms / 1000.f) * _sampleRate_hz) / CONTROL_FRAMES;
+    return (steps > 0.f) ? std::exp(-1.f / steps) : 0.f;
+  };
+  _threshold = decibelsToGain(threshold_db);
+  _exponent = (1.f / std::max(ratio, 1.f)) - 1.f;
+  _attackCoefficient = stepCoefficient(attack_ms);
+  _releaseCoefficient = stepCoefficient(release_ms);
+  _makeup = decibelsToGain(makeup_db);
+}
+
+void Compressor::process(float* samples, int frameCount, int numChannels)
+{
+  for(int f = 0; f < frameCount; f += CONTROL_FRAMES){
+    int n = std::min(CONTROL_FRAMES, frameCount - f);
+    float* run = samples + (f * numChannels);
+    float peak = findPeak(run, n * numChannels);
+    float coefficient = (peak > _envelope) ? _attackCoefficient : _releaseCoefficient;
+    _envelope = peak + ((_envelope - peak) * coefficient);
+    float gain = (_envelope > _threshold) ? std::pow(_envelope / _threshold, _exponent) : 1.f;
+    scaleFrames(run, n, numChannels, _gain * _makeup, ((gain - _gain) * _makeup) / n);
+    _gain = gain;
+  }
+}
+
+float Compressor::getGainReduction_db() const
+{
+  return -20.f * std::log10(_gain);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+// RESAMPLER
+/////////////////////////////////////////////////////////////////////////////////////////////////
+
+Resampler::Resampler(int inRate_hz, int outRate_hz)
+{
+  assert(inRate_hz > 0 && outRate_hz > 0);
+  int64_t divisor = std::gcd(inRate_hz, outRate_hz);
+  _upFactor = outRate_hz / divisor;
+  _downFactor = inRate_hz / divisor;
+  _phaseCount = static_cast<int>(std::min(_upFactor, int64_t{MAX_PHASES}));
+
+  float downRatio = std::min(static_cast<float>(inRate_hz) / outRate_hz, float{MAX_DOWN_FACTOR});
+  _halfTapCount = static_cast<int>(std::ceil(HALF_TAPS_PER_UNITY * std::max(1.f, downRatio)));
+  _tapCount = _halfTapCount * 2;
+
+  generateFilterBank();
+}
+
+int Resampler::calculateOutputCount(int inputCount) const
+{
+  return static_cast<int>(((inputCount * _upFactor) + _downFactor - 1) / _downFactor);
+}
+
+//
+// Each phase p holds the coefficients of the prototype low-pass filter h(t) sampled at the
+// distances t between the output position (at fraction p/_phaseCount between two input
+// samples) and each of the _tapCount input samples around it. The prototype is a blackman
+// windowed sinc with its cutoff at the lower of the input and output nyquist frequencies.
+//
+void Resampler::generateFilterBank()
+{
+  double cutoff = 0.5 * std::min(1.0, static_cast<double>(_upFactor) / _downFactor) * CUTOFF_ROLLOFF;
+
+  _bank.resize(_phaseCount * _tapCount);
+  for(int p = 0; p < _phaseCount; ++p){
+    float* phase = _bank.data() + (p * _tapCount);
+    double fraction = static_cast<double>(p) / _phaseCount;
+    double sum {0.0};
+    for(int k = 0; k < _tapCount; ++k){
+      double t = fraction + (_halfTapCount - 1 - k);
+      double x = 2.0 * cutoff * t;
+      double sinc = (x == 0.0) ? 1.0 : std::sin(M_PI * x) / (M_PI * x);
+      double w = t / _halfTapCount;
+      double window = 0.42 + (0.5 * std::cos(M_PI * w)) + (0.08 * std::cos(2.0 * M_PI * w));
+      double h = (std::abs(w) < 1.0) ? 2.0 * cutoff * sinc * window : 0.0;
+      phase[k] = static_cast<float>(h);
+      sum += h;
+    }
+
+    //
+    // Normalize each phase to unity gain at DC to avoid a ripple at the phase rate.
+    //
+    for(int k = 0; k < _tapCount; ++k)
+      phase[k] = static_cast<float>(phase[k] / sum);
+  }
+}
+
+void Resampler::resample(const float* src, int inputCount, float* dst) const
+{
+  //
+  // Pad the input with silence so every output sample is a full length dot product.
+  //
+  std::vector<float> padded(inputCount + (_tapCount * 2), 0.f);
+  std::copy(src, src + inputCount, padded.begin() + _tapCount);
+
+  int outputCount = calculateOutputCount(inputCount);
+  int64_t position {0};   // in units of 1/_upFactor input samples.
+  for(int n = 0; n < outputCount; ++n){
+    int64_t whole = position / _upFactor;
+    int64_t fraction = position % _upFactor;
+    int p = static_cast<int>((fraction * _phaseCount) / _upFactor);
+    const float* taps = padded.data() + _tapCount + whole - _halfTapCount + 1;
+    dst[n] = dotProduct(taps, _bank.data() + (p * _tapCount), _tapCount);
+    position += _downFactor;
+  }
+}
+
+} // namespace dsp
+} // namespace pxr
@@ -1,8 +1,9 @@
 #include <SDL2/SDL.h>
 #include <thread>
 #include <sstream>
-#include <iomanip>
 #include <cassert>
+#include <algorithm>
+#include <limits>
 #include "../include/pxr_engine.h"
 #include "../include/pxr_log.h"
 #include "../include/pxr_game.h"
@@ -11,6 +12,11 @@
 #include "../include/pxr_sfx.h"
 #include "../include/pxr_color.h"
 #include "../include/pxr_rand.h"
+#include "../include/pxr_cache.h"
+#include "../include/pxr_profile.h"
+#include "../include/pxr_replay.h"
+#include "../include/pxr_jobs.h"
+#include "../include/pxr_arena.h"
 
 #include <iostream>
 
@@ -32,7 +38,7 @@ void Engine::GameClock::update(Duration_t realDt)
 }
 
 Engine::Ticker::Ticker(Callback_t onTick, Engine* tickCtx, Duration_t tickPeriod, 
-                       int maxTicksPerFrame, bool isChasingGameNow) :
+                       int maxTicksPerFrame, bool isChasingGameNow, CatchUpPolicy policy) :
   _onTick{onTick},
   _tickCtx{tickCtx},
   _tickerNow{0},
@@ -44,23 +50,58 @@ Engine::Ticker::Ticker(Callback_t onTick, Engine* tickCtx, Duration_t tickPeriod
   _ticksDoneThisFrame{0},
   _maxTicksPerFrame{maxTicksPerFrame},
   _ticksAccumulated{0},
+  _maxTicksAccumulated{static_cast<int>(maxCatchUpDuration / tickPeriod)},
+  _ticksDroppedTotal{0},
+  _alpha{0.f},
+  _slowedTime{0},
+  _policy{policy},
   _isChasingGameNow{isChasingGameNow},
   _isNewTickFrequencySample{false}
 {
+  assert(policy != CATCHUP_SLOWMO || isChasingGameNow);
+
   for(int i = 0; i < FPS_HISTORY_SIZE - 1; ++i)
     _measuredTickFrequencyHistory[i] = 0.0;
 
 }
 
-void Engine::Ticker::doTicks(Duration_t gameNow, Duration_t realNow)
+void Engine::Ticker::scheduleTicks(Duration_t gameNow, Duration_t realNow)
 {
   Duration_t now = _isChasingGameNow ? gameNow : realNow;
 
-  while(_tickerNow + _tickPeriod < now){
-    _tickerNow += _tickPeriod;
-    ++_ticksAccumulated;
+  //
+  // A tick falls due at every whole period the ticker trails the clock by; however long the
+  // stall the catch up costs a division.
+  //
+  if(now > _tickerNow){
+    int64_t ticksDue = (now - _tickerNow) / _tickPeriod;
+    _tickerNow += _tickPeriod * ticksDue;
+    _ticksAccumulated = static_cast<int>(std::min<int64_t>(_ticksAccumulated + ticksDue, 
+                                                           std::numeric_limits<int>::max()));
   }
 
+  //
+  // The policy applies to the ticks this frame will not do, so the time slowed is known before
+  // any tick runs and the owner can wind it off the clock first.
+  //
+  _slowedTime = Duration_t::zero();
+  int ticksLeftOver = _ticksAccumulated - std::min(_ticksAccumulated, _maxTicksPerFrame);
+  int maxTicksCarried = (_policy == CATCHUP_CLAMP) ? _maxTicksAccumulated : 0;
+  if(ticksLeftOver > maxTicksCarried){
+    int ticksDropped = ticksLeftOver - maxTicksCarried;
+    _ticksAccumulated -= ticksDropped;
+    _ticksDroppedTotal += ticksDropped;
+    if(_policy == CATCHUP_SLOWMO){
+      _slowedTime = _tickPeriod * ticksDropped;
+      _tickerNow -= _slowedTime;
+    }
+  }
+}
+
+void Engine::Ticker::doTicks(Duration_t gameNow, Duration_t realNow)
+{
+  Duration_t now = _isChasingGameNow ? gameNow : realNow;
+
   _ticksDoneThisFrame = 0;
   while(_ticksAccumulated > 0 && _ticksDoneThisFrame < _maxTicksPerFrame){
     ++_ticksDoneThisFrame;
@@ -68,6 +109,13 @@ void Engine::Ticker::doTicks(Duration_t gameNow, Duration_t realNow)
     (_tickCtx->*_onTick)(_tickPeriodSeconds);
   }
 
+  //
+  // Ticks still carried fall after the last tick done.
+  //
+  Duration_t lastTickDone = _tickerNow - (_tickPeriod * _ticksAccumulated);
+  Duration_t sinceLastTick = now - lastTickDone;
+  _alpha = std::clamp(static_cast<float>(sinceLastTick.count()) / _tickPeriod.count(), 0.f, 1.f);
+
   _ticksDoneThisHalfSecond += _ticksDoneThisFrame;
   _ticksDoneTotal += _ticksDoneThisFrame;
 
@@ -87,6 +135,15 @@ void Engine::Ticker::doTicks(Duration_t gameNow, Duration_t realNow)
   }
 }
 
+Engine::Duration_t Engine::Ticker::getTimeToNextTick(Duration_t gameNow, Duration_t realNow) const
+{
+  if(_ticksAccumulated > 0)
+    return Duration_t::zero();
+  Duration_t now = _isChasingGameNow ? gameNow : realNow;
+  Duration_t nextTick = _tickerNow + _tickPeriod;
+  return (nextTick > now) ? nextTick - now : Duration_t::zero();
+}
+
 void Engine::Ticker::reset()
 {
   _tickerNow = Duration_t::zero();
@@ -95,26 +152,60 @@ void Engine::Ticker::reset()
   _ticksDoneThisHalfSecond = 0;
   _ticksDoneThisFrame = 0;
   _ticksAccumulated = 0;
+  _ticksDroppedTotal = 0;
+  _alpha = 0.f;
+  _slowedTime = Duration_t::zero();
 }
 
 void Engine::initialize(std::unique_ptr<Game> game)
 {
+  PXR_PROFILE_THREAD_NAME("main");
   log::initialize();
   input::initialize();
 
   if(_rc.load(EngineRC::filename) < 0)
     _rc.write(EngineRC::filename);    // generate a default rc file if one doesn't exist.
 
-  if(SDL_Init(SDL_INIT_VIDEO) < 0){
+  //
+  // Logging asynchronously keeps log writes off the main and simulation threads; set asyncLog
+  // to 0 when chasing a crash, as a crash loses the messages still queued.
+  //
+  if(_rc.getBoolValue(EngineRC::KEY_ASYNC_LOG))
+    log::startAsync();
+
+  cache::initialize(_rc.getIntValue(EngineRC::KEY_CACHE_BUDGET_MIB) * cache::ONE_MEBIBYTE);
+
+  //
+  // jobWorkers of -1 starts a worker per core but the main thread's (see jobs::initialize).
+  //
+  jobs::initialize(_rc.getIntValue(EngineRC::KEY_JOB_WORKERS));
+
+  if(!_isHeadless && SDL_Init(SDL_INIT_VIDEO) < 0){
     log::log(log::FATAL, log::msg_eng_fail_sdl_init, std::string{SDL_GetError()});
     exit(EXIT_FAILURE);
   }
 
-  if(!sfx::initialize()){
+  if(_sfxrc.load(SFXRC::filename) < 0)
+    _sfxrc.write(SFXRC::filename);
+
+  sfx::SFXConfiguration sfxconf = makeSFXConfiguration();
+  if(_isHeadless){
+    sfxconf._isOffline = true;
+    sfxconf._isAdaptiveChunkSize = false;
+  }
+
+  if(!sfx::initialize(sfxconf)){
     log::log(log::FATAL, log::msg_sfx_fail_init);
     exit(EXIT_FAILURE);
   }
 
+  _fpsLockHz = _rc.getIntValue(EngineRC::KEY_FPS_LOCK);
+  _tickPeriod = Duration_t{static_cast<int64_t>(1.0e9 / static_cast<double>(_fpsLockHz))};
+  _idleDrawPeriod = Duration_t{static_cast<int64_t>(1.0e9 / static_cast<double>(_rc.getIntValue(EngineRC::KEY_IDLE_FPS)))};
+  _lastIdleDrawNow = Duration_t::zero();
+  _isWindowHidden = false;
+  log::log(log::INFO, log::msg_eng_locking_fps, std::to_string(_fpsLockHz) + "hz");
+
   // 
   // Testing the seed_seq on my system shows it just produces the same results with every run, 
   // which is obviously useless. However I get different results with std::random_device so have 
@@ -124,11 +215,28 @@ void Engine::initialize(std::unique_ptr<Game> game)
   // std::seed_seq seq{1, 2, 3, 4, 5};
   // randGenerator.seed(seq);
   //
-  std::random_device rd{};
-  rand::xorwow::state_type seedstate {};
-  for(auto& seed : seedstate)
-    seed = rd();
-  rand::generator.seed(seedstate);
+  if(_isHeadless)
+    rand::generator.seed(static_cast<rand::xorwow::result_type>(_headlessSeed));
+  else{
+    std::random_device rd{};
+    rand::xorwow::state_type seedstate {};
+    for(auto& seed : seedstate)
+      seed = rd();
+    rand::generator.seed(seedstate);
+  }
+
+  //
+  // Sessions are recorded from the generator's state as seeded and played back with the state
+  // and tick period they were recorded with; headless runs are seeded by their tools so never
+  // record or play back.
+  //
+  auto replayMode = static_cast<replay::Mode>(_rc.getIntValue(EngineRC::KEY_REPLAY_MODE));
+  if(!_isHeadless && replayMode == replay::MODE_RECORD)
+    replay::startRecording(replayFilename, rand::generator.getState(), _tickPeriod.count());
+  else if(!_isHeadless && replayMode == replay::MODE_PLAYBACK && replay::startPlayback(replayFilename)){
+    rand::generator.seed(replay::getSeed());
+    _tickPeriod = Duration_t{replay::getTickPeriodNanoseconds()};
+  }
 
   _game = std::move(game);
 
@@ -143,7 +251,7 @@ void Engine::initialize(std::unique_ptr<Game> game)
   windowSize._x = _rc.getIntValue(EngineRC::KEY_WINDOW_WIDTH);
   windowSize._y = _rc.getIntValue(EngineRC::KEY_WINDOW_HEIGHT);
   bool fullscreen = _rc.getBoolValue(EngineRC::KEY_FULLSCREEN);
-  if(!gfx::initialize(ss.str(), windowSize, fullscreen)){
+  if(!gfx::initialize(ss.str(), windowSize, fullscreen, _isHeadless)){
     log::log(log::FATAL, log::msg_gfx_fail_init);
     exit(EXIT_FAILURE);
   }
@@ -162,16 +270,26 @@ void Engine::initialize(std::unique_ptr<Game> game)
 
   _pauseScreenId = gfx::createScreen(pauseScreenResolution);
 
-  _fpsLockHz = _rc.getIntValue(EngineRC::KEY_FPS_LOCK);
-  Duration_t tickPeriod {static_cast<int64_t>(1.0e9 / static_cast<double>(_fpsLockHz))};
-  log::log(log::INFO, log::msg_eng_locking_fps, std::to_string(_fpsLockHz) + "hz");
+  auto catchUpPolicy = static_cast<Ticker::CatchUpPolicy>(_rc.getIntValue(EngineRC::KEY_CATCH_UP_POLICY));
+  _updateTicker = Ticker{&Engine::onSplashUpdateTick, this, _tickPeriod, 5, true, catchUpPolicy};
+  _drawTicker = Ticker{&Engine::onSplashDrawTick, this, _tickPeriod, 1, false, Ticker::CATCHUP_DROP};
 
-  _updateTicker = Ticker{&Engine::onSplashUpdateTick, this, tickPeriod, 5, true};
-  _drawTicker = Ticker{&Engine::onSplashDrawTick, this, tickPeriod, 1, false};
+  _isThreaded = _rc.getBoolValue(EngineRC::KEY_THREADED_UPDATE) && !_isHeadless;
+  if(_isThreaded && !_game->isThreadedUpdateSupported()){
+    log::log(log::INFO, log::msg_eng_threaded_update_unsupported);
+    _isThreaded = false;
+  }
+  _forwardedEvents.reset(forwardedEventCapacity);
+  _updateFrequencySamples = 0;
+  _drawnUpdateFrequencySamples = 0;
+  _isPauseScreenEnabled = false;
 
   //_splashSoundKey = sfx::loadSound(splashName);
-  _splashSpriteKey = gfx::loadSpritesheet(splashName);
-  if(gfx::isErrorSpritesheet(_splashSpriteKey)){
+  if(!_isHeadless)
+    _splashSpriteKey = gfx::loadSpritesheet(splashName);
+  if(_isHeadless)
+    onSplashExit();
+  else if(gfx::isErrorSpritesheet(_splashSpriteKey)){
     log::log(log::INFO, log::msg_eng_fail_load_splash);
     onSplashExit();
   }
@@ -204,36 +322,126 @@ void Engine::initialize(std::unique_ptr<Game> game)
   _isDone = false;
 }
 
+sfx::SFXConfiguration Engine::makeSFXConfiguration()
+{
+  sfx::SFXConfiguration sfxconf {};
+  if(_sfxrc.getBoolValue(SFXRC::KEY_LOW_LATENCY))
+    sfxconf = sfx::makeLowLatencyConfiguration();
+  else{
+    sfxconf._chunkSize = _sfxrc.getIntValue(SFXRC::KEY_CHUNK_SIZE);
+    sfxconf._isAdaptiveChunkSize = _sfxrc.getBoolValue(SFXRC::KEY_ADAPTIVE_CHUNK_SIZE);
+  }
+
+  int sampleBits = _sfxrc.getIntValue(SFXRC::KEY_SAMPLE_BITS);
+  if(sampleBits <= 8)
+    sfxconf._sampleFormat = sfx::SAMPLE_FORMAT_U8;
+  else if(sampleBits <= 16)
+    sfxconf._sampleFormat = sfx::SAMPLE_FORMAT_S16LSB;
+  else
+    sfxconf._sampleFormat = sfx::SAMPLE_FORMAT_S32LSB;
+
+  sfxconf._samplingFreq_hz = _sfxrc.getIntValue(SFXRC::KEY_SAMPLING_FREQ_HZ);
+  sfxconf._outputMode = _sfxrc.getBoolValue(SFXRC::KEY_STEREO) ? sfx::STEREO : sfx::MONO;
+  sfxconf._numMixChannels = _sfxrc.getIntValue(SFXRC::KEY_NUM_MIX_CHANNELS);
+  sfxconf._maxChunkSize = _sfxrc.getIntValue(SFXRC::KEY_MAX_CHUNK_SIZE);
+
+  //
+  // Start where adaptive sizing settled last run.
+  //
+  int adaptedChunkSize = _sfxrc.getIntValue(SFXRC::KEY_ADAPTED_CHUNK_SIZE);
+  if(sfxconf._isAdaptiveChunkSize && adaptedChunkSize > sfxconf._chunkSize)
+    sfxconf._chunkSize = std::min(adaptedChunkSize, sfxconf._maxChunkSize);
+
+  return sfxconf;
+}
+
+void Engine::saveAdaptedChunkSize()
+{
+  const sfx::SFXConfiguration& sfxconf = sfx::getConfiguration();
+  if(!sfxconf._isAdaptiveChunkSize || sfxconf._chunkSize <= _sfxrc.getIntValue(SFXRC::KEY_ADAPTED_CHUNK_SIZE))
+    return;
+  _sfxrc.setIntValue(SFXRC::KEY_ADAPTED_CHUNK_SIZE, sfxconf._chunkSize);
+  _sfxrc.write(SFXRC::filename);
+}
+
+void Engine::initializeHeadless(std::unique_ptr<Game> game, uint32_t seed)
+{
+  _isHeadless = true;
+  _headlessSeed = seed;
+  initialize(std::move(game));
+  _gameClock.reset();
+}
+
+void Engine::stepUpdate()
+{
+  assert(_isHeadless);
+  _gameClock.update(_tickPeriod);
+  onUpdateTick(getTickPeriodSeconds());
+}
+
+void Engine::stepDraw()
+{
+  assert(_isHeadless);
+  onDrawTick(getTickPeriodSeconds());
+  arena::resetFrame();
+}
+
+float Engine::getTickPeriodSeconds() const
+{
+  return static_cast<float>(_tickPeriod.count()) / oneSecond.count();
+}
+
 void Engine::shutdown()
 {
+  if(_rc.getIntValue(EngineRC::KEY_TELEMETRY_EXPORT) != telemetry::EXPORT_NONE)
+    exportTelemetry();
+  PXR_PROFILE_WRITE_TRACE(profileTraceFilename);
+  replay::stop();
+  _game->waitPreloads();
   _game->onShutdown();
+  jobs::shutdown();
   gfx::shutdown();
+  saveAdaptedChunkSize();
   sfx::shutdown();
+  cache::shutdown();
   log::shutdown();
 }
 
 void Engine::run()
 {
+  //
+  // The splash always runs to completion on the main thread, so the simulation thread (if
+  // any) starts on the game's ticks and never runs the splash's, which draw.
+  //
   _realClock.reset();
   while(!_isSplashDone) 
     mainloop();
+  if(_isDone)
+    return;
   
   _realClock.reset();
   _gameClock.reset();
   _updateTicker.reset();
   _drawTicker.reset();
-  while(!_isDone) 
-    mainloop();
+  if(_isThreaded)
+    threadedRun();
+  else{
+    while(!_isDone) 
+      mainloop();
+  }
 }
 
 void Engine::mainloop()
 {
+  PXR_PROFILE_ZONE("Engine::mainloop");
   auto frameStart = Clock_t::now();
 
-  _gameClock.update(_realClock.update()); 
+  auto realDt = _realClock.update();
+  _gameClock.update(realDt); 
   auto gameNow = _gameClock.getNow();
   auto realNow = _realClock.getNow();
 
+  auto eventsStart = Clock_t::now();
   SDL_Event event;
   while(SDL_PollEvent(&event) != 0){
     switch(event.type){
@@ -242,30 +450,13 @@ void Engine::mainloop()
         _isDone = true;
         return;
       case SDL_WINDOWEVENT:
-        if(event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED)
-          gfx::onWindowResize(Vector2i{event.window.data1, event.window.data2});
+        onWindowEvent(event.window);
         break;
       case SDL_KEYDOWN:
-        if(event.key.keysym.sym == decrementGameClockScaleKey){
-          _gameClock.incrementScale(-0.1);
-          break;
-        }
-        else if(event.key.keysym.sym == incrementGameClockScaleKey){
-          _gameClock.incrementScale(0.1);
+        if(onEngineKey(event.key.keysym.sym))
           break;
-        }
-        else if(event.key.keysym.sym == resetGameClockScaleKey){
-          _gameClock.setScale(1.f);
-          break;
-        }
-        else if(event.key.keysym.sym == pauseGameClockKey){
-          if(!_isSplashDone)
-            continue;
-          _gameClock.togglePause();
-          if(_gameClock.isPaused())
-            gfx::enableScreen(_pauseScreenId);
-          else
-            gfx::disableScreen(_pauseScreenId);
+        else if(event.key.keysym.sym == exportTelemetryKey){
+          exportTelemetry();
           break;
         }
         else if(event.key.keysym.sym == toggleDrawEngineStatsKey){
@@ -282,17 +473,179 @@ void Engine::mainloop()
         }
         // FALLTHROUGH
       case SDL_KEYUP:
-        input::onKeyEvent(event);
+        if(replay::getMode() != replay::MODE_PLAYBACK)
+          input::onKeyEvent(event);
         break;
     }
   }
+  telemetry::record(telemetry::PHASE_EVENTS, durationToMilliseconds(Clock_t::now() - eventsStart));
+
+  if(_isSplashDone)
+    syncPauseScreen(_gameClock.isPaused());
+
+  _updateTicker.scheduleTicks(gameNow, realNow);
+  _gameClock.rewind(_updateTicker.getSlowedTime());
+  _updateTicker.doTicks(_gameClock.getNow(), realNow);
+
+  bool isIdle = _isSplashDone && (_gameClock.isPaused() || _isWindowHidden || _game->isIdle());
+  if(isDrawDue(isIdle, realNow)){
+    _drawTicker.scheduleTicks(_gameClock.getNow(), realNow);
+    _drawTicker.doTicks(_gameClock.getNow(), realNow);
+  }
 
-  _updateTicker.doTicks(gameNow, realNow);
-  _drawTicker.doTicks(gameNow, realNow);
+  //
+  // The music plays on (ducked) whilst paused, so the sfx module must still be updated to
+  // keep its music sequence queued, which the stalled update ticker no longer does.
+  //
+  if(_gameClock.isPaused())
+    sfx::onUpdate(std::chrono::duration<float>(realDt).count());
 
   if(_updateTicker.isNewTickFrequencySample() || _drawTicker.isNewTickFrequencySample())
     _needRedrawEngineStats = true;
 
+  measureFrameFrequency(realNow);
+  endFrame(frameStart, isIdle ? calculateIdleWait(true, realNow) : Duration_t::zero());
+}
+
+//
+// Handles the keys which control the game clock; returns false if key is not one of them. Runs
+// on whichever thread owns the game clock.
+//
+bool Engine::onEngineKey(SDL_Keycode key)
+{
+  if(key == decrementGameClockScaleKey){
+    _gameClock.incrementScale(-0.1);
+    return true;
+  }
+  else if(key == incrementGameClockScaleKey){
+    _gameClock.incrementScale(0.1);
+    return true;
+  }
+  else if(key == resetGameClockScaleKey){
+    _gameClock.setScale(1.f);
+    return true;
+  }
+  else if(key == pauseGameClockKey){
+    if(_isSplashDone){
+      _gameClock.togglePause();
+      sfx::duckMusic(_gameClock.isPaused());
+    }
+    return true;
+  }
+  return false;
+}
+
+//
+// Shows the pause dialog whilst the game clock is paused; main thread only as it is drawn.
+//
+void Engine::syncPauseScreen(bool isPaused)
+{
+  if(isPaused == _isPauseScreenEnabled)
+    return;
+  if(isPaused)
+    gfx::enableScreen(_pauseScreenId);
+  else
+    gfx::disableScreen(_pauseScreenId);
+  _isPauseScreenEnabled = isPaused;
+}
+
+//
+// Main thread only.
+//
+void Engine::onWindowEvent(const SDL_WindowEvent& event)
+{
+  switch(event.event){
+    case SDL_WINDOWEVENT_SIZE_CHANGED:
+      gfx::onWindowResize(Vector2i{event.data1, event.data2});
+      break;
+    case SDL_WINDOWEVENT_MINIMIZED:
+    case SDL_WINDOWEVENT_HIDDEN:
+      _isWindowHidden = true;
+      break;
+    case SDL_WINDOWEVENT_RESTORED:
+    case SDL_WINDOWEVENT_MAXIMIZED:
+    case SDL_WINDOWEVENT_SHOWN:
+    case SDL_WINDOWEVENT_EXPOSED:
+      _isWindowHidden = false;
+      break;
+  }
+}
+
+//
+// Returns false if the draw ticker should not be ticked this frame: never whilst the window is
+// hidden, and whilst idle only every idle draw period. Main thread only.
+//
+bool Engine::isDrawDue(bool isIdle, Duration_t realNow)
+{
+  if(_isWindowHidden)
+    return false;
+  if(!isIdle)
+    return true;
+  if(realNow - _lastIdleDrawNow < _idleDrawPeriod)
+    return false;
+  _lastIdleDrawNow = realNow;
+  return true;
+}
+
+//
+// The real time until the next update tick falls due; maxIdleWait if none will fall due as
+// the game clock is stopped. Called by whichever thread owns the simulation.
+//
+Engine::Duration_t Engine::calculateTimeToNextUpdate()
+{
+  float scale = _gameClock.getScale();
+  if(_gameClock.isPaused() || scale <= 0.f)
+    return maxIdleWait;
+  Duration_t gameWait = _updateTicker.getTimeToNextTick(_gameClock.getNow(), _realClock.getNow());
+  return std::min(maxIdleWait, Duration_t{static_cast<int64_t>(gameWait.count() / scale)});
+}
+
+//
+// How long the main thread may block waiting for events whilst idle: until the next idle draw
+// or, if the thread runs the updates, the next update; whichever is first.
+//
+Engine::Duration_t Engine::calculateIdleWait(bool isUpdating, Duration_t realNow)
+{
+  Duration_t wait = isUpdating ? calculateTimeToNextUpdate() : maxIdleWait;
+  if(!_isWindowHidden)
+    wait = std::min(wait, _lastIdleDrawNow + _idleDrawPeriod - realNow);
+  return std::max(wait, Duration_t::zero());
+}
+
+//
+// Sleeps out what remains of the min frame period, or whilst idle blocks on events until
+// idleWait is out, records the frame's telemetry and frees the frame's transient allocations.
+//
+void Engine::endFrame(TimePoint_t frameStart, Duration_t idleWait)
+{
+  auto sleepStart = Clock_t::now();
+  auto framePeriod = sleepStart - frameStart;
+  auto idleRemaining = idleWait - framePeriod;
+  if(idleRemaining > minFramePeriod){
+    auto timeout_ms = std::chrono::ceil<std::chrono::milliseconds>(idleRemaining).count();
+    SDL_WaitEventTimeout(nullptr, static_cast<int>(timeout_ms));
+  }
+  else if(framePeriod < minFramePeriod)
+    std::this_thread::sleep_for(minFramePeriod - framePeriod); 
+  auto frameEnd = Clock_t::now();
+  telemetry::record(telemetry::PHASE_SLEEP, durationToMilliseconds(frameEnd - sleepStart));
+  telemetry::record(telemetry::PHASE_FRAME, durationToMilliseconds(frameEnd - frameStart));
+  arena::resetFrame();
+}
+
+//
+// Exports in the format set in the engine rc, or csv if none is set.
+//
+void Engine::exportTelemetry()
+{
+  auto format = static_cast<telemetry::ExportFormat>(_rc.getIntValue(EngineRC::KEY_TELEMETRY_EXPORT));
+  if(format == telemetry::EXPORT_NONE)
+    format = telemetry::EXPORT_CSV;
+  telemetry::exportStats(std::string{telemetryName} + telemetry::exportExtensions[format], format);
+}
+
+void Engine::measureFrameFrequency(Duration_t realNow)
+{
   ++_framesDone;
   ++_framesDoneThisSecond;
   if((realNow - _lastFrameMeasureNow) >= oneSecond){
@@ -302,40 +655,232 @@ void Engine::mainloop()
     _lastFrameMeasureNow = realNow;
     _framesDoneThisSecond = 0;
   }
+}
 
-  auto framePeriod = Clock_t::now() - frameStart;
-  if(framePeriod < minFramePeriod)
-    std::this_thread::sleep_for(minFramePeriod - framePeriod); 
+void Engine::threadedRun()
+{
+  assert(_isSplashDone);
+  log::log(log::INFO, log::msg_eng_threaded_update);
+  _renderClock.reset();
+  _lastFrameMeasureNow = Duration_t::zero();
+  _isSimulating.store(true, std::memory_order_release);
+  _simulationThread = std::thread{&Engine::simulationLoop, this};
+
+  while(!_isDone)
+    threadedMainloop();
+
+  _isSimulating.store(false, std::memory_order_release);
+  _simulationThread.join();
+}
+
+//
+// The main thread's loop with threaded updates; polls events, draws and presents.
+//
+void Engine::threadedMainloop()
+{
+  PXR_PROFILE_ZONE("Engine::threadedMainloop");
+  auto frameStart = Clock_t::now();
+
+  _renderClock.update();
+  auto realNow = _renderClock.getNow();
+
+  auto eventsStart = Clock_t::now();
+  SDL_Event event;
+  while(SDL_PollEvent(&event) != 0){
+    switch(event.type){
+      case SDL_QUIT:
+        _isDone = true;
+        return;
+      case SDL_WINDOWEVENT:
+        onWindowEvent(event.window);
+        break;
+      case SDL_KEYDOWN:
+        if(event.key.keysym.sym == exportTelemetryKey){
+          exportTelemetry();
+          break;
+        }
+        else if(event.key.keysym.sym == toggleDrawEngineStatsKey){
+          _isDrawingEngineStats = !_isDrawingEngineStats;
+          if(!_isDrawingEngineStats)
+            gfx::disableScreen(_statsScreenId);
+          else
+            gfx::enableScreen(_statsScreenId);
+          break;
+        }
+        // FALLTHROUGH
+      case SDL_KEYUP:
+        if(!_forwardedEvents.push(event))
+          log::log(log::WARN, log::msg_eng_event_queue_full);
+        break;
+    }
+  }
+  telemetry::record(telemetry::PHASE_EVENTS, durationToMilliseconds(Clock_t::now() - eventsStart));
+
+  _simulationState.acquire();
+  const SimulationState& state = _simulationState.getReadBuffer();
+  syncPauseScreen(state._isPaused);
+  if(state._updateFrequencySamples != _drawnUpdateFrequencySamples){
+    _drawnUpdateFrequencySamples = state._updateFrequencySamples;
+    _needRedrawEngineStats = true;
+  }
+
+  bool isIdle = state._isPaused || state._isSceneIdle || _isWindowHidden;
+  if(isDrawDue(isIdle, realNow)){
+    _drawTicker.scheduleTicks(state._gameNow, realNow);
+    _drawTicker.doTicks(state._gameNow, realNow);
+    if(_drawTicker.isNewTickFrequencySample())
+      _needRedrawEngineStats = true;
+  }
+
+  measureFrameFrequency(realNow);
+  endFrame(frameStart, isIdle ? calculateIdleWait(false, realNow) : Duration_t::zero());
+}
+
+//
+// The simulation thread's loop with threaded updates; applies the forwarded key events, ticks
+// the update ticker and publishes the simulation state.
+//
+void Engine::simulationLoop()
+{
+  PXR_PROFILE_THREAD_NAME("simulation");
+  while(_isSimulating.load(std::memory_order_acquire)){
+    auto loopStart = Clock_t::now();
+
+    auto realDt = _realClock.update();
+    _gameClock.update(realDt);
+
+    SDL_Event event;
+    while(_forwardedEvents.pop(event)){
+      if(event.type == SDL_KEYDOWN && onEngineKey(event.key.keysym.sym))
+        continue;
+      if(replay::getMode() != replay::MODE_PLAYBACK)
+        input::onKeyEvent(event);
+    }
+
+    _updateTicker.scheduleTicks(_gameClock.getNow(), _realClock.getNow());
+    _gameClock.rewind(_updateTicker.getSlowedTime());
+    _updateTicker.doTicks(_gameClock.getNow(), _realClock.getNow());
+    if(_updateTicker.isNewTickFrequencySample())
+      ++_updateFrequencySamples;
+
+    if(_gameClock.isPaused())
+      sfx::onUpdate(std::chrono::duration<float>(realDt).count());
+
+    _simulationState.getWriteBuffer() = makeSimulationState();
+    _simulationState.publish();
+    arena::resetFrame();
+
+    //
+    // Whilst idle sleep until the next update falls due rather than spinning, but wake often
+    // enough to apply forwarded keys promptly.
+    //
+    Duration_t sleepPeriod = minFramePeriod;
+    if(_gameClock.isPaused() || _game->isIdle())
+      sleepPeriod = std::clamp(calculateTimeToNextUpdate(), minFramePeriod, idleSimulationPollPeriod);
+
+    auto loopPeriod = Clock_t::now() - loopStart;
+    if(loopPeriod < sleepPeriod)
+      std::this_thread::sleep_for(sleepPeriod - loopPeriod); 
+  }
+}
+
+//
+// Called by whichever thread owns the simulation.
+//
+Engine::SimulationState Engine::makeSimulationState()
+{
+  SimulationState state {};
+  state._gameNow = _gameClock.getNow();
+  state._realNow = _realClock.getNow();
+  state._updateFrequency = _updateTicker.getTickFrequencyHistory()[Ticker::FPS_HISTORY_SIZE - 1];
+  state._updateFrequencySamples = _updateFrequencySamples;
+  state._updateAlpha = _updateTicker.getAlpha();
+  state._isPaused = _gameClock.isPaused();
+  state._isSceneIdle = _game->isIdle();
+  state._cacheStats = cache::getTotalStats();
+  state._cacheBudget = cache::getBudget();
+  state._audioStats = sfx::getAudioStats();
+  state._chunkSize = sfx::getConfiguration()._chunkSize;
+  return state;
+}
+
+//
+// Main thread only.
+//
+Engine::SimulationState Engine::readSimulationState()
+{
+  if(_isSimulating.load(std::memory_order_relaxed))
+    return _simulationState.getReadBuffer();
+  return makeSimulationState();
 }
 
 void Engine::drawEngineStats()
 {
+  PXR_PROFILE_ZONE("Engine::drawEngineStats");
   if(!_needRedrawEngineStats)
     return;
 
   gfx::clearScreenShade(1, _statsScreenId);
 
-  const auto& updateHistory = _updateTicker.getTickFrequencyHistory();
+  SimulationState state = readSimulationState();
   const auto& drawHistory = _drawTicker.getTickFrequencyHistory();
 
-  std::stringstream ss{};
-
-  ss << std::setprecision(3);
-  ss << "update FPS: " << updateHistory[Ticker::FPS_HISTORY_SIZE - 1] << "hz  "
-     << "render FPS: " << drawHistory[Ticker::FPS_HISTORY_SIZE - 1] << "hz  "
-     << "frame FPS: " << _measuredFrameFrequency << "hz";
-  gfx::drawText({10, 20}, ss.str(), _engineFontKey, gfx::colors::white, _statsScreenId);
-
-  std::stringstream().swap(ss);
+  //
+  // The lines are formatted on the frame arena so redrawing the stats never touches the heap.
+  //
+  auto line = arena::formatFrameString("update FPS: %.3ghz  render FPS: %.3ghz  frame FPS: %.3ghz",
+    state._updateFrequency,
+    drawHistory[Ticker::FPS_HISTORY_SIZE - 1],
+    static_cast<double>(_measuredFrameFrequency)
+  );
+  gfx::drawText({10, 20}, line, _engineFontKey, gfx::colors::white, _statsScreenId);
 
   int gameHours, gameMins, gameSecs, realHours, realMins, realSecs;
-  durationToDigitalClock(_gameClock.getNow(), gameHours, gameMins, gameSecs);
-  durationToDigitalClock(_realClock.getNow(), realHours, realMins, realSecs);
+  durationToDigitalClock(state._gameNow, gameHours, gameMins, gameSecs);
+  durationToDigitalClock(state._realNow, realHours, realMins, realSecs);
+
+  line = arena::formatFrameString("time [h:m:s] -- game=%d:%d:%d -- real=%d:%d:%d",
+    gameHours, gameMins, gameSecs,
+    realHours, realMins, realSecs
+  );
+  gfx::drawText({10, 10}, line, _engineFontKey, gfx::colors::white, _statsScreenId);
+
+  const cache::Stats& cacheStats = state._cacheStats;
+  line = arena::formatFrameString("cache [MiB] -- resident=%.1f warm=%.1f budget=%.1f -- hits=%lld misses=%lld evictions=%lld",
+    static_cast<double>(cacheStats._residentBytes) / cache::ONE_MEBIBYTE,
+    static_cast<double>(cacheStats._warmBytes) / cache::ONE_MEBIBYTE,
+    static_cast<double>(state._cacheBudget) / cache::ONE_MEBIBYTE,
+    static_cast<long long>(cacheStats._hits),
+    static_cast<long long>(cacheStats._misses),
+    static_cast<long long>(cacheStats._evictions)
+  );
+  gfx::drawText({10, 30}, line, _engineFontKey, gfx::colors::white, _statsScreenId);
+
+  const sfx::AudioStats& audioStats = state._audioStats;
+  line = arena::formatFrameString("audio [ms] -- latency=%.1f period=%.1f mix=%.1f max=%.1f fx=%.1f -- chunk=%d underruns=%lld resizes=%d",
+    audioStats._latency_ms,
+    audioStats._callbackPeriod_ms,
+    audioStats._averageCallback_ms,
+    audioStats._maxCallback_ms,
+    audioStats._averageEffects_ms,
+    state._chunkSize,
+    static_cast<long long>(audioStats._underruns),
+    audioStats._chunkResizes
+  );
+  gfx::drawText({10, 40}, line, _engineFontKey, gfx::colors::white, _statsScreenId);
 
-  ss << std::setprecision(3);
-  ss << "time [h:m:s] -- game=" << gameHours << ":" << gameMins << ":" << gameSecs
-                 << " -- real=" << realHours << ":" << realMins << ":" << realSecs;
-  gfx::drawText({10, 10}, ss.str(), _engineFontKey, gfx::colors::white, _statsScreenId);
+  //
+  // The 99th percentiles of the frame's phases; see telemetry::Phase.
+  //
+  line = arena::formatFrameString("p99 [ms] -- frame=%.1f events=%.1f update=%.1f raster=%.1f present=%.1f sleep=%.1f",
+    telemetry::calculateStats(telemetry::PHASE_FRAME)._p99_ms,
+    telemetry::calculateStats(telemetry::PHASE_EVENTS)._p99_ms,
+    telemetry::calculateStats(telemetry::PHASE_UPDATE_TICK)._p99_ms,
+    telemetry::calculateStats(telemetry::PHASE_RASTER)._p99_ms,
+    telemetry::calculateStats(telemetry::PHASE_PRESENT)._p99_ms,
+    telemetry::calculateStats(telemetry::PHASE_SLEEP)._p99_ms
+  );
+  gfx::drawText({10, 50}, line, _engineFontKey, gfx::colors::white, _statsScreenId);
 
   _needRedrawEngineStats = false;
 }
@@ -364,24 +909,57 @@ void Engine::drawPauseDialog()
 
 void Engine::onUpdateTick(float tickPeriodSeconds)
 {
-  double nowSeconds = durationToSeconds(_gameClock.getNow());
-  _game->onUpdate(nowSeconds, tickPeriodSeconds);
+  PXR_PROFILE_ZONE("Engine::onUpdateTick");
+  telemetry::ScopedPhase tickPhase {telemetry::PHASE_UPDATE_TICK};
+  Duration_t gameNow = _gameClock.getNow();
+  if(replay::getMode() == replay::MODE_RECORD)
+    replay::recordTick(gameNow.count(), input::getEvents());
+  else if(replay::getMode() == replay::MODE_PLAYBACK){
+    int64_t recordedNow_ns {0};
+    if(replay::playTick(recordedNow_ns))
+      gameNow = Duration_t{recordedNow_ns};
+  }
+  double nowSeconds = durationToSeconds(gameNow);
+  {
+    telemetry::ScopedPhase scenePhase {telemetry::PHASE_SCENE_UPDATE};
+    _game->onUpdate(nowSeconds, tickPeriodSeconds);
+  }
   input::onUpdate();
   sfx::onUpdate(tickPeriodSeconds);
 }
 
 void Engine::onDrawTick(float tickPeriodSeconds)
 {
-  gfx::clearWindowColor(_clearColor);
+  PXR_PROFILE_ZONE("Engine::onDrawTick");
+  auto rasterStart = Clock_t::now();
 
-  double nowSeconds = durationToSeconds(_gameClock.getNow());
-  _game->onDraw(nowSeconds, tickPeriodSeconds);
+  //
+  // A scene transition fades the window to black along with the game's screens.
+  //
+  float fadeLevel = _game->getFadeLevel();
+  float fadeScale = 1.f - fadeLevel;
+  gfx::clearWindowColor(gfx::Color4f{
+    _clearColor._r * fadeScale, _clearColor._g * fadeScale, _clearColor._b * fadeScale, _clearColor._a
+  });
+
+  Duration_t gameNow = _gameClock.getNow();
+  float alpha = _updateTicker.getAlpha();
+  if(_isSimulating.load(std::memory_order_relaxed)){
+    const SimulationState& state = _simulationState.getReadBuffer();
+    gameNow = state._gameNow;
+    alpha = state._updateAlpha;
+  }
+  double nowSeconds = durationToSeconds(gameNow);
+  _game->onDraw(nowSeconds, tickPeriodSeconds, alpha);
+  for(gfx::ScreenID_t screenid : _game->getScreens())
+    gfx::setScreenFade(fadeLevel, screenid);
 
   if(_isDrawingEngineStats)
     drawEngineStats();
+  telemetry::record(telemetry::PHASE_RASTER, durationToMilliseconds(Clock_t::now() - rasterStart));
 
+  telemetry::ScopedPhase presentPhase {telemetry::PHASE_PRESENT};
   gfx::present();
-
 }
 
 void Engine::onSplashUpdateTick(float tickPeriodSeconds)
@@ -439,6 +1017,7 @@ void Engine::onSplashExit()
   _drawTicker.setCallback(&Engine::onDrawTick);
   //sfx::unloadSound(_splashSoundKey);
   gfx::disableScreen(_pauseScreenId);
+  _isPauseScreenEnabled = false;
   drawPauseDialog();
   gfx::setScreenSizeMode(gfx::SizeMode::AUTO_MIN, _pauseScreenId);
 }
@@ -3,6 +3,9 @@
 #include <vector>
 #include <array>
 #include <map>
+#include <unordered_map>
+#include <mutex>
+#include <optional>
 #include <string>
 #include <cstring>
 #include <sstream>
@@ -18,7 +21,10 @@
 #include "../include/pxr_rect.h"
 #include "../include/pxr_color.h"
 #include "../include/pxr_bmp.h"
+#include "../include/pxr_qoi.h"
 #include "../include/pxr_log.h"
+#include "../include/pxr_cache.h"
+#include "../include/pxr_profile.h"
 
 using namespace tinyxml2;
 using namespace pxr::io;
@@ -41,9 +47,15 @@ static constexpr int DEF_OPENGL_VERSION_MINOR = 0;
 
 static constexpr int ALPHA_KEY = 0;
 
+//
+// The pixel size range assumed without opengl to query; any size a screen could want.
+//
+static constexpr int HEADLESS_MAX_PIXEL_SIZE = 64;
+
 static std::string windowTitle;
 static Vector2i windowSize;
 static bool fullscreen;
+static bool headless;
 static int minPixelSize;
 static int maxPixelSize;
 static SDL_Window* window;
@@ -73,6 +85,13 @@ static std::map<ResourceKey_t, FontResource> fonts;
 static constexpr const char* errorSpritesheetName {"error_spritesheet"};
 static constexpr const char* errorFontName {"error_font"};
 
+//
+// Spritesheets read by prefetchSpritesheet (on any thread) and waiting for loadSpritesheet to
+// register them; the mutex guards only this map.
+//
+static std::unordered_map<std::string, Spritesheet> prefetched;
+static std::mutex prefetchMutex;
+
 static ResourceKey_t errorSpritesheetKey;
 static SpritesheetResource errorSpritesheet;
 static FontResource errorFont;
@@ -152,14 +171,66 @@ static void genErrorFont()
   fonts.emplace(std::make_pair(nextResourceKey++, resource));
 }
 
-bool initialize(std::string windowTitle_, Vector2i windowSize_, bool fullscreen_)
+//
+// The number of bytes a bmp image keeps resident; used for the resource cache accounting.
+//
+static int64_t calculateImageBytes(const Bmp& image)
 {
-  log::log(log::INFO, log::msg_gfx_initializing);
+  return (static_cast<int64_t>(image.getWidth()) * image.getHeight() * sizeof(Color4u)) +
+         (image.getHeight() * sizeof(Color4u*));
+}
 
-  windowSize = windowSize_;
-  windowTitle = windowTitle_;
-  fullscreen = fullscreen_;
+//
+// Loads the image of a spritesheet or font asset; basepath is the path of the asset without
+// a file extension. The image format is picked by extension; a qoi image is preferred if both
+// a qoi and a bmp image exist.
+//
+static bool loadImage(const std::string& basepath, Bmp& image)
+{
+  std::string qoipath {basepath + QOI_FILE_EXTENSION};
+  if(std::ifstream{qoipath, std::ios::binary})
+    return loadQoi(qoipath, image);
+  return image.load(basepath + Bmp::FILE_EXTENSION);
+}
+
+static int64_t calculateSpritesheetBytes(const Spritesheet& sheet)
+{
+  return calculateImageBytes(sheet._image) + (sheet._sprites.size() * sizeof(Sprite));
+}
+
+static int64_t calculateFontBytes(const Font& font)
+{
+  return calculateImageBytes(font._image) + sizeof(Font);
+}
+
+//
+// Evictors invoked by the resource cache to free warm (unreferenced) resources.
+//
+static bool evictSpritesheet(cache::Key_t sheetKey)
+{
+  auto search = spritesheets.find(sheetKey);
+  assert(search != spritesheets.end());
+  assert(search->second._referenceCount <= 0);
+  log::log(log::INFO, log::msg_gfx_unload_spritesheet_success, "key=" + std::to_string(sheetKey));
+  spritesheets.erase(search);
+  return true;
+}
+
+static bool evictFont(cache::Key_t fontKey)
+{
+  auto search = fonts.find(fontKey);
+  assert(search != fonts.end());
+  assert(search->second._referenceCount <= 0);
+  log::log(log::INFO, log::msg_gfx_unload_font_success, "key=" + std::to_string(fontKey));
+  fonts.erase(search);
+  return true;
+}
 
+//
+// Creates the window and its opengl context and sets up the opengl state used to present.
+//
+static bool createWindow()
+{
   uint32_t flags = SDL_WINDOW_OPENGL;
   if(fullscreen){
     flags |= SDL_WINDOW_FULLSCREEN_DESKTOP;
@@ -231,9 +302,33 @@ bool initialize(std::string windowTitle_, Vector2i windowSize_, bool fullscreen_
   glEnable(GL_ALPHA_TEST);
   glAlphaFunc(GL_GREATER, 0.f);
 
+  return true;
+}
+
+bool initialize(std::string windowTitle_, Vector2i windowSize_, bool fullscreen_, bool headless_)
+{
+  log::log(log::INFO, log::msg_gfx_initializing);
+
+  windowSize = windowSize_;
+  windowTitle = windowTitle_;
+  fullscreen = fullscreen_;
+  headless = headless_;
+
+  if(headless){
+    log::log(log::INFO, log::msg_gfx_headless);
+    minPixelSize = 1;
+    maxPixelSize = HEADLESS_MAX_PIXEL_SIZE;
+    viewport = iRect{0, 0, windowSize._x, windowSize._y};
+  }
+  else if(!createWindow())
+    return false;
+
   genErrorSpritesheet();
   genErrorFont();
 
+  cache::setEvictor(cache::RESOURCE_SPRITESHEET, &evictSpritesheet);
+  cache::setEvictor(cache::RESOURCE_FONT, &evictFont);
+
   return true;
 }
 
@@ -250,6 +345,8 @@ static void freeScreens()
 void shutdown()
 {
   freeScreens();
+  if(headless)
+    return;
   SDL_GL_DeleteContext(glContext);
   SDL_DestroyWindow(window);
 }
@@ -336,6 +433,7 @@ int createScreen(Vector2i resolution)
   screen._pxColors = new Color4u[screen._pxCount];
   screen._pxPositions = new Vector2i[screen._pxCount];
   screen._isEnabled = true;
+  screen._fadeLevel = 0.f;
 
   clearScreenTransparent(screenid); 
   autoAdjustScreen(windowSize, screen);
@@ -377,33 +475,18 @@ static ResourceKey_t useErrorFont()
   assert(0);  // This would mean the error font has not been generated.
 }
 
-ResourceKey_t loadSpritesheet(ResourceName_t name)
+//
+// Reads a spritesheet's image and xml from the file system into sheet and validates them.
+// Touches no module data so may be called from any thread (see prefetchSpritesheet).
+//
+static bool readSpritesheet(const std::string& name, Spritesheet& sheet)
 {
-  log::log(log::INFO, log::msg_gfx_loading_spritesheet, name);
-
-  for(auto& pair : spritesheets){
-    if(pair.second._name == name){
-      pair.second._referenceCount++;
-      std::string addendum {"ref count="};
-      addendum += std::to_string(pair.second._referenceCount);
-      log::log(log::INFO, log::msg_gfx_spritesheet_already_loaded, addendum);
-      return pair.first;
-    }
-  }
-
-  SpritesheetResource resource{};
-  Spritesheet& sheet = resource._sheet;
-
-  resource._name = name;
-  resource._referenceCount = 1;
-
-  std::string bmppath{};
-  bmppath += RESOURCE_PATH_SPRITESHEETS;
-  bmppath += name;
-  bmppath += Bmp::FILE_EXTENSION;
-  if(!sheet._image.load(bmppath)){
+  std::string imagepath{};
+  imagepath += RESOURCE_PATH_SPRITESHEETS;
+  imagepath += name;
+  if(!loadImage(imagepath, sheet._image)){
     log::log(log::ERROR, log::msg_gfx_fail_load_asset_bmp, name);
-    return useErrorSpritesheet();
+    return false;
   }
 
   std::string xmlpath {};
@@ -412,14 +495,14 @@ ResourceKey_t loadSpritesheet(ResourceName_t name)
   xmlpath += XML_RESOURCE_EXTENSION_SPRITESHEETS;
   XMLDocument doc{};
   if(!parseXmlDocument(&doc, xmlpath)) 
-    return useErrorSpritesheet();
+    return false;
 
   XMLElement* xmlsheet{nullptr};
   XMLElement* xmlsprite{nullptr};
 
   int err{0};
-  if(!extractChildElement(&doc, &xmlsheet, "spritesheet")) return useErrorSpritesheet();
-  if(!extractChildElement(xmlsheet, &xmlsprite, "sprite")) return useErrorSpritesheet();
+  if(!extractChildElement(&doc, &xmlsheet, "spritesheet")) return false;
+  if(!extractChildElement(xmlsheet, &xmlsprite, "sprite")) return false;
   do{
     Sprite sprite{};
     if(!extractIntAttribute(xmlsprite, "x", &sprite._position._x)){++err; break;}
@@ -432,7 +515,7 @@ ResourceKey_t loadSpritesheet(ResourceName_t name)
     xmlsprite = xmlsprite->NextSiblingElement("sprite");
   }
   while(xmlsprite != 0);
-  if(err) return useErrorSpritesheet();
+  if(err) return false;
 
   // 
   // Validate all sprites to avoid segfaults.
@@ -450,13 +533,76 @@ ResourceKey_t loadSpritesheet(ResourceName_t name)
 
   if(err){
     log::log(log::ERROR, log::msg_gfx_spritesheet_invalid_xml_bmp_mismatch, name);
-    return useErrorSpritesheet();
+    return false;
   }
 
+  return true;
+}
+
+void prefetchSpritesheet(ResourceName_t name)
+{
+  PXR_PROFILE_ZONE("gfx::prefetchSpritesheet");
+  {
+    std::lock_guard<std::mutex> lock {prefetchMutex};
+    if(prefetched.count(name) != 0)
+      return;
+  }
+
+  Spritesheet sheet {};
+  if(!readSpritesheet(name, sheet))
+    return;     // loadSpritesheet will read it again and fall back to the error spritesheet.
+
+  std::lock_guard<std::mutex> lock {prefetchMutex};
+  prefetched.emplace(name, std::move(sheet));
+  log::log(log::INFO, log::msg_gfx_prefetched_spritesheet, name);
+}
+
+ResourceKey_t loadSpritesheet(ResourceName_t name)
+{
+  PXR_PROFILE_ZONE("gfx::loadSpritesheet");
+  log::log(log::INFO, log::msg_gfx_loading_spritesheet, name);
+
+  //
+  // Take any prefetched copy even if the sheet is already loaded, so it is not left staged.
+  //
+  std::optional<Spritesheet> prefetchedSheet {};
+  {
+    std::lock_guard<std::mutex> lock {prefetchMutex};
+    auto search = prefetched.find(name);
+    if(search != prefetched.end()){
+      prefetchedSheet = std::move(search->second);
+      prefetched.erase(search);
+    }
+  }
+
+  for(auto& pair : spritesheets){
+    if(pair.second._name == name){
+      pair.second._referenceCount++;
+      cache::onHit(cache::RESOURCE_SPRITESHEET, pair.first);
+      std::string addendum {"ref count="};
+      addendum += std::to_string(pair.second._referenceCount);
+      log::log(log::INFO, log::msg_gfx_spritesheet_already_loaded, addendum);
+      return pair.first;
+    }
+  }
+
+  SpritesheetResource resource{};
+  Spritesheet& sheet = resource._sheet;
+
+  resource._name = name;
+  resource._referenceCount = 1;
+
+  if(prefetchedSheet)
+    sheet = std::move(*prefetchedSheet);
+  else if(!readSpritesheet(name, sheet))
+    return useErrorSpritesheet();
+
   ResourceKey_t newKey = nextResourceKey;
   ++nextResourceKey;
 
+  int64_t sheetBytes = calculateSpritesheetBytes(sheet);
   spritesheets.emplace(std::make_pair(newKey, std::move(resource)));
+  cache::onLoad(cache::RESOURCE_SPRITESHEET, newKey, sheetBytes);
 
   std::string addendum{};
   addendum += "[name:key]=[";
@@ -478,21 +624,33 @@ void unloadSpritesheet(ResourceKey_t sheetKey)
   }
 
   SpritesheetResource& resource = search->second;
+  if(resource._name == errorSpritesheetName){
+    resource._referenceCount--;
+    return;
+  }
+
+  if(resource._referenceCount <= 0){
+    log::log(log::WARN, log::msg_gfx_unloading_nonexistent_resource, "key=" + std::to_string(sheetKey));
+    return;
+  }
+
   resource._referenceCount--;
-  if(resource._referenceCount <= 0 && resource._name != errorSpritesheetName){
-    log::log(log::INFO, log::msg_gfx_unload_spritesheet_success, "key=" + std::to_string(sheetKey));
-    spritesheets.erase(search);
+  if(resource._referenceCount == 0){
+    log::log(log::INFO, log::msg_gfx_release_spritesheet, "key=" + std::to_string(sheetKey));
+    cache::onRelease(cache::RESOURCE_SPRITESHEET, sheetKey);
   }
 }
 
 ResourceKey_t loadFont(ResourceName_t name)
 {
+  PXR_PROFILE_ZONE("gfx::loadFont");
   log::log(log::INFO, log::msg_gfx_loading_font, name);
 
   for(auto& resource : fonts){
     if(resource.second._name == name){
       log::log(log::INFO, log::msg_gfx_loading_font_success);
       resource.second._referenceCount++;
+      cache::onHit(cache::RESOURCE_FONT, resource.first);
       return resource.first;
     }
   }
@@ -503,11 +661,10 @@ ResourceKey_t loadFont(ResourceName_t name)
   resource._name = name;
   resource._referenceCount = 1;
 
-  std::string bmppath{};
-  bmppath += RESOURCE_PATH_FONTS;
-  bmppath += name;
-  bmppath += Bmp::FILE_EXTENSION;
-  if(!resource._font._image.load(bmppath)){
+  std::string imagepath{};
+  imagepath += RESOURCE_PATH_FONTS;
+  imagepath += name;
+  if(!loadImage(imagepath, resource._font._image)){
     log::log(log::ERROR, log::msg_gfx_fail_load_asset_bmp, name);
     return useErrorFont();
   }
@@ -603,7 +760,9 @@ ResourceKey_t loadFont(ResourceName_t name)
   ResourceKey_t newKey = nextResourceKey;
   ++nextResourceKey;
 
+  int64_t fontBytes = calculateFontBytes(font);
   fonts.emplace(std::make_pair(newKey, std::move(resource)));
+  cache::onLoad(cache::RESOURCE_FONT, newKey, fontBytes);
 
   return newKey;
 }
@@ -617,10 +776,20 @@ void unloadFont(ResourceKey_t fontKey)
   }
 
   FontResource& resource = search->second;
+  if(resource._name == errorFontName){
+    resource._referenceCount--;
+    return;
+  }
+
+  if(resource._referenceCount <= 0){
+    log::log(log::WARN, log::msg_gfx_unloading_nonexistent_resource, "font" + std::to_string(fontKey));
+    return;
+  }
+
   resource._referenceCount--;
-  if(resource._referenceCount <= 0 && resource._name != errorFontName){
-    log::log(log::INFO, log::msg_gfx_unload_font_success, "key=" + std::to_string(fontKey));
-    fonts.erase(search);
+  if(resource._referenceCount == 0){
+    log::log(log::INFO, log::msg_gfx_release_font, "key=" + std::to_string(fontKey));
+    cache::onRelease(cache::RESOURCE_FONT, fontKey);
   }
 }
 
@@ -650,6 +819,8 @@ void onWindowResize(Vector2i windowSize)
 
 void clearWindowColor(Color4f color)
 {
+  if(headless)
+    return;
   glClearColor(color._r, color._g, color._b, color._a); 
   glClear(GL_COLOR_BUFFER_BIT);
 }
@@ -678,6 +849,7 @@ void clearScreenColor(Color4u color, int screenid)
 void drawSprite(Vector2i position, ResourceKey_t sheetKey, int spriteid, int screenid, 
                 bool mirrorX, bool mirrorY)
 {
+  PXR_PROFILE_ZONE("gfx::drawSprite");
   assert(0 <= screenid && screenid < screens.size());
   auto& screen = screens[screenid];
 
@@ -724,6 +896,7 @@ void drawSprite(Vector2i position, ResourceKey_t sheetKey, int spriteid, int scr
 
 void drawSpriteColumn(Vector2i position, ResourceKey_t sheetKey, int spriteid, int colid, int screenid)
 {
+  PXR_PROFILE_ZONE("gfx::drawSpriteColumn");
   assert(0 <= screenid && screenid < screens.size());
   auto& screen = screens[screenid];
 
@@ -758,8 +931,9 @@ void drawSpriteColumn(Vector2i position, ResourceKey_t sheetKey, int spriteid, i
   }
 }
 
-void drawText(Vector2i position, const std::string& text, ResourceKey_t fontKey, Color4u color, int screenid)
+void drawText(Vector2i position, std::string_view text, ResourceKey_t fontKey, Color4u color, int screenid)
 {
+  PXR_PROFILE_ZONE("gfx::drawText");
   assert(0 <= screenid && screenid < screens.size());
   auto& screen = screens[screenid];
 
@@ -911,14 +1085,43 @@ void drawPoint(Vector2i position, Color4u color, int screenid)
         (screen._xmode == PixelMode::SHADER) ? screen._pxShader(color, x, y) : color;
 }
 
+//
+// Returns the colors of a screen darkened by its fade level, in a scratch buffer which is valid
+// until the next call; the screen itself is left as drawn. Fixed function opengl 1.1 (all this
+// module assumes of a context) has no way to scale a color array as it is drawn.
+//
+static const Color4u* fadeColors(const Screen& screen)
+{
+  static std::vector<Color4u> fadedColors {};
+  if(fadedColors.size() < static_cast<size_t>(screen._pxCount))
+    fadedColors.resize(screen._pxCount);
+
+  int scale = static_cast<int>((1.f - std::clamp(screen._fadeLevel, 0.f, 1.f)) * 256.f);
+  for(int px = 0; px < screen._pxCount; ++px){
+    Color4u color = screen._pxColors[px];
+    color._r = static_cast<uint8_t>((color._r * scale) >> 8);
+    color._g = static_cast<uint8_t>((color._g * scale) >> 8);
+    color._b = static_cast<uint8_t>((color._b * scale) >> 8);
+    fadedColors[px] = color;
+  }
+  return fadedColors.data();
+}
+
 void present()
 {
+  PXR_PROFILE_ZONE("gfx::present");
+  if(headless)
+    return;
+
   for(auto& screen : screens){
     if(!screen._isEnabled) 
       continue;
 
     glVertexPointer(2, GL_INT, 0, screen._pxPositions);
-    glColorPointer(4, GL_UNSIGNED_BYTE, 0, screen._pxColors);
+    if(screen._fadeLevel > 0.f)
+      glColorPointer(4, GL_UNSIGNED_BYTE, 0, fadeColors(screen));
+    else
+      glColorPointer(4, GL_UNSIGNED_BYTE, 0, screen._pxColors);
     glPointSize(screen._pxSize);
     glDrawArrays(GL_POINTS, 0, screen._pxCount);
   }
@@ -974,6 +1177,12 @@ void setPixelShader(PXShader_t shader, int screenid)
   screen._pxShader = shader;
 }
 
+void setScreenFade(float level, int screenid)
+{
+  assert(0 <= screenid && screenid < screens.size());
+  screens[screenid]._fadeLevel = std::clamp(level, 0.f, 1.f);
+}
+
 void enableScreen(int screenid)
 {
   assert(0 <= screenid && screenid < screens.size());
@@ -986,7 +1195,7 @@ void disableScreen(int screenid)
   screens[screenid]._isEnabled = false;
 }
 
-Vector2i calculateTextSize(const std::string& text, ResourceKey_t fontKey)
+Vector2i calculateTextSize(std::string_view text, ResourceKey_t fontKey)
 {
   Vector2i size{0, 0};
 
@@ -1,9 +1,37 @@
 #include <cassert>
+#include <array>
+#include <limits>
+#include <algorithm>
+#include <charconv>
+#include <memory_resource>
 #include "../include/pxr_hud.h"
+#include "../include/pxr_telemetry.h"
+#include "../include/pxr_profile.h"
 
 namespace pxr
 {
 
+//
+// Shared by every HUD on whichever threads they run (see Engine threaded updates), hence the
+// synchronized pool. Deliberately leaked so it outlives every Label, including those freed
+// during static destruction (e.g. by a game owned by a static engine).
+//
+static std::pmr::synchronized_pool_resource& getLabelPool()
+{
+  static auto* labelPool = new std::pmr::synchronized_pool_resource{};
+  return *labelPool;
+}
+
+void* HUD::Label::operator new(std::size_t bytes)
+{
+  return getLabelPool().allocate(bytes, alignof(std::max_align_t));
+}
+
+void HUD::Label::operator delete(void* p, std::size_t bytes)
+{
+  getLabelPool().deallocate(p, bytes, alignof(std::max_align_t));
+}
+
 HUD::Label::Label(
   Vector2f position,
   gfx::Color4u color,
@@ -81,11 +109,13 @@ HUD::TextLabel::TextLabel(
   :
   Label(position, color, activationDelay, lifetime),
   _fontKey{fontKey},
-  _fullText{text},
-  _visibleText{phaseIn ? std::string{} : text},
+  _fullText{std::move(text)},
+  _visibleText{phaseIn ? std::string{} : _fullText},
   _nextCharToShow{0},
   _isPhasingIn{phaseIn}
-{}
+{
+  _visibleText.reserve(_fullText.length());   // so phasing in never reallocates.
+}
 
 void HUD::TextLabel::onReset()
 {
@@ -131,6 +161,7 @@ HUD::IntLabel::IntLabel(
   _displayValue{sourceValue},
   _precision{precision}
 {
+  _displayStr.reserve(std::max(_precision, std::numeric_limits<int>::digits10 + 1) + 1);
   composeDisplayStr();
 }
 
@@ -157,20 +188,26 @@ void HUD::IntLabel::onDraw(gfx::ScreenID_t screenid)
     gfx::drawText(_position, _displayStr, _fontKey, _color, screenid);
 }
 
+//
+// Formats in place (the display string is reserved for the widest int) so the score labels,
+// which recompose as the game plays, never allocate.
+//
 void HUD::IntLabel::composeDisplayStr()
 {
-  std::string valueStr = std::to_string(_sourceValue);
+  std::array<char, std::numeric_limits<int>::digits10 + 2> digits;
+  auto [end, ec] = std::to_chars(digits.data(), digits.data() + digits.size(), _sourceValue);
+  assert(ec == std::errc{});
   _displayStr.clear();
-  int sign{0};
+  const char* begin = digits.data();
   if(_sourceValue < 0){
-    assert(valueStr.front() == '-');
-    sign = 1;
+    assert(*begin == '-');
     _displayStr += '-';
+    ++begin;
   }
-  for(int i{0}; i < _precision - (valueStr.length() - sign); ++i){
-    _displayStr += '0';
-  }
-  _displayStr.append(valueStr.begin() + sign, valueStr.end());
+  int numDigits = static_cast<int>(end - begin);
+  if(_precision > numDigits)
+    _displayStr.append(_precision - numDigits, '0');
+  _displayStr.append(begin, numDigits);
 }
 
 HUD::BitmapLabel::BitmapLabel(
@@ -225,6 +262,9 @@ void HUD::onReset()
 
 void HUD::onUpdate(float dt)
 {
+  PXR_PROFILE_ZONE("HUD::onUpdate");
+  telemetry::ScopedPhase phase {telemetry::PHASE_HUD_UPDATE};
+
   _flashClock += dt;
   if(_flashClock >= _flashPeriod){
     _flashClock = 0.f;
@@ -249,6 +289,8 @@ void HUD::onUpdate(float dt)
 
 void HUD::onDraw(gfx::ScreenID_t screenid)
 {
+  PXR_PROFILE_ZONE("HUD::onDraw");
+  telemetry::ScopedPhase phase {telemetry::PHASE_HUD_DRAW};
   for(auto& label : _labels)
     label->onDraw(screenid);
 }
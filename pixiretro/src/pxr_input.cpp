@@ -13,6 +13,7 @@ namespace input
 
 static std::array<KeyLog, KEY_COUNT> keys;   // logs for all keys.
 static std::vector<KeyCode> history;         // ordered history of keys pressed.
+static std::vector<KeyEvent> events;         // ordered key events since the last update.
 
 static KeyCode convertSdlKeyCode(int sdlCode)
 {
@@ -69,7 +70,16 @@ void onKeyEvent(const SDL_Event& event)
   if(key == KEY_COUNT) 
     return;
 
-  if(event.type == SDL_KEYDOWN){
+  onKey(key, event.type == SDL_KEYDOWN);
+}
+
+void onKey(KeyCode key, bool isDown)
+{
+  assert(key != KEY_COUNT);
+
+  events.push_back({key, isDown});
+
+  if(isDown){
     keys[key]._isDown = true;
     keys[key]._isPressed = true;
     history.push_back(key);
@@ -85,6 +95,7 @@ void onUpdate()
   for(auto& key : keys)
     key._isPressed = key._isReleased = false;
   history.clear();
+  events.clear();
 }
 
 bool isKeyDown(KeyCode key)
@@ -107,6 +118,11 @@ const std::vector<KeyCode>& getHistory()
   return history;
 }
 
+const std::vector<KeyEvent>& getEvents()
+{
+  return events;
+}
+
 int keyToAsciiCode(KeyCode key)
 {
   switch(key){
@@ -0,0 +1,210 @@
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include <memory>
+#include <cassert>
+#include "../include/pxr_jobs.h"
+#include "../include/pxr_deque.h"
+#include "../include/pxr_log.h"
+#include "../include/pxr_profile.h"
+
+namespace pxr
+{
+namespace jobs
+{
+
+using Deque_t = WorkStealingDeque<Job, DEQUE_CAPACITY>;
+
+//
+// The most times an idle worker looks for a job to steal before it sleeps.
+//
+static constexpr int STEAL_ATTEMPTS_BEFORE_SLEEP {64};
+
+//
+// The deques of all threads which have ever made or run a job. Deques are claimed, never
+// released, so thieves can scan the first numDeques without locking; the mutex guards only the
+// claiming.
+//
+static std::array<std::unique_ptr<Deque_t>, MAX_THREADS> deques;
+static std::atomic<int> numDeques {0};
+static std::mutex dequesMutex;
+
+static constexpr int NO_DEQUE {-2};      // every deque was claimed before the thread's first job.
+static thread_local int dequeIndex {-1};
+
+static std::vector<std::thread> workers;
+static std::atomic<int> numWorkers {0};           // workers.size(), readable by any thread.
+static std::atomic<bool> isRunning {false};
+
+//
+// Workers sleep on the condition variable when idle. Every job made bumps the epoch; a worker
+// only sleeps if the epoch is unchanged since it last looked for jobs, so a job made whilst it
+// was falling asleep is never missed.
+//
+static std::mutex sleepMutex;
+static std::condition_variable sleepCondition;
+static std::atomic<uint64_t> workEpoch {0};
+static std::atomic<int> numSleeping {0};
+
+//
+// Returns the calling thread's deque index, claiming it one on its first call; -1 if every
+// deque is claimed, in which case the thread runs the jobs it makes itself.
+//
+static int getDequeIndex()
+{
+  if(dequeIndex >= 0)
+    return dequeIndex;
+  if(dequeIndex == NO_DEQUE)
+    return -1;
+
+  std::lock_guard<std::mutex> lock {dequesMutex};
+  int index = numDeques.load(std::memory_order_relaxed);
+  if(index == MAX_THREADS){
+    log::log(log::WARN, log::msg_jobs_too_many_threads);
+    dequeIndex = NO_DEQUE;
+    return -1;
+  }
+  deques[index] = std::make_unique<Deque_t>();
+  numDeques.store(index + 1, std::memory_order_release);
+  dequeIndex = index;
+  return dequeIndex;
+}
+
+static void execute(Job* job)
+{
+  job->_function(job->_data);
+  job->_counter->_count.fetch_sub(1, std::memory_order_release);
+}
+
+//
+// Pops a job from the thread's own deque, else steals one from another, starting after the
+// thread's own so thieves spread over the victims.
+//
+static Job* findJob(int index)
+{
+  if(index >= 0){
+    if(Job* job = deques[index]->pop())
+      return job;
+  }
+
+  int count = numDeques.load(std::memory_order_acquire);
+  for(int i = 1; i <= count; ++i){
+    int victim = (index + i) % count;
+    if(victim == index)
+      continue;
+    if(Job* job = deques[victim]->steal())
+      return job;
+  }
+  return nullptr;
+}
+
+static void wakeWorkers(int numJobs)
+{
+  workEpoch.fetch_add(1, std::memory_order_seq_cst);
+  if(numSleeping.load(std::memory_order_seq_cst) == 0)
+    return;
+  std::lock_guard<std::mutex> lock {sleepMutex};
+  if(numJobs == 1)
+    sleepCondition.notify_one();
+  else
+    sleepCondition.notify_all();
+}
+
+static void workerLoop()
+{
+  PXR_PROFILE_THREAD_NAME("job worker");
+  int index = getDequeIndex();
+  int failedAttempts {0};
+  while(isRunning.load(std::memory_order_acquire)){
+    uint64_t epoch = workEpoch.load(std::memory_order_seq_cst);
+    if(Job* job = findJob(index)){
+      execute(job);
+      failedAttempts = 0;
+      continue;
+    }
+
+    if(++failedAttempts < STEAL_ATTEMPTS_BEFORE_SLEEP){
+      std::this_thread::yield();
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock {sleepMutex};
+    numSleeping.fetch_add(1, std::memory_order_seq_cst);
+    sleepCondition.wait(lock, [epoch](){
+      return workEpoch.load(std::memory_order_seq_cst) != epoch || !isRunning.load(std::memory_order_acquire);
+    });
+    numSleeping.fetch_sub(1, std::memory_order_seq_cst);
+    failedAttempts = 0;
+  }
+}
+
+void initialize(int numWorkers_)
+{
+  assert(workers.empty());
+
+  if(numWorkers_ < 0)
+    numWorkers_ = std::max(0, static_cast<int>(std::thread::hardware_concurrency()) - 1);
+  numWorkers_ = std::min(numWorkers_, MAX_THREADS - 1);
+
+  getDequeIndex();    // the calling thread's.
+
+  isRunning.store(true, std::memory_order_release);
+  for(int w = 0; w < numWorkers_; ++w)
+    workers.emplace_back(&workerLoop);
+  numWorkers.store(numWorkers_, std::memory_order_release);
+
+  log::log(log::INFO, log::msg_jobs_workers, std::to_string(numWorkers_));
+}
+
+void shutdown()
+{
+  isRunning.store(false, std::memory_order_release);
+  {
+    std::lock_guard<std::mutex> lock {sleepMutex};
+    sleepCondition.notify_all();
+  }
+  for(auto& worker : workers)
+    worker.join();
+  workers.clear();
+  numWorkers.store(0, std::memory_order_release);
+}
+
+int getWorkerCount()
+{
+  return numWorkers.load(std::memory_order_acquire);
+}
+
+void run(Job* jobs, int numJobs, Counter& counter)
+{
+  if(numJobs <= 0)
+    return;
+
+  counter._count.fetch_add(numJobs, std::memory_order_relaxed);
+  int index = getDequeIndex();
+  int numPushed {0};
+  for(int j = 0; j < numJobs; ++j){
+    jobs[j]._counter = &counter;
+    if(index >= 0 && deques[index]->push(&jobs[j]))
+      ++numPushed;
+    else
+      execute(&jobs[j]);
+  }
+
+  if(numPushed > 0)
+    wakeWorkers(numPushed);
+}
+
+void wait(Counter& counter)
+{
+  int index = getDequeIndex();
+  while(!counter.isDone()){
+    if(Job* job = findJob(index))
+      execute(job);
+    else
+      std::this_thread::yield();
+  }
+}
+
+} // namespace jobs
+} // namespace pxr
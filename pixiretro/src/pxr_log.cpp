@@ -1,14 +1,307 @@
 #include <iostream>
 #include <fstream>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <unordered_map>
+#include <chrono>
+#include <algorithm>
+#include <limits>
+#include <cstring>
 #include "../include/pxr_log.h"
+#include "../include/pxr_mpsc.h"
 
 namespace pxr
 {
 namespace log
 {
 
+using Clock_t = std::chrono::steady_clock;
+
+//
+// A message as queued in asynchronous mode.
+//
+struct Record
+{
+  const char* _error;
+  Level _level;
+  int _length;
+  std::array<char, MAX_ADDENDUM_LENGTH> _addendum;
+};
+
+//
+// The rate limiting of a message; see RATE_LIMIT_BURST.
+//
+struct Repeats
+{
+  const char* _error;
+  int64_t _periodStart_ms;
+  int _count;
+  int _suppressed;
+};
+
 static std::ofstream _os;
 
+//
+// Serializes writing to the stream (and rate limiting); taken by the logging thread in
+// synchronous mode and by the writer thread in asynchronous mode.
+//
+static std::mutex _mutex;
+
+//
+// The messages logged within the last rate limit period, keyed by a hash of the error and
+// addendum; pruned once it tracks this many.
+//
+static constexpr size_t MAX_REPEATS_TRACKED {256};
+static std::unordered_map<uint64_t, Repeats> repeats;
+
+//
+// The rate limiting of a message in asynchronous mode, updated lock free by the logging
+// threads; the writer reports and clears the counts of suppressed repeats. The state packs the
+// period (time / RATE_LIMIT_PERIOD_MS) above the count of the period's repeats. The logging
+// thread which starts a new period carries the ended period's suppressed repeats, if the
+// writer has yet to report them, over to the writer.
+//
+struct RateSlot
+{
+  std::atomic<uint64_t> _key;
+  std::atomic<const char*> _error;
+  std::atomic<uint64_t> _state;
+  std::atomic<uint64_t> _carried;
+};
+
+static constexpr int RATE_COUNT_BITS {24};
+static constexpr uint64_t RATE_COUNT_MASK {(uint64_t{1} << RATE_COUNT_BITS) - 1};
+
+static_assert((RATE_LIMIT_SLOTS & (RATE_LIMIT_SLOTS - 1)) == 0, "RATE_LIMIT_SLOTS must be a power of 2");
+static std::array<RateSlot, RATE_LIMIT_SLOTS> rateSlots;
+
+static MPSCQueue<Record> queue {ASYNC_QUEUE_CAPACITY};
+static std::atomic<bool> isAsync {false};
+static std::atomic<int64_t> numDropped {0};
+static std::atomic<uint64_t> numPushed {0};
+static std::atomic<uint64_t> numPopped {0};
+
+static std::mutex writerMutex;
+static std::condition_variable writerCondition;      // wakes the writer.
+static std::condition_variable flushCondition;       // signals a batch was written.
+static bool isWriterRunning {false};                 // guarded by the writer mutex.
+static std::atomic<bool> isWakeRequested {false};
+
+//
+// Joins the writer should the program exit without a shutdown (e.g. after a FATAL message);
+// defined after the stream so destroyed before it.
+//
+static struct Writer
+{
+  ~Writer() {shutdown();}
+
+  std::thread _thread;
+} writer;
+
+static int64_t now_ms()
+{
+  return std::chrono::duration_cast<std::chrono::milliseconds>(Clock_t::now().time_since_epoch()).count();
+}
+
+static std::ostream& getStream()
+{
+  return _os.is_open() ? static_cast<std::ostream&>(_os) : std::cerr;
+}
+
+static void writeLine(std::ostream& os, Level level, const char* error, std::string_view addendum)
+{
+  os << prefix[level] << LOG_DELIM << error;
+  if(!addendum.empty())
+    os << LOG_DELIM << addendum;
+  os << '\n';
+}
+
+static void writeSuppressed(std::ostream& os, const Repeats& r)
+{
+  writeLine(os, INFO, msg_log_suppressed, std::string(r._error) + LOG_DELIM + std::to_string(r._suppressed));
+}
+
+//
+// Forgets the messages whose rate limit period is out. Caller must hold the mutex.
+//
+static void pruneRepeats(std::ostream& os, int64_t time_ms)
+{
+  for(auto it = repeats.begin(); it != repeats.end();){
+    if(time_ms - it->second._periodStart_ms < RATE_LIMIT_PERIOD_MS){
+      ++it;
+      continue;
+    }
+    if(it->second._suppressed > 0)
+      writeSuppressed(os, it->second);
+    it = repeats.erase(it);
+  }
+}
+
+static uint64_t hashMessage(const char* error, std::string_view addendum)
+{
+  return std::hash<std::string_view>{}(addendum) ^ (reinterpret_cast<uintptr_t>(error) * 0x9e3779b97f4a7c15ull);
+}
+
+//
+// Returns false if the message is a repeat over the rate limit. Caller must hold the mutex.
+// Synchronous mode only; see admitAsync.
+//
+static bool admit(std::ostream& os, Level level, const char* error, std::string_view addendum, int64_t time_ms)
+{
+  if(level == FATAL)
+    return true;
+
+  if(repeats.size() >= MAX_REPEATS_TRACKED)
+    pruneRepeats(os, time_ms);
+
+  uint64_t key = hashMessage(error, addendum);
+  Repeats& r = repeats.try_emplace(key, Repeats{error, time_ms, 0, 0}).first->second;
+  if(time_ms - r._periodStart_ms >= RATE_LIMIT_PERIOD_MS){
+    if(r._suppressed > 0)
+      writeSuppressed(os, r);
+    r = Repeats{error, time_ms, 0, 0};
+  }
+  if(r._count < RATE_LIMIT_BURST){
+    ++r._count;
+    return true;
+  }
+  ++r._suppressed;
+  return false;
+}
+
+//
+// Returns false if the message is a repeat over the rate limit; lock free, any thread. A
+// message which collides with another in the table takes the slot over, restarting its count
+// (and forgetting the other's unreported repeats), so colliding messages are limited loosely
+// rather than wrongly suppressed.
+//
+static bool admitAsync(Level level, const char* error, std::string_view addendum, int64_t time_ms)
+{
+  if(level == FATAL)
+    return true;
+
+  uint64_t key = hashMessage(error, addendum);
+  uint64_t period = static_cast<uint64_t>(time_ms / RATE_LIMIT_PERIOD_MS);
+  RateSlot& slot = rateSlots[key & (RATE_LIMIT_SLOTS - 1)];
+  if(slot._key.load(std::memory_order_relaxed) != key){
+    slot._key.store(key, std::memory_order_relaxed);
+    slot._error.store(error, std::memory_order_relaxed);
+    slot._carried.store(0, std::memory_order_relaxed);
+    slot._state.store((period << RATE_COUNT_BITS) | 1, std::memory_order_release);
+    return true;
+  }
+
+  uint64_t state = slot._state.load(std::memory_order_relaxed);
+  uint64_t next;
+  do{
+    uint64_t count = state & RATE_COUNT_MASK;
+    if((state >> RATE_COUNT_BITS) != period)
+      count = 0;
+    next = (period << RATE_COUNT_BITS) | std::min(count + 1, RATE_COUNT_MASK);
+  }
+  while(!slot._state.compare_exchange_weak(state, next, std::memory_order_acq_rel, std::memory_order_relaxed));
+
+  //
+  // The exchange swapped the ended period's count out, so only this thread can carry it.
+  //
+  uint64_t endedCount = state & RATE_COUNT_MASK;
+  if((state >> RATE_COUNT_BITS) != period && endedCount > static_cast<uint64_t>(RATE_LIMIT_BURST))
+    slot._carried.fetch_add(endedCount - RATE_LIMIT_BURST, std::memory_order_release);
+
+  return (next & RATE_COUNT_MASK) <= static_cast<uint64_t>(RATE_LIMIT_BURST);
+}
+
+//
+// Writes (and clears) the counts of the repeats suppressed by admitAsync in periods which have
+// ended, or in every period if isFinal, along with those carried over by new periods. Writer thread (or the thread which stops it) only;
+// caller must hold the mutex.
+//
+static void writeSlotsSuppressed(std::ostream& os, int64_t time_ms, bool isFinal)
+{
+  uint64_t period = static_cast<uint64_t>(time_ms / RATE_LIMIT_PERIOD_MS);
+  for(auto& slot : rateSlots){
+    uint64_t suppressed {0};
+    uint64_t state = slot._state.load(std::memory_order_acquire);
+    uint64_t count = state & RATE_COUNT_MASK;
+    if(count > static_cast<uint64_t>(RATE_LIMIT_BURST) && (isFinal || (state >> RATE_COUNT_BITS) < period)){
+      uint64_t cleared = (state & ~RATE_COUNT_MASK) | static_cast<uint64_t>(RATE_LIMIT_BURST);
+      if(slot._state.compare_exchange_strong(state, cleared, std::memory_order_acq_rel))
+        suppressed += count - RATE_LIMIT_BURST;
+    }
+    if(slot._carried.load(std::memory_order_relaxed) > 0)
+      suppressed += slot._carried.exchange(0, std::memory_order_acquire);
+    if(suppressed == 0)
+      continue;
+    const char* error = slot._error.load(std::memory_order_relaxed);
+    writeSuppressed(os, Repeats{error, 0, 0, static_cast<int>(std::min<uint64_t>(suppressed, std::numeric_limits<int>::max()))});
+  }
+}
+
+//
+// Writes the counts of the repeats suppressed in periods which never ended. Caller must hold
+// the mutex.
+//
+static void writeAllSuppressed(std::ostream& os)
+{
+  for(auto& [key, r] : repeats){
+    if(r._suppressed > 0)
+      writeSuppressed(os, r);
+  }
+  repeats.clear();
+}
+
+//
+// Writes out every waiting record; writer thread (or the thread which stops it) only.
+//
+static void writeBatch()
+{
+  std::lock_guard<std::mutex> lock {_mutex};
+  std::ostream& os = getStream();
+
+  int64_t dropped = numDropped.exchange(0, std::memory_order_relaxed);
+  if(dropped > 0)
+    writeLine(os, WARN, msg_log_dropped, std::to_string(dropped));
+
+  Record record;
+  int numWritten {0};
+  while(queue.pop(record)){
+    writeLine(os, record._level, record._error, {record._addendum.data(), static_cast<size_t>(record._length)});
+    ++numWritten;
+  }
+  writeSlotsSuppressed(os, now_ms(), false);
+  if(numWritten > 0 || dropped > 0)
+    os.flush();
+
+  std::lock_guard<std::mutex> writerLock {writerMutex};
+  numPopped.fetch_add(numWritten, std::memory_order_release);
+}
+
+static void writerLoop()
+{
+  std::unique_lock<std::mutex> lock {writerMutex};
+  while(isWriterRunning){
+    writerCondition.wait_for(lock, std::chrono::milliseconds{WRITER_PERIOD_MS}, [](){
+      return isWakeRequested.load(std::memory_order_relaxed) || !isWriterRunning;
+    });
+    isWakeRequested.store(false, std::memory_order_relaxed);
+    lock.unlock();
+    writeBatch();
+    lock.lock();
+    flushCondition.notify_all();
+  }
+}
+
+//
+// Lock free, so a wake may be missed if the writer is just falling asleep; it then writes on
+// its next periodic wake.
+//
+static void wakeWriter()
+{
+  if(!isWakeRequested.exchange(true, std::memory_order_relaxed))
+    writerCondition.notify_one();
+}
+
 void initialize()
 {
   _os.open(LOG_FILENAME, std::ios_base::trunc);
@@ -18,19 +311,93 @@ void initialize()
   }
 }
 
+void startAsync()
+{
+  {
+    std::lock_guard<std::mutex> lock {writerMutex};
+    if(isWriterRunning)
+      return;
+    isWriterRunning = true;
+    writer._thread = std::thread{&writerLoop};
+  }
+  isAsync.store(true, std::memory_order_release);
+  log(INFO, msg_log_async);
+}
+
+void flush()
+{
+  if(!isAsync.load(std::memory_order_acquire))
+    return;
+
+  uint64_t target = numPushed.load(std::memory_order_acquire);
+  std::unique_lock<std::mutex> lock {writerMutex};
+  isWakeRequested.store(true, std::memory_order_relaxed);
+  writerCondition.notify_one();
+  flushCondition.wait(lock, [target](){
+    return numPopped.load(std::memory_order_acquire) >= target || !isWriterRunning;
+  });
+}
+
 void shutdown()
 {
-  if(_os)
+  isAsync.store(false, std::memory_order_release);
+  {
+    std::lock_guard<std::mutex> lock {writerMutex};
+    isWriterRunning = false;
+    writerCondition.notify_one();
+  }
+  if(writer._thread.joinable())
+    writer._thread.join();
+
+  //
+  // Records pushed whilst the writer stopped.
+  //
+  writeBatch();
+
+  std::lock_guard<std::mutex> lock {_mutex};
+  writeSlotsSuppressed(getStream(), now_ms(), true);
+  writeAllSuppressed(getStream());
+  if(_os.is_open())
     _os.close();
 }
 
-void log(Level level, const char* error, const std::string& addendum)
+void write(Level level, const char* error, std::string_view addendum)
 {
-  std::ostream& os {_os ? _os : std::cerr}; 
-  os << prefix[level] << LOG_DELIM << error;
-  if(!addendum.empty())
-    os << LOG_DELIM << addendum;
-  os << std::endl;
+  if(!isAsync.load(std::memory_order_acquire)){
+    std::lock_guard<std::mutex> lock {_mutex};
+    std::ostream& os = getStream();
+    if(admit(os, level, error, addendum, now_ms())){
+      writeLine(os, level, error, addendum);
+      os.flush();
+    }
+    return;
+  }
+
+  if(!admitAsync(level, error, addendum, now_ms()))
+    return;
+
+  Record record;
+  record._error = error;
+  record._level = level;
+  record._length = static_cast<int>(std::min(addendum.size(), record._addendum.size()));
+  std::memcpy(record._addendum.data(), addendum.data(), record._length);
+  if(addendum.size() > record._addendum.size())
+    std::memcpy(record._addendum.data() + record._length - 3, "...", 3);
+
+  if(!queue.push(record)){
+    numDropped.fetch_add(1, std::memory_order_relaxed);
+    wakeWriter();
+    return;
+  }
+  uint64_t pushed = numPushed.fetch_add(1, std::memory_order_release) + 1;
+
+  //
+  // Errors are written promptly, as is a filling queue so bursts are not dropped.
+  //
+  if(level == FATAL)
+    flush();
+  else if(level == ERROR || pushed - numPopped.load(std::memory_order_relaxed) >= ASYNC_QUEUE_CAPACITY / 2)
+    wakeWriter();
 }
 
 } // namespace log
@@ -0,0 +1,1473 @@
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <atomic>
+#include <array>
+#include <memory>
+#include <cmath>
+#include <SDL2/SDL_audio.h>
+#include "../include/pxr_mixer.h"
+#include "../include/pxr_spsc.h"
+#include "../include/pxr_dsp.h"
+#include "../include/pxr_log.h"
+#include "../include/pxr_profile.h"
+
+namespace pxr
+{
+namespace mixer
+{
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+// MODULE DATA
+/////////////////////////////////////////////////////////////////////////////////////////////////
+
+struct Voice
+{
+  const int16_t* _samples = nullptr;
+  int _frameCount = 0;
+  int _position = 0;
+  int _loopsRemaining = 0;
+  int64_t _framesUntilStop = -1;      // -1 == never.
+  float _fade = 1.f;
+  float _fadeStep = 0.f;              // per frame; the voice stops when a fade out reaches 0.
+  float _gain = 1.f;
+  float _pan = PAN_CENTER;
+  float _rampGain[2] {0.f, 0.f};      // the gains applied at the end of the last block mixed.
+  uint32_t _generation = 0;
+  bool _isActive = false;
+  bool _isPaused = false;
+
+  //
+  // The play a voice was stolen from; faded out over the first block mixed after the steal
+  // so the steal does not click.
+  //
+  struct Tail
+  {
+    const int16_t* _samples = nullptr;
+    int _frameCount = 0;
+    int _position = 0;
+    float _gain[2] {0.f, 0.f};
+    uint32_t _generation = 0;
+  };
+
+  Tail _tail;
+};
+
+//
+// An effect in a bus's chain; created and freed by the game thread, processed by the audio
+// thread. The parameters are the values last set by the game thread; the gliding parameters
+// move towards them a block at a time.
+//
+struct Effect
+{
+  EffectID_t _id;
+  Bus _bus;
+  EffectType _type;
+  std::array<float, PARAM_COUNT> _parameters;
+  dsp::OnePole _mix;
+  dsp::OnePole _gain;
+  dsp::OnePole _cutoff;             // glides in octaves, i.e. log2(hz).
+  float _configuredCutoff_hz;       // the cutoff the filters were last configured with.
+  float _configuredQ;
+  dsp::Biquad _biquads[2];          // a filter per channel.
+  dsp::OnePole _smoothers[2];
+  std::unique_ptr<dsp::SchroederReverb> _reverb;
+  std::unique_ptr<dsp::Compressor> _compressor;
+  bool _isIdle;                     // skipped whilst its mix is 0; state cleared on entry.
+  bool _isStarted;                  // whether it has processed a block yet.
+};
+
+//
+// Messages from the game thread to the audio thread.
+//
+struct Command
+{
+  enum Type
+  {
+    PLAY,
+    STOP,
+    STOP_TIMED,
+    STOP_FADE_OUT,
+    PAUSE,
+    RESUME,
+    SET_GAIN,
+    SET_PAN,
+    QUEUE_TRACK_NODE,
+    STOP_TRACK,
+    PAUSE_TRACK,
+    RESUME_TRACK,
+    SET_TRACK_GAIN,
+    INSERT_EFFECT,
+    REMOVE_EFFECT,
+    SET_EFFECT_PARAMETER
+  };
+
+  Type _type;
+  int _voice;
+  uint32_t _generation;
+  const int16_t* _samples;
+  int _frameCount;
+  int _loops;
+  int _fadeFrames;          // fade in or fade out duration.
+  int _durationFrames;      // play duration or duration until stop; -1 == never.
+  int _fadeOutFrames;       // track nodes only.
+  float _value;             // gain, pan or effect parameter.
+  Effect* _effect;          // effects only.
+  int _parameter;
+};
+
+//
+// A node queued on the music track; see the MUSIC TRACK section.
+//
+struct TrackNode
+{
+  uint32_t _id;
+  const int16_t* _samples;
+  int _frameCount;
+  int _fadeInFrames;
+  int _playFrames;          // -1 == forever.
+  int _fadeOutFrames;
+};
+
+//
+// The state of a voice as seen by the game thread. A voice is busy from the moment the game
+// thread plays it until the game thread drains the event which reports it finished.
+//
+struct VoiceStatus
+{
+  bool _isBusy = false;
+  bool _isPaused = false;
+  bool _isStealPending = false;   // the event of a stolen play has yet to be drained.
+  uint32_t _generation = 0;
+};
+
+static int sampleRate_hz;
+static uint16_t sampleFormat;
+static int numChannels;
+
+//
+// Owned by the audio thread. The sound voices are followed by the TRACK_VOICES voices of the
+// music track, which the game thread never addresses directly.
+//
+static std::vector<Voice> voices;
+static int numSoundVoices;
+
+//
+// The indices of all active voices such that mixing need not visit idle voices. Owned by the
+// audio thread.
+//
+static std::vector<int> activeVoices;
+
+//
+// Owned by the game thread.
+//
+static std::vector<VoiceStatus> voiceStatus;
+
+static SPSCQueue<Command> commandQueue;
+static SPSCQueue<Event> eventQueue;
+
+static int stealFadeFrames;
+
+//
+// The music track; owned by the audio thread except trackFading which is published for the
+// game thread. trackVoice is the voice of the current node (or -1) and the node queue holds
+// nodes waiting to start, oldest first.
+//
+static std::array<TrackNode, MAX_QUEUED_TRACK_NODES> trackNodeQueue;
+static int trackNodeCount {0};
+static int trackVoice {-1};
+static int trackFadeOutFrames {0};
+static int64_t framesUntilTrackTransition {-1};   // -1 == never.
+static bool isTrackPaused {false};
+static float trackGain {1.f};
+static std::atomic<int> trackFading {TRACK_NOT_FADING};
+
+//
+// The effect chains; owned by the audio thread. The effects themselves are owned by the game
+// thread, indexed by id; an effect's slot is only reused once the audio thread has removed it
+// from its chain.
+//
+static constexpr int MAX_EFFECTS {MAX_EFFECTS_PER_BUS * BUS_COUNT};
+
+static std::array<std::array<Effect*, MAX_EFFECTS_PER_BUS>, BUS_COUNT> effectChains;
+static std::array<int, BUS_COUNT> effectChainLengths;
+static std::array<std::unique_ptr<Effect>, MAX_EFFECTS> effects;
+static std::array<bool, MAX_EFFECTS> isEffectRemoved;
+
+//
+// Scratch buffers of the audio thread; the music bus and the dry and planar copies of a block
+// made by effects.
+//
+static std::vector<float> musicBusBuffer;
+static std::vector<float> effectDryBuffer;
+static std::array<std::vector<float>, 2> effectPlanarBuffers;
+
+static std::vector<float> mixBuffer;
+static dsp::Limiter limiter {LIMITER_THRESHOLD, LIMITER_RELEASE_MS, 44100};
+
+//
+// Callback timing; the clock state is owned by the audio thread and the stats are published
+// through atomics for the game thread to read.
+//
+using Clock_t = std::chrono::steady_clock;
+
+static Clock_t::time_point callbackClockStart;
+static int64_t callbackFramesProduced {0};
+static float averageCallbackDuration_ms {0.f};
+static float maxCallbackDuration_ms {0.f};
+static float callbackEffectsDuration_ms {0.f};
+static float averageEffectsDuration_ms {0.f};
+
+static std::atomic<int64_t> callbackCount {0};
+static std::atomic<int64_t> underrunCount {0};
+static std::atomic<int> framesPerCallback {0};
+static std::atomic<float> publishedAverageDuration_ms {0.f};
+static std::atomic<float> publishedMaxDuration_ms {0.f};
+static std::atomic<float> publishedEffectsDuration_ms {0.f};
+
+//
+// The weight of each new duration in the running average.
+//
+static constexpr float CALLBACK_AVERAGE_WEIGHT {0.05f};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+// MIXING
+/////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int msToFrames(int duration_ms)
+{
+  return static_cast<int>((static_cast<int64_t>(duration_ms) * sampleRate_hz) / 1000);
+}
+
+//
+// Balance pan law; unity gain at center so panning never alters the level of a centered voice.
+//
+static void calculateTargetGains(const Voice& voice, float fade, float* gains)
+{
+  float gain = voice._gain * fade;
+  if(numChannels == 1){
+    gains[0] = gain;
+    return;
+  }
+  gains[0] = gain * std::min(1.f, 1.f - voice._pan);
+  gains[1] = gain * std::min(1.f, 1.f + voice._pan);
+}
+
+static bool isTrackVoice(int voice)
+{
+  return voice >= numSoundVoices;
+}
+
+static void pushEvent(const Event& event)
+{
+  //
+  // The event queue has room for two events from every voice; a voice cannot be played again
+  // until the event of its current play is drained, nor stolen again until the event of its
+  // stolen play is drained. The track reports two events for each node and has at most
+  // MAX_QUEUED_TRACK_NODES + TRACK_VOICES nodes unfinished. So this cannot fail.
+  //
+  bool pushed = eventQueue.push(event);
+  assert(pushed);
+  static_cast<void>(pushed);
+}
+
+//
+// The generation of a track voice is the id of the node it plays.
+//
+static void pushFinishedEvent(const Voice& voice, uint32_t generation)
+{
+  int index = static_cast<int>(&voice - voices.data());
+  if(isTrackVoice(index)){
+    pushEvent(Event{Event::TRACK_NODE_FINISHED, NULL_VOICE, generation});
+    return;
+  }
+  pushEvent(Event{Event::VOICE_FINISHED, index, generation});
+}
+
+static void deactivate(Voice& voice)
+{
+  voice._isActive = false;
+  voice._isPaused = false;
+  voice._samples = nullptr;
+  pushFinishedEvent(voice, voice._generation);
+}
+
+static void releaseTail(Voice& voice)
+{
+  voice._tail._samples = nullptr;
+  pushFinishedEvent(voice, voice._tail._generation);
+}
+
+static void mixTail(Voice& voice, float* dst, int frameCount)
+{
+  Voice::Tail& tail = voice._tail;
+  int n = std::min({frameCount, stealFadeFrames, tail._frameCount - tail._position});
+  if(n > 0){
+    const int16_t* src = tail._samples + (tail._position * numChannels);
+    if(numChannels == 1)
+      dsp::mixS16Mono(src, dst, n, tail._gain[0], -tail._gain[0] / n);
+    else
+      dsp::mixS16Stereo(src, dst, n, tail._gain[0], tail._gain[1], -tail._gain[0] / n, -tail._gain[1] / n);
+  }
+  releaseTail(voice);
+}
+
+static void mixVoice(Voice& voice, float* dst, int frameCount)
+{
+  int mixed {0};
+  while(mixed < frameCount && voice._isActive){
+    int n = std::min(frameCount - mixed, voice._frameCount - voice._position);
+    if(voice._framesUntilStop >= 0)
+      n = static_cast<int>(std::min(int64_t{n}, voice._framesUntilStop));
+    if(n <= 0){
+      deactivate(voice);
+      break;
+    }
+
+    float fade = std::clamp(voice._fade + (voice._fadeStep * n), 0.f, 1.f);
+    float target[2];
+    calculateTargetGains(voice, fade, target);
+
+    const int16_t* src = voice._samples + (voice._position * numChannels);
+    float* out = dst + (mixed * numChannels);
+    if(numChannels == 1){
+      float step = (target[0] - voice._rampGain[0]) / n;
+      dsp::mixS16Mono(src, out, n, voice._rampGain[0], step);
+    }
+    else{
+      float stepLeft = (target[0] - voice._rampGain[0]) / n;
+      float stepRight = (target[1] - voice._rampGain[1]) / n;
+      dsp::mixS16Stereo(src, out, n, voice._rampGain[0], voice._rampGain[1], stepLeft, stepRight);
+    }
+    voice._rampGain[0] = target[0];
+    voice._rampGain[1] = target[1];
+    voice._fade = fade;
+
+    voice._position += n;
+    mixed += n;
+    if(voice._framesUntilStop > 0)
+      voice._framesUntilStop -= n;
+
+    if(voice._fadeStep > 0.f && voice._fade >= 1.f)
+      voice._fadeStep = 0.f;     // faded in; plays on at full gain.
+
+    if(voice._fadeStep < 0.f && voice._fade <= 0.f){
+      deactivate(voice);
+    }
+    else if(voice._framesUntilStop == 0){
+      deactivate(voice);
+    }
+    else if(voice._position == voice._frameCount){
+      if(voice._loopsRemaining == 0){
+        deactivate(voice);
+      }
+      else{
+        voice._position = 0;
+        if(voice._loopsRemaining > 0)
+          --voice._loopsRemaining;
+      }
+    }
+  }
+}
+
+//
+// Sound voices are mixed into dst (the master bus) and the track's voices into music.
+//
+static void mixVoices(float* dst, float* music, int frameCount)
+{
+  for(size_t i = 0; i < activeVoices.size();){
+    Voice& voice = voices[activeVoices[i]];
+    float* bus = isTrackVoice(activeVoices[i]) ? music : dst;
+    if(voice._tail._samples != nullptr)
+      mixTail(voice, bus, frameCount);
+    if(voice._isActive && !voice._isPaused)
+      mixVoice(voice, bus, frameCount);
+    if(!voice._isActive && voice._tail._samples == nullptr){
+      activeVoices[i] = activeVoices.back();
+      activeVoices.pop_back();
+    }
+    else{
+      ++i;
+    }
+  }
+}
+
+//
+// Applies an operation to a single voice or to all voices.
+//
+template<typename Op>
+static void forVoices(int voice, Op op)
+{
+  if(voice == ALL_VOICES){
+    for(int v = 0; v < numSoundVoices; ++v)
+      op(voices[v]);
+    return;
+  }
+  assert(0 <= voice && voice < numSoundVoices);
+  op(voices[voice]);
+}
+
+static void startVoice(const Command& command)
+{
+  Voice& voice = voices[command._voice];
+  bool isListed = voice._isActive || voice._tail._samples != nullptr;
+
+  //
+  // Playing on an active voice steals it; what it was playing becomes the tail.
+  //
+  if(voice._isActive){
+    if(voice._tail._samples != nullptr)
+      releaseTail(voice);
+    voice._tail._samples = voice._isPaused ? nullptr : voice._samples;
+    voice._tail._frameCount = voice._frameCount;
+    voice._tail._position = voice._position;
+    voice._tail._gain[0] = voice._rampGain[0];
+    voice._tail._gain[1] = voice._rampGain[1];
+    voice._tail._generation = voice._generation;
+    if(voice._tail._samples == nullptr)
+      pushFinishedEvent(voice, voice._generation);
+  }
+
+  voice._generation = command._generation;
+  voice._samples = command._samples;
+  voice._frameCount = command._frameCount;
+  voice._position = 0;
+  voice._loopsRemaining = command._loops;
+  voice._framesUntilStop = command._durationFrames;
+  if(command._fadeFrames > 0){
+    voice._fade = 0.f;
+    voice._fadeStep = 1.f / command._fadeFrames;
+  }
+  else{
+    voice._fade = 1.f;
+    voice._fadeStep = 0.f;
+  }
+
+  //
+  // Start the ramp at the gains of the first block so the voice starts at the right level.
+  //
+  calculateTargetGains(voice, voice._fade, voice._rampGain);
+  voice._isPaused = false;
+  voice._isActive = true;
+  if(!isListed)
+    activeVoices.push_back(command._voice);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+// EFFECTS
+/////////////////////////////////////////////////////////////////////////////////////////////////
+
+static constexpr std::array<float, PARAM_COUNT> DEFAULT_EFFECT_PARAMETERS {
+  1.f,                        // PARAM_MIX
+  1.f,                        // PARAM_GAIN
+  1000.f,                     // PARAM_CUTOFF_HZ
+  dsp::Biquad::DEFAULT_Q,     // PARAM_Q
+  1.5f,                       // PARAM_DECAY_S
+  -12.f,                      // PARAM_THRESHOLD_DB
+  4.f,                        // PARAM_RATIO
+  5.f,                        // PARAM_ATTACK_MS
+  100.f,                      // PARAM_RELEASE_MS
+  0.f,                        // PARAM_MAKEUP_DB
+  20.f                        // PARAM_GLIDE_MS
+};
+
+//
+// Cutoffs are kept within this range so the filters remain stable at any sampling rate.
+//
+static constexpr float MIN_CUTOFF_HZ {20.f};
+static constexpr float MAX_CUTOFF_FRACTION {0.45f};   // of the sampling rate.
+
+static float clampCutoff(float cutoff_hz)
+{
+  return std::clamp(cutoff_hz, MIN_CUTOFF_HZ, sampleRate_hz * MAX_CUTOFF_FRACTION);
+}
+
+static void configureGlides(Effect& effect)
+{
+  float glide_ms = std::max(0.f, effect._parameters[PARAM_GLIDE_MS]);
+  effect._mix.configure(glide_ms, sampleRate_hz);
+  effect._gain.configure(glide_ms, sampleRate_hz);
+  effect._cutoff.configure(glide_ms, sampleRate_hz);
+}
+
+static void configureFilters(Effect& effect, float cutoff_hz)
+{
+  dsp::Biquad::Type type {dsp::Biquad::LOWPASS};
+  if(effect._type == EFFECT_HIGHPASS) type = dsp::Biquad::HIGHPASS;
+  else if(effect._type == EFFECT_BANDPASS) type = dsp::Biquad::BANDPASS;
+
+  float q = std::max(0.1f, effect._parameters[PARAM_Q]);
+  for(int c = 0; c < 2; ++c){
+    if(effect._type == EFFECT_SMOOTH)
+      effect._smoothers[c].configure(static_cast<float>(1000.0 / (2.0 * M_PI * cutoff_hz)), sampleRate_hz);
+    else
+      effect._biquads[c].configure(type, cutoff_hz, q, sampleRate_hz);
+  }
+  effect._configuredCutoff_hz = cutoff_hz;
+  effect._configuredQ = q;
+}
+
+static void configureCompressor(Effect& effect)
+{
+  const auto& p = effect._parameters;
+  effect._compressor->configure(p[PARAM_THRESHOLD_DB], std::max(1.f, p[PARAM_RATIO]),
+                                std::max(0.f, p[PARAM_ATTACK_MS]), std::max(0.f, p[PARAM_RELEASE_MS]),
+                                p[PARAM_MAKEUP_DB]);
+}
+
+//
+// Creates an effect with the default parameters; game thread only as it allocates.
+//
+static std::unique_ptr<Effect> createEffect(EffectID_t id, Bus bus, EffectType type)
+{
+  auto effect = std::make_unique<Effect>();
+  effect->_id = id;
+  effect->_bus = bus;
+  effect->_type = type;
+  effect->_parameters = DEFAULT_EFFECT_PARAMETERS;
+  configureGlides(*effect);
+  effect->_mix.reset(effect->_parameters[PARAM_MIX]);
+  effect->_gain.reset(effect->_parameters[PARAM_GAIN]);
+  float cutoff_hz = clampCutoff(effect->_parameters[PARAM_CUTOFF_HZ]);
+  effect->_cutoff.reset(std::log2(cutoff_hz));
+  configureFilters(*effect, cutoff_hz);
+  if(type == EFFECT_REVERB){
+    effect->_reverb = std::make_unique<dsp::SchroederReverb>(sampleRate_hz);
+    effect->_reverb->setDecay(effect->_parameters[PARAM_DECAY_S]);
+  }
+  if(type == EFFECT_COMPRESSOR){
+    effect->_compressor = std::make_unique<dsp::Compressor>(sampleRate_hz);
+    configureCompressor(*effect);
+  }
+  effect->_isIdle = false;
+  effect->_isStarted = false;
+  return effect;
+}
+
+static void applyEffectParameter(Effect& effect, EffectParameter parameter, float value)
+{
+  effect._parameters[parameter] = value;
+  switch(parameter){
+    case PARAM_GLIDE_MS: {
+      configureGlides(effect);
+      break;
+    }
+    case PARAM_DECAY_S: {
+      if(effect._reverb)
+        effect._reverb->setDecay(std::max(0.f, value));
+      break;
+    }
+    case PARAM_THRESHOLD_DB:
+    case PARAM_RATIO:
+    case PARAM_ATTACK_MS:
+    case PARAM_RELEASE_MS:
+    case PARAM_MAKEUP_DB: {
+      if(effect._compressor)
+        configureCompressor(effect);
+      break;
+    }
+    default:
+      break;   // the gliding parameters and Q are picked up by the next block.
+  }
+}
+
+//
+// Removes an effect from its chain and hands it back to the game thread to be freed.
+//
+static void detachEffect(Effect* effect)
+{
+  auto& chain = effectChains[effect->_bus];
+  int& length = effectChainLengths[effect->_bus];
+  auto end = chain.begin() + length;
+  auto search = std::find(chain.begin(), end, effect);
+  if(search == end)
+    return;
+  std::copy(search + 1, end, search);
+  --length;
+
+  Event event {};
+  event._type = Event::EFFECT_REMOVED;
+  event._generation = static_cast<uint32_t>(effect->_id);
+  pushEvent(event);
+}
+
+//
+// Glides the cutoff a block and reconfigures the filters if it moved perceptibly; the
+// coefficients are recalculated at most once a block.
+//
+static void updateCutoff(Effect& effect, int frameCount)
+{
+  float target = std::log2(clampCutoff(effect._parameters[PARAM_CUTOFF_HZ]));
+  float cutoff_hz = std::exp2(effect._cutoff.advance(target, frameCount));
+  bool isCutoffMoved = std::fabs(cutoff_hz - effect._configuredCutoff_hz) > effect._configuredCutoff_hz * 0.001f;
+  bool isQChanged = std::max(0.1f, effect._parameters[PARAM_Q]) != effect._configuredQ;
+  if(isCutoffMoved || isQChanged)
+    configureFilters(effect, cutoff_hz);
+}
+
+static void runFilter(Effect& effect, int channel, float* samples, int count)
+{
+  if(effect._type == EFFECT_SMOOTH)
+    effect._smoothers[channel].process(samples, count);
+  else
+    effect._biquads[channel].process(samples, count);
+}
+
+static void resetEffect(Effect& effect)
+{
+  for(int c = 0; c < 2; ++c){
+    effect._biquads[c].reset();
+    effect._smoothers[c].reset(0.f);
+  }
+  if(effect._reverb)
+    effect._reverb->reset();
+}
+
+//
+// Processes an effect which blends its output with its input; the filters and the reverb.
+// Each is processed as planar channels so the kernels run over contiguous samples.
+//
+static void processBlendedEffect(Effect& effect, float* samples, int frameCount)
+{
+  if(effect._type != EFFECT_REVERB)
+    updateCutoff(effect, frameCount);
+
+  float mixFrom = effect._mix.getValue();
+  float mixTo = effect._mix.advance(std::clamp(effect._parameters[PARAM_MIX], 0.f, 1.f), frameCount);
+  if(mixFrom == 0.f && mixTo == 0.f){
+    if(!effect._isIdle)
+      resetEffect(effect);
+    effect._isIdle = true;
+    return;
+  }
+  effect._isIdle = false;
+
+  bool isBlended = !(mixFrom == 1.f && mixTo == 1.f);
+  if(isBlended)
+    std::copy_n(samples, frameCount * numChannels, effectDryBuffer.begin());
+
+  float* left = effectPlanarBuffers[0].data();
+  float* right = effectPlanarBuffers[1].data();
+  if(effect._type == EFFECT_REVERB){
+    const float* input = samples;
+    if(numChannels == 2){
+      dsp::deinterleaveStereo(samples, left, right, frameCount);
+      dsp::downmixStereoToMono(left, right, left, frameCount);
+      input = left;
+    }
+    effect._reverb->process(input, right, frameCount);
+    if(numChannels == 2)
+      dsp::interleaveStereo(right, right, samples, frameCount);
+    else
+      std::copy_n(right, frameCount, samples);
+  }
+  else if(numChannels == 2){
+    dsp::deinterleaveStereo(samples, left, right, frameCount);
+    runFilter(effect, 0, left, frameCount);
+    runFilter(effect, 1, right, frameCount);
+    dsp::interleaveStereo(left, right, samples, frameCount);
+  }
+  else{
+    runFilter(effect, 0, samples, frameCount);
+  }
+
+  if(isBlended)
+    dsp::blendFrames(effectDryBuffer.data(), samples, frameCount, numChannels, mixFrom, (mixTo - mixFrom) / frameCount);
+}
+
+static void processEffect(Effect& effect, float* samples, int frameCount)
+{
+  //
+  // Parameters set before the first block are jumped to, so an effect can be inserted at
+  // (say) a mix of 0 without being heard gliding there.
+  //
+  if(!effect._isStarted){
+    effect._mix.reset(std::clamp(effect._parameters[PARAM_MIX], 0.f, 1.f));
+    effect._gain.reset(std::max(0.f, effect._parameters[PARAM_GAIN]));
+    float cutoff_hz = clampCutoff(effect._parameters[PARAM_CUTOFF_HZ]);
+    effect._cutoff.reset(std::log2(cutoff_hz));
+    configureFilters(effect, cutoff_hz);
+    effect._isStarted = true;
+  }
+
+  switch(effect._type){
+    case EFFECT_GAIN: {
+      float from = effect._gain.getValue();
+      float to = effect._gain.advance(std::max(0.f, effect._parameters[PARAM_GAIN]), frameCount);
+      if(from != 1.f || to != 1.f)
+        dsp::scaleFrames(samples, frameCount, numChannels, from, (to - from) / frameCount);
+      break;
+    }
+    case EFFECT_COMPRESSOR: {
+      effect._compressor->process(samples, frameCount, numChannels);
+      break;
+    }
+    default: {
+      processBlendedEffect(effect, samples, frameCount);
+      break;
+    }
+  }
+}
+
+static void processEffectChain(Bus bus, float* samples, int frameCount)
+{
+  int length = effectChainLengths[bus];
+  if(length == 0)
+    return;
+  Clock_t::time_point start = Clock_t::now();
+  for(int i = 0; i < length; ++i)
+    processEffect(*effectChains[bus][i], samples, frameCount);
+  std::chrono::duration<float, std::milli> duration = Clock_t::now() - start;
+  callbackEffectsDuration_ms += duration.count();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+// MUSIC TRACK
+/////////////////////////////////////////////////////////////////////////////////////////////////
+
+//
+// Fades a voice out to stop exactly fadeFrames from now; stops it now if fadeFrames is 0.
+//
+static void fadeOutVoice(Voice& voice, int fadeFrames)
+{
+  if(!voice._isActive)
+    return;
+  if(fadeFrames <= 0){
+    deactivate(voice);
+    return;
+  }
+  voice._fadeStep = -std::max(voice._fade, 0.f) / fadeFrames;
+  voice._framesUntilStop = fadeFrames;
+}
+
+static void startTrackNode(int voice, const TrackNode& node)
+{
+  Command command {};
+  command._voice = voice;
+  command._generation = node._id;
+  command._samples = node._samples;
+  command._frameCount = node._frameCount;
+  command._loops = INFINITE_LOOPS;
+  command._fadeFrames = node._fadeInFrames;
+  command._durationFrames = -1;
+  voices[voice]._gain = trackGain;
+  startVoice(command);
+  voices[voice]._isPaused = isTrackPaused;
+}
+
+//
+// Called at the frame the current node begins to fade out (or immediately if the track is
+// idle). The next node starts on the other track voice at this exact frame, so the fade out
+// of the current node and the fade in of the next overlap (a crossfade), or with no fades
+// the nodes join without a gap. With no next node the current node fades out and the track
+// becomes idle.
+//
+static void transitionTrack()
+{
+  if(trackVoice != -1)
+    fadeOutVoice(voices[trackVoice], trackFadeOutFrames);
+
+  if(trackNodeCount == 0){
+    trackVoice = -1;
+    framesUntilTrackTransition = -1;
+    return;
+  }
+
+  TrackNode node = trackNodeQueue[0];
+  std::move(trackNodeQueue.begin() + 1, trackNodeQueue.begin() + trackNodeCount, trackNodeQueue.begin());
+  --trackNodeCount;
+
+  int voice = (trackVoice == numSoundVoices) ? numSoundVoices + 1 : numSoundVoices;
+  startTrackNode(voice, node);
+  trackVoice = voice;
+  trackFadeOutFrames = node._fadeOutFrames;
+  if(node._playFrames < 0)
+    framesUntilTrackTransition = -1;
+  else
+    framesUntilTrackTransition = std::max(1, node._playFrames - node._fadeOutFrames);
+  pushEvent(Event{Event::TRACK_NODE_STARTED, NULL_VOICE, node._id});
+}
+
+static void enqueueTrackNode(const Command& command)
+{
+  TrackNode node {};
+  node._id = command._generation;
+  node._samples = command._samples;
+  node._frameCount = command._frameCount;
+  node._fadeInFrames = command._fadeFrames;
+  node._playFrames = command._durationFrames;
+  node._fadeOutFrames = command._fadeOutFrames;
+  if(trackNodeCount == MAX_QUEUED_TRACK_NODES){
+    pushEvent(Event{Event::TRACK_NODE_FINISHED, NULL_VOICE, node._id});
+    return;
+  }
+  trackNodeQueue[trackNodeCount++] = node;
+
+  //
+  // An idle track starts the node at once; the first node of a sequence starts when it
+  // reaches the audio thread.
+  //
+  if(trackVoice == -1)
+    transitionTrack();
+}
+
+static void haltTrack(int fadeFrames)
+{
+  for(int n = 0; n < trackNodeCount; ++n)
+    pushEvent(Event{Event::TRACK_NODE_FINISHED, NULL_VOICE, trackNodeQueue[n]._id});
+  trackNodeCount = 0;
+  for(int v = numSoundVoices; v < numSoundVoices + TRACK_VOICES; ++v){
+    if(voices[v]._isPaused)
+      fadeOutVoice(voices[v], 0);
+    else
+      fadeOutVoice(voices[v], (v == trackVoice) ? fadeFrames : std::min(fadeFrames, static_cast<int>(voices[v]._framesUntilStop)));
+  }
+  trackVoice = -1;
+  framesUntilTrackTransition = -1;
+  isTrackPaused = false;
+}
+
+static void setTrackPaused(bool isPaused)
+{
+  isTrackPaused = isPaused;
+  for(int v = numSoundVoices; v < numSoundVoices + TRACK_VOICES; ++v)
+    if(voices[v]._isActive)
+      voices[v]._isPaused = isPaused;
+}
+
+static void publishTrackFading()
+{
+  int fading {TRACK_NOT_FADING};
+  if(trackVoice != -1 && voices[trackVoice]._isActive){
+    const Voice& voice = voices[trackVoice];
+    if(voice._fadeStep > 0.f)
+      fading = TRACK_FADING_IN;
+    else if(voice._fadeStep < 0.f)
+      fading = TRACK_FADING_OUT;
+  }
+  else{
+    for(int v = numSoundVoices; v < numSoundVoices + TRACK_VOICES; ++v)
+      if(voices[v]._isActive && voices[v]._fadeStep < 0.f)
+        fading = TRACK_FADING_OUT;
+  }
+  trackFading.store(fading, std::memory_order_relaxed);
+}
+
+static void applyCommands()
+{
+  Command command;
+  while(commandQueue.pop(command)){
+    switch(command._type){
+      case Command::PLAY: {
+        startVoice(command);
+        break;
+      }
+      case Command::STOP: {
+        forVoices(command._voice, [](Voice& v){
+          if(v._isActive) deactivate(v);
+        });
+        break;
+      }
+      case Command::STOP_TIMED: {
+        int64_t frames = command._durationFrames;
+        forVoices(command._voice, [frames](Voice& v){
+          if(v._isActive) v._framesUntilStop = frames;
+        });
+        break;
+      }
+      case Command::STOP_FADE_OUT: {
+        float fadeStep = -1.f / std::max(1, command._fadeFrames);
+        forVoices(command._voice, [fadeStep](Voice& v){
+          if(v._isActive) v._fadeStep = fadeStep * std::max(v._fade, 0.f);
+        });
+        break;
+      }
+      case Command::PAUSE: {
+        forVoices(command._voice, [](Voice& v){
+          if(v._isActive) v._isPaused = true;
+        });
+        break;
+      }
+      case Command::RESUME: {
+        forVoices(command._voice, [](Voice& v){
+          v._isPaused = false;
+        });
+        break;
+      }
+      case Command::SET_GAIN: {
+        float gain = command._value;
+        forVoices(command._voice, [gain](Voice& v){
+          v._gain = gain;
+        });
+        break;
+      }
+      case Command::SET_PAN: {
+        float pan = command._value;
+        forVoices(command._voice, [pan](Voice& v){
+          v._pan = pan;
+        });
+        break;
+      }
+      case Command::QUEUE_TRACK_NODE: {
+        enqueueTrackNode(command);
+        break;
+      }
+      case Command::STOP_TRACK: {
+        haltTrack(command._fadeFrames);
+        break;
+      }
+      case Command::PAUSE_TRACK: {
+        setTrackPaused(true);
+        break;
+      }
+      case Command::RESUME_TRACK: {
+        setTrackPaused(false);
+        break;
+      }
+      case Command::SET_TRACK_GAIN: {
+        trackGain = command._value;
+        for(int v = numSoundVoices; v < numSoundVoices + TRACK_VOICES; ++v)
+          voices[v]._gain = trackGain;
+        break;
+      }
+      case Command::INSERT_EFFECT: {
+        Bus bus = command._effect->_bus;
+        assert(effectChainLengths[bus] < MAX_EFFECTS_PER_BUS);
+        effectChains[bus][effectChainLengths[bus]++] = command._effect;
+        break;
+      }
+      case Command::REMOVE_EFFECT: {
+        detachEffect(command._effect);
+        break;
+      }
+      case Command::SET_EFFECT_PARAMETER: {
+        applyEffectParameter(*command._effect, static_cast<EffectParameter>(command._parameter), command._value);
+        break;
+      }
+    }
+  }
+}
+
+//
+// Blocks are split at track transitions so nodes start and fade out at exact frames. The
+// track's timeline only advances whilst it is not paused.
+//
+void mix(float* dst, int frameCount)
+{
+  applyCommands();
+  int f {0};
+  while(f < frameCount){
+    int n = std::min(MIX_BLOCK_FRAMES, frameCount - f);
+    bool isTrackTiming = !isTrackPaused && framesUntilTrackTransition >= 0;
+    if(isTrackTiming)
+      n = static_cast<int>(std::min(int64_t{n}, framesUntilTrackTransition));
+    float* block = dst + (f * numChannels);
+    std::fill_n(musicBusBuffer.begin(), n * numChannels, 0.f);
+    mixVoices(block, musicBusBuffer.data(), n);
+    processEffectChain(BUS_MUSIC, musicBusBuffer.data(), n);
+    dsp::addSamples(musicBusBuffer.data(), block, n * numChannels);
+    processEffectChain(BUS_MASTER, block, n);
+    f += n;
+    if(isTrackTiming){
+      framesUntilTrackTransition -= n;
+      if(framesUntilTrackTransition == 0)
+        transitionTrack();
+    }
+  }
+  limiter.process(dst, frameCount, numChannels);
+  publishTrackFading();
+}
+
+//
+// Conversions between the output sample format and the float mix buffer.
+//
+static void convertStreamToFloat(const uint8_t* stream, float* dst, int count)
+{
+  switch(sampleFormat){
+    case AUDIO_U8: {
+      for(int i = 0; i < count; ++i)
+        dst[i] = (static_cast<int>(stream[i]) - 128) / 128.f;
+      break;
+    }
+    case AUDIO_S8: {
+      const int8_t* src = reinterpret_cast<const int8_t*>(stream);
+      for(int i = 0; i < count; ++i)
+        dst[i] = src[i] / 128.f;
+      break;
+    }
+    case AUDIO_U16LSB: {
+      const uint16_t* src = reinterpret_cast<const uint16_t*>(stream);
+      for(int i = 0; i < count; ++i)
+        dst[i] = (static_cast<int>(src[i]) - 32768) / 32768.f;
+      break;
+    }
+    case AUDIO_S16LSB: {
+      dsp::convertS16ToFloat(reinterpret_cast<const int16_t*>(stream), dst, count);
+      break;
+    }
+    case AUDIO_S32LSB: {
+      const int32_t* src = reinterpret_cast<const int32_t*>(stream);
+      for(int i = 0; i < count; ++i)
+        dst[i] = src[i] / 2147483648.f;
+      break;
+    }
+    default: assert(0);
+  }
+}
+
+static void convertFloatToStream(const float* src, uint8_t* stream, int count)
+{
+  switch(sampleFormat){
+    case AUDIO_U8: {
+      for(int i = 0; i < count; ++i)
+        stream[i] = static_cast<uint8_t>(std::clamp(src[i] * 127.f, -128.f, 127.f) + 128.f);
+      break;
+    }
+    case AUDIO_S8: {
+      int8_t* dst = reinterpret_cast<int8_t*>(stream);
+      for(int i = 0; i < count; ++i)
+        dst[i] = static_cast<int8_t>(std::clamp(src[i] * 127.f, -128.f, 127.f));
+      break;
+    }
+    case AUDIO_U16LSB: {
+      uint16_t* dst = reinterpret_cast<uint16_t*>(stream);
+      for(int i = 0; i < count; ++i)
+        dst[i] = static_cast<uint16_t>(std::clamp(src[i] * 32767.f, -32768.f, 32767.f) + 32768.f);
+      break;
+    }
+    case AUDIO_S16LSB: {
+      dsp::convertFloatToS16(src, reinterpret_cast<int16_t*>(stream), count);
+      break;
+    }
+    case AUDIO_S32LSB: {
+      int32_t* dst = reinterpret_cast<int32_t*>(stream);
+      for(int i = 0; i < count; ++i)
+        dst[i] = static_cast<int32_t>(std::clamp(src[i] * 2147483520.f, -2147483648.f, 2147483520.f));
+      break;
+    }
+    default: assert(0);
+  }
+}
+
+//
+// The device consumes frames at the sampling rate from the first callback on; the callback
+// must keep the frames it has produced ahead of that. When it falls behind the device has
+// run dry, after which the clock is restarted so a single stall counts as a single underrun.
+//
+// The clock is also restarted every few seconds since the device's clock drifts against the
+// system clock.
+//
+static constexpr int CALLBACK_CLOCK_RESTART_S {10};
+
+static void onCallbackStart(Clock_t::time_point now, int frameCount)
+{
+  if(callbackFramesProduced == 0 || callbackFramesProduced >= CALLBACK_CLOCK_RESTART_S * sampleRate_hz){
+    callbackFramesProduced = 0;
+    callbackClockStart = now;
+  }
+  else{
+    double elapsed_s = std::chrono::duration<double>(now - callbackClockStart).count();
+    double produced_s = static_cast<double>(callbackFramesProduced) / sampleRate_hz;
+    double tolerance_s = (UNDERRUN_TOLERANCE * frameCount) / sampleRate_hz;
+    if(elapsed_s - produced_s > tolerance_s){
+      underrunCount.fetch_add(1, std::memory_order_relaxed);
+      callbackClockStart = now;
+      callbackFramesProduced = 0;
+    }
+  }
+  callbackFramesProduced += frameCount;
+  callbackEffectsDuration_ms = 0.f;
+  callbackCount.fetch_add(1, std::memory_order_relaxed);
+  framesPerCallback.store(frameCount, std::memory_order_relaxed);
+}
+
+static void onCallbackEnd(Clock_t::time_point start, Clock_t::time_point end)
+{
+  float duration_ms = std::chrono::duration<float, std::milli>(end - start).count();
+  averageCallbackDuration_ms += (duration_ms - averageCallbackDuration_ms) * CALLBACK_AVERAGE_WEIGHT;
+  maxCallbackDuration_ms = std::max(maxCallbackDuration_ms, duration_ms);
+  averageEffectsDuration_ms += (callbackEffectsDuration_ms - averageEffectsDuration_ms) * CALLBACK_AVERAGE_WEIGHT;
+  publishedAverageDuration_ms.store(averageCallbackDuration_ms, std::memory_order_relaxed);
+  publishedEffectsDuration_ms.store(averageEffectsDuration_ms, std::memory_order_relaxed);
+  publishedMaxDuration_ms.store(maxCallbackDuration_ms, std::memory_order_relaxed);
+}
+
+void onPostMix(void* userdata, uint8_t* stream, int bytes)
+{
+  PXR_PROFILE_THREAD_NAME("audio");
+  PXR_PROFILE_ZONE("mixer::onPostMix");
+  Clock_t::time_point start = Clock_t::now();
+  int frameBytes = SDL_AUDIO_BITSIZE(sampleFormat) / 8 * numChannels;
+  int frameCount = bytes / frameBytes;
+  onCallbackStart(start, frameCount);
+  for(int f = 0; f < frameCount; f += MIX_BLOCK_FRAMES){
+    int n = std::min(MIX_BLOCK_FRAMES, frameCount - f);
+    uint8_t* block = stream + (f * frameBytes);
+    convertStreamToFloat(block, mixBuffer.data(), n * numChannels);
+    mix(mixBuffer.data(), n);
+    convertFloatToStream(mixBuffer.data(), block, n * numChannels);
+  }
+  onCallbackEnd(start, Clock_t::now());
+}
+
+CallbackStats getCallbackStats()
+{
+  CallbackStats stats {};
+  stats._callbacks = callbackCount.load(std::memory_order_relaxed);
+  stats._underruns = underrunCount.load(std::memory_order_relaxed);
+  stats._framesPerCallback = framesPerCallback.load(std::memory_order_relaxed);
+  stats._averageDuration_ms = publishedAverageDuration_ms.load(std::memory_order_relaxed);
+  stats._maxDuration_ms = publishedMaxDuration_ms.load(std::memory_order_relaxed);
+  stats._averageEffectsDuration_ms = publishedEffectsDuration_ms.load(std::memory_order_relaxed);
+  return stats;
+}
+
+void restartCallbackClock()
+{
+  callbackFramesProduced = 0;
+  maxCallbackDuration_ms = 0.f;
+  publishedMaxDuration_ms.store(0.f, std::memory_order_relaxed);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+// VOICE CONTROL
+/////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void pushCommand(const Command& command)
+{
+  if(!commandQueue.push(command))
+    log::log(log::WARN, log::msg_mixer_command_queue_full, std::to_string(command._type));
+}
+
+bool initialize(int outputRate_hz, uint16_t outputFormat, int outputChannels, int numVoices)
+{
+  assert(!SDL_AUDIO_ISFLOAT(outputFormat));
+  assert(numVoices > 0);
+  if(outputChannels != 1 && outputChannels != 2){
+    log::log(log::ERROR, log::msg_mixer_unsupported_channels, std::to_string(outputChannels));
+    return false;
+  }
+  sampleRate_hz = outputRate_hz;
+  sampleFormat = outputFormat;
+  numChannels = outputChannels;
+  voices.clear();
+  voices.resize(numVoices + TRACK_VOICES);
+  voices.shrink_to_fit();
+  numSoundVoices = numVoices;
+  trackNodeCount = 0;
+  trackVoice = -1;
+  framesUntilTrackTransition = -1;
+  isTrackPaused = false;
+  trackGain = 1.f;
+  trackFading.store(TRACK_NOT_FADING, std::memory_order_relaxed);
+  activeVoices.clear();
+  activeVoices.reserve(numVoices + TRACK_VOICES);
+  voiceStatus.clear();
+  voiceStatus.resize(numVoices);
+  voiceStatus.shrink_to_fit();
+  commandQueue.reset(COMMAND_QUEUE_CAPACITY);
+  eventQueue.reset((numVoices * 2) + ((MAX_QUEUED_TRACK_NODES + TRACK_VOICES) * 2) + MAX_EFFECTS);
+  stealFadeFrames = std::max(1, msToFrames(STEAL_FADE_MS));
+  mixBuffer.resize(MIX_BLOCK_FRAMES * numChannels);
+  musicBusBuffer.resize(MIX_BLOCK_FRAMES * numChannels);
+  effectDryBuffer.resize(MIX_BLOCK_FRAMES * numChannels);
+  for(auto& buffer : effectPlanarBuffers)
+    buffer.resize(MIX_BLOCK_FRAMES);
+  effectChainLengths.fill(0);
+  for(auto& effect : effects)
+    effect.reset();
+  isEffectRemoved.fill(false);
+  limiter = dsp::Limiter{LIMITER_THRESHOLD, LIMITER_RELEASE_MS, sampleRate_hz};
+  log::log(log::INFO, log::msg_mixer_voices, std::to_string(numVoices));
+  return true;
+}
+
+void shutdown()
+{
+  effectChainLengths.fill(0);
+  for(auto& effect : effects)
+    effect.reset();
+  voices.clear();
+  activeVoices.clear();
+  voiceStatus.clear();
+  commandQueue.reset(1);
+  eventQueue.reset(1);
+}
+
+static int startPlay(int voice, const int16_t* samples, int frameCount, int loops, int fadeIn_ms, int playDuration_ms)
+{
+  VoiceStatus& status = voiceStatus[voice];
+  Command command {};
+  command._type = Command::PLAY;
+  command._voice = voice;
+  command._generation = status._generation + 1;
+  command._samples = samples;
+  command._frameCount = frameCount;
+  command._loops = loops;
+  command._fadeFrames = fadeIn_ms > 0 ? std::max(1, msToFrames(fadeIn_ms)) : 0;
+  command._durationFrames = playDuration_ms < 0 ? -1 : msToFrames(playDuration_ms);
+  if(!commandQueue.push(command)){
+    log::log(log::WARN, log::msg_mixer_command_queue_full, std::to_string(command._type));
+    return NULL_VOICE;
+  }
+  if(status._isBusy)
+    status._isStealPending = true;
+  status._generation = command._generation;
+  status._isBusy = true;
+  status._isPaused = false;
+  return voice;
+}
+
+int play(const int16_t* samples, int frameCount, int loops, int fadeIn_ms, int playDuration_ms)
+{
+  assert(samples != nullptr && frameCount > 0);
+  auto search = std::find_if(voiceStatus.begin(), voiceStatus.end(), [](const VoiceStatus& v){return !v._isBusy;});
+  if(search == voiceStatus.end())
+    return NULL_VOICE;
+  int voice = static_cast<int>(search - voiceStatus.begin());
+  return startPlay(voice, samples, frameCount, loops, fadeIn_ms, playDuration_ms);
+}
+
+int steal(int voice, const int16_t* samples, int frameCount, int loops, int fadeIn_ms, int playDuration_ms)
+{
+  assert(samples != nullptr && frameCount > 0);
+  assert(0 <= voice && voice < static_cast<int>(voiceStatus.size()));
+  if(!canSteal(voice))
+    return NULL_VOICE;
+  return startPlay(voice, samples, frameCount, loops, fadeIn_ms, playDuration_ms);
+}
+
+bool canSteal(int voice)
+{
+  assert(0 <= voice && voice < static_cast<int>(voiceStatus.size()));
+  return !voiceStatus[voice]._isStealPending;
+}
+
+uint32_t getGeneration(int voice)
+{
+  assert(0 <= voice && voice < static_cast<int>(voiceStatus.size()));
+  return voiceStatus[voice]._generation;
+}
+
+static void pushVoiceCommand(Command::Type type, int voice, int fadeFrames, int durationFrames, float value)
+{
+  if(voice == NULL_VOICE)
+    return;
+  assert(voice == ALL_VOICES || (0 <= voice && voice < static_cast<int>(voiceStatus.size())));
+  Command command {};
+  command._type = type;
+  command._voice = voice;
+  command._fadeFrames = fadeFrames;
+  command._durationFrames = durationFrames;
+  command._value = value;
+  pushCommand(command);
+}
+
+void stop(int voice)
+{
+  pushVoiceCommand(Command::STOP, voice, 0, -1, 0.f);
+}
+
+void stopTimed(int voice, int durationUntilStop_ms)
+{
+  pushVoiceCommand(Command::STOP_TIMED, voice, 0, msToFrames(durationUntilStop_ms), 0.f);
+}
+
+void stopFadeOut(int voice, int fadeDuration_ms)
+{
+  pushVoiceCommand(Command::STOP_FADE_OUT, voice, msToFrames(fadeDuration_ms), -1, 0.f);
+}
+
+void pause(int voice)
+{
+  pushVoiceCommand(Command::PAUSE, voice, 0, -1, 0.f);
+  if(voice == ALL_VOICES){
+    for(auto& status : voiceStatus)
+      status._isPaused = status._isBusy;
+  }
+  else if(voice != NULL_VOICE && voiceStatus[voice]._isBusy){
+    voiceStatus[voice]._isPaused = true;
+  }
+}
+
+void resume(int voice)
+{
+  pushVoiceCommand(Command::RESUME, voice, 0, -1, 0.f);
+  if(voice == ALL_VOICES){
+    for(auto& status : voiceStatus)
+      status._isPaused = false;
+  }
+  else if(voice != NULL_VOICE){
+    voiceStatus[voice]._isPaused = false;
+  }
+}
+
+bool isPlaying(int voice)
+{
+  if(voice == NULL_VOICE || voice == ALL_VOICES)
+    return false;
+  assert(0 <= voice && voice < static_cast<int>(voiceStatus.size()));
+  return voiceStatus[voice]._isBusy;
+}
+
+bool isPaused(int voice)
+{
+  if(voice == NULL_VOICE || voice == ALL_VOICES)
+    return false;
+  assert(0 <= voice && voice < static_cast<int>(voiceStatus.size()));
+  return voiceStatus[voice]._isBusy && voiceStatus[voice]._isPaused;
+}
+
+void setGain(int voice, float gain)
+{
+  pushVoiceCommand(Command::SET_GAIN, voice, 0, -1, std::clamp(gain, 0.f, 1.f));
+}
+
+void setPan(int voice, float pan)
+{
+  pushVoiceCommand(Command::SET_PAN, voice, 0, -1, std::clamp(pan, PAN_LEFT, PAN_RIGHT));
+}
+
+bool pollEvent(Event& event)
+{
+  if(!eventQueue.pop(event))
+    return false;
+  while(event._type == Event::EFFECT_REMOVED){
+    effects[event._generation].reset();
+    isEffectRemoved[event._generation] = false;
+    if(!eventQueue.pop(event))
+      return false;
+  }
+  if(event._type == Event::VOICE_FINISHED){
+    VoiceStatus& status = voiceStatus[event._voice];
+    if(event._generation == status._generation){
+      status._isBusy = false;
+      status._isPaused = false;
+    }
+    else{
+      status._isStealPending = false;
+    }
+  }
+  return true;
+}
+
+void queueTrackNode(uint32_t id, const int16_t* samples, int frameCount, int fadeIn_ms, int play_ms, int fadeOut_ms)
+{
+  assert(samples != nullptr && frameCount > 0);
+  Command command {};
+  command._type = Command::QUEUE_TRACK_NODE;
+  command._generation = id;
+  command._samples = samples;
+  command._frameCount = frameCount;
+  command._fadeFrames = msToFrames(std::max(0, fadeIn_ms));
+  command._durationFrames = (play_ms == PLAY_FOREVER) ? -1 : msToFrames(std::max(0, play_ms));
+  command._fadeOutFrames = msToFrames(std::max(0, fadeOut_ms));
+  if(command._durationFrames >= 0)
+    command._fadeOutFrames = std::min(command._fadeOutFrames, command._durationFrames);
+  pushCommand(command);
+}
+
+void stopTrack(int fadeOut_ms)
+{
+  Command command {};
+  command._type = Command::STOP_TRACK;
+  command._fadeFrames = msToFrames(std::max(0, fadeOut_ms));
+  pushCommand(command);
+}
+
+void pauseTrack()
+{
+  Command command {};
+  command._type = Command::PAUSE_TRACK;
+  pushCommand(command);
+}
+
+void resumeTrack()
+{
+  Command command {};
+  command._type = Command::RESUME_TRACK;
+  pushCommand(command);
+}
+
+void setTrackGain(float gain)
+{
+  Command command {};
+  command._type = Command::SET_TRACK_GAIN;
+  command._value = std::clamp(gain, 0.f, 1.f);
+  pushCommand(command);
+}
+
+EffectID_t insertEffect(Bus bus, EffectType type)
+{
+  assert(0 <= bus && bus < BUS_COUNT);
+  int chainLength = static_cast<int>(std::count_if(effects.begin(), effects.end(), [bus](const std::unique_ptr<Effect>& e){
+    return e != nullptr && e->_bus == bus;
+  }));
+  if(chainLength >= MAX_EFFECTS_PER_BUS){
+    log::log(log::WARN, log::msg_mixer_effect_chain_full, std::to_string(bus));
+    return NULL_EFFECT;
+  }
+  auto search = std::find(effects.begin(), effects.end(), nullptr);
+  assert(search != effects.end());
+  EffectID_t id = static_cast<EffectID_t>(search - effects.begin());
+  std::unique_ptr<Effect> effect = createEffect(id, bus, type);
+
+  Command command {};
+  command._type = Command::INSERT_EFFECT;
+  command._effect = effect.get();
+  if(!commandQueue.push(command)){
+    log::log(log::WARN, log::msg_mixer_command_queue_full, std::to_string(command._type));
+    return NULL_EFFECT;
+  }
+  *search = std::move(effect);
+  return id;
+}
+
+void removeEffect(EffectID_t effect)
+{
+  if(effect < 0 || effect >= MAX_EFFECTS || effects[effect] == nullptr || isEffectRemoved[effect])
+    return;
+  Command command {};
+  command._type = Command::REMOVE_EFFECT;
+  command._effect = effects[effect].get();
+  if(!commandQueue.push(command)){
+    log::log(log::WARN, log::msg_mixer_command_queue_full, std::to_string(command._type));
+    return;
+  }
+  isEffectRemoved[effect] = true;
+}
+
+void setEffectParameter(EffectID_t effect, EffectParameter parameter, float value)
+{
+  if(effect < 0 || effect >= MAX_EFFECTS || effects[effect] == nullptr || isEffectRemoved[effect])
+    return;
+  assert(0 <= parameter && parameter < PARAM_COUNT);
+  Command command {};
+  command._type = Command::SET_EFFECT_PARAMETER;
+  command._effect = effects[effect].get();
+  command._parameter = parameter;
+  command._value = value;
+  pushCommand(command);
+}
+
+int getTrackFading()
+{
+  return trackFading.load(std::memory_order_relaxed);
+}
+
+int getVoiceCount()
+{
+  return static_cast<int>(voiceStatus.size());
+}
+
+int getActiveVoiceCount()
+{
+  return static_cast<int>(std::count_if(voiceStatus.begin(), voiceStatus.end(), [](const VoiceStatus& v){
+    return v._isBusy;
+  }));
+}
+
+} // namespace mixer
+} // namespace pxr
@@ -24,25 +24,26 @@ void ParticleEngine::update(float dt)
 {
   assert(_particles != nullptr);
 
-  int numUpdates{0}, i{0};
-  while(i < _config._maxParticles && numUpdates < _numParticles){
+  int numAlive {_numParticles};
+  int numVisited {0};
+  for(int i = 0; i < _config._maxParticles && numVisited < numAlive; ++i){
     auto& particle = _particles[i];
 
     if(!particle._isAlive)
       continue;
 
+    ++numVisited;
+
     particle._clock += dt;
     if(particle._clock > particle._lifetime){
       particle._isAlive = false; 
+      --_numParticles;
       continue;
     }
 
     particle._velocity += particle._acceleration * dt;
     particle._velocity *= _config._damping;
     particle._position += particle._velocity * dt; 
-
-    ++numUpdates;
-    ++i;
   }
 }
 
@@ -72,6 +73,7 @@ void ParticleEngine::spawnParticle(Vector2f position, Vector2f velocity, Vector2
     particle._lifetime = rand::uniformReal(_config._loLifetime, _config._hiLifetime);
     particle._clock = 0.f;
     particle._isAlive = true;
+    ++_numParticles;
 
     break;
   }
@@ -0,0 +1,220 @@
+#if defined(PXR_PROFILE)
+
+#include <atomic>
+#include <array>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+#include <cstring>
+#include "../include/pxr_profile.h"
+#include "../include/pxr_log.h"
+
+namespace pxr
+{
+namespace profile
+{
+
+//
+// A zone as recorded; its fields are atomics only so a trace can be written by another thread
+// without tearing them.
+//
+struct ZoneRecord
+{
+  std::atomic<const char*> _name;
+  std::atomic<int64_t> _start_ns;      // since the epoch.
+  std::atomic<int64_t> _duration_ns;
+};
+
+//
+// The zones of one thread. Written only by its thread; the next zone is written at
+// count % RING_SIZE.
+//
+struct ThreadBuffer
+{
+  std::array<ZoneRecord, RING_SIZE> _zones;
+  std::atomic<uint64_t> _count;
+  std::atomic<const char*> _threadName;
+  int _threadId;
+};
+
+//
+// The buffers of all threads which have ever recorded a zone. Buffers outlive their threads so
+// the zones of threads which have ended still make it into the trace. The mutex guards only
+// the vector itself, i.e. registration and the writing of traces, never recording.
+//
+static std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+static std::mutex buffersMutex;
+
+static thread_local ThreadBuffer* threadBuffer {nullptr};
+
+//
+// Buffers made ahead for threads which must never allocate or lock, such as the audio thread;
+// see reserveThread. A slot is free whilst its buffer is null. The reserving thread fills a
+// slot (under the buffers mutex) and the named thread claims it lock free.
+//
+struct Reservation
+{
+  std::atomic<const char*> _threadName;
+  std::atomic<ThreadBuffer*> _buffer;
+};
+
+static std::array<Reservation, MAX_RESERVED_THREADS> reservations;
+
+static const Clock_t::time_point epoch {Clock_t::now()};
+
+//
+// Caller must hold the buffers mutex.
+//
+static ThreadBuffer* registerBuffer(const char* threadName)
+{
+  auto buffer = std::make_unique<ThreadBuffer>();
+  buffer->_count.store(0, std::memory_order_relaxed);
+  buffer->_threadName.store(threadName, std::memory_order_relaxed);
+  buffer->_threadId = static_cast<int>(buffers.size()) + 1;
+  buffers.push_back(std::move(buffer));
+  return buffers.back().get();
+}
+
+static ThreadBuffer* claimReservation(const char* threadName)
+{
+  for(auto& reservation : reservations){
+    ThreadBuffer* buffer = reservation._buffer.load(std::memory_order_acquire);
+    if(buffer == nullptr || std::strcmp(reservation._threadName.load(std::memory_order_relaxed), threadName) != 0)
+      continue;
+    if(reservation._buffer.compare_exchange_strong(buffer, nullptr, std::memory_order_acq_rel))
+      return buffer;
+  }
+  return nullptr;
+}
+
+static ThreadBuffer& getThreadBuffer()
+{
+  if(threadBuffer != nullptr)
+    return *threadBuffer;
+
+  std::lock_guard<std::mutex> lock {buffersMutex};
+  threadBuffer = registerBuffer(nullptr);
+  return *threadBuffer;
+}
+
+void reserveThread(const char* name)
+{
+  std::lock_guard<std::mutex> lock {buffersMutex};
+  for(auto& reservation : reservations){
+    if(reservation._buffer.load(std::memory_order_acquire) != nullptr &&
+       std::strcmp(reservation._threadName.load(std::memory_order_relaxed), name) == 0)
+      return;     // the last reservation is still unclaimed.
+  }
+  for(auto& reservation : reservations){
+    if(reservation._buffer.load(std::memory_order_acquire) != nullptr)
+      continue;
+    reservation._threadName.store(name, std::memory_order_relaxed);
+    reservation._buffer.store(registerBuffer(name), std::memory_order_release);
+    return;
+  }
+  log::log(log::WARN, log::msg_profile_too_many_reservations, name);
+}
+
+void recordZone(const char* name, Clock_t::time_point start, Clock_t::time_point end)
+{
+  ThreadBuffer& buffer = getThreadBuffer();
+  uint64_t count = buffer._count.load(std::memory_order_relaxed);
+  ZoneRecord& zone = buffer._zones[count % RING_SIZE];
+  zone._name.store(name, std::memory_order_relaxed);
+  zone._start_ns.store(std::chrono::duration_cast<std::chrono::nanoseconds>(start - epoch).count(),
+                       std::memory_order_relaxed);
+  zone._duration_ns.store(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count(),
+                          std::memory_order_relaxed);
+  buffer._count.store(count + 1, std::memory_order_release);
+}
+
+void setThreadName(const char* name)
+{
+  if(threadBuffer == nullptr)
+    threadBuffer = claimReservation(name);
+  getThreadBuffer()._threadName.store(name, std::memory_order_relaxed);
+}
+
+//
+// Writes the zones of a buffer as complete ("X") events. The zones are copied before they are
+// written and those its thread may have overwritten during the copy, judged by its count after
+// the copy, are discarded. The zone at the count itself may be half written, so the oldest zone
+// which can be trusted is one past count - RING_SIZE.
+//
+static void writeZones(std::ofstream& os, const ThreadBuffer& buffer, bool& isFirstEvent)
+{
+  struct ZoneCopy
+  {
+    const char* _name;
+    int64_t _start_ns;
+    int64_t _duration_ns;
+  };
+
+  uint64_t countBefore = buffer._count.load(std::memory_order_acquire);
+  uint64_t first = (countBefore > RING_SIZE) ? countBefore - RING_SIZE : 0;
+
+  std::vector<ZoneCopy> zones;
+  zones.reserve(countBefore - first);
+  for(uint64_t i = first; i < countBefore; ++i){
+    const ZoneRecord& zone = buffer._zones[i % RING_SIZE];
+    zones.push_back({zone._name.load(std::memory_order_relaxed),
+                     zone._start_ns.load(std::memory_order_relaxed),
+                     zone._duration_ns.load(std::memory_order_relaxed)});
+  }
+
+  std::atomic_thread_fence(std::memory_order_acquire);
+  uint64_t countAfter = buffer._count.load(std::memory_order_relaxed);
+  uint64_t firstTrusted = (countAfter >= RING_SIZE) ? countAfter - RING_SIZE + 1 : 0;
+  size_t numDiscarded = static_cast<size_t>(std::max(first, firstTrusted) - first);
+
+  for(size_t i = std::min(numDiscarded, zones.size()); i < zones.size(); ++i){
+    const ZoneCopy& zone = zones[i];
+    os << (isFirstEvent ? "\n" : ",\n")
+       << "{\"name\":\"" << zone._name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer._threadId
+       << ",\"ts\":" << (zone._start_ns / 1000.0)
+       << ",\"dur\":" << (zone._duration_ns / 1000.0) << "}";
+    isFirstEvent = false;
+  }
+}
+
+bool writeTrace(const std::string& filepath)
+{
+  std::ofstream os {filepath, std::ios_base::trunc};
+  if(!os){
+    log::log(log::ERROR, log::msg_profile_fail_write, filepath);
+    return false;
+  }
+
+  os << std::fixed << std::setprecision(3);
+  os << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+  bool isFirstEvent {true};
+  {
+    std::lock_guard<std::mutex> lock {buffersMutex};
+    for(const auto& buffer : buffers){
+      if(buffer->_count.load(std::memory_order_acquire) == 0)
+        continue;     // e.g. a reservation never claimed.
+      const char* threadName = buffer->_threadName.load(std::memory_order_relaxed);
+      if(threadName != nullptr){
+        os << (isFirstEvent ? "\n" : ",\n")
+           << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->_threadId
+           << ",\"args\":{\"name\":\"" << threadName << "\"}}";
+        isFirstEvent = false;
+      }
+      writeZones(os, *buffer, isFirstEvent);
+    }
+  }
+
+  os << "\n]}\n";
+
+  log::log(log::INFO, log::msg_profile_trace_written, filepath);
+  return true;
+}
+
+} // namespace profile
+} // namespace pxr
+
+#endif
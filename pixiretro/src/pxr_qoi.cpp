@@ -0,0 +1,264 @@
+#include <fstream>
+#include <vector>
+#include <cstring>
+#include <sstream>
+#include "../include/pxr_qoi.h"
+#include "../include/pxr_log.h"
+#include "../include/pxr_profile.h"
+
+namespace pxr
+{
+namespace io
+{
+
+static constexpr uint32_t QOI_MAGIC {0x716f6966};   // "qoif" read big endian.
+
+static constexpr int QOI_HEADER_SIZE_BYTES {14};
+static constexpr int QOI_PADDING_SIZE_BYTES {8};
+static constexpr uint8_t QOI_PADDING[QOI_PADDING_SIZE_BYTES] {0, 0, 0, 0, 0, 0, 0, 1};
+
+static constexpr uint8_t QOI_OP_INDEX {0x00};   // 2-bit tags.
+static constexpr uint8_t QOI_OP_DIFF  {0x40};
+static constexpr uint8_t QOI_OP_LUMA  {0x80};
+static constexpr uint8_t QOI_OP_RUN   {0xc0};
+static constexpr uint8_t QOI_OP_RGB   {0xfe};   // 8-bit tags.
+static constexpr uint8_t QOI_OP_RGBA  {0xff};
+static constexpr uint8_t QOI_MASK_2   {0xc0};
+
+static constexpr int QOI_RUN_MAX {62};
+static constexpr int QOI_INDEX_SIZE {64};
+
+//
+// Same limits as bitmaps; guards against allocating excessive memory for corrupt files.
+//
+static constexpr int QOI_MAX_WIDTH {3000};
+static constexpr int QOI_MAX_HEIGHT {3000};
+
+static inline int hashPixel(const gfx::Color4u& px)
+{
+  return (px._r * 3 + px._g * 5 + px._b * 7 + px._a * 11) % QOI_INDEX_SIZE;
+}
+
+static inline bool isEqual(const gfx::Color4u& a, const gfx::Color4u& b)
+{
+  return a._r == b._r && a._g == b._g && a._b == b._b && a._a == b._a;
+}
+
+static inline uint32_t readBigEndian32(const uint8_t* bytes)
+{
+  return (uint32_t{bytes[0]} << 24) | (uint32_t{bytes[1]} << 16) | (uint32_t{bytes[2]} << 8) | uint32_t{bytes[3]};
+}
+
+static inline void writeBigEndian32(uint8_t* bytes, uint32_t value)
+{
+  bytes[0] = static_cast<uint8_t>(value >> 24);
+  bytes[1] = static_cast<uint8_t>(value >> 16);
+  bytes[2] = static_cast<uint8_t>(value >> 8);
+  bytes[3] = static_cast<uint8_t>(value);
+}
+
+bool loadQoi(const std::string& filepath, Bmp& image)
+{
+  PXR_PROFILE_ZONE("loadQoi");
+  std::ifstream file {filepath, std::ios::binary | std::ios::ate};
+  if(!file){
+    log::log(log::ERROR, log::msg_qoi_fail_open, filepath);
+    return false;
+  }
+
+  //
+  // Read the whole file in one go.
+  //
+  std::streamoff fileSize = file.tellg();
+  if(fileSize < QOI_HEADER_SIZE_BYTES + QOI_PADDING_SIZE_BYTES){
+    log::log(log::ERROR, log::msg_qoi_corrupted, filepath);
+    return false;
+  }
+  std::vector<uint8_t> bytes(fileSize);
+  file.seekg(0, std::ios::beg);
+  if(!file.read(reinterpret_cast<char*>(bytes.data()), fileSize)){
+    log::log(log::ERROR, log::msg_qoi_corrupted, filepath);
+    return false;
+  }
+
+  uint32_t magic = readBigEndian32(bytes.data() + 0);
+  uint32_t width = readBigEndian32(bytes.data() + 4);
+  uint32_t height = readBigEndian32(bytes.data() + 8);
+  uint8_t channels = bytes[12];
+  if(magic != QOI_MAGIC || (channels != 3 && channels != 4)){
+    log::log(log::ERROR, log::msg_qoi_corrupted, filepath);
+    return false;
+  }
+
+  if(width == 0 || height == 0 || width > QOI_MAX_WIDTH || height > QOI_MAX_HEIGHT){
+    std::stringstream ss{};
+    ss << "[w:" << width << ",h:" << height << "]";
+    log::log(log::ERROR, log::msg_qoi_unsupported_size, ss.str());
+    return false;
+  }
+
+  Vector2i size {static_cast<int>(width), static_cast<int>(height)};
+  image.create(size, gfx::Color4u{});
+  gfx::Color4u* const* pixels = image.getPixels();
+
+  gfx::Color4u index[QOI_INDEX_SIZE] {};
+  gfx::Color4u px {0, 0, 0, 255};
+  int run {0};
+  const uint8_t* p = bytes.data() + QOI_HEADER_SIZE_BYTES;
+  const uint8_t* end = bytes.data() + bytes.size() - QOI_PADDING_SIZE_BYTES;
+
+  //
+  // Qoi images are stored top row first whereas in memory images have their origin in the
+  // bottom left, hence the rows are filled in reverse.
+  //
+  for(int row = size._y - 1; row >= 0; --row){
+    gfx::Color4u* dst = pixels[row];
+    for(int col = 0; col < size._x; ++col){
+      if(run > 0){
+        --run;
+      }
+      else if(p < end){
+        uint8_t b1 = *p++;
+        if(b1 == QOI_OP_RGB){
+          px._r = p[0];
+          px._g = p[1];
+          px._b = p[2];
+          p += 3;
+        }
+        else if(b1 == QOI_OP_RGBA){
+          px._r = p[0];
+          px._g = p[1];
+          px._b = p[2];
+          px._a = p[3];
+          p += 4;
+        }
+        else if((b1 & QOI_MASK_2) == QOI_OP_INDEX){
+          px = index[b1];
+        }
+        else if((b1 & QOI_MASK_2) == QOI_OP_DIFF){
+          px._r += ((b1 >> 4) & 0x03) - 2;
+          px._g += ((b1 >> 2) & 0x03) - 2;
+          px._b += ( b1       & 0x03) - 2;
+        }
+        else if((b1 & QOI_MASK_2) == QOI_OP_LUMA){
+          uint8_t b2 = *p++;
+          int dg = (b1 & 0x3f) - 32;
+          px._r += dg - 8 + ((b2 >> 4) & 0x0f);
+          px._g += dg;
+          px._b += dg - 8 + (b2 & 0x0f);
+        }
+        else if((b1 & QOI_MASK_2) == QOI_OP_RUN){
+          run = (b1 & 0x3f);
+        }
+        index[hashPixel(px)] = px;
+      }
+      else {
+        log::log(log::ERROR, log::msg_qoi_truncated, filepath);
+        return false;
+      }
+      dst[col] = px;
+    }
+  }
+
+  return true;
+}
+
+bool saveQoi(const std::string& filepath, const Bmp& image)
+{
+  Vector2i size = image.getSize();
+  const gfx::Color4u* const* pixels = image.getPixels();
+
+  //
+  // Worst case every pixel is a 5 byte rgba op.
+  //
+  std::vector<uint8_t> bytes(QOI_HEADER_SIZE_BYTES + (size._x * size._y * 5) + QOI_PADDING_SIZE_BYTES);
+  uint8_t* p = bytes.data();
+
+  writeBigEndian32(p + 0, QOI_MAGIC);
+  writeBigEndian32(p + 4, size._x);
+  writeBigEndian32(p + 8, size._y);
+  p[12] = 4;    // channels; rgba.
+  p[13] = 0;    // colorspace; srgb with linear alpha.
+  p += QOI_HEADER_SIZE_BYTES;
+
+  gfx::Color4u index[QOI_INDEX_SIZE] {};
+  gfx::Color4u prev {0, 0, 0, 255};
+  int run {0};
+  int pixelCount = size._x * size._y;
+  int pixelNo {0};
+
+  for(int row = size._y - 1; row >= 0; --row){
+    const gfx::Color4u* src = pixels[row];
+    for(int col = 0; col < size._x; ++col, ++pixelNo){
+      gfx::Color4u px = src[col];
+
+      if(isEqual(px, prev)){
+        ++run;
+        if(run == QOI_RUN_MAX || pixelNo == pixelCount - 1){
+          *p++ = QOI_OP_RUN | (run - 1);
+          run = 0;
+        }
+        continue;
+      }
+
+      if(run > 0){
+        *p++ = QOI_OP_RUN | (run - 1);
+        run = 0;
+      }
+
+      int hash = hashPixel(px);
+      if(isEqual(index[hash], px)){
+        *p++ = QOI_OP_INDEX | hash;
+      }
+      else {
+        index[hash] = px;
+        if(px._a == prev._a){
+          int8_t dr = px._r - prev._r;
+          int8_t dg = px._g - prev._g;
+          int8_t db = px._b - prev._b;
+          int8_t drdg = dr - dg;
+          int8_t dbdg = db - dg;
+          if(dr > -3 && dr < 2 && dg > -3 && dg < 2 && db > -3 && db < 2){
+            *p++ = QOI_OP_DIFF | ((dr + 2) << 4) | ((dg + 2) << 2) | (db + 2);
+          }
+          else if(drdg > -9 && drdg < 8 && dg > -33 && dg < 32 && dbdg > -9 && dbdg < 8){
+            *p++ = QOI_OP_LUMA | (dg + 32);
+            *p++ = ((drdg + 8) << 4) | (dbdg + 8);
+          }
+          else {
+            *p++ = QOI_OP_RGB;
+            *p++ = px._r;
+            *p++ = px._g;
+            *p++ = px._b;
+          }
+        }
+        else {
+          *p++ = QOI_OP_RGBA;
+          *p++ = px._r;
+          *p++ = px._g;
+          *p++ = px._b;
+          *p++ = px._a;
+        }
+      }
+      prev = px;
+    }
+  }
+
+  std::memcpy(p, QOI_PADDING, QOI_PADDING_SIZE_BYTES);
+  p += QOI_PADDING_SIZE_BYTES;
+
+  std::ofstream file {filepath, std::ios::binary | std::ios::trunc};
+  if(!file){
+    log::log(log::ERROR, log::msg_qoi_fail_create, filepath);
+    return false;
+  }
+  file.write(reinterpret_cast<const char*>(bytes.data()), p - bytes.data());
+  if(!file){
+    log::log(log::ERROR, log::msg_qoi_write_fail, filepath);
+    return false;
+  }
+  return true;
+}
+
+} // namespace io
+} // namespace pxr
@@ -0,0 +1,245 @@
+#include <fstream>
+#include <iterator>
+#include <cstring>
+#include <cassert>
+#include "../include/pxr_replay.h"
+#include "../include/pxr_log.h"
+
+namespace pxr
+{
+namespace replay
+{
+
+static constexpr char magic[4] {'P', 'X', 'R', 'R'};
+
+static constexpr int HEADER_SIZE_BYTES {
+  sizeof(magic) + sizeof(uint32_t) + (sizeof(uint32_t) * rand::xorwow::state_size) + sizeof(int64_t)
+};
+
+//
+// Each event is a byte of key code and up/down bit.
+//
+static_assert(input::KEY_COUNT <= 128);
+
+//
+// The recording is flushed to the file every this many ticks so a crash loses little of it.
+//
+static constexpr int FLUSH_INTERVAL_TICKS {60};
+
+static Mode mode {MODE_OFF};
+static std::string filepath;
+static rand::xorwow::state_type seed;
+static int64_t tickPeriod_ns;
+static int64_t lastGameNow_ns;
+static int64_t ticksDone;
+
+static std::ofstream recordFile;
+static std::vector<uint8_t> tickBytes;         // the encoded tick being recorded.
+
+static std::vector<uint8_t> playbackBytes;     // the whole recording being played back.
+static size_t playbackPos;
+
+static void putFixed(std::vector<uint8_t>& bytes, uint64_t value, int numBytes)
+{
+  for(int i = 0; i < numBytes; ++i)
+    bytes.push_back(static_cast<uint8_t>((value >> (8 * i)) & 0xff));
+}
+
+static void putVarint(std::vector<uint8_t>& bytes, uint64_t value)
+{
+  while(value >= 0x80){
+    bytes.push_back(static_cast<uint8_t>(value | 0x80));
+    value >>= 7;
+  }
+  bytes.push_back(static_cast<uint8_t>(value));
+}
+
+static uint64_t getFixed(const std::vector<uint8_t>& bytes, size_t& pos, int numBytes)
+{
+  uint64_t value {0};
+  for(int i = 0; i < numBytes; ++i)
+    value |= static_cast<uint64_t>(bytes[pos++]) << (8 * i);
+  return value;
+}
+
+//
+// Returns false if the bytes run out before the varint does.
+//
+static bool getVarint(const std::vector<uint8_t>& bytes, size_t& pos, uint64_t& value)
+{
+  value = 0;
+  for(int shift = 0; shift < 64; shift += 7){
+    if(pos >= bytes.size())
+      return false;
+    uint8_t byte = bytes[pos++];
+    value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if((byte & 0x80) == 0)
+      return true;
+  }
+  return false;
+}
+
+static uint64_t zigzagEncode(int64_t value)
+{
+  return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+static int64_t zigzagDecode(uint64_t value)
+{
+  return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+bool startRecording(const std::string& filepath_, const rand::xorwow::state_type& seed_,
+                    int64_t tickPeriod_ns_)
+{
+  stop();
+
+  recordFile.open(filepath_, std::ios_base::binary | std::ios_base::trunc);
+  if(!recordFile){
+    log::log(log::ERROR, log::msg_replay_fail_open, filepath_);
+    return false;
+  }
+
+  filepath = filepath_;
+  seed = seed_;
+  tickPeriod_ns = tickPeriod_ns_;
+  lastGameNow_ns = 0;
+  ticksDone = 0;
+
+  std::vector<uint8_t> header {};
+  header.insert(header.end(), std::begin(magic), std::end(magic));
+  putFixed(header, FILE_VERSION, sizeof(uint32_t));
+  for(auto word : seed)
+    putFixed(header, word, sizeof(word));
+  putFixed(header, static_cast<uint64_t>(tickPeriod_ns), sizeof(int64_t));
+  assert(header.size() == HEADER_SIZE_BYTES);
+  recordFile.write(reinterpret_cast<const char*>(header.data()), header.size());
+
+  tickBytes.reserve(64);
+  mode = MODE_RECORD;
+  log::log(log::INFO, log::msg_replay_recording, filepath);
+  return true;
+}
+
+void recordTick(int64_t gameNow_ns, const std::vector<input::KeyEvent>& events)
+{
+  assert(mode == MODE_RECORD);
+
+  tickBytes.clear();
+  putVarint(tickBytes, zigzagEncode(gameNow_ns - lastGameNow_ns));
+  putVarint(tickBytes, events.size());
+  for(const auto& event : events)
+    tickBytes.push_back(static_cast<uint8_t>((event._key << 1) | (event._isDown ? 1 : 0)));
+  recordFile.write(reinterpret_cast<const char*>(tickBytes.data()), tickBytes.size());
+
+  lastGameNow_ns = gameNow_ns;
+  ++ticksDone;
+  if(ticksDone % FLUSH_INTERVAL_TICKS == 0)
+    recordFile.flush();
+}
+
+bool startPlayback(const std::string& filepath_)
+{
+  stop();
+
+  std::ifstream file {filepath_, std::ios_base::binary};
+  if(!file){
+    log::log(log::ERROR, log::msg_replay_fail_open, filepath_);
+    return false;
+  }
+
+  playbackBytes.assign(std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{});
+  if(playbackBytes.size() < HEADER_SIZE_BYTES || std::memcmp(playbackBytes.data(), magic, sizeof(magic)) != 0){
+    log::log(log::ERROR, log::msg_replay_not_a_replay, filepath_);
+    playbackBytes.clear();
+    return false;
+  }
+
+  playbackPos = sizeof(magic);
+  uint32_t version = static_cast<uint32_t>(getFixed(playbackBytes, playbackPos, sizeof(uint32_t)));
+  if(version != FILE_VERSION){
+    log::log(log::ERROR, log::msg_replay_unsupported_version, std::to_string(version));
+    playbackBytes.clear();
+    return false;
+  }
+
+  for(auto& word : seed)
+    word = static_cast<rand::xorwow::result_type>(getFixed(playbackBytes, playbackPos, sizeof(word)));
+  tickPeriod_ns = static_cast<int64_t>(getFixed(playbackBytes, playbackPos, sizeof(int64_t)));
+
+  filepath = filepath_;
+  lastGameNow_ns = 0;
+  ticksDone = 0;
+  mode = MODE_PLAYBACK;
+  log::log(log::INFO, log::msg_replay_playing, filepath);
+  return true;
+}
+
+const rand::xorwow::state_type& getSeed()
+{
+  return seed;
+}
+
+int64_t getTickPeriodNanoseconds()
+{
+  return tickPeriod_ns;
+}
+
+bool playTick(int64_t& gameNow_ns)
+{
+  assert(mode == MODE_PLAYBACK);
+
+  if(playbackPos >= playbackBytes.size()){
+    stop();
+    return false;
+  }
+
+  uint64_t delta {0}, numEvents {0};
+  if(!getVarint(playbackBytes, playbackPos, delta) ||
+     !getVarint(playbackBytes, playbackPos, numEvents) ||
+     numEvents > playbackBytes.size() - playbackPos)
+  {
+    log::log(log::ERROR, log::msg_replay_truncated, std::to_string(ticksDone));
+    stop();
+    return false;
+  }
+
+  for(uint64_t i = 0; i < numEvents; ++i){
+    uint8_t byte = playbackBytes[playbackPos++];
+    auto key = static_cast<input::KeyCode>(byte >> 1);
+    if(key < input::KEY_COUNT)
+      input::onKey(key, (byte & 1) != 0);
+  }
+
+  lastGameNow_ns += zigzagDecode(delta);
+  gameNow_ns = lastGameNow_ns;
+  ++ticksDone;
+  return true;
+}
+
+void stop()
+{
+  if(mode == MODE_RECORD){
+    recordFile.close();
+    log::log(log::INFO, log::msg_replay_recorded, filepath + " [" + std::to_string(ticksDone) + " ticks]");
+  }
+  else if(mode == MODE_PLAYBACK){
+    playbackBytes.clear();
+    playbackBytes.shrink_to_fit();
+    log::log(log::INFO, log::msg_replay_played, filepath + " [" + std::to_string(ticksDone) + " ticks]");
+  }
+  mode = MODE_OFF;
+}
+
+Mode getMode()
+{
+  return mode;
+}
+
+int64_t getTicksDone()
+{
+  return ticksDone;
+}
+
+} // namespace replay
+} // namespace pxr
@@ -4,10 +4,18 @@
 #include <cassert>
 #include <vector>
 #include <algorithm>
+#include <numeric>
+#include <array>
+#include <cstring>
 #include <SDL2/SDL_mixer.h>
 #include "../include/pxr_sfx.h"
+#include "../include/pxr_mixer.h"
 #include "../include/pxr_log.h"
 #include "../include/pxr_wav.h"
+#include "../include/pxr_cache.h"
+#include "../include/pxr_dsp.h"
+#include "../include/pxr_synth.h"
+#include "../include/pxr_profile.h"
 
 #include <iostream>
 
@@ -16,6 +24,9 @@ namespace pxr
 namespace sfx
 {
 
+static_assert(ALL_CHANNELS == mixer::ALL_VOICES);
+static_assert(NULL_CHANNEL == mixer::NULL_VOICE);
+
 /////////////////////////////////////////////////////////////////////////////////////////////////
 // MODULE DATA
 /////////////////////////////////////////////////////////////////////////////////////////////////
@@ -23,40 +34,63 @@ namespace sfx
 struct SoundResource
 {
   std::string _name = "";
-  Mix_Chunk* _chunk = nullptr;
   int _referenceCount = 0;
+
+  //
+  // Signed 16-bit samples interleaved in the sampling rate and channel count of the mixer.
+  //
+  std::vector<int16_t> _samples {};
+  int _frameCount = 0;
+
+  SoundPolicy _policy {};
+  int _instanceCount = 0;                                   // the number of channels playing it.
+  double _lastPlay_s = -std::numeric_limits<double>::max(); // on the sfx clock.
 };
 
 struct MusicResource
 {
   std::string _name = "";
-  Mix_Music* _music = nullptr;
   int _referenceCount = 0;
+  std::vector<int16_t> _samples {};
+  int _frameCount = 0;
 };
 
+//
+// Plays music sequences on the mixer's music track. The track times the nodes itself; the
+// player keeps nodes queued ahead of it, reacting to the track's events, and knows which music
+// the track may still be reading.
+//
 class MusicSequencePlayer
 {
 public:
-  enum State { STOPPED, PAUSED, PLAYING, FADING_OUT };
+  enum State { STOPPED, PAUSED, PLAYING };
   MusicSequencePlayer();
-  void onUpdate(float dt);
   void play(MusicSequence_t sequence, bool loop);
   void stop();
   void pause();
   void resume();
+  void onNodeStarted(uint32_t nodeId);
+  void onNodeFinished(uint32_t nodeId);
   State getState() const {return _state;} 
   bool isUsingMusicResource(ResourceKey_t musicKey);
 private:
-  void playNode(const MusicSequenceNode* node);
-  void stopNode(const MusicSequenceNode* node);
-  void onPlayingUpdate(float dt);
-  void onFadingOutUpdate(float dt);
+  bool queueNextNode();
+  int countNodesWaiting() const;
 private:
+  struct QueuedNode
+  {
+    uint32_t _id;
+    ResourceKey_t _musicKey;
+    bool _isCurrentSequence;    // false once stopped or replaced by another sequence.
+    bool _hasStarted;
+  };
+
   State _state;
   MusicSequence_t _sequence;
-  int _currentNode;
-  float _musicClock_s;
+  int _nextNode;
   bool _isLooping;
+  uint32_t _nextNodeId;
+  std::vector<QueuedNode> _queuedNodes;  // queued on the track and yet to finish.
 };
 
 static MusicSequencePlayer musicSequencePlayer;
@@ -83,11 +117,15 @@ static std::unordered_map<ResourceKey_t, SoundResource> sounds;
 static std::unordered_map<ResourceKey_t, MusicResource> music;
 
 //
-// Music volume is updated in the update function at the next point in which the update will
-// succeed; volume cannot be set during fade effects.
+// Music volume is the gain of the music track which is independent of the track's fades.
 //
-static int musicVolume;
-static bool hasMusicVolumeChanged {false};
+static int musicVolume {MAX_VOLUME};
+
+//
+// The effects on the music bus with which the music is ducked.
+//
+static mixer::EffectID_t duckGainEffect {mixer::NULL_EFFECT};
+static mixer::EffectID_t duckFilterEffect {mixer::NULL_EFFECT};
 
 //
 // The configuration this module was initialized with.
@@ -96,13 +134,62 @@ SFXConfiguration sfxconfiguration;
 
 //
 // Maintains data on which channel is playing which sound. Channel ids range from 0 up to
-// sfxconfiguration._numMixChannels - 1.
+// sfxconfiguration._numMixChannels - 1 and map directly to the voices of the mixer.
+//
+// Only ever accessed from the game thread; entries are set when a sound is played and cleared
+// when the mixer's finished events are drained in onUpdate. A sound's samples are thus never
+// freed whilst the audio thread may still be reading them.
 //
 static std::vector<ResourceKey_t> channelPlayback;
 
 //
-// An array of current volumes for all mix channels. Stored here because in SDL_Mixer there 
-// appears to be no way to get the volume of a channel without setting it.
+// The priority of the sound playing on each channel and the order in which the channels were
+// played; used to pick which channel to steal.
+//
+static std::vector<int> channelPriority;
+static std::vector<uint64_t> channelPlayOrder;
+static uint64_t nextPlayOrder {0};
+
+//
+// Plays which were stolen but whose finished events have yet to be drained; their sounds may
+// still be being read by the audio thread (whilst faded out).
+//
+struct StolenPlay
+{
+  SoundChannel_t _channel;
+  uint32_t _generation;
+  ResourceKey_t _soundKey;
+};
+
+static std::vector<StolenPlay> stolenPlayback;
+
+//
+// Advanced by onUpdate; used to time sound cooldowns.
+//
+static double sfxClock_s {0.0};
+
+static PlaybackStats playbackStats {};
+
+//
+// Adaptive chunk sizing; see adaptChunkSize.
+//
+static constexpr int ADAPTIVE_UNDERRUN_THRESHOLD {3};
+static constexpr double ADAPTIVE_WINDOW_S {10.0};
+static constexpr double ADAPTIVE_GRACE_S {1.0};
+static int64_t adaptiveWindowUnderruns {0};
+static double adaptiveWindowStart_s {0.0};
+static double adaptiveGraceEnd_s {0.0};
+static int chunkResizes {0};
+
+//
+// Time advanced by advanceOffline and the frames it has mixed to keep up with it.
+//
+static double offlineClock_s {0.0};
+static int64_t offlineFramesMixed {0};
+static std::vector<float> offlineBlock;
+
+//
+// An array of current volumes for all mix channels; mirrors the gains set on the mixer voices.
 //
 static std::vector<int> channelVolume;
 
@@ -117,94 +204,112 @@ static std::vector<ResourceKey_t> musicUnloadQueue;
 // SOUND FUNCTIONS 
 /////////////////////////////////////////////////////////////////////////////////////////////////
 
-void onChannelFinished(int channel)
-{
-  assert(0 <= channel && channel < sfxconfiguration._numMixChannels);
-  channelPlayback[channel] = nullResourceKey;
-}
-
 //
-// Generates a short sinusoidal beep.
+// Generates a short sinusoidal beep in the mixer's sample rate and channel count.
 //
-template<typename T>
-Mix_Chunk* generateSineBeep(int waveFreq_hz, float waveDuration_s)
+static std::vector<int16_t> generateSineBeep(int waveFreq_hz, float waveDuration_s)
 {
-  static_assert(std::numeric_limits<T>::is_integer);
-
   float waveFreq_rad_per_s = waveFreq_hz * 2.f * M_PI;
-  int sampleCount = sfxconfiguration._samplingFreq_hz * waveDuration_s;
+  int frameCount = sfxconfiguration._samplingFreq_hz * waveDuration_s;
   float samplePeriod_s = 1.f / sfxconfiguration._samplingFreq_hz;
-  T* pcm = new T[sampleCount];
-  for(int s = 0; s < sampleCount; ++s){
-    float sf = sinf(waveFreq_rad_per_s * (s * samplePeriod_s));   // wave equation = sin(wt)
-    if(std::numeric_limits<T>::is_signed){
-      if(sf < 0.f)  pcm[s] = static_cast<T>(sf * std::numeric_limits<T>::min());
-      if(sf >= 0.f) pcm[s] = static_cast<T>(sf * std::numeric_limits<T>::max());
-    }
-    else{
-      pcm[s] = static_cast<T>((sf + 1.f) * (std::numeric_limits<T>::max() / 2));
-    }
+  int numChannels = sfxconfiguration._outputMode;
+  std::vector<int16_t> pcm(frameCount * numChannels);
+  for(int f = 0; f < frameCount; ++f){
+    float sf = sinf(waveFreq_rad_per_s * (f * samplePeriod_s));   // wave equation = sin(wt)
+    int16_t sample = static_cast<int16_t>(sf * std::numeric_limits<int16_t>::max());
+    for(int c = 0; c < numChannels; ++c)
+      pcm[(f * numChannels) + c] = sample;
   }
-
-  Mix_Chunk* chunk = new Mix_Chunk();
-  chunk->allocated = 1;
-  chunk->abuf = reinterpret_cast<uint8_t*>(pcm);
-  chunk->alen = sampleCount * sizeof(T);
-  chunk->volume = errorSoundVolume;
-  return chunk;
+  return pcm;
 }
 
-static void generateErrorSound(SampleFormat format)
+static void generateErrorSound()
 {
-  Mix_Chunk* chunk {nullptr};
-  switch(format){
-    case SAMPLE_FORMAT_U8     : {chunk = generateSineBeep<uint8_t >(errorSoundFreq_hz, errorSoundDuration_s); break;}
-    case SAMPLE_FORMAT_S8     : {chunk = generateSineBeep<int8_t  >(errorSoundFreq_hz, errorSoundDuration_s); break;}
-    case SAMPLE_FORMAT_U16LSB : {chunk = generateSineBeep<uint16_t>(errorSoundFreq_hz, errorSoundDuration_s); break;}
-    case SAMPLE_FORMAT_S16LSB : {chunk = generateSineBeep<int16_t >(errorSoundFreq_hz, errorSoundDuration_s); break;}
-    case SAMPLE_FORMAT_S32LSB : {chunk = generateSineBeep<int32_t >(errorSoundFreq_hz, errorSoundDuration_s); break;}
-    default: assert(0);
-  }
   SoundResource resource {};
   resource._name = errorSoundName;
-  resource._chunk = chunk;
+  resource._samples = generateSineBeep(errorSoundFreq_hz, errorSoundDuration_s);
+  resource._frameCount = static_cast<int>(resource._samples.size()) / sfxconfiguration._outputMode;
   resource._referenceCount = 0;
   errorSoundKey = nextResourceKey++;
-  sounds.emplace(std::make_pair(errorSoundKey, resource));
+  sounds.emplace(errorSoundKey, std::move(resource));
 }
 
 static void freeErrorSound()
 {
   auto search = sounds.find(errorSoundKey);
   assert(search != sounds.end());
-  auto& resource = search->second;
-  delete[] resource._chunk->abuf;
-  delete resource._chunk;
-  resource._chunk = nullptr;
   sounds.erase(search);
 }
 
+static bool isChannelPlayingSound(ResourceKey_t soundKey)
+{
+  auto search = sounds.find(soundKey);
+  return search != sounds.end() && search->second._instanceCount > 0;
+}
+
+static void onPlayFinished(ResourceKey_t soundKey)
+{
+  auto search = sounds.find(soundKey);
+  assert(search != sounds.end() && search->second._instanceCount > 0);
+  search->second._instanceCount--;
+}
+
+static void drainMixerEvents()
+{
+  mixer::Event event;
+  while(mixer::pollEvent(event)){
+    if(event._type == mixer::Event::TRACK_NODE_STARTED){
+      musicSequencePlayer.onNodeStarted(event._generation);
+    }
+    else if(event._type == mixer::Event::TRACK_NODE_FINISHED){
+      musicSequencePlayer.onNodeFinished(event._generation);
+    }
+    else if(event._generation == mixer::getGeneration(event._voice)){
+      onPlayFinished(channelPlayback[event._voice]);
+      channelPlayback[event._voice] = nullResourceKey;
+    }
+    else{
+      auto search = std::find_if(stolenPlayback.begin(), stolenPlayback.end(), [&event](const StolenPlay& play){
+        return play._channel == event._voice && play._generation == event._generation;
+      });
+      assert(search != stolenPlayback.end());
+      onPlayFinished(search->_soundKey);
+      *search = stolenPlayback.back();
+      stolenPlayback.pop_back();
+    }
+  }
+}
+
 static bool unloadSound(ResourceKey_t soundKey)
 {
   assert(soundKey != errorSoundKey);
   auto search = sounds.find(soundKey);
-  if(search == sounds.end()){
+  if(search == sounds.end() || search->second._referenceCount <= 0){
     log::log(log::WARN, log::msg_sfx_unloading_nonexistent_sound, std::to_string(soundKey));
   }
   else{
     search->second._referenceCount--;
-    if(search->second._referenceCount <= 0){
-      Mix_FreeChunk(search->second._chunk);
-      sounds.erase(search);
-      log::log(log::INFO, log::msg_sfx_sound_unloaded, std::to_string(soundKey));
+    if(search->second._referenceCount == 0){
+      log::log(log::INFO, log::msg_sfx_release_sound, std::to_string(soundKey));
+      cache::onRelease(cache::RESOURCE_SOUND, soundKey);
     }
   }
   return true;
 }
 
-static bool isChannelPlayingSound(ResourceKey_t soundKey)
+//
+// Invoked by the resource cache to free a warm sound. Warm sounds can still be played by key
+// so must not be freed whilst a channel is playing them.
+//
+static bool evictSound(cache::Key_t soundKey)
 {
-  return std::find(channelPlayback.begin(), channelPlayback.end(), soundKey) != channelPlayback.end();
+  if(isChannelPlayingSound(soundKey))
+    return false;
+  auto search = sounds.find(soundKey);
+  assert(search != sounds.end());
+  sounds.erase(search);
+  log::log(log::INFO, log::msg_sfx_sound_unloaded, std::to_string(soundKey));
+  return true;
 }
 
 static void unloadUnusedSounds()
@@ -224,36 +329,43 @@ static ResourceKey_t returnErrorSound()
   return errorSoundKey;
 }
 
-ResourceKey_t loadSoundWAV(ResourceName_t soundName)
+//
+// Returns the key of a sound already loaded under a name (adding a reference) or
+// nullResourceKey if there is none.
+//
+static ResourceKey_t findLoadedSound(ResourceName_t soundName)
 {
-  log::log(log::INFO, log::msg_sfx_loading_sound, soundName);
-
   for(auto& pair : sounds){
     if(pair.second._name == soundName){
       pair.second._referenceCount++;
+      cache::onHit(cache::RESOURCE_SOUND, pair.first);
       std::string addendum {"reference count="};
       addendum += std::to_string(pair.second._referenceCount);
       log::log(log::INFO, log::msg_sfx_sound_already_loaded, addendum);
       return pair.first;
     }
   }
+  return nullResourceKey;
+}
 
+//
+// Adds a sound whose samples are in the sampling rate and channel count of the mixer.
+//
+static ResourceKey_t addSound(ResourceName_t soundName, std::vector<int16_t> samples)
+{
   SoundResource resource {};
-  std::string wavpath {};
-  wavpath += RESOURCE_PATH_SOUNDS;
-  wavpath += soundName;
-  wavpath += io::Wav::FILE_EXTENSION;
-  resource._chunk = Mix_LoadWAV(wavpath.c_str());
-  if(resource._chunk == nullptr){
-    log::log(log::ERROR, log::msg_sfx_fail_load_sound, wavpath + " : " + Mix_GetError());
-    log::log(log::INFO, log::msg_sfx_using_error_sound, wavpath);
-    return returnErrorSound();
-  }
+  resource._samples = std::move(samples);
+  resource._frameCount = static_cast<int>(resource._samples.size()) / sfxconfiguration._outputMode;
   resource._name = soundName;
   resource._referenceCount = 1;
 
+  //
+  // Moving the resource keeps the samples at the same address; voices point at them.
+  //
   ResourceKey_t newKey = nextResourceKey++;
-  sounds.emplace(std::make_pair(newKey, resource));
+  int64_t residentBytes = resource._samples.size() * sizeof(int16_t);
+  sounds.emplace(newKey, std::move(resource));
+  cache::onLoad(cache::RESOURCE_SOUND, newKey, residentBytes);
 
   std::string addendum{};
   addendum += "[name:key]=[";
@@ -266,109 +378,238 @@ ResourceKey_t loadSoundWAV(ResourceName_t soundName)
   return newKey;
 }
 
+ResourceKey_t loadSoundWAV(ResourceName_t soundName)
+{
+  PXR_PROFILE_ZONE("sfx::loadSoundWAV");
+  log::log(log::INFO, log::msg_sfx_loading_sound, soundName);
+
+  ResourceKey_t loadedKey = findLoadedSound(soundName);
+  if(loadedKey != nullResourceKey)
+    return loadedKey;
+
+  std::string wavpath {};
+  wavpath += RESOURCE_PATH_SOUNDS;
+  wavpath += soundName;
+  wavpath += io::Wav::FILE_EXTENSION;
+
+  //
+  // Convert the sound to the sampling rate and channel count of the mixer at load time so the
+  // mixer can play the samples as is.
+  //
+  io::Wav wav {};
+  if(!wav.load(wavpath, sfxconfiguration._samplingFreq_hz, sfxconfiguration._outputMode) || wav.getFrameCount() == 0){
+    log::log(log::ERROR, log::msg_sfx_fail_load_sound, wavpath);
+    log::log(log::INFO, log::msg_sfx_using_error_sound, wavpath);
+    return returnErrorSound();
+  }
+
+  std::vector<int16_t> samples(wav.getSampleData(), wav.getSampleData() + wav.getSampleCount());
+  return addSound(soundName, std::move(samples));
+}
+
+ResourceKey_t loadSoundSynth(ResourceName_t soundName, const synth::Patch& patch)
+{
+  PXR_PROFILE_ZONE("sfx::loadSoundSynth");
+  log::log(log::INFO, log::msg_sfx_synthesizing_sound, soundName);
+
+  ResourceKey_t loadedKey = findLoadedSound(soundName);
+  if(loadedKey != nullResourceKey)
+    return loadedKey;
+
+  std::vector<int16_t> samples = synth::render(patch, sfxconfiguration._samplingFreq_hz, sfxconfiguration._outputMode);
+  if(samples.empty()){
+    log::log(log::ERROR, log::msg_sfx_fail_synthesize_sound, soundName);
+    log::log(log::INFO, log::msg_sfx_using_error_sound, soundName);
+    return returnErrorSound();
+  }
+  return addSound(soundName, std::move(samples));
+}
+
 void queueUnloadSound(ResourceKey_t soundKey)
 {
   assert(soundKey != errorSoundKey);
   soundUnloadQueue.push_back(soundKey);
 }
 
-static Mix_Chunk* findChunk(ResourceKey_t soundKey)
+static SoundResource* findSound(ResourceKey_t soundKey)
 {
   auto search = sounds.find(soundKey);
   if(search == sounds.end()){
     log::log(log::WARN, log::msg_sfx_playing_nonexistent_sound, std::to_string(soundKey));
     return nullptr;
   }
-  return search->second._chunk;
+  return &search->second;
 }
 
-static SoundChannel_t onSoundPlayError(ResourceKey_t soundKey)
+void setSoundPolicy(ResourceKey_t soundKey, SoundPolicy policy)
 {
-  std::string addendum{};
-  addendum += std::to_string(soundKey);
-  addendum += " : ";
-  addendum += Mix_GetError();
-  log::log(log::WARN, log::msg_sfx_fail_play_sound, addendum);
-  return NULL_CHANNEL;
+  SoundResource* sound = findSound(soundKey);
+  if(sound == nullptr) return;
+  sound->_policy = policy;
 }
 
-SoundChannel_t playSound(ResourceKey_t soundKey, int loops)
+const PlaybackStats& getPlaybackStats()
+{
+  return playbackStats;
+}
+
+//
+// Returns the oldest channel playing a sound which can be stolen, or NULL_CHANNEL.
+//
+static SoundChannel_t findOldestInstance(ResourceKey_t soundKey)
+{
+  SoundChannel_t oldest {NULL_CHANNEL};
+  for(int channel = 0; channel < sfxconfiguration._numMixChannels; ++channel){
+    if(channelPlayback[channel] != soundKey || !mixer::canSteal(channel))
+      continue;
+    if(oldest == NULL_CHANNEL || channelPlayOrder[channel] < channelPlayOrder[oldest])
+      oldest = channel;
+  }
+  return oldest;
+}
+
+//
+// Returns the channel to steal for a sound of the given priority, or NULL_CHANNEL if every
+// channel is playing a sound of higher priority. Lower priority sounds are stolen first, then
+// the quietest (i.e. most distant) and then the oldest.
+//
+static SoundChannel_t findStealCandidate(int priority)
+{
+  SoundChannel_t candidate {NULL_CHANNEL};
+  for(int channel = 0; channel < sfxconfiguration._numMixChannels; ++channel){
+    if(channelPriority[channel] > priority || !mixer::canSteal(channel))
+      continue;
+    if(candidate == NULL_CHANNEL){
+      candidate = channel;
+      continue;
+    }
+    if(channelPriority[channel] != channelPriority[candidate]){
+      if(channelPriority[channel] < channelPriority[candidate])
+        candidate = channel;
+    }
+    else if(channelVolume[channel] != channelVolume[candidate]){
+      if(channelVolume[channel] < channelVolume[candidate])
+        candidate = channel;
+    }
+    else if(channelPlayOrder[channel] < channelPlayOrder[candidate]){
+      candidate = channel;
+    }
+  }
+  return candidate;
+}
+
+//
+// Failures to play are expected during bursts so are only counted, never logged.
+//
+static SoundChannel_t playSound_(ResourceKey_t soundKey, int loops, int fadeDuration_ms, int playDuration_ms)
 {
-  auto* chunk = findChunk(soundKey);
-  if(chunk == nullptr) return NULL_CHANNEL;
-  SoundChannel_t channel = Mix_PlayChannel(-1, chunk, loops);
-  if(channel == -1) return onSoundPlayError(soundKey);
-  assert(channelPlayback[channel] == nullResourceKey);
+  SoundResource* sound = findSound(soundKey);
+  if(sound == nullptr) return NULL_CHANNEL;
+  const SoundPolicy& policy = sound->_policy;
+
+  if(policy._cooldown_ms > 0 && (sfxClock_s - sound->_lastPlay_s) * 1000.0 < policy._cooldown_ms){
+    ++playbackStats._droppedCooldown;
+    return NULL_CHANNEL;
+  }
+
+  const int16_t* samples = sound->_samples.data();
+  SoundChannel_t channel {NULL_CHANNEL};
+  SoundChannel_t victim {NULL_CHANNEL};
+  if(policy._maxInstances != UNLIMITED_INSTANCES && sound->_instanceCount >= policy._maxInstances){
+    if(policy._stealOldestInstance)
+      victim = findOldestInstance(soundKey);
+    if(victim == NULL_CHANNEL){
+      ++playbackStats._droppedInstances;
+      return NULL_CHANNEL;
+    }
+  }
+  else{
+    channel = mixer::play(samples, sound->_frameCount, loops, fadeDuration_ms, playDuration_ms);
+    if(channel == mixer::NULL_VOICE){
+      victim = findStealCandidate(policy._priority);
+      if(victim == NULL_CHANNEL){
+        ++playbackStats._droppedNoChannel;
+        return NULL_CHANNEL;
+      }
+    }
+  }
+
+  if(victim != NULL_CHANNEL){
+    uint32_t generation = mixer::getGeneration(victim);
+    channel = mixer::steal(victim, samples, sound->_frameCount, loops, fadeDuration_ms, playDuration_ms);
+    if(channel == mixer::NULL_VOICE){
+      ++playbackStats._droppedNoChannel;
+      return NULL_CHANNEL;
+    }
+    stolenPlayback.push_back(StolenPlay{channel, generation, channelPlayback[channel]});
+    ++playbackStats._stolen;
+  }
+  else{
+    assert(channelPlayback[channel] == nullResourceKey);
+  }
+
   channelPlayback[channel] = soundKey;
+  channelPriority[channel] = policy._priority;
+  channelPlayOrder[channel] = nextPlayOrder++;
+  sound->_instanceCount++;
+  sound->_lastPlay_s = sfxClock_s;
+  ++playbackStats._played;
   return channel;
 }
 
+SoundChannel_t playSound(ResourceKey_t soundKey, int loops)
+{
+  return playSound_(soundKey, loops, 0, -1);
+}
+
 SoundChannel_t playSoundTimed(ResourceKey_t soundKey, int loops, int playDuration_ms)
 {
-  auto* chunk = findChunk(soundKey);
-  if(chunk == nullptr) return NULL_CHANNEL;
-  SoundChannel_t channel = Mix_PlayChannelTimed(-1, chunk, loops, playDuration_ms);
-  if(channel == -1) return onSoundPlayError(soundKey);
-  assert(channelPlayback[channel] == nullResourceKey);
-  channelPlayback[channel] = soundKey;
-  return channel;
+  return playSound_(soundKey, loops, 0, playDuration_ms);
 }
 
 SoundChannel_t playSoundFadeIn(ResourceKey_t soundKey, int loops, int fadeDuration_ms)
 {
-  auto* chunk = findChunk(soundKey);
-  if(chunk == nullptr) return NULL_CHANNEL;
-  SoundChannel_t channel = Mix_FadeInChannel(-1, chunk, loops, fadeDuration_ms);
-  if(channel == -1) return onSoundPlayError(soundKey);
-  assert(channelPlayback[channel] == nullResourceKey);
-  channelPlayback[channel] = soundKey;
-  return channel;
+  return playSound_(soundKey, loops, fadeDuration_ms, -1);
 }
 
 SoundChannel_t playSoundFadeInTimed(ResourceKey_t soundKey, int loops, int fadeDuration_ms, int playDuration_ms)
 {
-  auto* chunk = findChunk(soundKey);
-  if(chunk == nullptr) return NULL_CHANNEL;
-  SoundChannel_t channel = Mix_FadeInChannelTimed(-1, chunk, loops, fadeDuration_ms, playDuration_ms);
-  if(channel == -1) return onSoundPlayError(soundKey);
-  assert(channelPlayback[channel] == nullResourceKey);
-  channelPlayback[channel] = soundKey;
-  return channel;
+  return playSound_(soundKey, loops, fadeDuration_ms, playDuration_ms);
 }
 
 void stopChannel(SoundChannel_t channel)
 {
   if(channel == NULL_CHANNEL) return;
   assert(ALL_CHANNELS <= channel && channel <= sfxconfiguration._numMixChannels - 1);
-  Mix_HaltChannel(channel);
+  mixer::stop(channel);
 }
 
 void stopChannelTimed(SoundChannel_t channel, int durationUntilStop_ms)
 {
   if(channel == NULL_CHANNEL) return;
   assert(ALL_CHANNELS <= channel && channel <= sfxconfiguration._numMixChannels - 1);
-  Mix_ExpireChannel(channel, durationUntilStop_ms);
+  mixer::stopTimed(channel, durationUntilStop_ms);
 }
 
 void stopChannelFadeOut(SoundChannel_t channel, int fadeDuration_ms)
 {
   if(channel == NULL_CHANNEL) return;
   assert(ALL_CHANNELS <= channel && channel <= sfxconfiguration._numMixChannels - 1);
-  Mix_FadeOutChannel(channel, fadeDuration_ms);
+  mixer::stopFadeOut(channel, fadeDuration_ms);
 }
 
 void pauseChannel(SoundChannel_t channel)
 {
   if(channel == NULL_CHANNEL) return;
   assert(ALL_CHANNELS <= channel && channel <= sfxconfiguration._numMixChannels - 1);
-  Mix_Pause(channel);
+  mixer::pause(channel);
 }
 
 void resumeChannel(SoundChannel_t channel)
 {
   if(channel == NULL_CHANNEL) return;
   assert(ALL_CHANNELS <= channel && channel <= sfxconfiguration._numMixChannels - 1);
-  Mix_Resume(channel);
+  mixer::resume(channel);
 }
 
 bool isChannelPlaying(SoundChannel_t channel)
@@ -376,7 +617,7 @@ bool isChannelPlaying(SoundChannel_t channel)
   if(channel == NULL_CHANNEL) return false;
   if(channel == ALL_CHANNELS) return false;
   assert(0 <= channel && channel <= sfxconfiguration._numMixChannels - 1);
-  return Mix_Playing(channel) == 1;
+  return mixer::isPlaying(channel);
 }
 
 bool isChannelPaused(SoundChannel_t channel)
@@ -384,7 +625,7 @@ bool isChannelPaused(SoundChannel_t channel)
   if(channel == NULL_CHANNEL) return false;
   if(channel == ALL_CHANNELS) return false;
   assert(0 <= channel && channel <= sfxconfiguration._numMixChannels - 1);
-  return Mix_Paused(channel) == 1;
+  return mixer::isPaused(channel);
 }
 
 void setChannelVolume(SoundChannel_t channel, int volume)
@@ -392,137 +633,89 @@ void setChannelVolume(SoundChannel_t channel, int volume)
   if(channel == NULL_CHANNEL) return;
   assert(ALL_CHANNELS <= channel && channel <= sfxconfiguration._numMixChannels - 1);
   int vol = std::clamp(volume, MIN_VOLUME, MAX_VOLUME);
-  channelVolume[channel] = Mix_Volume(channel, vol); 
+  if(channel == ALL_CHANNELS)
+    std::fill(channelVolume.begin(), channelVolume.end(), vol);
+  else
+    channelVolume[channel] = vol;
+  mixer::setGain(channel, static_cast<float>(vol) / MAX_VOLUME);
 }
 
 int getChannelVolume(SoundChannel_t channel)
 {
   if(channel == NULL_CHANNEL) return 0;
   assert(ALL_CHANNELS <= channel && channel <= sfxconfiguration._numMixChannels - 1);
+  if(channel == ALL_CHANNELS){
+    int sum = std::accumulate(channelVolume.begin(), channelVolume.end(), 0);
+    return sum / static_cast<int>(channelVolume.size());
+  }
   return channelVolume[channel];
 }
 
+void setChannelPan(SoundChannel_t channel, float pan)
+{
+  if(channel == NULL_CHANNEL) return;
+  assert(ALL_CHANNELS <= channel && channel <= sfxconfiguration._numMixChannels - 1);
+  mixer::setPan(channel, pan);
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////////////
 // MUSIC FUNCTIONS 
 /////////////////////////////////////////////////////////////////////////////////////////////////
 
-static Mix_Music* findMusic(ResourceKey_t musicKey)
+static const MusicResource* findMusic(ResourceKey_t musicKey)
 {
-  if(musicKey == nullResourceKey){
-    log::log(log::WARN, log::msg_sfx_playing_nonexistent_music, std::to_string(musicKey));
-    return nullptr;
-  }
   auto search = music.find(musicKey);
-  if(search == music.end()){
+  if(musicKey == nullResourceKey || search == music.end()){
     log::log(log::WARN, log::msg_sfx_playing_nonexistent_music, std::to_string(musicKey));
     return nullptr;
   }
-  return search->second._music;
-}
-
-static void onMusicPlayError(ResourceKey_t musicKey)
-{
-  std::string addendum{};
-  addendum += std::to_string(musicKey);
-  addendum += " : ";
-  addendum += Mix_GetError();
-  log::log(log::WARN, log::msg_sfx_fail_play_music, addendum);
-}
-
-static void playMusic_(ResourceKey_t musicKey, int loops)
-{
-  Mix_HaltMusic(); // to prevent the mixer play function blocking.
-  Mix_Music* found_music = findMusic(musicKey);
-  if(found_music == nullptr) return;
-  if(Mix_PlayMusic(found_music, loops) != 0) return onMusicPlayError(musicKey);
-}
-
-static void playMusicFadeIn_(ResourceKey_t musicKey, int loops, int fadeDuration_ms)
-{
-  Mix_HaltMusic(); // to prevent the mixer play function blocking.
-  Mix_Music* found_music = findMusic(musicKey);
-  if(found_music == nullptr) return;
-  if(Mix_FadeInMusic(found_music, loops, fadeDuration_ms) != 0)
-      onMusicPlayError(musicKey);
-}
-
-static void stopMusic_()
-{
-  Mix_HaltMusic();
-}
-
-static void stopMusicFadeOut_(int fadeDuration_ms)
-{
-  Mix_FadeOutMusic(fadeDuration_ms);
-}
-
-static void pauseMusic_()
-{
-  Mix_PauseMusic();
-}
-
-static void resumeMusic_()
-{
-  Mix_ResumeMusic();
+  return &search->second;
 }
 
 MusicSequencePlayer::MusicSequencePlayer() :
   _state{STOPPED},
   _sequence{},
-  _currentNode{0},
-  _musicClock_s{0.f},
-  _isLooping{false}
+  _nextNode{0},
+  _isLooping{false},
+  _nextNodeId{0},
+  _queuedNodes{}
 {}
 
-void MusicSequencePlayer::onUpdate(float dt)
-{
-  // note: requires a fading out state here because the SDL_mixer play functions will block
-  // if there is currently music fading out, sleeping until the fade out is complete so it can
-  // start playing the new music. To prevent blocking I wait for the fade out myself without
-  // blocking.
-
-  switch(_state){
-    case PLAYING: 
-      onPlayingUpdate(dt); 
-      break;
-    case FADING_OUT: 
-      onFadingOutUpdate(dt); 
-      break;
-    default:
-      break;
-  }
-}
-
 void MusicSequencePlayer::play(MusicSequence_t sequence, bool loop)
 {
   stop();
   _sequence = std::move(sequence);
-  _currentNode = 0;
-  _musicClock_s = 0.f;
+  _nextNode = 0;
   _isLooping = loop;
-  if(_sequence.size() == 0){ 
-    _state = STOPPED;
+  _state = PLAYING;
+
+  //
+  // Queue the second node straight away so it is waiting on the track however short the
+  // first node is.
+  //
+  if(!queueNextNode()){
+    stop();
     return;
   }
-  playNode(&_sequence[_currentNode]);
+  queueNextNode();
 }
 
 void MusicSequencePlayer::stop()
 {
-  if(_state != STOPPED){
-    _musicClock_s = 0.f;
-    _currentNode = 0;
-    _state = STOPPED;
-    _sequence.clear();
-    stopMusic_();
-  }
+  if(_state == STOPPED)
+    return;
+  mixer::stopTrack();
+  for(auto& node : _queuedNodes)
+    node._isCurrentSequence = false;
+  _sequence.clear();
+  _state = STOPPED;
 }
 
 void MusicSequencePlayer::pause()
 {
   if(_state == PLAYING){
     _state = PAUSED;
-    pauseMusic_();
+    mixer::pauseTrack();
   }
 }
 
@@ -530,71 +723,99 @@ void MusicSequencePlayer::resume()
 {
   if(_state == PAUSED){
     _state = PLAYING;
-    resumeMusic_();
+    mixer::resumeTrack();
   }
 }
 
-bool MusicSequencePlayer::isUsingMusicResource(ResourceKey_t musicKey)
+//
+// Queues the next node of the sequence on the track, skipping nodes whose music is not
+// loaded. Returns false at the end of a sequence which does not loop.
+//
+bool MusicSequencePlayer::queueNextNode()
 {
-  return music.find(musicKey) != music.end();
+  for(size_t attempts = 0; attempts < _sequence.size(); ++attempts){
+    if(_nextNode >= static_cast<int>(_sequence.size())){
+      if(!_isLooping)
+        return false;
+      _nextNode = 0;
+    }
+    const MusicSequenceNode& node = _sequence[_nextNode++];
+    const MusicResource* resource = findMusic(node._musicKey);
+    if(resource == nullptr)
+      continue;
+    uint32_t id = _nextNodeId++;
+    mixer::queueTrackNode(id, resource->_samples.data(), resource->_frameCount, node._fadeInDuration_ms,
+                          (node._playDuration_ms == PLAY_MUSIC_FOREVER) ? mixer::PLAY_FOREVER : node._playDuration_ms,
+                          node._fadeOutDuration_ms);
+    _queuedNodes.push_back(QueuedNode{id, node._musicKey, true, false});
+    return true;
+  }
+  return false;
 }
 
-void MusicSequencePlayer::playNode(const MusicSequenceNode* node)
+int MusicSequencePlayer::countNodesWaiting() const
 {
-  bool result;
-  if(node->_fadeInDuration_ms > 0.f)
-    playMusicFadeIn_(node->_musicKey, INFINITE_LOOPS, node->_fadeInDuration_ms);
-  else
-    playMusic_(node->_musicKey, INFINITE_LOOPS);
-  _state = PLAYING;
+  return static_cast<int>(std::count_if(_queuedNodes.begin(), _queuedNodes.end(), [](const QueuedNode& node){
+    return node._isCurrentSequence && !node._hasStarted;
+  }));
 }
 
-void MusicSequencePlayer::stopNode(const MusicSequenceNode* node)
+void MusicSequencePlayer::onNodeStarted(uint32_t nodeId)
 {
-  if(node->_fadeOutDuration_ms > 0.f) 
-    stopMusicFadeOut_(node->_fadeOutDuration_ms);
-  else 
-    stopMusic_();
-  _state = FADING_OUT;
+  auto search = std::find_if(_queuedNodes.begin(), _queuedNodes.end(), [nodeId](const QueuedNode& node){
+    return node._id == nodeId;
+  });
+  assert(search != _queuedNodes.end());
+  search->_hasStarted = true;
+  if(search->_isCurrentSequence && countNodesWaiting() == 0)
+    queueNextNode();
 }
 
-void MusicSequencePlayer::onPlayingUpdate(float dt)
-{
-  assert(0 <= _currentNode && _currentNode < _sequence.size());
-  const MusicSequenceNode* node {nullptr};
-  node = &_sequence[_currentNode];
-  _musicClock_s += dt;
-  if(_musicClock_s > ((node->_playDuration_ms - node->_fadeOutDuration_ms) / 1000.f)){
-    stopNode(node);
-    _musicClock_s = 0.f;
+void MusicSequencePlayer::onNodeFinished(uint32_t nodeId)
+{
+  auto search = std::find_if(_queuedNodes.begin(), _queuedNodes.end(), [nodeId](const QueuedNode& node){
+    return node._id == nodeId;
+  });
+  assert(search != _queuedNodes.end());
+  _queuedNodes.erase(search);
+
+  //
+  // A sequence which does not loop stops once its last node has finished.
+  //
+  bool isSequenceDone = std::none_of(_queuedNodes.begin(), _queuedNodes.end(), [](const QueuedNode& node){
+    return node._isCurrentSequence;
+  });
+  if(_state != STOPPED && isSequenceDone){
+    _sequence.clear();
+    _state = STOPPED;
   }
 }
 
-void MusicSequencePlayer::onFadingOutUpdate(float dt)
+bool MusicSequencePlayer::isUsingMusicResource(ResourceKey_t musicKey)
 {
-  assert(0 <= _currentNode && _currentNode < _sequence.size());
-  const MusicSequenceNode* node {nullptr};
-  node = &_sequence[_currentNode];
-  _musicClock_s += dt;
-  if(_musicClock_s > ((node->_fadeOutDuration_ms / 1000.f))){
-    ++_currentNode;
-    if(_currentNode >= _sequence.size()){
-      if(!_isLooping) return stop();
-      _currentNode = 0;
-    }
-    node = &_sequence[_currentNode];
-    playNode(node);
-    _musicClock_s = 0.f;
-  }
+  auto usesMusic = [musicKey](const auto& node){return node._musicKey == musicKey;};
+  return std::any_of(_sequence.begin(), _sequence.end(), usesMusic) ||
+         std::any_of(_queuedNodes.begin(), _queuedNodes.end(), usesMusic);
+}
+
+static std::string getMusicPath(const std::string& musicName)
+{
+  std::string wavpath {};
+  wavpath += RESOURCE_PATH_MUSIC;
+  wavpath += musicName;
+  wavpath += io::Wav::FILE_EXTENSION;
+  return wavpath;
 }
 
 ResourceKey_t loadMusicWAV(ResourceName_t musicName)
 {
+  PXR_PROFILE_ZONE("sfx::loadMusicWAV");
   log::log(log::INFO, log::msg_sfx_loading_music, musicName);
 
   for(auto& pair : music){
     if(pair.second._name == musicName){
       pair.second._referenceCount++;
+      cache::onHit(cache::RESOURCE_MUSIC, pair.first);
       std::string addendum {"reference count="};
       addendum += std::to_string(pair.second._referenceCount);
       log::log(log::INFO, log::msg_sfx_music_already_loaded, addendum);
@@ -602,22 +823,27 @@ ResourceKey_t loadMusicWAV(ResourceName_t musicName)
     }
   }
 
-  MusicResource resource {};
-  std::string wavpath {};
-  wavpath += RESOURCE_PATH_MUSIC;
-  wavpath += musicName;
-  wavpath += io::Wav::FILE_EXTENSION;
-  resource._music = Mix_LoadMUS(wavpath.c_str());
-  if(resource._music == nullptr){
-    log::log(log::ERROR, log::msg_sfx_fail_load_music, wavpath + " : " + Mix_GetError());
+  std::string wavpath = getMusicPath(musicName);
+  io::Wav wav {};
+  if(!wav.load(wavpath, sfxconfiguration._samplingFreq_hz, sfxconfiguration._outputMode) || wav.getFrameCount() == 0){
+    log::log(log::ERROR, log::msg_sfx_fail_load_music, wavpath);
     log::log(log::WARN, log::msg_sfx_no_error_music);
     return nullResourceKey;
   }
+
+  MusicResource resource {};
+  resource._samples.assign(wav.getSampleData(), wav.getSampleData() + wav.getSampleCount());
+  resource._frameCount = wav.getFrameCount();
   resource._name = musicName;
   resource._referenceCount = 1;
 
+  //
+  // Moving the resource keeps the samples at the same address; the track points at them.
+  //
   ResourceKey_t newKey = nextResourceKey++;
-  music.emplace(std::make_pair(newKey, resource));
+  int64_t residentBytes = resource._samples.size() * sizeof(int16_t);
+  music.emplace(newKey, std::move(resource));
+  cache::onLoad(cache::RESOURCE_MUSIC, newKey, residentBytes);
 
   std::string addendum{};
   addendum += "[name:key]=[";
@@ -633,20 +859,30 @@ ResourceKey_t loadMusicWAV(ResourceName_t musicName)
 static bool unloadMusic(ResourceKey_t musicKey)
 {
   auto search = music.find(musicKey);
-  if(search == music.end()){
+  if(search == music.end() || search->second._referenceCount <= 0){
     log::log(log::WARN, log::msg_sfx_unloading_nonexistent_music, std::to_string(musicKey));
   }
   else{
     search->second._referenceCount--;
-    if(search->second._referenceCount <= 0){
-      Mix_FreeMusic(search->second._music);
-      music.erase(search);
-      log::log(log::INFO, log::msg_sfx_music_unloaded, std::to_string(musicKey));
+    if(search->second._referenceCount == 0){
+      log::log(log::INFO, log::msg_sfx_release_music, std::to_string(musicKey));
+      cache::onRelease(cache::RESOURCE_MUSIC, musicKey);
     }
   }
   return true;
 }
 
+static bool evictMusic(cache::Key_t musicKey)
+{
+  if(musicSequencePlayer.isUsingMusicResource(musicKey))
+    return false;
+  auto search = music.find(musicKey);
+  assert(search != music.end());
+  music.erase(search);
+  log::log(log::INFO, log::msg_sfx_music_unloaded, std::to_string(musicKey));
+  return true;
+}
+
 static void unloadUnusedMusic()
 {
   if(musicUnloadQueue.size() == 0) return;
@@ -682,22 +918,22 @@ void resumeMusic()
 
 bool isMusicPlaying()
 {
-  return Mix_PlayingMusic() == 1;
+  return musicSequencePlayer.getState() != MusicSequencePlayer::STOPPED;
 }
 
 bool isMusicPaused()
 {
-  return Mix_PausedMusic() == 1;
+  return musicSequencePlayer.getState() == MusicSequencePlayer::PAUSED;
 }
 
 bool isMusicFadingIn()
 {
-  return Mix_FadingMusic() == MIX_FADING_IN;
+  return isMusicPlaying() && mixer::getTrackFading() == mixer::TRACK_FADING_IN;
 }
 
 bool isMusicFadingOut()
 {
-  return Mix_FadingMusic() == MIX_FADING_OUT;
+  return isMusicPlaying() && mixer::getTrackFading() == mixer::TRACK_FADING_OUT;
 }
 
 void setMusicVolume(int volume)
@@ -705,15 +941,86 @@ void setMusicVolume(int volume)
   int vol = std::clamp(volume, MIN_VOLUME, MAX_VOLUME);
   if(vol != musicVolume){
     musicVolume = vol;
-    hasMusicVolumeChanged = true;
+    mixer::setTrackGain(static_cast<float>(musicVolume) / MAX_VOLUME);
   }
 }
 
+void duckMusic(bool isDucked)
+{
+  mixer::setEffectParameter(duckGainEffect, mixer::PARAM_GAIN, isDucked ? PAUSE_DUCK_GAIN : 1.f);
+  mixer::setEffectParameter(duckFilterEffect, mixer::PARAM_MIX, isDucked ? 1.f : 0.f);
+}
+
 int getMusicVolume(int volume)
 {
   return musicVolume;
 }
 
+/////////////////////////////////////////////////////////////////////////////////////////////////
+// OFFLINE RENDERING
+/////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool renderOffline(std::string wavpath, float duration_s, float tickPeriod_s, RenderTick_t onTick)
+{
+  if(!sfxconfiguration._isOffline){
+    log::log(log::ERROR, log::msg_sfx_render_not_offline);
+    return false;
+  }
+  assert(tickPeriod_s > 0.f);
+
+  int numChannels = sfxconfiguration._outputMode;
+  int64_t totalFrames = std::llround(duration_s * static_cast<double>(sfxconfiguration._samplingFreq_hz));
+  std::vector<int16_t> output(totalFrames * numChannels);
+  std::vector<float> block {};
+
+  double clock_s {0.0};
+  int64_t renderedFrames {0};
+  while(renderedFrames < totalFrames){
+    if(onTick != nullptr)
+      onTick(static_cast<float>(clock_s));
+    onUpdate(tickPeriod_s);
+    clock_s += tickPeriod_s;
+
+    //
+    // Ticks need not span a whole number of frames so render up to the frame nearest the new
+    // time; the error never accumulates.
+    //
+    int64_t targetFrames = std::min<int64_t>(totalFrames, std::llround(clock_s * sfxconfiguration._samplingFreq_hz));
+    int frameCount = static_cast<int>(targetFrames - renderedFrames);
+    if(frameCount <= 0)
+      continue;
+    block.assign(frameCount * numChannels, 0.f);
+    mixer::mix(block.data(), frameCount);
+    dsp::convertFloatToS16(block.data(), output.data() + (renderedFrames * numChannels), frameCount * numChannels);
+    renderedFrames = targetFrames;
+  }
+
+  io::Wav wav {};
+  wav.create(std::move(output), sfxconfiguration._samplingFreq_hz, numChannels);
+  if(!wav.save(wavpath))
+    return false;
+
+  std::string addendum {};
+  addendum += std::to_string(duration_s);
+  addendum += ":";
+  addendum += wavpath;
+  log::log(log::INFO, log::msg_sfx_render_offline, addendum);
+  return true;
+}
+
+void advanceOffline(float dt_s)
+{
+  assert(sfxconfiguration._isOffline);
+  offlineClock_s += dt_s;
+  int64_t targetFrames = std::llround(offlineClock_s * sfxconfiguration._samplingFreq_hz);
+  int frameCount = static_cast<int>(targetFrames - offlineFramesMixed);
+  if(frameCount <= 0)
+    return;
+  offlineBlock.assign(frameCount * sfxconfiguration._outputMode, 0.f);
+  mixer::mix(offlineBlock.data(), frameCount);
+  offlineFramesMixed = targetFrames;
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////////////
 // GENERAL FUNCTIONS
 /////////////////////////////////////////////////////////////////////////////////////////////////
@@ -755,53 +1062,216 @@ static void logSpec()
   log::log(log::INFO, "output mode: ", modeString);
 }
 
-bool initialize(SFXConfiguration sfxconf)
+static void initializeChannels()
 {
-  assert(!(SDL_AUDIO_ISFLOAT(sfxconf._sampleFormat)));
-  log::log(log::INFO, log::msg_sfx_initializing);
-  sfxconfiguration = sfxconf;
+  channelPlayback.resize(sfxconfiguration._numMixChannels, nullResourceKey);
+  channelPlayback.shrink_to_fit();
+  channelPriority.resize(sfxconfiguration._numMixChannels, DEFAULT_SOUND_PRIORITY);
+  channelPriority.shrink_to_fit();
+  channelPlayOrder.resize(sfxconfiguration._numMixChannels, 0);
+  channelPlayOrder.shrink_to_fit();
+  channelVolume.resize(sfxconfiguration._numMixChannels, MAX_VOLUME);
+  channelVolume.shrink_to_fit();
+  generateErrorSound();
+  cache::setEvictor(cache::RESOURCE_SOUND, &evictSound);
+  cache::setEvictor(cache::RESOURCE_MUSIC, &evictMusic);
+
+  //
+  // The ducking effects are inserted settled at values which leave the music unaltered, at
+  // which the mixer skips them.
+  //
+  duckGainEffect = mixer::insertEffect(mixer::BUS_MUSIC, mixer::EFFECT_GAIN);
+  mixer::setEffectParameter(duckGainEffect, mixer::PARAM_GLIDE_MS, PAUSE_DUCK_GLIDE_MS);
+  duckFilterEffect = mixer::insertEffect(mixer::BUS_MUSIC, mixer::EFFECT_LOWPASS);
+  mixer::setEffectParameter(duckFilterEffect, mixer::PARAM_GLIDE_MS, PAUSE_DUCK_GLIDE_MS);
+  mixer::setEffectParameter(duckFilterEffect, mixer::PARAM_CUTOFF_HZ, PAUSE_DUCK_CUTOFF_HZ);
+  mixer::setEffectParameter(duckFilterEffect, mixer::PARAM_MIX, 0.f);
+}
+
+//
+// Offline there is no audio device and SDL_mixer is never opened; the mixer is driven by
+// renderOffline in the configured spec.
+//
+static bool initializeOffline()
+{
+  if(!mixer::initialize(sfxconfiguration._samplingFreq_hz, sfxconfiguration._sampleFormat,
+                        sfxconfiguration._outputMode, sfxconfiguration._numMixChannels)){
+    return false;
+  }
+  initializeChannels();
+  return true;
+}
+
+SFXConfiguration makeLowLatencyConfiguration()
+{
+  SFXConfiguration sfxconf {};
+  sfxconf._chunkSize = LOW_LATENCY_CHUNK_SIZE;
+  sfxconf._isAdaptiveChunkSize = true;
+  return sfxconf;
+}
+
+static bool openAudio(int chunkSize)
+{
+  //
+  // The device may start a new audio thread, whose first zone must not allocate.
+  //
+  PXR_PROFILE_RESERVE_THREAD("audio");
   int result = Mix_OpenAudio(
-    sfxconf._samplingFreq_hz, 
-    sfxconf._sampleFormat, 
-    sfxconf._outputMode, 
-    sfxconf._chunkSize
+    sfxconfiguration._samplingFreq_hz, 
+    sfxconfiguration._sampleFormat, 
+    sfxconfiguration._outputMode, 
+    chunkSize
   );
   if(result != 0){
     log::log(log::ERROR, log::msg_sfx_fail_open_audio, std::string{Mix_GetError()});
     return false;
   }
-  Mix_AllocateChannels(sfxconf._numMixChannels);
-  Mix_ChannelFinished(&onChannelFinished);
-  channelPlayback.resize(sfxconf._numMixChannels, nullResourceKey);
-  channelPlayback.shrink_to_fit();
-  channelVolume.resize(sfxconf._numMixChannels, MAX_VOLUME);
-  channelVolume.shrink_to_fit();
-  generateErrorSound(static_cast<SampleFormat>(sfxconf._sampleFormat));
+  return true;
+}
+
+//
+// Reopens the audio device with a larger chunk size. Voices and the music track are
+// unaffected; the mixer keeps its state whilst the device is closed.
+//
+static void growChunkSize()
+{
+  int chunkSize = std::min(sfxconfiguration._chunkSize * 2, sfxconfiguration._maxChunkSize);
+  Mix_CloseAudio();
+  mixer::restartCallbackClock();
+
+  //
+  // The device is reopened in the spec already in use, which the mixer and all loaded sounds
+  // are in.
+  //
+  if(!openAudio(chunkSize) && !openAudio(sfxconfiguration._chunkSize))
+    return;
+  Mix_AllocateChannels(0);
+  Mix_SetPostMix(&mixer::onPostMix, nullptr);
+
+  std::string addendum {};
+  addendum += std::to_string(sfxconfiguration._chunkSize);
+  addendum += "->";
+  addendum += std::to_string(chunkSize);
+  log::log(log::INFO, log::msg_sfx_chunk_size_grown, addendum);
+  sfxconfiguration._chunkSize = chunkSize;
+  ++chunkResizes;
+}
+
+//
+// Grows the chunk size once the device underruns ADAPTIVE_UNDERRUN_THRESHOLD times within
+// ADAPTIVE_WINDOW_S. Underruns just after the device opens are ignored as devices commonly
+// glitch whilst starting.
+//
+static void adaptChunkSize()
+{
+  int64_t underruns = mixer::getCallbackStats()._underruns;
+  if(sfxClock_s < adaptiveGraceEnd_s){
+    adaptiveWindowUnderruns = underruns;
+    adaptiveWindowStart_s = sfxClock_s;
+    return;
+  }
+  if(underruns - adaptiveWindowUnderruns >= ADAPTIVE_UNDERRUN_THRESHOLD){
+    if(sfxconfiguration._chunkSize < sfxconfiguration._maxChunkSize){
+      growChunkSize();
+      adaptiveGraceEnd_s = sfxClock_s + ADAPTIVE_GRACE_S;
+    }
+    adaptiveWindowUnderruns = underruns;
+    adaptiveWindowStart_s = sfxClock_s;
+  }
+  else if(sfxClock_s - adaptiveWindowStart_s > ADAPTIVE_WINDOW_S){
+    adaptiveWindowUnderruns = underruns;
+    adaptiveWindowStart_s = sfxClock_s;
+  }
+}
+
+const SFXConfiguration& getConfiguration()
+{
+  return sfxconfiguration;
+}
+
+AudioStats getAudioStats()
+{
+  mixer::CallbackStats callbackStats = mixer::getCallbackStats();
+  int framesPerCallback = callbackStats._framesPerCallback;
+  if(framesPerCallback == 0)
+    framesPerCallback = sfxconfiguration._chunkSize;
+  AudioStats stats {};
+  stats._callbacks = callbackStats._callbacks;
+  stats._underruns = callbackStats._underruns;
+  stats._chunkResizes = chunkResizes;
+  stats._averageCallback_ms = callbackStats._averageDuration_ms;
+  stats._maxCallback_ms = callbackStats._maxDuration_ms;
+  stats._averageEffects_ms = callbackStats._averageEffectsDuration_ms;
+  stats._callbackPeriod_ms = (framesPerCallback * 1000.f) / sfxconfiguration._samplingFreq_hz;
+  stats._latency_ms = stats._callbackPeriod_ms * 2.f;
+  return stats;
+}
+
+bool initialize(SFXConfiguration sfxconf)
+{
+  assert(!(SDL_AUDIO_ISFLOAT(sfxconf._sampleFormat)));
+  log::log(log::INFO, log::msg_sfx_initializing);
+  sfxconfiguration = sfxconf;
+  sfxconfiguration._maxChunkSize = std::max(sfxconf._chunkSize, sfxconf._maxChunkSize);
+  if(sfxconfiguration._isOffline)
+    return initializeOffline();
+  if(!openAudio(sfxconfiguration._chunkSize))
+    return false;
+
+  //
+  // The device may have been opened with a different sampling rate or channel count to that
+  // requested; sounds must be loaded in the spec actually in use.
+  //
+  int freq, channels; uint16_t format;
+  if(Mix_QuerySpec(&freq, &format, &channels)){
+    sfxconfiguration._samplingFreq_hz = freq;
+    sfxconfiguration._sampleFormat = format;
+    sfxconfiguration._outputMode = channels;
+  }
+
+  //
+  // Sound effects and music are played by the engine's mixer rather than SDL_mixer, which only
+  // runs the audio device and calls the mixer back.
+  //
+  Mix_AllocateChannels(0);
+  if(!mixer::initialize(sfxconfiguration._samplingFreq_hz, sfxconfiguration._sampleFormat,
+                        sfxconfiguration._outputMode, sfxconfiguration._numMixChannels)){
+    Mix_CloseAudio();
+    return false;
+  }
+  Mix_SetPostMix(&mixer::onPostMix, nullptr);
+  initializeChannels();
+  adaptiveGraceEnd_s = sfxClock_s + ADAPTIVE_GRACE_S;
   logSpec();
   return true;
 }
 
 void shutdown()
 {
-  stopChannel(ALL_CHANNELS);
+  if(sfxconfiguration._isOffline){
+    mixer::shutdown();
+    freeErrorSound();
+    sounds.clear();
+    music.clear();
+    return;
+  }
+  Mix_SetPostMix(nullptr, nullptr);
+  mixer::shutdown();
   freeErrorSound();
-  for(auto& pair : sounds)
-    Mix_FreeChunk(pair.second._chunk);
   sounds.clear();
+  music.clear();
   Mix_CloseAudio();
 }
 
 void onUpdate(float dt)
 {
+  PXR_PROFILE_ZONE("sfx::onUpdate");
+  sfxClock_s += dt;
+  drainMixerEvents();
+  if(sfxconfiguration._isAdaptiveChunkSize && !sfxconfiguration._isOffline)
+    adaptChunkSize();
   unloadUnusedSounds();
   unloadUnusedMusic();
-
-  if(hasMusicVolumeChanged && Mix_FadingMusic() == MIX_NO_FADING){
-    Mix_VolumeMusic(musicVolume);
-    hasMusicVolumeChanged = false;
-  }
-
-  musicSequencePlayer.onUpdate(dt);
 }
 
 } // namespace sfx
@@ -0,0 +1,195 @@
+#include <cmath>
+#include <cstdlib>
+#include <cassert>
+#include <algorithm>
+#include <sstream>
+#include "../include/pxr_synth.h"
+#include "../include/pxr_dsp.h"
+
+namespace pxr
+{
+namespace synth
+{
+
+//
+// The noise shift register is clocked this many times per period of the oscillator frequency.
+//
+static constexpr int NOISE_CLOCKS_PER_PERIOD {16};
+
+//
+// The 15-bit linear feedback shift register of the NES noise channel (long mode); the output
+// is the low bit.
+//
+class NoiseRegister
+{
+public:
+  NoiseRegister() : _bits{1} {}
+
+  void clock()
+  {
+    uint16_t feedback = (_bits ^ (_bits >> 1)) & 1;
+    _bits = (_bits >> 1) | (feedback << 14);
+  }
+
+  float getOutput() const {return (_bits & 1) ? 1.f : -1.f;}
+
+private:
+  uint16_t _bits;
+};
+
+//
+// Returns the summed length of the envelope stages, which is unbounded.
+//
+static float sumEnvelope(const Patch& patch)
+{
+  return std::max(0.f, patch._attack_s) + std::max(0.f, patch._decay_s) +
+         std::max(0.f, patch._sustain_s) + std::max(0.f, patch._release_s);
+}
+
+float calculateDuration(const Patch& patch)
+{
+  return std::min(sumEnvelope(patch), MAX_DURATION_S);
+}
+
+//
+// Returns the level of the envelope at time t_s.
+//
+static float calculateEnvelope(const Patch& patch, float t_s)
+{
+  float attack_s = std::max(0.f, patch._attack_s);
+  float decay_s = std::max(0.f, patch._decay_s);
+  float sustain_s = std::max(0.f, patch._sustain_s);
+  float release_s = std::max(0.f, patch._release_s);
+  float sustainLevel = std::clamp(patch._sustainLevel, 0.f, 1.f);
+
+  if(t_s < attack_s)
+    return t_s / attack_s;
+  t_s -= attack_s;
+  if(t_s < decay_s)
+    return 1.f - ((1.f - sustainLevel) * (t_s / decay_s));
+  t_s -= decay_s;
+  if(t_s < sustain_s)
+    return sustainLevel;
+  t_s -= sustain_s;
+  if(t_s < release_s)
+    return sustainLevel * (1.f - (t_s / release_s));
+  return 0.f;
+}
+
+std::vector<int16_t> render(const Patch& patch, int sampleRate_hz, int numChannels)
+{
+  assert(sampleRate_hz > 0);
+  assert(numChannels > 0);
+
+  int frameCount = static_cast<int>(std::lround(calculateDuration(patch) * sampleRate_hz));
+  std::vector<float> mono(frameCount);
+
+  float samplePeriod_s = 1.f / sampleRate_hz;
+  float maxFrequency_hz = std::min(MAX_FREQUENCY_HZ, sampleRate_hz * 0.5f);
+  double frequency_hz = std::clamp(patch._frequency_hz, MIN_FREQUENCY_HZ, maxFrequency_hz);
+  double sweepFactor = std::exp2(static_cast<double>(patch._sweep_oct_per_s) / sampleRate_hz);
+  float duty = std::clamp(patch._duty, MIN_DUTY, MAX_DUTY);
+  float dutyStep = patch._dutySweep_per_s * samplePeriod_s;
+  float volume = std::clamp(patch._volume, 0.f, 1.f);
+
+  //
+  // The phase is in periods, so [0, 1); accumulated in double as rounding errors in the phase
+  // increment would otherwise detune long sounds.
+  //
+  double phase {0.0};
+  NoiseRegister noise {};
+  for(int f = 0; f < frameCount; ++f){
+    float sample {0.f};
+    switch(patch._waveform){
+      case WAVE_SQUARE:   {sample = (phase < 0.5) ? 1.f : -1.f; break;}
+      case WAVE_PULSE:    {sample = (phase < duty) ? 1.f : -1.f; break;}
+      case WAVE_TRIANGLE: {sample = 1.f - (4.f * std::fabs(static_cast<float>(phase) - 0.5f)); break;}
+      case WAVE_NOISE:    {sample = noise.getOutput(); break;}
+    }
+    mono[f] = sample * calculateEnvelope(patch, f * samplePeriod_s) * volume;
+
+    double increment = frequency_hz / sampleRate_hz;
+    if(patch._waveform == WAVE_NOISE){
+      int clocks = static_cast<int>((phase + increment) * NOISE_CLOCKS_PER_PERIOD) -
+                   static_cast<int>(phase * NOISE_CLOCKS_PER_PERIOD);
+      while(clocks-- > 0)
+        noise.clock();
+    }
+    phase += increment;
+    phase -= std::floor(phase);
+
+    frequency_hz = std::clamp<double>(frequency_hz * sweepFactor, MIN_FREQUENCY_HZ, maxFrequency_hz);
+    duty = std::clamp(duty + dutyStep, MIN_DUTY, MAX_DUTY);
+  }
+
+  std::vector<int16_t> pcm(frameCount * numChannels);
+  dsp::convertFloatToS16(mono.data(), pcm.data(), frameCount);
+  if(numChannels > 1){
+    for(int f = frameCount - 1; f >= 0; --f){
+      int16_t sample = pcm[f];
+      std::fill_n(pcm.begin() + (f * numChannels), numChannels, sample);
+    }
+  }
+  return pcm;
+}
+
+bool parsePatch(const std::string& text, Patch& patch)
+{
+  std::istringstream words {text};
+  std::string word {};
+  if(!(words >> word))
+    return false;
+
+  Patch parsed {};
+  if(word == "square")        parsed._waveform = WAVE_SQUARE;
+  else if(word == "pulse")    parsed._waveform = WAVE_PULSE;
+  else if(word == "triangle") parsed._waveform = WAVE_TRIANGLE;
+  else if(word == "noise")    parsed._waveform = WAVE_NOISE;
+  else return false;
+
+  struct Property
+  {
+    const char* _name;
+    float Patch::* _member;
+  };
+
+  static constexpr Property properties[] {
+    {"freq",      &Patch::_frequency_hz},
+    {"sweep",     &Patch::_sweep_oct_per_s},
+    {"duty",      &Patch::_duty},
+    {"dutysweep", &Patch::_dutySweep_per_s},
+    {"attack",    &Patch::_attack_s},
+    {"decay",     &Patch::_decay_s},
+    {"sustain",   &Patch::_sustain_s},
+    {"release",   &Patch::_release_s},
+    {"level",     &Patch::_sustainLevel},
+    {"volume",    &Patch::_volume}
+  };
+
+  while(words >> word){
+    size_t equals = word.find('=');
+    if(equals == std::string::npos)
+      return false;
+    std::string name = word.substr(0, equals);
+    std::string value = word.substr(equals + 1);
+    auto search = std::find_if(std::begin(properties), std::end(properties), [&name](const Property& property){
+      return name == property._name;
+    });
+    if(search == std::end(properties) || value.empty())
+      return false;
+    char* end {nullptr};
+    float number = std::strtof(value.c_str(), &end);
+    if(*end != '\0' || !std::isfinite(number))
+      return false;
+    parsed.*(search->_member) = number;
+  }
+
+  if(sumEnvelope(parsed) > MAX_DURATION_S)
+    return false;
+
+  patch = parsed;
+  return true;
+}
+
+} // namespace synth
+} // namespace pxr
@@ -0,0 +1,133 @@
+#include <atomic>
+#include <array>
+#include <fstream>
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+#include "../include/pxr_telemetry.h"
+#include "../include/pxr_log.h"
+
+namespace pxr
+{
+namespace telemetry
+{
+
+//
+// A ring of samples written by one thread; the samples are atomics only so they can be read
+// by another thread without tearing.
+//
+struct Ring
+{
+  std::array<std::atomic<float>, RING_SIZE> _samples;
+  std::atomic<uint32_t> _count;     // samples ever recorded; the next is written at count % size.
+};
+
+static std::array<Ring, PHASE_COUNT> rings;
+
+void record(Phase phase, float duration_ms)
+{
+  Ring& ring = rings[phase];
+  uint32_t count = ring._count.load(std::memory_order_relaxed);
+  ring._samples[count % RING_SIZE].store(duration_ms, std::memory_order_relaxed);
+  ring._count.store(count + 1, std::memory_order_release);
+}
+
+//
+// Returns the sample at percentile p of the sorted samples; nearest rank.
+//
+static float calculatePercentile(const float* sorted, int numSamples, float p)
+{
+  int rank = static_cast<int>(std::ceil(p * numSamples)) - 1;
+  return sorted[std::clamp(rank, 0, numSamples - 1)];
+}
+
+PhaseStats calculateStats(Phase phase)
+{
+  const Ring& ring = rings[phase];
+  uint32_t count = ring._count.load(std::memory_order_acquire);
+  int numSamples = static_cast<int>(std::min<uint32_t>(count, RING_SIZE));
+
+  PhaseStats stats {};
+  if(numSamples == 0)
+    return stats;
+
+  //
+  // Sorted on the stack (the ring is small) so the engine can redraw its stats every frame
+  // without touching the heap.
+  //
+  std::array<float, RING_SIZE> samples;
+  for(int i = 0; i < numSamples; ++i)
+    samples[i] = ring._samples[i].load(std::memory_order_relaxed);
+  float* first = samples.data();
+  float* last = first + numSamples;
+  std::sort(first, last);
+
+  stats._samples = numSamples;
+  stats._mean_ms = std::accumulate(first, last, 0.f) / numSamples;
+  stats._p50_ms = calculatePercentile(first, numSamples, 0.50f);
+  stats._p95_ms = calculatePercentile(first, numSamples, 0.95f);
+  stats._p99_ms = calculatePercentile(first, numSamples, 0.99f);
+  stats._max_ms = *(last - 1);
+  return stats;
+}
+
+void clear()
+{
+  for(auto& ring : rings)
+    ring._count.store(0, std::memory_order_release);
+}
+
+static void writeCSV(std::ofstream& os)
+{
+  os << "phase,samples,mean_ms,p50_ms,p95_ms,p99_ms,max_ms\n";
+  for(int phase = 0; phase < PHASE_COUNT; ++phase){
+    PhaseStats stats = calculateStats(static_cast<Phase>(phase));
+    os << phaseNames[phase] << ","
+       << stats._samples << ","
+       << stats._mean_ms << ","
+       << stats._p50_ms << ","
+       << stats._p95_ms << ","
+       << stats._p99_ms << ","
+       << stats._max_ms << "\n";
+  }
+}
+
+static void writeJSON(std::ofstream& os)
+{
+  os << "{\n  \"phases\": [\n";
+  for(int phase = 0; phase < PHASE_COUNT; ++phase){
+    PhaseStats stats = calculateStats(static_cast<Phase>(phase));
+    os << "    {\"phase\": \"" << phaseNames[phase] << "\""
+       << ", \"samples\": " << stats._samples
+       << ", \"mean_ms\": " << stats._mean_ms
+       << ", \"p50_ms\": " << stats._p50_ms
+       << ", \"p95_ms\": " << stats._p95_ms
+       << ", \"p99_ms\": " << stats._p99_ms
+       << ", \"max_ms\": " << stats._max_ms
+       << "}" << ((phase < PHASE_COUNT - 1) ? ",\n" : "\n");
+  }
+  os << "  ]\n}\n";
+}
+
+bool exportStats(const std::string& filepath, ExportFormat format)
+{
+  if(format == EXPORT_NONE)
+    return true;
+
+  std::ofstream os {filepath, std::ios_base::trunc};
+  if(!os){
+    log::log(log::ERROR, log::msg_telemetry_fail_export, filepath);
+    return false;
+  }
+
+  if(format == EXPORT_CSV)
+    writeCSV(os);
+  else
+    writeJSON(os);
+
+  log::log(log::INFO, log::msg_telemetry_exported, filepath);
+  return true;
+}
+
+} // namespace telemetry
+} // namespace pxr
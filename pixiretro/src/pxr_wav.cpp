@@ -1,5 +1,10 @@
 #include <fstream>
+#include <chrono>
+#include <cstring>
+#include <cassert>
 #include "../include/pxr_wav.h"
+#include "../include/pxr_dsp.h"
+#include "../include/pxr_adpcm.h"
 #include "../include/pxr_log.h"
 
 namespace pxr
@@ -7,33 +12,118 @@ namespace pxr
 namespace io
 {
 
-Wav::Wav() :
-  _waveData{nullptr},
-  _waveSizeBytes{0},
-  _sampleRate{0},
-  _bitsPerSample{0},
-  _numChannels{0}
-{}
+using Planes_t = std::vector<std::vector<float>>;
 
-Wav::~Wav()
+//
+// Decodes every sample of an interleaved buffer to its planar float channel; decodeSample
+// converts the bytes of a single sample to a float.
+//
+template<typename Decoder>
+static void decodeInterleaved(const uint8_t* raw, int bytesPerSample, int frameCount, Planes_t& planes, Decoder decodeSample)
 {
-  if(_waveData != nullptr){
-    delete[] _waveData;
-    _waveData = nullptr;
+  int numChannels = static_cast<int>(planes.size());
+  for(int c = 0; c < numChannels; ++c){
+    float* plane = planes[c].data();
+    const uint8_t* sample = raw + (c * bytesPerSample);
+    int stride = numChannels * bytesPerSample;
+    for(int f = 0; f < frameCount; ++f, sample += stride)
+      plane[f] = decodeSample(sample);
   }
 }
 
-bool Wav::load(std::string filepath)
+//
+// Converts the raw contents of a data chunk to planar float channels. 16-bit mono and stereo,
+// the common cases, are handled by the vectorized kernels.
+//
+static void decodeToPlanes(const uint8_t* raw, bool isFloat, int bitsPerSample, int frameCount, Planes_t& planes)
 {
-  unload();
+  int numChannels = static_cast<int>(planes.size());
+  int bytesPerSample = bitsPerSample / 8;
+
+  if(isFloat){
+    decodeInterleaved(raw, bytesPerSample, frameCount, planes, [](const uint8_t* p){
+      float f; std::memcpy(&f, p, sizeof(f)); return f;
+    });
+    return;
+  }
 
-  log::log(log::INFO, log::msg_wav_loading, filepath);
+  switch(bitsPerSample){
+    case 8:
+      decodeInterleaved(raw, bytesPerSample, frameCount, planes, [](const uint8_t* p){
+        return (static_cast<int>(p[0]) - 128) * (1.f / 128.f);
+      });
+      break;
+    case 16:
+      if(numChannels == 1){
+        dsp::convertS16ToFloat(reinterpret_cast<const int16_t*>(raw), planes[0].data(), frameCount);
+      }
+      else if(numChannels == 2){
+        dsp::deinterleaveS16Stereo(reinterpret_cast<const int16_t*>(raw), planes[0].data(), planes[1].data(), frameCount);
+      }
+      else {
+        decodeInterleaved(raw, bytesPerSample, frameCount, planes, [](const uint8_t* p){
+          int16_t s; std::memcpy(&s, p, sizeof(s)); return s * (1.f / 32768.f);
+        });
+      }
+      break;
+    case 24:
+      decodeInterleaved(raw, bytesPerSample, frameCount, planes, [](const uint8_t* p){
+        int32_t s = (p[0] << 8) | (p[1] << 16) | (p[2] << 24);
+        return s * (1.f / 2147483648.f);
+      });
+      break;
+    case 32:
+      decodeInterleaved(raw, bytesPerSample, frameCount, planes, [](const uint8_t* p){
+        int32_t s; std::memcpy(&s, p, sizeof(s)); return s * (1.f / 2147483648.f);
+      });
+      break;
+  }
+}
 
-  std::ifstream file {filepath, std::ios::binary};  
-  if(!file){
-    log::log(log::ERROR, log::msg_wav_fail_open, filepath);
-    return false;
+//
+// Mixes the source channels down (or up) to the target channel count.
+//
+static void remapChannels(Planes_t& planes, int targetNumChannels)
+{
+  int numChannels = static_cast<int>(planes.size());
+  if(numChannels == targetNumChannels)
+    return;
+
+  if(targetNumChannels == 1){
+    if(numChannels == 2){
+      dsp::downmixStereoToMono(planes[0].data(), planes[1].data(), planes[0].data(), planes[0].size());
+    }
+    else {
+      float scale = 1.f / numChannels;
+      std::vector<float>& mono = planes[0];
+      for(int c = 1; c < numChannels; ++c)
+        for(size_t f = 0; f < mono.size(); ++f)
+          mono[f] += planes[c][f];
+      for(auto& sample : mono)
+        sample *= scale;
+    }
+    planes.resize(1);
   }
+  else if(targetNumChannels == 2){
+    if(numChannels == 1)
+      planes.push_back(planes[0]);
+    else
+      planes.resize(2);   // keep the front left and right channels.
+  }
+}
+
+Wav::Wav() :
+  _samples{},
+  _sampleRate{0},
+  _bitsPerSample{0},
+  _numChannels{0}
+{}
+
+bool Wav::readLayout(std::ifstream& file, const std::string& filepath, Layout& layout)
+{
+  file.seekg(0, std::ios::end);
+  std::streamoff fileSize = file.tellg();
+  file.seekg(0, std::ios::beg);
 
   auto readFail = [](){
     log::log(log::ERROR, log::msg_wav_read_fail);
@@ -41,128 +131,423 @@ bool Wav::load(std::string filepath)
   };
 
   RiffHeader riff {};
-  if(!file.read(reinterpret_cast<char*>(&riff._riffMagic), sizeof(riff._riffMagic))) return readFail();
+  if(!file.read(reinterpret_cast<char*>(&riff), sizeof(riff))) return readFail();
 
   if(riff._riffMagic != RIFFMAGIC){
     log::log(log::ERROR, log::msg_wav_not_riff);
     return false;
   }
 
-  if(!file.read(reinterpret_cast<char*>(&riff._chunkSize), sizeof(riff._chunkSize))) return readFail();
-  if(!file.read(reinterpret_cast<char*>(&riff._waveMagic), sizeof(riff._waveMagic))) return readFail();
-
   if(riff._waveMagic != WAVEMAGIC){
     log::log(log::ERROR, log::msg_wav_not_wave);
     return false;
   }
 
-  FormatSubChunk fmt {};
-  if(!file.read(reinterpret_cast<char*>(&fmt._formatMagic), sizeof(fmt._formatMagic))) return readFail();
+  //
+  // Walk the chunks to find the format and data chunks, skipping any others. Chunks are word
+  // aligned so odd sized chunks are followed by a pad byte.
+  //
+  FormatChunk& fmt = layout._fmt;
+  fmt = FormatChunk{};
+  layout._samplesPerBlock = 0;
+  bool hasFormat {false};
+  bool hasData {false};
+  int64_t factFrameCount {-1};
+  ChunkHeader chunk {};
+  while(!(hasFormat && hasData) && file.read(reinterpret_cast<char*>(&chunk), sizeof(chunk))){
+    std::streamoff chunkOffset = file.tellg();
+    int64_t chunkSize = static_cast<uint32_t>(chunk._size);
+
+    if(chunk._magic == FORMATMAGIC){
+      if(chunkSize < static_cast<int64_t>(sizeof(FormatChunk))){
+        log::log(log::ERROR, log::msg_wav_bad_fmt_chunk);
+        return false;
+      }
+      if(!file.read(reinterpret_cast<char*>(&fmt), sizeof(fmt))) return readFail();
+      if(fmt._audioFormat == FORMAT_EXTENSIBLE){
+        if(chunkSize < FORMAT_EXTENSIBLE_SIZE){
+          log::log(log::ERROR, log::msg_wav_bad_fmt_chunk);
+          return false;
+        }
+        file.seekg(chunkOffset + FORMAT_EXTENSIBLE_SUBFORMAT_OFFSET);
+        if(!file.read(reinterpret_cast<char*>(&fmt._audioFormat), sizeof(fmt._audioFormat))) return readFail();
+        if(fmt._audioFormat != FORMAT_PCM && fmt._audioFormat != FORMAT_IEEE_FLOAT){
+          log::log(log::ERROR, log::msg_wav_not_pcm);
+          return false;
+        }
+      }
+      else if(fmt._audioFormat == FORMAT_IMA_ADPCM){
+        if(chunkSize < FORMAT_IMA_ADPCM_SIZE){
+          log::log(log::ERROR, log::msg_wav_bad_fmt_chunk);
+          return false;
+        }
+        int16_t samplesPerBlock {0};
+        file.seekg(chunkOffset + FORMAT_IMA_ADPCM_SAMPLES_PER_BLOCK_OFFSET);
+        if(!file.read(reinterpret_cast<char*>(&samplesPerBlock), sizeof(samplesPerBlock))) return readFail();
+        layout._samplesPerBlock = static_cast<uint16_t>(samplesPerBlock);
+      }
+      hasFormat = true;
+    }
+    else if(chunk._magic == FACTMAGIC && chunkSize >= 4){
+      uint32_t sampleLength {0};
+      if(!file.read(reinterpret_cast<char*>(&sampleLength), sizeof(sampleLength))) return readFail();
+      factFrameCount = sampleLength;
+    }
+    else if(chunk._magic == DATAMAGIC){
+      layout._dataOffset = chunkOffset;
+      layout._dataSize = chunkSize;
+      hasData = true;
+    }
 
-  if(fmt._formatMagic != FORMATMAGIC){
-    log::log(log::ERROR, log::msg_wav_fmt_chunk_missing);
-    return false;
+    file.seekg(chunkOffset + chunkSize + (chunkSize & 1));
   }
 
-  if(!file.read(reinterpret_cast<char*>(&fmt._subChunkSize), sizeof(fmt._subChunkSize))) return readFail();
-  if(!file.read(reinterpret_cast<char*>(&fmt._audioFormat), sizeof(fmt._audioFormat))) return readFail();
-  if(!file.read(reinterpret_cast<char*>(&fmt._numChannels), sizeof(fmt._numChannels))) return readFail();
-  if(!file.read(reinterpret_cast<char*>(&fmt._sampleRate), sizeof(fmt._sampleRate))) return readFail();
-  if(!file.read(reinterpret_cast<char*>(&fmt._byteRate), sizeof(fmt._byteRate))) return readFail();
-  if(!file.read(reinterpret_cast<char*>(&fmt._blockAlign), sizeof(fmt._blockAlign))) return readFail();
-  if(!file.read(reinterpret_cast<char*>(&fmt._bitsPerSample), sizeof(fmt._bitsPerSample))) return readFail();
-
-  if(fmt._subChunkSize != 16){
-    log::log(log::ERROR, log::msg_wav_not_pcm);
+  if(!hasFormat){
+    log::log(log::ERROR, log::msg_wav_fmt_chunk_missing);
     return false;
   }
 
-  if(fmt._audioFormat != 1){
-    log::log(log::ERROR, log::msg_wav_bad_compressed);
+  if(fmt._audioFormat != FORMAT_PCM && fmt._audioFormat != FORMAT_IEEE_FLOAT && fmt._audioFormat != FORMAT_IMA_ADPCM){
+    log::log(log::ERROR, log::msg_wav_bad_compressed, std::to_string(fmt._audioFormat));
     return false;
   }
 
-  if(fmt._numChannels != 1 && fmt._numChannels != 2){
+  if(fmt._numChannels < 1 || fmt._numChannels > MAX_CHANNELS){
     log::log(log::ERROR, log::msg_wav_odd_channels, std::to_string(fmt._numChannels));
     return false;
   }
 
-  if(fmt._bitsPerSample != 8 && fmt._bitsPerSample != 16){
+  bool isBitsSupported {false};
+  switch(fmt._audioFormat){
+    case FORMAT_PCM:
+      isBitsSupported = fmt._bitsPerSample == 8 || fmt._bitsPerSample == 16 || fmt._bitsPerSample == 24 || fmt._bitsPerSample == 32;
+      break;
+    case FORMAT_IEEE_FLOAT:
+      isBitsSupported = fmt._bitsPerSample == 32;
+      break;
+    case FORMAT_IMA_ADPCM:
+      isBitsSupported = fmt._bitsPerSample == adpcm::BITS_PER_SAMPLE;
+      break;
+  }
+  if(!isBitsSupported){
     log::log(log::ERROR, log::msg_wav_odd_sample_bits, std::to_string(fmt._bitsPerSample));
     return false;
   }
 
-  _numChannels = fmt._numChannels;
-  _sampleRate = fmt._sampleRate;
-  _bitsPerSample = fmt._bitsPerSample;
+  if(fmt._audioFormat == FORMAT_IMA_ADPCM){
+    int samplesPerBlock = adpcm::calculateSamplesPerBlock(fmt._blockAlign, fmt._numChannels);
+    if(samplesPerBlock == 0 || samplesPerBlock != layout._samplesPerBlock){
+      log::log(log::ERROR, log::msg_wav_odd_block_align, std::to_string(fmt._blockAlign));
+      return false;
+    }
+  }
 
-  DataSubChunk data {};
-  if(!file.read(reinterpret_cast<char*>(&data._dataMagic), sizeof(data._dataMagic))) return readFail();
-  if(!file.read(reinterpret_cast<char*>(&data._subChunkSize), sizeof(data._subChunkSize))) return readFail();
+  //
+  // Uncompressed blocks are single frames; readers size their buffers on that assumption.
+  //
+  else if(fmt._blockAlign != fmt._numChannels * (fmt._bitsPerSample / 8)){
+    log::log(log::ERROR, log::msg_wav_odd_frame_align, std::to_string(fmt._blockAlign));
+    return false;
+  }
 
-  if(data._dataMagic != DATAMAGIC){
+  if(fmt._sampleRate <= 0){
+    log::log(log::ERROR, log::msg_wav_odd_sample_rate, std::to_string(fmt._sampleRate));
+    return false;
+  }
+
+  if(!hasData){
     log::log(log::ERROR, log::msg_wav_data_chunk_missing);
     return false;
   }
 
-  _waveSizeBytes = data._subChunkSize;
+  //
+  // Writers which stream their output may leave the data size unset or too large.
+  //
+  if(layout._dataOffset + layout._dataSize > fileSize){
+    log::log(log::WARN, log::msg_wav_truncated_data, filepath);
+    layout._dataSize = fileSize - layout._dataOffset;
+  }
+
+  if(fmt._audioFormat == FORMAT_IMA_ADPCM){
+    int64_t blockCount = layout._dataSize / fmt._blockAlign;
+    int remainderBytes = static_cast<int>(layout._dataSize % fmt._blockAlign);
+    layout._frameCount = blockCount * layout._samplesPerBlock;
+    if(remainderBytes > 0)
+      layout._frameCount += adpcm::calculateSamplesInBlock(remainderBytes, fmt._numChannels);
+    if(factFrameCount >= 0)
+      layout._frameCount = std::min(layout._frameCount, factFrameCount);
+  }
+  else {
+    layout._frameCount = layout._dataSize / (fmt._numChannels * (fmt._bitsPerSample / 8));
+  }
+
+  file.clear();
+  return true;
+}
+
+bool Wav::load(std::string filepath, int targetSampleRate_hz, int targetNumChannels)
+{
+  unload();
+
+  log::log(log::INFO, log::msg_wav_loading, filepath);
+
+  auto startTime = std::chrono::steady_clock::now();
+
+  if(targetSampleRate_hz < 0 || !(targetNumChannels == KEEP_SOURCE || targetNumChannels == 1 || targetNumChannels == 2)){
+    std::string addendum {std::to_string(targetSampleRate_hz)};
+    addendum += "hz ";
+    addendum += std::to_string(targetNumChannels);
+    addendum += " channels";
+    log::log(log::ERROR, log::msg_wav_odd_target, addendum);
+    return false;
+  }
+
+  std::ifstream file {filepath, std::ios::binary};
+  if(!file){
+    log::log(log::ERROR, log::msg_wav_fail_open, filepath);
+    return false;
+  }
+
+  Layout layout {};
+  if(!readLayout(file, filepath, layout))
+    return false;
+
+  const FormatChunk& fmt = layout._fmt;
+
+  if(layout._dataSize <= 0 || layout._dataSize > SOUND_DATA_SIZE_MAX_BYTES){
+    log::log(log::ERROR, log::msg_wav_odd_data_size, std::to_string(layout._dataSize));
+    return false;
+  }
+
+  int frameCount = static_cast<int>(layout._frameCount);
 
-  if(!(0 < _waveSizeBytes || _waveSizeBytes <= SOUND_DATA_SIZE_MAX_BYTES)){
-    log::log(log::ERROR, log::msg_wav_odd_data_size, std::to_string(_waveSizeBytes));
+  //
+  // Read the whole data chunk in one go.
+  //
+  std::vector<uint8_t> raw(layout._dataSize);
+  file.seekg(layout._dataOffset);
+  if(!file.read(reinterpret_cast<char*>(raw.data()), layout._dataSize)){
+    log::log(log::ERROR, log::msg_wav_read_fail);
     return false;
   }
 
-  _waveData = new char[_waveSizeBytes];
-  
-  if(_numChannels == 1){
-    if(!file.read(_waveData, _waveSizeBytes)){ 
-      delete[] _waveData;
-      return readFail();
+  int sourceNumChannels = fmt._numChannels;
+  int sourceSampleRate = fmt._sampleRate;
+  int sourceBitsPerSample = fmt._bitsPerSample;
+  bool isFloat = fmt._audioFormat == FORMAT_IEEE_FLOAT;
+
+  //
+  // Adpcm is decoded block by block to 16-bit pcm, after which it is treated as any other
+  // 16-bit pcm data.
+  //
+  if(fmt._audioFormat == FORMAT_IMA_ADPCM){
+    int blockAlign = fmt._blockAlign;
+    int64_t blockCount = (layout._dataSize + blockAlign - 1) / blockAlign;
+    std::vector<int16_t> decoded(blockCount * layout._samplesPerBlock * sourceNumChannels);
+    for(int64_t b = 0; b < blockCount; ++b){
+      int64_t offset = b * blockAlign;
+      int blockBytes = static_cast<int>(std::min(int64_t{blockAlign}, layout._dataSize - offset));
+      int16_t* dst = decoded.data() + (b * layout._samplesPerBlock * sourceNumChannels);
+      adpcm::decodeBlock(raw.data() + offset, blockBytes, sourceNumChannels, dst);
     }
+    decoded.resize(frameCount * sourceNumChannels);
+    raw.resize(decoded.size() * sizeof(int16_t));
+    std::memcpy(raw.data(), decoded.data(), raw.size());
+    sourceBitsPerSample = 16;
   }
 
+  _numChannels = (targetNumChannels == KEEP_SOURCE) ? sourceNumChannels : targetNumChannels;
+  _sampleRate = (targetSampleRate_hz == KEEP_SOURCE) ? sourceSampleRate : targetSampleRate_hz;
+  _bitsPerSample = 16;
+
   //
-  // For stereo PCM data we need it in a channel interleaved format; .wav files store channel
-  // data in a non-interleaved format with right channel samples first and then left channels
-  // second.
+  // If the data already matches the target there is nothing to convert.
   //
+  if(!isFloat && sourceBitsPerSample == 16 && _numChannels == sourceNumChannels && _sampleRate == sourceSampleRate){
+    _samples.resize(frameCount * _numChannels);
+    std::memcpy(_samples.data(), raw.data(), _samples.size() * sizeof(int16_t));
+  }
   else {
-    int bytesPerSample = _bitsPerSample / 8;
-    int samplesPerChannel = _waveSizeBytes / (_numChannels * bytesPerSample);
+    Planes_t planes(sourceNumChannels, std::vector<float>(frameCount));
+    decodeToPlanes(raw.data(), isFloat, sourceBitsPerSample, frameCount, planes);
+    raw = std::vector<uint8_t>{};
+
+    remapChannels(planes, _numChannels);
+
+    if(_sampleRate != sourceSampleRate){
+      std::string addendum {std::to_string(sourceSampleRate)};
+      addendum += "hz -> ";
+      addendum += std::to_string(_sampleRate);
+      addendum += "hz";
+      log::log(log::INFO, log::msg_wav_resampling, addendum);
+
+      dsp::Resampler resampler {sourceSampleRate, _sampleRate};
+      frameCount = resampler.calculateOutputCount(frameCount);
+      for(auto& plane : planes){
+        std::vector<float> resampled(frameCount);
+        resampler.resample(plane.data(), static_cast<int>(plane.size()), resampled.data());
+        plane = std::move(resampled);
+      }
+    }
 
-    //
-    // load right channel.
-    //
-    for(int rsample = 1; rsample < samplesPerChannel; rsample += 2){
-      if(!file.read(_waveData + (rsample * bytesPerSample), bytesPerSample)){
-        delete[] _waveData;
-        return readFail();
+    _samples.resize(frameCount * _numChannels);
+    if(_numChannels == 1){
+      dsp::convertFloatToS16(planes[0].data(), _samples.data(), frameCount);
+    }
+    else if(_numChannels == 2){
+      dsp::interleaveFloatToS16Stereo(planes[0].data(), planes[1].data(), _samples.data(), frameCount);
+    }
+    else {
+      std::vector<int16_t> plane16(frameCount);
+      for(int c = 0; c < _numChannels; ++c){
+        dsp::convertFloatToS16(planes[c].data(), plane16.data(), frameCount);
+        for(int f = 0; f < frameCount; ++f)
+          _samples[(f * _numChannels) + c] = plane16[f];
       }
     }
+  }
+
+  auto loadTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime);
+  std::string addendum {filepath};
+  addendum += " in ";
+  addendum += std::to_string(loadTime.count() / 1000.f);
+  addendum += "ms";
+  log::log(log::INFO, log::msg_wav_load_success, addendum);
+
+  return true;
+}
+
+bool Wav::save(std::string filepath, Encoding encoding, int blockAlign) const
+{
+  log::log(log::INFO, log::msg_wav_saving, filepath);
+
+  std::vector<uint8_t> bytes {};
+  if(!encode(bytes, encoding, blockAlign))
+    return false;
+
+  std::ofstream file {filepath, std::ios::binary | std::ios::trunc};
+  if(!file){
+    log::log(log::ERROR, log::msg_wav_fail_create, filepath);
+    return false;
+  }
+
+  file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+  if(!file){
+    log::log(log::ERROR, log::msg_wav_write_fail, filepath);
+    return false;
+  }
+
+  log::log(log::INFO, log::msg_wav_save_success, filepath);
+  return true;
+}
+
+bool Wav::encode(std::vector<uint8_t>& bytes, Encoding encoding, int blockAlign) const
+{
+  int frameCount = getFrameCount();
+
+  FormatChunk fmt {};
+  fmt._numChannels = _numChannels;
+  fmt._sampleRate = _sampleRate;
+
+  std::vector<uint8_t> data {};
+  int samplesPerBlock {0};
+
+  if(encoding == ENCODING_IMA_ADPCM){
+    if(blockAlign == 0)
+      blockAlign = adpcm::DEFAULT_BLOCK_ALIGN_PER_CHANNEL * _numChannels;
+    samplesPerBlock = adpcm::calculateSamplesPerBlock(blockAlign, _numChannels);
+    if(samplesPerBlock == 0){
+      log::log(log::ERROR, log::msg_wav_odd_block_align, std::to_string(blockAlign));
+      return false;
+    }
+
+    fmt._audioFormat = FORMAT_IMA_ADPCM;
+    fmt._blockAlign = blockAlign;
+    fmt._bitsPerSample = adpcm::BITS_PER_SAMPLE;
+    fmt._byteRate = static_cast<int32_t>((static_cast<int64_t>(_sampleRate) * blockAlign) / samplesPerBlock);
 
     //
-    // load left channel.
+    // The last block is padded by repeating the last frame; the fact chunk records the true
+    // length.
     //
-    for(int lsample = 0; lsample < samplesPerChannel; lsample += 2){
-      if(!file.read(_waveData + (lsample * bytesPerSample), bytesPerSample)){
-        delete[] _waveData;
-        return readFail();
+    int blockCount = (frameCount + samplesPerBlock - 1) / samplesPerBlock;
+    data.resize(static_cast<size_t>(blockCount) * blockAlign);
+    std::vector<int16_t> padded(samplesPerBlock * _numChannels);
+    adpcm::ChannelState states[adpcm::MAX_CHANNELS] {};
+    for(int b = 0; b < blockCount; ++b){
+      int firstFrame = b * samplesPerBlock;
+      int blockFrames = std::min(samplesPerBlock, frameCount - firstFrame);
+      const int16_t* src = _samples.data() + (firstFrame * _numChannels);
+      if(blockFrames < samplesPerBlock){
+        std::copy(src, src + (blockFrames * _numChannels), padded.begin());
+        for(int f = blockFrames; f < samplesPerBlock; ++f)
+          std::copy(src + ((blockFrames - 1) * _numChannels), src + (blockFrames * _numChannels), padded.begin() + (f * _numChannels));
+        src = padded.data();
       }
+      adpcm::encodeBlock(src, blockAlign, _numChannels, states, data.data() + (b * blockAlign));
     }
   }
+  else {
+    fmt._audioFormat = FORMAT_PCM;
+    fmt._blockAlign = _numChannels * sizeof(int16_t);
+    fmt._bitsPerSample = 16;
+    fmt._byteRate = _sampleRate * fmt._blockAlign;
+    data.resize(getSampleDataSize());
+    std::memcpy(data.data(), _samples.data(), data.size());
+  }
+
+  bool isADPCM = encoding == ENCODING_IMA_ADPCM;
+  int32_t fmtSize = isADPCM ? FORMAT_IMA_ADPCM_SIZE : static_cast<int32_t>(sizeof(FormatChunk));
+  int32_t factSize = isADPCM ? static_cast<int32_t>(sizeof(ChunkHeader) + sizeof(uint32_t)) : 0;
+  int32_t dataSize = static_cast<int32_t>(data.size());
+
+  RiffHeader riff {RIFFMAGIC, 0, WAVEMAGIC};
+  riff._chunkSize = sizeof(riff._waveMagic) + sizeof(ChunkHeader) + fmtSize + factSize + sizeof(ChunkHeader) + dataSize + (dataSize & 1);
 
-  log::log(log::INFO, log::msg_wav_load_success, filepath);
+  bytes.clear();
+  bytes.reserve(sizeof(RiffHeader) + riff._chunkSize);
+  auto write = [&bytes](const void* src, size_t count){
+    const uint8_t* begin = static_cast<const uint8_t*>(src);
+    bytes.insert(bytes.end(), begin, begin + count);
+  };
+
+  write(&riff, sizeof(riff));
+  ChunkHeader fmtHeader {FORMATMAGIC, fmtSize};
+  write(&fmtHeader, sizeof(fmtHeader));
+  write(&fmt, sizeof(fmt));
+  if(isADPCM){
+    int16_t extension[2] {2, static_cast<int16_t>(samplesPerBlock)};   // {cbSize, wSamplesPerBlock}
+    write(extension, sizeof(extension));
+    ChunkHeader factHeader {FACTMAGIC, sizeof(uint32_t)};
+    uint32_t sampleLength = frameCount;
+    write(&factHeader, sizeof(factHeader));
+    write(&sampleLength, sizeof(sampleLength));
+  }
+  ChunkHeader dataHeader {DATAMAGIC, dataSize};
+  write(&dataHeader, sizeof(dataHeader));
+  write(data.data(), data.size());
+  if(dataSize & 1){
+    uint8_t pad {0};
+    write(&pad, sizeof(pad));
+  }
 
   return true;
 }
 
-void Wav::unload()
+void Wav::create(std::vector<int16_t> samples, int sampleRate_hz, int numChannels)
 {
-  if(_waveData != nullptr)
-    delete[] _waveData;
+  assert(0 < numChannels && numChannels <= MAX_CHANNELS);
+  assert(samples.size() % numChannels == 0);
+  _samples = std::move(samples);
+  _sampleRate = sampleRate_hz;
+  _bitsPerSample = 16;
+  _numChannels = numChannels;
+}
 
-  _waveData = nullptr;
-  _waveSizeBytes = 0;
+void Wav::unload()
+{
+  _samples.clear();
+  _samples.shrink_to_fit();
   _sampleRate = 0;
   _bitsPerSample = 0;
   _numChannels = 0;
@@ -0,0 +1,66 @@
+//
+// Converts bitmap images to qoi images which the pixiretro gfx module loads in preference to
+// bitmaps of the same name.
+//
+// usage: pxr_bmp2qoi <input.bmp> <output.qoi>
+//
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cstdlib>
+#include "pxr_bmp.h"
+#include "pxr_qoi.h"
+
+using namespace pxr;
+
+static int64_t getFileSize(const std::string& filepath)
+{
+  std::ifstream file {filepath, std::ios::binary | std::ios::ate};
+  return file ? static_cast<int64_t>(file.tellg()) : 0;
+}
+
+int main(int argc, char* argv[])
+{
+  if(argc != 3){
+    std::cerr << "usage: " << argv[0] << " <input.bmp> <output.qoi>" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::string inpath {argv[1]};
+  std::string outpath {argv[2]};
+
+  io::Bmp source {};
+  if(!source.load(inpath))
+    return EXIT_FAILURE;
+
+  if(!io::saveQoi(outpath, source))
+    return EXIT_FAILURE;
+
+  //
+  // Qoi is lossless so the result must load back to identical pixels.
+  //
+  io::Bmp result {};
+  if(!io::loadQoi(outpath, result) || result.getWidth() != source.getWidth() || result.getHeight() != source.getHeight()){
+    std::cerr << "failed to verify " << outpath << std::endl;
+    return EXIT_FAILURE;
+  }
+  for(int row = 0; row < source.getHeight(); ++row){
+    for(int col = 0; col < source.getWidth(); ++col){
+      gfx::Color4u a = source.getPixels()[row][col];
+      gfx::Color4u b = result.getPixels()[row][col];
+      if(a._r != b._r || a._g != b._g || a._b != b._b || a._a != b._a){
+        std::cerr << "failed to verify " << outpath << " : pixel mismatch" << std::endl;
+        return EXIT_FAILURE;
+      }
+    }
+  }
+
+  int64_t inSize = getFileSize(inpath);
+  int64_t outSize = getFileSize(outpath);
+  std::cout << inpath << " -> " << outpath << " : "
+            << inSize << " -> " << outSize << " bytes ("
+            << (outSize ? static_cast<double>(inSize) / outSize : 0.0) << ":1)" << std::endl;
+
+  return EXIT_SUCCESS;
+}
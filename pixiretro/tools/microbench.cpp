@@ -0,0 +1,573 @@
+//
+// Microbenchmarks of the engine's hot kernels: bitmap loading, sprite and text drawing, screen
+// clears, pixel collisions, particles, rc loading and random number generation. Where pxr_bench
+// times whole scenes this times the kernels they are built from, one at a time, so a change to
+// a kernel can be measured without the noise of everything around it.
+//
+// usage: pxr_microbench [--baseline <baseline.json>] [--threshold <percent>]
+//                       [--output <results.json>] [--filter <substring>]
+//                       [--samples <count>] [--sample-ms <ms>]
+//
+// Run from the game directory; the sprite and text benchmarks draw the game's spritesheets and
+// fonts (see the constants below), the rc benchmark writes its rc file to the rc directory
+// (and removes it after) and the bmp benchmarks generate their images in the system's temp
+// directory. Gfx runs headless so no window is opened.
+//
+// Every benchmark runs its kernel in batches; the batch size is calibrated so a batch takes at
+// least the sample time (default 10ms) and then the given number of batches (default 15) is
+// timed. A benchmark's result is the median time per call of its batches, which is what is
+// compared against the baseline; the least is reported alongside it.
+//
+// Results go to stdout as json unless an output file is given. A results file is also a
+// baseline: save one with --output, then pass it to later runs with --baseline to have each
+// benchmark compared against it. A benchmark whose median is slower than its baseline by more
+// than the threshold (default 10 percent) is a regression. The comparison is printed to stderr
+// and if there are any regressions the program exits with failure, so it can gate a script.
+// Benchmarks missing from the baseline are reported but never fail. Baselines are only
+// meaningful on the machine (and build type) which made them.
+//
+// A filter runs only the benchmarks whose names contain it, e.g. --filter draw_sprite.
+//
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <algorithm>
+#include <filesystem>
+#include <chrono>
+#include <cstdlib>
+#include <cstdio>
+#include "pxr_gfx.h"
+#include "pxr_bmp.h"
+#include "pxr_collision.h"
+#include "pxr_particle.h"
+#include "pxr_rc.h"
+#include "pxr_rand.h"
+#include "pxr_log.h"
+#include "pxr_cache.h"
+
+using namespace pxr;
+
+//
+// The game assets drawn by the gfx benchmarks.
+//
+static constexpr gfx::ResourceName_t largeSheetName {"foreground"};     // one 200x200 sprite.
+static constexpr gfx::ResourceName_t smallSheetName {"nuggets"};        // 4x4 sprites.
+static constexpr gfx::ResourceName_t fontName {"kongtext"};
+
+static constexpr Vector2i screenSize {200, 200};
+static constexpr Vector2i bmpSize {128, 128};
+
+static constexpr const char* rcFilename {"microbench"};
+
+//
+// Results of kernels are folded into this so the compiler cannot discard the calls.
+//
+static volatile uint32_t sink {0};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+// FIXTURES
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void writeBytes(std::ofstream& os, uint32_t value, int numBytes)
+{
+  for(int i = 0; i < numBytes; ++i)
+    os.put(static_cast<char>((value >> (8 * i)) & 0xff));
+}
+
+//
+// Writes an uncompressed bmp with a v1 info header; indexed depths get a full grey palette.
+// Rows are stored bottom up as most bmps are.
+//
+static bool writeBmp(const std::string& filepath, int bitsPerPixel, Vector2i size)
+{
+  std::ofstream os {filepath, std::ios_base::binary | std::ios_base::trunc};
+  if(!os)
+    return false;
+
+  uint32_t numPaletteColors = (bitsPerPixel <= 8) ? (1u << bitsPerPixel) : 0;
+  uint32_t rowSize_bytes = ((bitsPerPixel * size._x + 31) / 32) * 4;
+  uint32_t pixelOffset_bytes = 14 + 40 + numPaletteColors * 4;
+  uint32_t imageSize_bytes = rowSize_bytes * size._y;
+
+  writeBytes(os, 0x4D42, 2);
+  writeBytes(os, pixelOffset_bytes + imageSize_bytes, 4);
+  writeBytes(os, 0, 4);
+  writeBytes(os, pixelOffset_bytes, 4);
+
+  writeBytes(os, 40, 4);
+  writeBytes(os, size._x, 4);
+  writeBytes(os, size._y, 4);
+  writeBytes(os, 1, 2);
+  writeBytes(os, bitsPerPixel, 2);
+  writeBytes(os, 0, 4);             // BI_RGB.
+  writeBytes(os, imageSize_bytes, 4);
+  writeBytes(os, 2835, 4);
+  writeBytes(os, 2835, 4);
+  writeBytes(os, numPaletteColors, 4);
+  writeBytes(os, 0, 4);
+
+  for(uint32_t i = 0; i < numPaletteColors; ++i){
+    uint32_t grey = (i * 255) / (numPaletteColors - 1);
+    writeBytes(os, grey | (grey << 8) | (grey << 16) | 0xff000000, 4);
+  }
+
+  std::vector<uint8_t> row(rowSize_bytes);
+  for(int y = 0; y < size._y; ++y){
+    std::fill(row.begin(), row.end(), 0);
+    for(int x = 0; x < size._x; ++x){
+      uint32_t value = static_cast<uint32_t>(x * 3 + y * 7);
+      if(bitsPerPixel <= 8){
+        value &= numPaletteColors - 1;
+        int bit = x * bitsPerPixel;
+        row[bit / 8] |= value << (8 - bitsPerPixel - (bit % 8));
+      }
+      else{
+        int pixelSize_bytes = bitsPerPixel / 8;
+        if(bitsPerPixel == 16)
+          value = (value & 0x1f) | ((value & 0x1f) << 5) | ((value & 0x1f) << 10) | 0x8000;
+        else
+          value = (value & 0xff) * 0x010101 | 0xff000000;
+        for(int i = 0; i < pixelSize_bytes; ++i)
+          row[x * pixelSize_bytes + i] = (value >> (8 * i)) & 0xff;
+      }
+    }
+    os.write(reinterpret_cast<const char*>(row.data()), row.size());
+  }
+
+  return static_cast<bool>(os);
+}
+
+//
+// An rc file of the size and mix of types of the engine's.
+//
+class MicrobenchRC final : public io::RC
+{
+public:
+  MicrobenchRC() : RC({
+    {0,  "windowWidth",        1000,  100,  4000},
+    {1,  "windowHeight",       800,   100,  4000},
+    {2,  "fullscreen",         false, false, true},
+    {3,  "tickRate",           60,    1,    1000},
+    {4,  "drawRate",           60,    1,    1000},
+    {5,  "vsync",              true,  false, true},
+    {6,  "maxTicksPerFrame",   5,     1,    100},
+    {7,  "masterVolume",       0.8f,  0.f,  1.f},
+    {8,  "musicVolume",        0.6f,  0.f,  1.f},
+    {9,  "soundVolume",        1.f,   0.f,  1.f},
+    {10, "mixerChannels",      16,    1,    64},
+    {11, "samplingRate",       48000, 8000, 96000},
+    {12, "particleDamping",    0.99f, 0.f,  1.f},
+    {13, "threaded",           false, false, true},
+    {14, "cacheBudgetMB",      64,    1,    4096},
+    {15, "drawStats",          false, false, true}
+  }){}
+};
+
+static gfx::Color4u shadeScanlines(gfx::Color4u color, int pxx, int pxy)
+{
+  if(pxy % 2 == 0)
+    return color;
+  return gfx::Color4u{static_cast<uint8_t>(color._r / 2), static_cast<uint8_t>(color._g / 2),
+                      static_cast<uint8_t>(color._b / 2), color._a};
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+// BENCHMARKS
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+struct Benchmark
+{
+  std::string _name;
+  std::function<void(int64_t)> _run;      // calls the kernel the given number of times.
+};
+
+static std::vector<Benchmark> benchmarks;
+static std::vector<std::string> tempFiles;
+
+static void addBmpBenchmarks()
+{
+  for(int bitsPerPixel : {1, 2, 4, 8, 16, 24, 32}){
+    std::filesystem::path filepath = std::filesystem::temp_directory_path();
+    filepath /= "pxr_microbench_" + std::to_string(bitsPerPixel) + "bpp.bmp";
+    if(!writeBmp(filepath.string(), bitsPerPixel, bmpSize)){
+      std::cerr << "failed to write " << filepath.string() << "; skipping its benchmark" << std::endl;
+      continue;
+    }
+    tempFiles.push_back(filepath.string());
+    benchmarks.push_back({"bmp_load_" + std::to_string(bitsPerPixel) + "bpp", [filepath](int64_t n){
+      io::Bmp bmp {};
+      for(int64_t i = 0; i < n; ++i){
+        bmp.load(filepath.string());
+        sink = sink + bmp.getPixels()[0][0]._r;
+      }
+    }});
+  }
+}
+
+static void addGfxBenchmarks()
+{
+  gfx::ScreenID_t screen = gfx::createScreen(screenSize);
+  gfx::ScreenID_t shadedScreen = gfx::createScreen(screenSize);
+  gfx::setScreenPixelMode(gfx::PixelMode::SHADER, shadedScreen);
+  gfx::setPixelShader(&shadeScanlines, shadedScreen);
+
+  gfx::ResourceKey_t largeSheet = gfx::loadSpritesheet(largeSheetName);
+  gfx::ResourceKey_t smallSheet = gfx::loadSpritesheet(smallSheetName);
+  gfx::ResourceKey_t font = gfx::loadFont(fontName);
+
+  Vector2i largeSize = gfx::getSpriteSize(largeSheet, 0);
+
+  benchmarks.push_back({"draw_sprite", [=](int64_t n){
+    for(int64_t i = 0; i < n; ++i)
+      gfx::drawSprite({0, 0}, largeSheet, 0, screen);
+  }});
+  benchmarks.push_back({"draw_sprite_small", [=](int64_t n){
+    for(int64_t i = 0; i < n; ++i)
+      gfx::drawSprite({static_cast<int>(i % 64) * 3, 100}, smallSheet, 0, screen);
+  }});
+  benchmarks.push_back({"draw_sprite_clipped", [=](int64_t n){
+    Vector2i position {-largeSize._x / 2, -largeSize._y / 2};
+    for(int64_t i = 0; i < n; ++i)
+      gfx::drawSprite(position, largeSheet, 0, screen);
+  }});
+  benchmarks.push_back({"draw_sprite_mirrored", [=](int64_t n){
+    for(int64_t i = 0; i < n; ++i)
+      gfx::drawSprite({0, 0}, largeSheet, 0, screen, true, true);
+  }});
+  benchmarks.push_back({"draw_sprite_shaded", [=](int64_t n){
+    for(int64_t i = 0; i < n; ++i)
+      gfx::drawSprite({0, 0}, largeSheet, 0, shadedScreen);
+  }});
+  benchmarks.push_back({"draw_text", [=](int64_t n){
+    for(int64_t i = 0; i < n; ++i)
+      gfx::drawText({2, 100}, "SCORE 0123456789", font, gfx::colors::white, screen);
+  }});
+  benchmarks.push_back({"clear_screen_transparent", [=](int64_t n){
+    for(int64_t i = 0; i < n; ++i)
+      gfx::clearScreenTransparent(screen);
+  }});
+  benchmarks.push_back({"clear_screen_shade", [=](int64_t n){
+    for(int64_t i = 0; i < n; ++i)
+      gfx::clearScreenShade(static_cast<int>(i % 10), screen);
+  }});
+  benchmarks.push_back({"clear_screen_color", [=](int64_t n){
+    for(int64_t i = 0; i < n; ++i)
+      gfx::clearScreenColor(gfx::colors::barbiepink, screen);
+  }});
+
+  // the large sprites overlap by a quarter of their area.
+  CollisionSubject largeA {{0, 0}, largeSheet, 0};
+  CollisionSubject largeB {{largeSize._x / 2, largeSize._y / 2}, largeSheet, 0};
+  CollisionSubject smallA {{0, 0}, smallSheet, 0};
+  CollisionSubject smallB {{2, 2}, smallSheet, 0};
+
+  benchmarks.push_back({"pixel_intersection", [=](int64_t n){
+    for(int64_t i = 0; i < n; ++i)
+      sink = sink + isPixelIntersection(largeA, largeB)._isCollision;
+  }});
+  benchmarks.push_back({"pixel_intersection_lists", [=](int64_t n){
+    for(int64_t i = 0; i < n; ++i)
+      sink = sink + isPixelIntersection(largeA, largeB, true)._aPixels.size();
+  }});
+  benchmarks.push_back({"pixel_intersection_small", [=](int64_t n){
+    for(int64_t i = 0; i < n; ++i)
+      sink = sink + isPixelIntersection(smallA, smallB)._isCollision;
+  }});
+}
+
+static void addParticleBenchmarks()
+{
+  // the lifetimes outlast any run so the engine stays full.
+  ParticleEngine::Configuration config {};
+  config._maxParticles = ParticleEngine::HARD_MAX_PARTICLES;
+  config._loLifetime = 1e6f;
+  config._hiLifetime = 2e6f;
+
+  benchmarks.push_back({"particle_update", [config](int64_t n){
+    static ParticleEngine engine {config};
+    static bool isSpawned {false};
+    if(!isSpawned){
+      for(int i = 0; i < config._maxParticles; ++i)
+        engine.spawnParticle(Vector2f{100.f, 100.f});
+      isSpawned = true;
+    }
+    for(int64_t i = 0; i < n; ++i)
+      engine.update(1.f / 60.f);
+  }});
+}
+
+static void addRCBenchmarks()
+{
+  MicrobenchRC rc {};
+  if(!rc.write(rcFilename)){
+    std::cerr << "failed to write the rc file; skipping its benchmark" << std::endl;
+    return;
+  }
+  tempFiles.push_back(std::string{io::RESOURCE_PATH_RC} + rcFilename + io::RC::FILE_EXTENSION);
+
+  benchmarks.push_back({"rc_load", [](int64_t n){
+    MicrobenchRC rc {};
+    for(int64_t i = 0; i < n; ++i){
+      rc.load(rcFilename);
+      sink = sink + rc.getIntValue(0);
+    }
+  }});
+}
+
+static void addRandBenchmarks()
+{
+  benchmarks.push_back({"xorwow", [](int64_t n){
+    rand::xorwow generator {};
+    uint32_t sum {0};
+    for(int64_t i = 0; i < n; ++i)
+      sum += generator();
+    sink = sink + sum;
+  }});
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+// MEASUREMENT
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+struct Result
+{
+  std::string _name;
+  int64_t _iterations;        // per batch.
+  double _ns_per_op;          // median of the batches.
+  double _min_ns_per_op;
+  double _baseline_ns_per_op; // 0 if not in the baseline.
+  double _change_pct;
+  bool _isRegression;
+};
+
+using Clock_t = std::chrono::steady_clock;
+
+static double timeBatch(const Benchmark& benchmark, int64_t iterations)
+{
+  auto start = Clock_t::now();
+  benchmark._run(iterations);
+  auto end = Clock_t::now();
+  return std::chrono::duration<double, std::nano>(end - start).count();
+}
+
+static Result measure(const Benchmark& benchmark, int numSamples, double sample_ms)
+{
+  double sample_ns = sample_ms * 1e6;
+
+  // grow the batch until it fills a sample; also warms the caches.
+  int64_t iterations {1};
+  double elapsed_ns = timeBatch(benchmark, iterations);
+  while(elapsed_ns < sample_ns){
+    double scale = (elapsed_ns > 0.0) ? (sample_ns / elapsed_ns) * 1.2 : 100.0;
+    iterations = static_cast<int64_t>(iterations * std::clamp(scale, 2.0, 100.0));
+    elapsed_ns = timeBatch(benchmark, iterations);
+  }
+
+  std::vector<double> ns_per_op {};
+  for(int s = 0; s < numSamples; ++s)
+    ns_per_op.push_back(timeBatch(benchmark, iterations) / iterations);
+  std::sort(ns_per_op.begin(), ns_per_op.end());
+
+  Result result {};
+  result._name = benchmark._name;
+  result._iterations = iterations;
+  result._ns_per_op = ns_per_op[ns_per_op.size() / 2];
+  result._min_ns_per_op = ns_per_op.front();
+  return result;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+// BASELINE
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+//
+// Reads the medians of a results file; expects a benchmark per line as writeResults writes.
+//
+static bool loadBaseline(const std::string& filepath, std::unordered_map<std::string, double>& baseline)
+{
+  std::ifstream file {filepath};
+  if(!file){
+    std::cerr << "failed to open baseline " << filepath << std::endl;
+    return false;
+  }
+  static constexpr const char* nameKey {"\"name\": \""};
+  static constexpr const char* nsKey {"\"ns_per_op\": "};
+  std::string line {};
+  while(std::getline(file, line)){
+    size_t namePos = line.find(nameKey);
+    size_t nsPos = line.find(nsKey);
+    if(namePos == std::string::npos || nsPos == std::string::npos)
+      continue;
+    namePos += std::char_traits<char>::length(nameKey);
+    size_t nameEnd = line.find('"', namePos);
+    if(nameEnd == std::string::npos)
+      continue;
+    nsPos += std::char_traits<char>::length(nsKey);
+    baseline[line.substr(namePos, nameEnd - namePos)] = std::strtod(line.c_str() + nsPos, nullptr);
+  }
+  return true;
+}
+
+static int compareBaseline(std::vector<Result>& results,
+                           const std::unordered_map<std::string, double>& baseline,
+                           float threshold_pct)
+{
+  int numRegressions {0};
+  for(Result& result : results){
+    auto search = baseline.find(result._name);
+    if(search == baseline.end() || search->second <= 0.0)
+      continue;
+    result._baseline_ns_per_op = search->second;
+    result._change_pct = (result._ns_per_op - search->second) / search->second * 100.0;
+    result._isRegression = result._change_pct > threshold_pct;
+    if(result._isRegression)
+      ++numRegressions;
+  }
+  return numRegressions;
+}
+
+static void printComparison(const std::vector<Result>& results, float threshold_pct)
+{
+  std::cerr << std::fixed << std::setprecision(1)
+            << std::left << std::setw(28) << "benchmark" << std::right
+            << std::setw(14) << "baseline ns" << std::setw(14) << "current ns"
+            << std::setw(10) << "change" << std::endl;
+  for(const Result& result : results){
+    std::cerr << std::left << std::setw(28) << result._name << std::right;
+    if(result._baseline_ns_per_op > 0.0){
+      std::cerr << std::setw(14) << result._baseline_ns_per_op
+                << std::setw(14) << result._ns_per_op
+                << std::setw(9) << std::showpos << result._change_pct << std::noshowpos << "%"
+                << (result._isRegression ? "  REGRESSION" : "");
+    }
+    else
+      std::cerr << std::setw(14) << "-" << std::setw(14) << result._ns_per_op << "  not in baseline";
+    std::cerr << std::endl;
+  }
+  std::cerr << "threshold " << threshold_pct << "%" << std::endl;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////
+// OUTPUT
+//////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void writeResults(std::ostream& os, const std::vector<Result>& results, int numSamples,
+                         double sample_ms, bool hasBaseline, float threshold_pct, int numRegressions)
+{
+  os << "{\n"
+     << "  \"samples\": " << numSamples << ",\n"
+     << "  \"sample_ms\": " << sample_ms << ",\n";
+  if(hasBaseline){
+    os << "  \"threshold_pct\": " << threshold_pct << ",\n"
+       << "  \"regressions\": " << numRegressions << ",\n";
+  }
+  os << "  \"benchmarks\": [\n";
+  for(size_t r = 0; r < results.size(); ++r){
+    const Result& result = results[r];
+    os << "    {\"name\": \"" << result._name << "\""
+       << ", \"iterations\": " << result._iterations
+       << ", \"ns_per_op\": " << result._ns_per_op
+       << ", \"min_ns_per_op\": " << result._min_ns_per_op;
+    if(result._baseline_ns_per_op > 0.0){
+      os << ", \"baseline_ns_per_op\": " << result._baseline_ns_per_op
+         << ", \"change_pct\": " << result._change_pct
+         << ", \"regression\": " << (result._isRegression ? "true" : "false");
+    }
+    os << "}" << ((r < results.size() - 1) ? ",\n" : "\n");
+  }
+  os << "  ]\n}\n";
+}
+
+int main(int argc, char* argv[])
+{
+  if(argc % 2 != 1){
+    std::cerr << "usage: " << argv[0] << " [--baseline <baseline.json>] [--threshold <percent>] "
+              << "[--output <results.json>] [--filter <substring>] [--samples <count>] "
+              << "[--sample-ms <ms>]" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::string baselinepath {};
+  std::string outpath {};
+  std::string filter {};
+  float threshold_pct {10.f};
+  int numSamples {15};
+  double sample_ms {10.0};
+  for(int a = 1; a + 1 < argc; a += 2){
+    std::string option {argv[a]};
+    if(option == "--baseline")
+      baselinepath = argv[a + 1];
+    else if(option == "--threshold")
+      threshold_pct = std::max(0.f, static_cast<float>(std::atof(argv[a + 1])));
+    else if(option == "--output")
+      outpath = argv[a + 1];
+    else if(option == "--filter")
+      filter = argv[a + 1];
+    else if(option == "--samples")
+      numSamples = std::max(1, std::atoi(argv[a + 1]));
+    else if(option == "--sample-ms")
+      sample_ms = std::max(0.1, std::atof(argv[a + 1]));
+    else{
+      std::cerr << "unknown option " << option << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  std::unordered_map<std::string, double> baseline {};
+  if(!baselinepath.empty() && !loadBaseline(baselinepath, baseline))
+    return EXIT_FAILURE;
+
+  log::initialize();
+  cache::initialize();
+  if(!gfx::initialize("pxr_microbench", screenSize, false, true)){
+    std::cerr << "failed to initialize gfx" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  addBmpBenchmarks();
+  addGfxBenchmarks();
+  addParticleBenchmarks();
+  addRCBenchmarks();
+  addRandBenchmarks();
+
+  std::vector<Result> results {};
+  for(const Benchmark& benchmark : benchmarks){
+    if(!filter.empty() && benchmark._name.find(filter) == std::string::npos)
+      continue;
+    std::cerr << "running " << benchmark._name << std::endl;
+    results.push_back(measure(benchmark, numSamples, sample_ms));
+  }
+
+  for(const std::string& filepath : tempFiles)
+    std::remove(filepath.c_str());
+
+  gfx::shutdown();
+  cache::shutdown();
+  log::shutdown();
+
+  int numRegressions = compareBaseline(results, baseline, threshold_pct);
+  if(!baselinepath.empty())
+    printComparison(results, threshold_pct);
+
+  if(outpath.empty())
+    writeResults(std::cout, results, numSamples, sample_ms, !baselinepath.empty(), threshold_pct, numRegressions);
+  else{
+    std::ofstream os {outpath, std::ios_base::trunc};
+    if(!os){
+      std::cerr << "failed to open " << outpath << std::endl;
+      return EXIT_FAILURE;
+    }
+    writeResults(os, results, numSamples, sample_ms, !baselinepath.empty(), threshold_pct, numRegressions);
+  }
+
+  if(numRegressions > 0){
+    std::cerr << numRegressions << " benchmark(s) regressed beyond " << threshold_pct << "%" << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
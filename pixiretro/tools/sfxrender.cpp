@@ -0,0 +1,183 @@
+//
+// Renders a scripted sequence of sounds and music through the pixiretro sfx module to a wave
+// file, faster than real time and without an audio device. Renders are deterministic so can
+// be diffed against reference renders to catch regressions in the mixer, and the reported
+// realtime factor measures mixer throughput.
+//
+// usage: pxr_sfxrender <script> <output.wav> [sampling rate hz] [mono|stereo]
+//
+// Run from the game directory so sounds and music load from their usual paths. The script
+// holds one command per line; blank lines and lines starting with '#' are ignored:
+//
+//    duration <seconds>                          the length of the render (default 10).
+//    tick <seconds>                              the tick period (default 1/60).
+//    channels <count>                            the number of mixer voices.
+//    <time_s> sound <name> [loops] [volume] [pan]
+//    <time_s> synth <name> <patch>                 plays a synthesized sound; see pxr_synth.h
+//                                                 for the patch text, e.g. square freq=440
+//    <time_s> music <name> <fadein_ms> <play_ms> <fadeout_ms> [<name> ...]
+//    <time_s> stopmusic
+//    <time_s> stopall
+//
+// Times are on the render clock; commands run on the first tick at or after their time.
+//
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include "pxr_sfx.h"
+#include "pxr_synth.h"
+#include "pxr_log.h"
+#include "pxr_cache.h"
+
+using namespace pxr;
+
+struct Command
+{
+  float _time_s;
+  std::vector<std::string> _args;
+};
+
+static std::vector<Command> commands;
+static size_t nextCommand {0};
+static std::vector<sfx::ResourceKey_t> loadedSounds;
+static std::vector<sfx::ResourceKey_t> loadedMusic;
+
+static void runCommand(const Command& command)
+{
+  const std::vector<std::string>& args = command._args;
+  const std::string& verb = args[0];
+  if(verb == "sound" && args.size() >= 2){
+    sfx::ResourceKey_t key = sfx::loadSoundWAV(args[1].c_str());
+    loadedSounds.push_back(key);
+    int loops = (args.size() > 2) ? std::stoi(args[2]) : sfx::NO_LOOPS;
+    sfx::SoundChannel_t channel = sfx::playSound(key, loops);
+    if(args.size() > 3)
+      sfx::setChannelVolume(channel, std::stoi(args[3]));
+    if(args.size() > 4)
+      sfx::setChannelPan(channel, std::stof(args[4]));
+  }
+  else if(verb == "synth" && args.size() >= 3){
+    std::string text {};
+    for(size_t a = 2; a < args.size(); ++a)
+      text += args[a] + " ";
+    synth::Patch patch {};
+    if(!synth::parsePatch(text, patch)){
+      std::cerr << "ignoring malformed patch '" << text << "' at " << command._time_s << "s" << std::endl;
+      return;
+    }
+    sfx::ResourceKey_t key = sfx::loadSoundSynth(args[1].c_str(), patch);
+    loadedSounds.push_back(key);
+    sfx::playSound(key);
+  }
+  else if(verb == "music" && args.size() >= 5){
+    sfx::MusicSequence_t sequence {};
+    for(size_t a = 1; a + 3 < args.size(); a += 4){
+      sfx::ResourceKey_t key = sfx::loadMusicWAV(args[a].c_str());
+      loadedMusic.push_back(key);
+      sequence.push_back({key, std::stoi(args[a + 1]), std::stoi(args[a + 2]), std::stoi(args[a + 3])});
+    }
+    sfx::playMusic(std::move(sequence));
+  }
+  else if(verb == "stopmusic"){
+    sfx::stopMusic();
+  }
+  else if(verb == "stopall"){
+    sfx::stopChannel(sfx::ALL_CHANNELS);
+  }
+  else{
+    std::cerr << "ignoring unknown command '" << verb << "' at " << command._time_s << "s" << std::endl;
+  }
+}
+
+static void onTick(float clock_s)
+{
+  while(nextCommand < commands.size() && commands[nextCommand]._time_s <= clock_s)
+    runCommand(commands[nextCommand++]);
+}
+
+int main(int argc, char* argv[])
+{
+  if(argc < 3 || argc > 5){
+    std::cerr << "usage: " << argv[0] << " <script> <output.wav> [sampling rate hz] [mono|stereo]" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::string scriptpath {argv[1]};
+  std::string outpath {argv[2]};
+
+  sfx::SFXConfiguration sfxconf {};
+  sfxconf._isOffline = true;
+  if(argc > 3)
+    sfxconf._samplingFreq_hz = std::atoi(argv[3]);
+  if(argc > 4)
+    sfxconf._outputMode = (std::string{argv[4]} == "stereo") ? sfx::STEREO : sfx::MONO;
+
+  float duration_s {10.f};
+  float tickPeriod_s {1.f / 60.f};
+
+  std::ifstream script {scriptpath};
+  if(!script){
+    std::cerr << "failed to open script " << scriptpath << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::string line {};
+  while(std::getline(script, line)){
+    std::istringstream words {line};
+    std::string first {};
+    if(!(words >> first) || first[0] == '#')
+      continue;
+    if(first == "duration"){
+      words >> duration_s;
+      continue;
+    }
+    if(first == "tick"){
+      words >> tickPeriod_s;
+      continue;
+    }
+    if(first == "channels"){
+      words >> sfxconf._numMixChannels;
+      continue;
+    }
+    Command command {std::stof(first), {}};
+    std::string word {};
+    while(words >> word)
+      command._args.push_back(word);
+    if(!command._args.empty())
+      commands.push_back(std::move(command));
+  }
+  std::stable_sort(commands.begin(), commands.end(), [](const Command& a, const Command& b){
+    return a._time_s < b._time_s;
+  });
+
+  log::initialize();
+  cache::initialize();
+  if(!sfx::initialize(sfxconf)){
+    std::cerr << "failed to initialize sfx" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  bool result = sfx::renderOffline(outpath, duration_s, tickPeriod_s, &onTick);
+  auto end = std::chrono::steady_clock::now();
+  double wall_s = std::chrono::duration<double>(end - start).count();
+
+  const sfx::PlaybackStats& stats = sfx::getPlaybackStats();
+  std::cout << scriptpath << " -> " << outpath << " : "
+            << duration_s << "s rendered in " << wall_s << "s ("
+            << (wall_s > 0.0 ? duration_s / wall_s : 0.0) << "x realtime)" << std::endl
+            << "played " << stats._played << ", stolen " << stats._stolen
+            << ", dropped (cooldown " << stats._droppedCooldown
+            << ", instances " << stats._droppedInstances
+            << ", no channel " << stats._droppedNoChannel << ")" << std::endl;
+
+  sfx::shutdown();
+  cache::shutdown();
+  log::shutdown();
+  return result ? EXIT_SUCCESS : EXIT_FAILURE;
+}
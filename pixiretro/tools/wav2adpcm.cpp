@@ -0,0 +1,70 @@
+//
+// Converts wave sound files to ima adpcm wave files, which the pixiretro sfx module loads
+// (decoding them to 16-bit pcm at load time) at a quarter of the size on disk.
+//
+// usage: pxr_wav2adpcm <input.wav> <output.wav> [block align bytes]
+//
+// The sampling rate and channel count of the input are kept; convert the input to the
+// rate the game mixes at beforehand for the smallest files.
+//
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cstdlib>
+#include <cmath>
+#include "pxr_wav.h"
+
+using namespace pxr;
+
+static int64_t getFileSize(const std::string& filepath)
+{
+  std::ifstream file {filepath, std::ios::binary | std::ios::ate};
+  return file ? static_cast<int64_t>(file.tellg()) : 0;
+}
+
+int main(int argc, char* argv[])
+{
+  if(argc < 3 || argc > 4){
+    std::cerr << "usage: " << argv[0] << " <input.wav> <output.wav> [block align bytes]" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::string inpath {argv[1]};
+  std::string outpath {argv[2]};
+  int blockAlign = (argc == 4) ? std::atoi(argv[3]) : 0;
+
+  io::Wav source {};
+  if(!source.load(inpath))
+    return EXIT_FAILURE;
+
+  if(!source.save(outpath, io::Wav::ENCODING_IMA_ADPCM, blockAlign))
+    return EXIT_FAILURE;
+
+  //
+  // Decode the result to report the coding error.
+  //
+  io::Wav result {};
+  if(!result.load(outpath) || result.getSampleCount() != source.getSampleCount()){
+    std::cerr << "failed to verify " << outpath << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  double errorSquareSum {0.0};
+  const int16_t* a = source.getSampleData();
+  const int16_t* b = result.getSampleData();
+  for(int s = 0; s < source.getSampleCount(); ++s){
+    double error = static_cast<double>(a[s]) - b[s];
+    errorSquareSum += error * error;
+  }
+  double rmsError = std::sqrt(errorSquareSum / std::max(1, source.getSampleCount()));
+
+  int64_t inSize = getFileSize(inpath);
+  int64_t outSize = getFileSize(outpath);
+  std::cout << inpath << " -> " << outpath << " : "
+            << inSize << " -> " << outSize << " bytes ("
+            << (outSize ? static_cast<double>(inSize) / outSize : 0.0) << ":1), rms error "
+            << rmsError << std::endl;
+
+  return EXIT_SUCCESS;
+}